@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""AST 节点分配方式的对比：每个节点的堆分配次数和语法分析耗时。
+
+用法: bench/arena_alloc.py <compiler> [--baseline <compiler>] [--size KB]
+                           [--runs N] [shape ...]
+
+对每种形状（默认 bench/gen_sysy.py 的全部形状）生成 size KB 的程序，
+每个编译器只做语法分析（不加输出选项），报告
+  allocs     : 整个进程的 malloc/calloc/realloc 次数，由脚本临时编译的
+               LD_PRELOAD 计数库统计，新旧编译器用同一种办法计数
+  allocs/node: 上一项除以语法树节点数。节点数取 -ast 输出中以 ':' 结尾的
+               非终结符行数，与编译器内部怎样建树无关，新旧版本的分母相同
+  ms         : 进程墙钟时间（含启动和退出时释放整棵树）跑 runs 次的中位数，
+               旧版本没有 --stats-json，所以不用 parse 阶段的计时
+--baseline 给出用 arena 之前的编译器，例如
+  git worktree add /tmp/base 869b53f && cmake -S /tmp/base -B /tmp/base/build
+  && cmake --build /tmp/base/build
+旧版本的命令行只有 compiler [-ast] <file>，-ast 写到当前目录的 example/ 下，
+所以脚本在临时目录里运行两个编译器。
+"""
+import argparse
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_sysy  # noqa: E402
+
+COUNTER = r"""
+#include <stdio.h>
+#include <stdlib.h>
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+static unsigned long long count;
+
+void *malloc(size_t n) { count++; return __libc_malloc(n); }
+void *calloc(size_t n, size_t m) { count++; return __libc_calloc(n, m); }
+void *realloc(void *p, size_t n) { count++; return __libc_realloc(p, n); }
+
+__attribute__((destructor)) static void report(void) {
+  const char *path = getenv("ALLOC_COUNT_FILE");
+  FILE *f = path ? fopen(path, "w") : NULL;
+  if (f) { fprintf(f, "%llu\n", count); fclose(f); }
+}
+"""
+
+
+def build_counter(tmp):
+    src = os.path.join(tmp, "count.c")
+    lib = os.path.join(tmp, "count.so")
+    with open(src, "w") as f:
+        f.write(COUNTER)
+    subprocess.run(["cc", "-O2", "-shared", "-fPIC", "-o", lib, src],
+                   check=True)
+    return lib
+
+
+def count_nodes(compiler, path, tmp):
+    """-ast 输出中非终结符的行数"""
+    subprocess.run([compiler, "-ast", path], cwd=tmp, check=True,
+                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    nodes = 0
+    ast = os.path.join(tmp, "example", os.path.basename(path) + ".ast.txt")
+    with open(ast, "rb") as f:
+        for line in f:
+            nodes += line.rstrip().endswith(b":")
+    return nodes
+
+
+def count_allocs(compiler, path, tmp, lib):
+    out = os.path.join(tmp, "allocs.txt")
+    env = dict(os.environ, LD_PRELOAD=lib, ALLOC_COUNT_FILE=out)
+    subprocess.run([compiler, path], cwd=tmp, env=env, check=True,
+                   stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    with open(out) as f:
+        return int(f.read())
+
+
+def parse_ms(compiler, path, tmp, runs):
+    times = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        subprocess.run([compiler, path], cwd=tmp, check=True,
+                       stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        times.append((time.perf_counter() - start) * 1000)
+    return statistics.median(times)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="AST 节点的分配次数和解析耗时")
+    parser.add_argument("compiler")
+    parser.add_argument("--baseline", help="用 arena 之前的编译器")
+    parser.add_argument("--size", type=int, default=4096, help="每种形状的 KB 数")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("shapes", nargs="*")
+    args = parser.parse_intermixed_args()
+    compilers = [("new", os.path.abspath(args.compiler))]
+    if args.baseline:
+        compilers.insert(0, ("base", os.path.abspath(args.baseline)))
+
+    with tempfile.TemporaryDirectory() as tmp:
+        lib = build_counter(tmp)
+        os.makedirs(os.path.join(tmp, "example"))
+        print("%-12s%-6s%10s%12s%12s%10s" %
+              ("shape", "build", "nodes", "allocs", "allocs/node", "ms"))
+        for shape in args.shapes or gen_sysy.SHAPES:
+            path = os.path.join(tmp, shape + ".sy")
+            with open(path, "w") as f:
+                f.write(gen_sysy.generate(shape, args.size))
+            nodes = count_nodes(compilers[-1][1], path, tmp)
+            for name, compiler in compilers:
+                allocs = count_allocs(compiler, path, tmp, lib)
+                ms = parse_ms(compiler, path, tmp, args.runs)
+                print("%-12s%-6s%10d%12d%12.2f%10.1f" %
+                      (shape, name, nodes, allocs, allocs / max(nodes, 1), ms),
+                      flush=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""词法分析、语法分析和 AST 输出的吞吐量基准，结果与保存的基线比较。
+
+用法: bench/compiler_bench.py <compiler> [--size KB] [--runs N] [--warmup N]
+                              [--json out.json] [--baseline bench/baseline.json]
+                              [--threshold 0.15] [--update-baseline]
+
+对 bench/gen_sysy.py 的每种形状生成 size KB 的程序，分别运行
+  lex  : compiler -lex，取 scan 阶段
+  parse: compiler（不加输出选项，只做语法分析），取 parse 阶段
+         （已扣除扫描时间）和 AST 节点数
+  print: compiler -ast，取 print 阶段
+每项先跑 warmup 次丢弃，再跑 runs 次取耗时的中位数，峰值内存取最大值，
+报告 MB/s（按源文件大小）、节点/s 和峰值 RSS。结果写到 --json；
+有基线时逐项比较，吞吐下降或峰值内存上升超过 threshold 的标为 REGRESSION
+并以 1 退出。--update-baseline 用这次的结果覆盖基线文件。
+基线与机器有关，换机器后应先在旧版本上重新生成。
+"""
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_sysy  # noqa: E402
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+MODES = [("lex", ["-lex"], "scan"), ("parse", [], "parse"),
+         ("print", ["-ast"], "print")]
+
+
+def run_once(compiler, flags, path, tmp):
+    stats = os.path.join(tmp, "stats.json")
+    subprocess.run([compiler] + flags + ["-o", tmp, "--stats-json", stats, path],
+                   check=True, stdout=subprocess.DEVNULL,
+                   stderr=subprocess.DEVNULL)
+    with open(stats) as f:
+        return json.load(f)
+
+
+def measure(compiler, flags, phase, path, tmp, runs, warmup):
+    for _ in range(warmup):
+        run_once(compiler, flags, path, tmp)
+    times, rss, nodes = [], 0, 0
+    for _ in range(runs):
+        data = run_once(compiler, flags, path, tmp)
+        times.append(data["phases"][phase]["wall_ms"])
+        rss = max(rss, data["peak_rss_kb"])
+        nodes = sum(n for k, n in data.get("nodes", {}).items() if "/" not in k)
+    ms = statistics.median(times)
+    size = os.path.getsize(path)
+    result = {"ms": ms, "mb_per_s": size / (1024 * 1024) / (ms / 1000),
+              "peak_rss_kb": rss}
+    if nodes > 0:
+        result["nodes"] = nodes
+        result["nodes_per_s"] = nodes / (ms / 1000)
+    return result
+
+
+def compare(results, baseline, threshold):
+    """返回回归项的描述列表"""
+    regressions = []
+    for key, result in results.items():
+        old = baseline.get(key)
+        if old is None:
+            continue
+        if result["mb_per_s"] < old["mb_per_s"] * (1 - threshold):
+            regressions.append("%s: %.1f MB/s, baseline %.1f MB/s" %
+                               (key, result["mb_per_s"], old["mb_per_s"]))
+        if result["peak_rss_kb"] > old["peak_rss_kb"] * (1 + threshold):
+            regressions.append("%s: peak RSS %d KB, baseline %d KB" %
+                               (key, result["peak_rss_kb"], old["peak_rss_kb"]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="前端吞吐量基准")
+    parser.add_argument("compiler")
+    parser.add_argument("--size", type=int, default=2048, help="每种形状的 KB 数")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--warmup", type=int, default=1)
+    parser.add_argument("--json", help="结果写到这个文件")
+    parser.add_argument("--baseline",
+                        default=os.path.join(ROOT, "bench", "baseline.json"))
+    parser.add_argument("--threshold", type=float, default=0.15)
+    parser.add_argument("--update-baseline", action="store_true")
+    args = parser.parse_args()
+    compiler = os.path.abspath(args.compiler)
+
+    baseline = {}
+    if os.path.exists(args.baseline) and not args.update_baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)["results"]
+
+    results = {}
+    print("%-20s%10s%10s%14s%12s%10s" %
+          ("shape/mode", "ms", "MB/s", "nodes/s", "RSS KB", "vs base"))
+    with tempfile.TemporaryDirectory() as tmp:
+        for shape in gen_sysy.SHAPES:
+            path = os.path.join(tmp, shape + ".sy")
+            with open(path, "w") as f:
+                f.write(gen_sysy.generate(shape, args.size))
+            for mode, flags, phase in MODES:
+                key = "%s/%s" % (shape, mode)
+                r = measure(compiler, flags, phase, path, tmp, args.runs,
+                            args.warmup)
+                results[key] = r
+                old = baseline.get(key)
+                delta = ("%+9.1f%%" % (100 * (r["mb_per_s"] / old["mb_per_s"] - 1))
+                         if old else "%10s" % "-")
+                print("%-20s%10.2f%10.1f%14s%12d%s" %
+                      (key, r["ms"], r["mb_per_s"],
+                       "%.3g" % r["nodes_per_s"] if "nodes_per_s" in r else "-",
+                       r["peak_rss_kb"], delta), flush=True)
+
+    report = {"size_kb": args.size, "runs": args.runs, "warmup": args.warmup,
+              "results": results}
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("baseline written to %s" % args.baseline)
+        return 0
+    regressions = compare(results, baseline, args.threshold)
+    for line in regressions:
+        print("REGRESSION " + line)
+    if not baseline:
+        print("no baseline at %s" % args.baseline)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
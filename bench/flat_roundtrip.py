@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""连续存储的 AST（-flat）和磁盘 AST 缓存（-ast-cache）的往返检查与耗时。
+
+用法: bench/flat_roundtrip.py <compiler> [--size KB] [--corrupt N] [--runs N]
+                             [corpus ...]
+
+输入为 bench/gen_sysy.py 的每种形状（size KB）、几个括号嵌套超过 255 层的
+程序，以及给出的 corpus（.sy 文件或目录）。每个输入要求
+  -ast -flat              （指针树 -> FlatAST，由 FlatPrinter 直接输出）
+  -ast -ast-cache <dir>   （第一次写入缓存，第二次从缓存读出）
+的输出都与直接 -ast 逐字节相同，第二次运行必须命中缓存（没有 parse 阶段）。
+之后把缓存文件截断或随机改写若干字节，共 corrupt 次，每次编译器都不能崩溃，
+输出仍要与直接 -ast 相同（损坏的缓存按未命中处理）。
+报告冷启动时 scan + parse、-flat 的 flat 阶段和命中缓存时 cache 阶段的
+耗时，各取 runs 次的中位数；命中缓存应当比 scan + parse 快。
+"""
+import argparse
+import json
+import os
+import random
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_sysy  # noqa: E402
+
+PARENS = [256, 300, 1000]
+
+
+def deep_parens(depth):
+    return ("int main() {\n  int a = %s1%s;\n  return %sa + 2%s * 3;\n}\n" %
+            ("(" * depth, ")" * depth, "(" * depth, ")" * depth))
+
+
+def run(compiler, flags, path, out_dir):
+    """返回 (退出码, AST 文本, 各阶段耗时)"""
+    stats = os.path.join(out_dir, "stats.json")
+    ast = os.path.join(out_dir, os.path.basename(path) + ".ast.txt")
+    for name in (stats, ast):
+        if os.path.exists(name):
+            os.remove(name)
+    proc = subprocess.run([compiler, "-ast", "-o", out_dir, "--stats-json",
+                           stats] + flags + [path],
+                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    text, phases = None, {}
+    if os.path.exists(ast):
+        with open(ast, "rb") as f:
+            text = f.read()
+    if os.path.exists(stats):
+        with open(stats) as f:
+            phases = {k: v["wall_ms"] for k, v in json.load(f)["phases"].items()}
+    return proc.returncode, text, phases
+
+
+def collect(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                files += [os.path.join(root, n) for n in sorted(names)
+                          if n.endswith(".sy")]
+        else:
+            files.append(path)
+    return files
+
+
+def corrupt(rng, data):
+    """截断，或改写几个随机字节"""
+    if rng.random() < 0.3:
+        return data[:rng.randrange(len(data))]
+    data = bytearray(data)
+    for _ in range(rng.randint(1, 4)):
+        data[rng.randrange(len(data))] ^= 1 << rng.randrange(8)
+    return bytes(data)
+
+
+def median_ms(compiler, flags, path, tmp, runs, names):
+    """重复运行 runs 次，names 中各阶段之和的中位数"""
+    return statistics.median(
+        sum(run(compiler, flags, path, tmp)[2].get(name, 0) for name in names)
+        for _ in range(runs))
+
+
+def check(compiler, path, tmp, corruptions, runs):
+    """返回 (出错信息列表, scan + parse ms, flat ms, 命中缓存的 cache ms)"""
+    problems = []
+    rc, ref, _ = run(compiler, [], path, tmp)
+    cold_ms = median_ms(compiler, [], path, tmp, runs, ["scan", "parse"])
+    _, flat, _ = run(compiler, ["-flat"], path, tmp)
+    if flat != ref:
+        problems.append("-flat output differs")
+    flat_ms = median_ms(compiler, ["-flat"], path, tmp, runs, ["flat"])
+    cache = os.path.join(tmp, "cache")
+    shutil.rmtree(cache, ignore_errors=True)
+    os.makedirs(cache)
+    run(compiler, ["-ast-cache", cache], path, tmp)
+    _, hit, phases = run(compiler, ["-ast-cache", cache], path, tmp)
+    if hit != ref:
+        problems.append("cached output differs")
+    if rc == 0 and "parse" in phases:
+        problems.append("second run missed the cache")
+    hit_ms = median_ms(compiler, ["-ast-cache", cache], path, tmp, runs,
+                       ["cache"])
+
+    entries = [os.path.join(cache, n) for n in os.listdir(cache)
+               if n.endswith(".ast")]
+    rng = random.Random(path)
+    for entry in entries:
+        with open(entry, "rb") as f:
+            original = f.read()
+        for _ in range(corruptions):
+            with open(entry, "wb") as f:
+                f.write(corrupt(rng, original))
+            code, text, _ = run(compiler, ["-ast-cache", cache], path, tmp)
+            if code < 0 or text != ref:
+                problems.append("corrupted cache entry: exit %d, output %s" %
+                                (code, "same" if text == ref else "differs"))
+                break
+            # 未命中时会重新写入完好的缓存，下一次从原文件重新改
+    return problems, cold_ms, flat_ms, hit_ms
+
+
+def main():
+    parser = argparse.ArgumentParser(description="FlatAST 与 AST 缓存往返检查")
+    parser.add_argument("compiler")
+    parser.add_argument("--size", type=int, default=1024, help="每种形状的 KB 数")
+    parser.add_argument("--corrupt", type=int, default=20,
+                        help="每个缓存文件的损坏次数")
+    parser.add_argument("--runs", type=int, default=3, help="计时的运行次数")
+    parser.add_argument("corpus", nargs="*")
+    args = parser.parse_intermixed_args()
+    compiler = os.path.abspath(args.compiler)
+    failed = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        inputs = []
+        for shape in gen_sysy.SHAPES:
+            path = os.path.join(tmp, shape + ".sy")
+            with open(path, "w") as f:
+                f.write(gen_sysy.generate(shape, args.size))
+            inputs.append(path)
+        for depth in PARENS:
+            path = os.path.join(tmp, "parens%d.sy" % depth)
+            with open(path, "w") as f:
+                f.write(deep_parens(depth))
+            inputs.append(path)
+        inputs += collect(args.corpus)
+
+        print("%-20s%10s%10s%10s" % ("input", "cold ms", "flat ms", "hit ms"))
+        for path in inputs:
+            problems, cold, flat, hit = check(compiler, path, tmp,
+                                              args.corrupt, args.runs)
+            print("%-20s%10.2f%10.2f%10.2f" %
+                  (os.path.basename(path)[:19], cold, flat, hit), flush=True)
+            for problem in problems:
+                print("  %s: %s" % (path, problem))
+            failed += len(problems) > 0
+        print("round trip: %d inputs, %d failures" % (len(inputs), failed))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""生成指定大小和形状的 SysY 程序，供吞吐量基准使用。
+
+用法: bench/gen_sysy.py <shape> <size_kb> [-o out.sy] [--seed N]
+
+形状：
+  functions  : 大量小函数，每个有几条语句、局部数组和对前面函数的调用
+  nesting    : 深层嵌套的 if/while/块
+  expressions: 很长的算术和逻辑表达式链
+  arrays     : 带大初始化列表的一维和多维全局数组
+  mixed      : 以上几种轮流出现
+生成的程序能通过语义分析，同样的参数和种子得到同样的内容。
+"""
+import argparse
+import random
+import sys
+
+SHAPES = ["functions", "nesting", "expressions", "arrays", "mixed"]
+
+
+class Generator:
+    def __init__(self, seed):
+        self.rng = random.Random(seed)
+        self.out = []
+        self.size = 0
+        self.funcs = 0
+        self.globals = 0
+
+    def emit(self, line):
+        self.out.append(line)
+        self.size += len(line) + 1
+
+    def number(self):
+        return str(self.rng.randint(0, 999))
+
+    def expr(self, names, terms):
+        """names 中的变量和常量组成的 terms 项算术表达式"""
+        ops = ["+", "-", "*", "/", "%"]
+        parts = [self.rng.choice(names)]
+        for _ in range(terms - 1):
+            op = self.rng.choice(ops)
+            # 除数用非零常量，避免运行时除零
+            operand = (str(self.rng.randint(1, 97)) if op in "/%"
+                       else self.rng.choice(names + [self.number()]))
+            parts.append(op)
+            parts.append(operand)
+        return " ".join(parts)
+
+    def function(self):
+        name = "f%d" % self.funcs
+        self.emit("int %s(int p, int q[]) {" % name)
+        self.emit("  int a = p, b = q[0], t[4] = {1, 2, 3, 4};")
+        for _ in range(self.rng.randint(2, 6)):
+            self.emit("  a = %s;" % self.expr(["a", "b", "p", "t[1]"], 5))
+            self.emit("  if (a > b) b = b + t[%d]; else b = a;" %
+                      self.rng.randint(0, 3))
+        if self.funcs > 0:
+            self.emit("  b = b + f%d(a %% 10, q);" %
+                      self.rng.randint(0, self.funcs - 1))
+        self.emit("  return a + b;")
+        self.emit("}")
+        self.funcs += 1
+
+    def nesting(self, depth=48):
+        name = "f%d" % self.funcs
+        self.emit("int %s(int p, int q[]) {" % name)
+        self.emit("  int a = p, b = 0;")
+        for d in range(depth):
+            pad = "  " * (d + 1)
+            kind = d % 3
+            if kind == 0:
+                self.emit("%sif (a > %d) {" % (pad, d))
+            elif kind == 1:
+                self.emit("%swhile (b < %d) {" % (pad, d))
+                self.emit("%s  b = b + 1;" % pad)
+            else:
+                self.emit("%s{" % pad)
+                self.emit("%s  int a = b + %d;" % (pad, d))
+            self.emit("%s  b = b + a %% %d;" % (pad, d + 2))
+        for d in reversed(range(depth)):
+            self.emit("  " * (d + 1) + "}")
+        self.emit("  return a + b;")
+        self.emit("}")
+        self.funcs += 1
+
+    def expressions(self, terms=400):
+        name = "f%d" % self.funcs
+        self.emit("int %s(int p, int q[]) {" % name)
+        self.emit("  int a = p, b = q[1], c = 3;")
+        for _ in range(4):
+            self.emit("  a = %s;" % self.expr(["a", "b", "c", "p"], terms))
+            conds = ["a > %s" % self.number() for _ in range(terms // 8)]
+            self.emit("  if (%s) b = b + 1;" % " && ".join(conds))
+            conds = ["b != %s" % self.number() for _ in range(terms // 8)]
+            self.emit("  if (%s) c = c - 1;" % " || ".join(conds))
+        self.emit("  return a + b + c;")
+        self.emit("}")
+        self.funcs += 1
+
+    def array(self, count=4096):
+        name = "g%d" % self.globals
+        if self.globals % 2 == 0:
+            values = ", ".join(self.number() for _ in range(count))
+            self.emit("int %s[%d] = {%s};" % (name, count, values))
+        else:
+            rows = count // 16
+            body = ", ".join(
+                "{%s}" % ", ".join(self.number() for _ in range(16))
+                for _ in range(rows))
+            self.emit("int %s[%d][16] = {%s};" % (name, rows, body))
+        self.globals += 1
+
+    def generate(self, shape, size):
+        step = {
+            "functions": self.function,
+            "nesting": self.nesting,
+            "expressions": self.expressions,
+            "arrays": self.array,
+        }
+        order = SHAPES[:-1] if shape == "mixed" else [shape]
+        i = 0
+        while self.size < size:
+            step[order[i % len(order)]]()
+            i += 1
+        self.emit("int main() {")
+        self.emit("  int q[4] = {1, 2, 3, 4};")
+        self.emit("  int s = 0;")
+        if self.funcs > 0:
+            self.emit("  s = f%d(1, q);" % (self.funcs - 1))
+        self.emit("  putint(s);")
+        self.emit("  return 0;")
+        self.emit("}")
+        return "\n".join(self.out) + "\n"
+
+
+def generate(shape, size_kb, seed=1):
+    return Generator(seed).generate(shape, size_kb * 1024)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="生成 SysY 基准程序")
+    parser.add_argument("shape", choices=SHAPES)
+    parser.add_argument("size_kb", type=int)
+    parser.add_argument("-o", dest="out")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    text = generate(args.shape, args.size_kb, args.seed)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""按函数增量编译的基准：大文件中改动一个函数后重新编译。
+
+用法: bench/incremental_edit.py <compiler> [funcs] [stmts]
+
+生成一个有 funcs 个函数的 SysY 程序（每个函数有循环和 stmts 条算术语句，
+另有一个被所有函数调用的小工具函数 helper），用 compiler -O -S -func-cache
+依次编译：
+  cold  : 空缓存
+  warm  : 源文件不变
+  edit  : 改动中间某个函数里的一个常量
+  helper: 改动 helper（它被内联进所有调用者，这些函数都要重新生成）
+每步报告墙钟时间、缓存命中数和命中率，并与不带缓存的完整编译对比时间，
+检查生成的汇编与完整编译逐字节相同。
+"""
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def generate(funcs, stmts, edit=None, helper=1):
+    out = ["int g[256];",
+           "int helper(int x) { return x * %d + 1; }" % helper]
+    for f in range(funcs):
+        c = 7 if f != edit else 8
+        out.append("int f%d(int n) {" % f)
+        out.append("  int i = 0, s = %d, x = n;" % f)
+        out.append("  while (i < n) {")
+        for k in range(stmts):
+            out.append("    x = x * %d + s / %d - i;" % ((f + k) % 13 + 1, k % 5 + 1))
+            out.append("    if (x > %d) s = s + x %% %d; else s = s - %d;" %
+                       (1000 + k * f, k % 11 + 2, c))
+        out.append("    g[(i + %d) %% 256] = helper(s);" % f)
+        out.append("    i = i + 1;")
+        out.append("  }")
+        out.append("  return s + x;")
+        out.append("}")
+    out.append("int main() {")
+    out.append("  int s = 0;")
+    for f in range(funcs):
+        out.append("  s = s + f%d(%d);" % (f, f % 3 + 1))
+    out.append("  putint(s);")
+    out.append("  return 0;")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def compile_once(compiler, path, out_dir, cache):
+    """返回 (墙钟 ms, 命中数, 未命中数, 汇编内容)"""
+    stats = os.path.join(out_dir, "stats.json")
+    command = [compiler, "-O", "-S", "-o", out_dir, "--stats-json", stats]
+    if cache is not None:
+        command += ["-func-cache", cache]
+    start = time.perf_counter()
+    subprocess.run(command + [path], check=True)
+    ms = (time.perf_counter() - start) * 1000
+    with open(stats) as f:
+        data = json.load(f)
+    with open(os.path.join(out_dir, os.path.basename(path) + ".s"), "rb") as f:
+        asm = f.read()
+    return ms, data["func_cache_hits"], data["func_cache_misses"], asm
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    compiler = os.path.abspath(sys.argv[1])
+    funcs = int(sys.argv[2]) if len(sys.argv) > 2 else 1000
+    stmts = int(sys.argv[3]) if len(sys.argv) > 3 else 8
+    steps = [("cold", {}), ("warm", {}), ("edit", {"edit": funcs // 2}),
+             ("helper", {"edit": funcs // 2, "helper": 3})]
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "big.sy")
+        cache = os.path.join(tmp, "cache")
+        print("%-8s%12s%12s%8s%8s%8s%10s" %
+              ("step", "full ms", "incr ms", "hits", "misses", "hit%",
+               "speedup"))
+        for name, args in steps:
+            with open(path, "w") as f:
+                f.write(generate(funcs, stmts, **args))
+            full = compile_once(compiler, path, tmp, None)
+            incr = compile_once(compiler, path, tmp, cache)
+            if incr[3] != full[3]:
+                sys.stderr.write("%s: assembly differs from a full build\n" % name)
+                failed += 1
+            total = incr[1] + incr[2]
+            print("%-8s%12.1f%12.1f%8d%8d%7.1f%%%9.2fx" %
+                  (name, full[0], incr[0], incr[1], incr[2],
+                   100.0 * incr[1] / total if total else 0, full[0] / incr[0]),
+                  flush=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""-jit 周转时间基准：进程内 JIT 与“生成汇编 -> 汇编链接 -> 运行”两条路径对比。
+
+用法: bench/jit_turnaround.py <compiler> [prog.sy ...]
+
+默认测 bench/kernels 下的内核。每个程序分别：
+  jit   : compiler -O -jit，首条指令时间取 --stats-json 中的 jit_first_insn_ms
+  native: compiler -O -S，gcc 汇编并链接预先编好的 runtime/sylib.o，再运行；
+          首条指令时间记为编译加汇编链接的时间（不含新进程的启动）
+各跑 3 次取最短的墙钟时间；两条路径的输出和返回值不一致时报错。需要 PATH 中有 gcc。
+"""
+import glob
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+RUNS = 3
+
+
+def timed(command, stdout=subprocess.DEVNULL):
+    start = time.perf_counter()
+    proc = subprocess.run(command, stdin=subprocess.DEVNULL, stdout=stdout,
+                          stderr=subprocess.PIPE)
+    return (time.perf_counter() - start) * 1000, proc
+
+
+def jit(compiler, path, tmp):
+    """返回 (首条指令 ms, 总时间 ms, 输出)"""
+    stats = os.path.join(tmp, "stats.json")
+    ms, proc = timed([compiler, "-O", "-jit", "--stats-json", stats, path],
+                     stdout=subprocess.PIPE)
+    with open(stats) as f:
+        first = json.load(f)["jit_first_insn_ms"]
+    return first, ms, (proc.returncode, proc.stdout)
+
+
+def native(compiler, path, tmp, obj):
+    """返回 (首条指令 ms, 总时间 ms, 输出)；失败时返回 None"""
+    asm = os.path.join(tmp, os.path.basename(path) + ".s")
+    exe = os.path.join(tmp, "prog")
+    compile_ms, proc = timed([compiler, "-O", "-S", "-o", tmp, path])
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stderr.decode())
+        return None
+    link_ms, proc = timed(["gcc", asm, obj, "-o", exe])
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stderr.decode())
+        return None
+    run_ms, proc = timed([exe], stdout=subprocess.PIPE)
+    first = compile_ms + link_ms
+    return first, first + run_ms, (proc.returncode, proc.stdout)
+
+
+def best(results):
+    """各项分别取最小值，输出取最后一次"""
+    return (min(r[0] for r in results), min(r[1] for r in results),
+            results[-1][2])
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    compiler = os.path.abspath(sys.argv[1])
+    programs = sys.argv[2:] or sorted(
+        glob.glob(os.path.join(ROOT, "bench", "kernels", "*.sy")))
+    print("%-12s%14s%14s%14s%14s%10s" %
+          ("program", "jit first", "jit total", "native first",
+           "native total", "speedup"))
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        obj = os.path.join(tmp, "sylib.o")
+        subprocess.run(["gcc", "-O2", "-c",
+                        os.path.join(ROOT, "runtime", "sylib.c"), "-o", obj],
+                       check=True)
+        for path in programs:
+            name = os.path.splitext(os.path.basename(path))[0]
+            jits = [jit(compiler, path, tmp) for _ in range(RUNS)]
+            natives = [native(compiler, path, tmp, obj) for _ in range(RUNS)]
+            if None in natives:
+                failed += 1
+                continue
+            j, n = best(jits), best(natives)
+            if j[2] != n[2]:
+                sys.stderr.write("%s: outputs differ\n" % name)
+                failed += 1
+            print("%-12s%11.1f ms%11.1f ms%11.1f ms%11.1f ms%9.1fx" %
+                  (name, j[0], j[1], n[0], n[1], n[1] / j[1]), flush=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
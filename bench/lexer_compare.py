@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""比较手写 SIMD 词法分析器（-fast-lex）和 flex 生成的扫描器。
+
+用法: bench/lexer_compare.py <compiler> [--size KB] [--runs N] [corpus ...]
+
+差分检查：对 bench/gen_sysy.py 的每种形状和给出的 corpus（.sy 文件或目录），
+两种词法分析器各用 -tokens 写出 token 流（行号、种类、值），要求逐行相同，
+标准输出上的 "Mysterious character" 报错也要相同。
+吞吐量：每种形状 size KB，各跑 runs 次 -lex，取 scan 阶段的中位数报告 MB/s
+和 token/s。
+"""
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_sysy  # noqa: E402
+
+LEXERS = [("flex", []), ("simd", ["-fast-lex"])]
+
+
+def tokens(compiler, flags, path, out_dir):
+    """返回 (标准输出, token 流)"""
+    proc = subprocess.run([compiler, "-tokens", "-o", out_dir] + flags + [path],
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    with open(os.path.join(out_dir, os.path.basename(path) + ".tokens.txt"),
+              "rb") as f:
+        return proc.stdout, f.read()
+
+
+def scan_ms(compiler, flags, path, out_dir):
+    stats = os.path.join(out_dir, "stats.json")
+    subprocess.run([compiler, "-lex", "--stats-json", stats] + flags + [path],
+                   check=True, stdout=subprocess.DEVNULL,
+                   stderr=subprocess.DEVNULL)
+    with open(stats) as f:
+        return json.load(f)["phases"]["scan"]["wall_ms"]
+
+
+def collect(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                files += [os.path.join(root, n) for n in sorted(names)
+                          if n.endswith(".sy")]
+        else:
+            files.append(path)
+    return files
+
+
+def main():
+    parser = argparse.ArgumentParser(description="SIMD 词法分析器与 flex 对比")
+    parser.add_argument("compiler")
+    parser.add_argument("--size", type=int, default=4096, help="每种形状的 KB 数")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("corpus", nargs="*")
+    args = parser.parse_intermixed_args()
+    compiler = os.path.abspath(args.compiler)
+    failed = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        generated = []
+        print("%-12s%-6s%10s%10s%14s%9s" %
+              ("shape", "lexer", "ms", "MB/s", "tokens/s", "speedup"))
+        for shape in gen_sysy.SHAPES:
+            path = os.path.join(tmp, shape + ".sy")
+            with open(path, "w") as f:
+                f.write(gen_sysy.generate(shape, args.size))
+            generated.append(path)
+            size = os.path.getsize(path)
+            count = tokens(compiler, [], path, tmp)[1].count(b"\n")
+            base = None
+            for name, flags in LEXERS:
+                ms = statistics.median(scan_ms(compiler, flags, path, tmp)
+                                       for _ in range(args.runs))
+                base = base or ms
+                print("%-12s%-6s%10.2f%10.1f%14.3g%8.2fx" %
+                      (shape, name, ms, size / (1024 * 1024) / (ms / 1000),
+                       count / (ms / 1000), base / ms), flush=True)
+
+        files = collect(args.corpus)
+        for path in generated + files:
+            results = [tokens(compiler, flags, path, tmp) for _, flags in LEXERS]
+            if results[0] != results[1]:
+                print("%s: token streams differ" % path)
+                failed += 1
+        print("differential: %d files, %d mismatches" %
+              (len(generated) + len(files), failed))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
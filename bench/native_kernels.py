@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""x86-64 后端基准：把 bench/kernels 下的内核编译成可执行文件并与 gcc 对比运行时间。
+
+用法: bench/native_kernels.py <compiler> [kernel.sy ...]
+
+每个内核分别用 compiler -O -S（链接 runtime/sylib.c）、gcc -O0 和 gcc -O2
+（把 SysY 源文件当作 C++ 编译，-include runtime/sylib.h）生成可执行文件，
+各运行 3 次取最短的墙钟时间；输出不一致时报错。需要 PATH 中有 gcc/g++。
+"""
+import glob
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+RUNTIME = os.path.join(ROOT, "runtime")
+RUNS = 3
+
+
+def build(compiler, path, tmp):
+    """返回 {名字: 可执行文件}，编译失败时把错误写到标准错误并跳过该项"""
+    name = os.path.splitext(os.path.basename(path))[0]
+    sylib = os.path.join(RUNTIME, "sylib.c")
+    obj = os.path.join(tmp, "sylib.o")
+    if not os.path.exists(obj):
+        subprocess.run(["gcc", "-O2", "-c", sylib, "-o", obj], check=True)
+    exes = {}
+    asm = os.path.join(tmp, os.path.basename(path) + ".s")
+    steps = {
+        "ours -O": [[compiler, "-O", "-S", "-o", tmp, path],
+                    ["gcc", asm, obj, "-o", os.path.join(tmp, name + ".ours")]],
+    }
+    for level in ("-O0", "-O2"):
+        exe = os.path.join(tmp, name + ".gcc" + level)
+        steps["gcc " + level] = [[
+            "g++", level, "-w", "-x", "c++", "-include",
+            os.path.join(RUNTIME, "sylib.h"), path, "-x", "none", obj, "-o", exe
+        ]]
+    for label, commands in steps.items():
+        ok = True
+        for command in commands:
+            proc = subprocess.run(command, stdout=subprocess.PIPE,
+                                  stderr=subprocess.PIPE,
+                                  universal_newlines=True)
+            if proc.returncode != 0:
+                sys.stderr.write("%s: %s failed\n%s" %
+                                 (name, label, proc.stdout + proc.stderr))
+                ok = False
+                break
+        if ok:
+            exes[label] = commands[-1][-1]
+    return exes
+
+
+def run(exe):
+    best = None
+    output = None
+    for _ in range(RUNS):
+        start = time.perf_counter()
+        proc = subprocess.run([exe], stdin=subprocess.DEVNULL,
+                              stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+        ms = (time.perf_counter() - start) * 1000
+        best = ms if best is None else min(best, ms)
+        output = (proc.returncode, proc.stdout)
+    return best, output
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    compiler = os.path.abspath(sys.argv[1])
+    kernels = sys.argv[2:] or sorted(
+        glob.glob(os.path.join(ROOT, "bench", "kernels", "*.sy")))
+    labels = ["ours -O", "gcc -O0", "gcc -O2"]
+    print("%-12s" % "kernel" + "".join("%12s" % l for l in labels) +
+          "%12s" % "vs -O0")
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for path in kernels:
+            name = os.path.splitext(os.path.basename(path))[0]
+            exes = build(compiler, path, tmp)
+            times = {}
+            outputs = set()
+            for label in labels:
+                if label in exes:
+                    times[label], output = run(exes[label])
+                    outputs.add(output)
+            if len(exes) < len(labels) or len(outputs) > 1:
+                if len(outputs) > 1:
+                    sys.stderr.write("%s: outputs differ\n" % name)
+                failed += 1
+            row = "%-12s" % name
+            for label in labels:
+                row += "%12s" % ("%.1f ms" % times[label]
+                                 if label in times else "-")
+            if "ours -O" in times and "gcc -O0" in times:
+                row += "%11.2fx" % (times["gcc -O0"] / times["ours -O"])
+            print(row, flush=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""按函数并行优化和代码生成的扩展性测试。
+
+用法: bench/parallel_functions.py <compiler> [funcs] [stmts]
+
+生成一个有 funcs 个函数的 SysY 程序，每个函数有几层循环、局部数组和
+stmts 条算术语句，main 调用每个函数两次（避免被整个内联进 main）。
+对 1/2/4/8/16 个线程各运行 compiler -O -S -j N 3 次，取 --stats-json 中
+opt 和 codegen 两个阶段最短的墙钟时间，并检查各线程数生成的汇编与
+单线程逐字节相同。机器的核数少于线程数时加速比会停在核数附近。
+"""
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+THREADS = [1, 2, 4, 8, 16]
+RUNS = 3
+
+
+def generate(funcs, stmts):
+    out = ["int g[1024];"]
+    for f in range(funcs):
+        out.append("int f%d(int n, int a[]) {" % f)
+        out.append("  int t[64];")
+        out.append("  int i = 0, s = %d, x = n;" % f)
+        out.append("  while (i < 64) { t[i] = a[i %% 16] + i * %d; i = i + 1; }"
+                   % (f % 7 + 1))
+        out.append("  i = 0;")
+        out.append("  while (i < n) {")
+        out.append("    int j = 0;")
+        out.append("    while (j < 64) {")
+        for k in range(stmts):
+            # 各函数的语句略有不同，避免 GVN 把整个函数合并成几条指令
+            out.append("      x = x * %d + t[(j + %d) %% 64] - s / %d;" %
+                       ((f + k) % 13 + 1, k, k % 5 + 1))
+            out.append("      if (x > %d) s = s + x %% %d; else s = s - j;" %
+                       (1000 + k * f, k % 11 + 2))
+        out.append("      j = j + 1;")
+        out.append("    }")
+        out.append("    g[(i + %d) %% 1024] = s;" % f)
+        out.append("    i = i + 1;")
+        out.append("  }")
+        out.append("  return s + x;")
+        out.append("}")
+    out.append("int main() {")
+    out.append("  int a[16] = {1, 2, 3, 4, 5, 6, 7, 8};")
+    out.append("  int s = 0;")
+    for f in range(funcs):
+        out.append("  s = s + f%d(%d, a) - f%d(1, a);" % (f, f % 3 + 1, f))
+    out.append("  putint(s);")
+    out.append("  return 0;")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def compile_once(compiler, path, out_dir, threads):
+    """返回 (opt ms, codegen ms, 汇编内容)"""
+    stats = os.path.join(out_dir, "stats.json")
+    subprocess.run([compiler, "-O", "-S", "-j", str(threads), "-o", out_dir,
+                    "--stats-json", stats, path], check=True)
+    with open(stats) as f:
+        phases = json.load(f)["phases"]
+    with open(os.path.join(out_dir, os.path.basename(path) + ".s"), "rb") as f:
+        asm = f.read()
+    return phases["opt"]["wall_ms"], phases["codegen"]["wall_ms"], asm
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    compiler = os.path.abspath(sys.argv[1])
+    funcs = int(sys.argv[2]) if len(sys.argv) > 2 else 400
+    stmts = int(sys.argv[3]) if len(sys.argv) > 3 else 12
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "funcs.sy")
+        with open(path, "w") as f:
+            f.write(generate(funcs, stmts))
+        print("%d functions, %d bytes, %d cpus" %
+              (funcs, os.path.getsize(path), os.cpu_count() or 1), flush=True)
+        print("%-8s%12s%12s%12s%10s" %
+              ("threads", "opt ms", "codegen ms", "total ms", "speedup"))
+        base = None
+        reference = None
+        for threads in THREADS:
+            runs = [compile_once(compiler, path, tmp, threads)
+                    for _ in range(RUNS)]
+            opt = min(r[0] for r in runs)
+            codegen = min(r[1] for r in runs)
+            if reference is None:
+                reference = runs[0][2]
+                base = opt + codegen
+            if any(r[2] != reference for r in runs):
+                sys.stderr.write("-j %d: assembly differs from -j 1\n" % threads)
+                failed += 1
+            total = opt + codegen
+            print("%-8d%12.1f%12.1f%12.1f%9.2fx" %
+                  (threads, opt, codegen, total, base / total), flush=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""按顶层声明并行输出 AST 的扩展性测试。
+
+用法: bench/parallel_print.py <compiler> [size_kb] [shape ...]
+
+对每种形状（默认 functions 和 mixed）用 bench/gen_sysy.py 生成 size_kb
+的程序，对 1/2/4/8/16 个线程各运行 compiler -ast -j N 3 次，取 --stats-json
+中 print 阶段（含写文件）最短的墙钟时间，并检查各线程数的 AST 输出与
+单线程逐字节相同。-j 1 走串行的 Printer。机器的核数少于线程数时加速比会
+停在核数附近。
+"""
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_sysy  # noqa: E402
+
+THREADS = [1, 2, 4, 8, 16]
+RUNS = 3
+
+
+def print_once(compiler, path, out_dir, threads):
+    """返回 (print ms, AST 文本)"""
+    stats = os.path.join(out_dir, "stats.json")
+    subprocess.run([compiler, "-ast", "-j", str(threads), "-o", out_dir,
+                    "--stats-json", stats, path], check=True)
+    with open(stats) as f:
+        phases = json.load(f)["phases"]
+    with open(os.path.join(out_dir, os.path.basename(path) + ".ast.txt"),
+              "rb") as f:
+        text = f.read()
+    return phases["print"]["wall_ms"], text
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    compiler = os.path.abspath(sys.argv[1])
+    size = int(sys.argv[2]) if len(sys.argv) > 2 else 4096
+    shapes = sys.argv[3:] or ["functions", "mixed"]
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        print("%d cpus" % (os.cpu_count() or 1))
+        print("%-12s%-8s%12s%10s%10s" %
+              ("shape", "threads", "print ms", "MB/s", "speedup"))
+        for shape in shapes:
+            path = os.path.join(tmp, shape + ".sy")
+            with open(path, "w") as f:
+                f.write(gen_sysy.generate(shape, size))
+            base = None
+            reference = None
+            for threads in THREADS:
+                runs = [print_once(compiler, path, tmp, threads)
+                        for _ in range(RUNS)]
+                ms = min(r[0] for r in runs)
+                if reference is None:
+                    reference = runs[0][1]
+                    base = ms
+                if any(r[1] != reference for r in runs):
+                    sys.stderr.write("%s -j %d: AST differs from -j 1\n" %
+                                     (shape, threads))
+                    failed += 1
+                # 吞吐量按输出的文本大小计算
+                print("%-12s%-8d%12.1f%10.1f%9.2fx" %
+                      (shape, threads, ms,
+                       len(reference) / (1024 * 1024) / (ms / 1000),
+                       base / ms), flush=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""比较手写递归下降分析器（-rd）和 bison 生成的 yyparse()。
+
+用法: bench/parser_compare.py <compiler> [--size KB] [--runs N] [corpus ...]
+
+对 bench/gen_sysy.py 的每种形状生成 size KB 的程序，两种分析器各跑 runs 次，
+取 --stats-json 中 parse 阶段（已扣除扫描时间）的中位数，报告 MB/s、
+节点/s、峰值 RSS 和加速比，并检查两者 -ast 输出逐字节相同。
+另外给出的 corpus（.sy 文件或目录）只做一致性检查：-ast 输出和报错都要相同。
+"""
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_sysy  # noqa: E402
+
+PARSERS = [("bison", []), ("rd", ["-rd"])]
+
+
+def run(compiler, flags, path, out_dir):
+    """返回 (退出码, 标准输出, stats, AST 文本)"""
+    stats = os.path.join(out_dir, "stats.json")
+    if os.path.exists(stats):
+        os.remove(stats)
+    ast = os.path.join(out_dir, os.path.basename(path) + ".ast.txt")
+    if os.path.exists(ast):
+        os.remove(ast)
+    proc = subprocess.run([compiler, "-ast", "-o", out_dir, "--stats-json",
+                           stats] + flags + [path],
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                          text=True)
+    data = None
+    if proc.returncode == 0:
+        with open(stats) as f:
+            data = json.load(f)
+    text = None
+    if os.path.exists(ast):
+        with open(ast, "rb") as f:
+            text = f.read()
+    return proc.returncode, proc.stdout, data, text
+
+
+def collect(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                files += [os.path.join(root, n) for n in sorted(names)
+                          if n.endswith(".sy")]
+        else:
+            files.append(path)
+    return files
+
+
+def main():
+    parser = argparse.ArgumentParser(description="递归下降分析器与 bison 对比")
+    parser.add_argument("compiler")
+    parser.add_argument("--size", type=int, default=4096, help="每种形状的 KB 数")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("corpus", nargs="*")
+    args = parser.parse_intermixed_args()
+    compiler = os.path.abspath(args.compiler)
+    failed = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        print("%-12s%-7s%10s%10s%14s%10s%9s" %
+              ("shape", "parser", "ms", "MB/s", "nodes/s", "RSS KB",
+               "speedup"))
+        for shape in gen_sysy.SHAPES:
+            path = os.path.join(tmp, shape + ".sy")
+            with open(path, "w") as f:
+                f.write(gen_sysy.generate(shape, args.size))
+            size = os.path.getsize(path)
+            texts, base = [], None
+            for name, flags in PARSERS:
+                times, rss = [], 0
+                for _ in range(args.runs):
+                    _, _, data, text = run(compiler, flags, path, tmp)
+                    times.append(data["phases"]["parse"]["wall_ms"])
+                    rss = max(rss, data["peak_rss_kb"])
+                nodes = sum(n for k, n in data["nodes"].items() if "/" not in k)
+                texts.append(text)
+                ms = statistics.median(times)
+                base = base or ms
+                print("%-12s%-7s%10.2f%10.1f%14.3g%10d%8.2fx" %
+                      (shape, name, ms, size / (1024 * 1024) / (ms / 1000),
+                       nodes / (ms / 1000), rss, base / ms), flush=True)
+            if texts[0] != texts[1]:
+                print("%s: AST output differs" % shape)
+                failed += 1
+
+        files = collect(args.corpus)
+        for path in files:
+            results = [run(compiler, flags, path, tmp) for _, flags in PARSERS]
+            (rc1, out1, _, text1), (rc2, out2, _, text2) = results
+            # 报错中列出的期望 token 允许不同
+            def errors(out):
+                return [line.split(", expecting")[0] for line in out.splitlines()]
+            if rc1 != rc2 or errors(out1) != errors(out2) or text1 != text2:
+                print("%s: parsers disagree" % path)
+                failed += 1
+        if files:
+            print("corpus: %d files, %d mismatches" % (len(files), failed))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""流式 AST 输出与逐层拼接字符串的旧 Printer 的对比。
+
+用法: bench/print_compare.py <compiler> --baseline <compiler> [--size KB]
+                             [--runs N] [shape ...]
+
+Printer 只保留流式这一种实现，旧的写法要用流式 Printer 之前的提交
+（6893045）单独编译一个编译器作 --baseline，例如
+  git worktree add /tmp/old 6893045 && cmake -S /tmp/old -B /tmp/old/build
+  && cmake --build /tmp/old/build
+对每种形状（默认 mixed 和 expressions）生成 size KB 的程序，两个编译器
+各运行 runs 次
+  compiler <file>       只做语法分析
+  compiler -ast <file>  再输出 AST
+取墙钟时间的中位数和最大的峰值 RSS（wait4 的 ru_maxrss，含启动时从脚本
+继承的十几 MB），print 一列为两者之差，即输出 AST 本身的开销。
+旧版本只认识 -ast 和写到当前目录 example/ 下，所以都在临时目录里运行，
+并检查两者的 AST 输出逐字节相同。
+"""
+import argparse
+import hashlib
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_sysy  # noqa: E402
+
+
+def run_once(compiler, flags, path, cwd):
+    """返回 (墙钟 ms, 峰值 RSS KB)"""
+    start = time.perf_counter()
+    proc = subprocess.Popen([compiler] + flags + [path], cwd=cwd,
+                            stdout=subprocess.DEVNULL,
+                            stderr=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    ms = (time.perf_counter() - start) * 1000
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode != 0:
+        raise RuntimeError("%s %s: exit %d" % (compiler, " ".join(flags),
+                                               proc.returncode))
+    return ms, usage.ru_maxrss
+
+
+def digest(path):
+    """输出可能有几百 MB，只留摘要：脚本自己的内存会算进子进程的 ru_maxrss"""
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            h.update(block)
+    return h.digest(), os.path.getsize(path)
+
+
+def measure(compiler, flags, path, cwd, runs):
+    results = [run_once(compiler, flags, path, cwd) for _ in range(runs)]
+    return (statistics.median(r[0] for r in results),
+            max(r[1] for r in results))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="流式 Printer 与旧 Printer 对比")
+    parser.add_argument("compiler")
+    parser.add_argument("--baseline", required=True,
+                        help="流式 Printer 之前的编译器")
+    parser.add_argument("--size", type=int, default=4096, help="每种形状的 KB 数")
+    parser.add_argument("--runs", type=int, default=3)
+    parser.add_argument("shapes", nargs="*")
+    args = parser.parse_intermixed_args()
+    compilers = [("base", os.path.abspath(args.baseline)),
+                 ("new", os.path.abspath(args.compiler))]
+    failed = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        out = os.path.join(tmp, "example")
+        os.makedirs(out)
+        print("%-12s%-6s%10s%10s%10s%10s%12s" %
+              ("shape", "build", "AST MB", "parse ms", "-ast ms", "print ms",
+               "-ast RSS KB"))
+        for shape in args.shapes or ["mixed", "expressions"]:
+            path = os.path.join(tmp, shape + ".sy")
+            with open(path, "w") as f:
+                f.write(gen_sysy.generate(shape, args.size))
+            ast = os.path.join(out, shape + ".sy.ast.txt")
+            digests = []
+            for name, compiler in compilers:
+                parse_ms, _ = measure(compiler, [], path, tmp, args.runs)
+                ast_ms, rss = measure(compiler, ["-ast"], path, tmp, args.runs)
+                digests.append(digest(ast))
+                os.remove(ast)
+                print("%-12s%-6s%10.1f%10.1f%10.1f%10.1f%12d" %
+                      (shape, name, digests[-1][1] / (1024 * 1024), parse_ms,
+                       ast_ms, ast_ms - parse_ms, rss), flush=True)
+            if digests[0] != digests[1]:
+                print("%s: AST output differs" % shape)
+                failed += 1
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
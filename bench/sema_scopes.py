@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""语义分析压力测试：生成块嵌套很深、局部变量很多的 SysY 程序并计时。
+
+用法: bench/sema_scopes.py <compiler> [depth] [locals] [funcs]
+
+每个函数最外层声明 locals 个局部变量，再嵌套 depth 层块，每层重新声明
+一部分外层变量（遮蔽）并引用各层的变量，用 -sema --time-report 报告耗时。
+"""
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def generate(depth, locals_, funcs):
+    out = []
+    for f in range(funcs):
+        out.append("int f%d(int p) {" % f)
+        for i in range(locals_):
+            out.append("  int v%d = p + %d;" % (i, i))
+        for d in range(depth):
+            pad = "  " * min(d + 2, 16)
+            out.append(pad[:-2] + "{")
+            # 每层遮蔽 8 个外层变量，并读写几个更外层的变量
+            for k in range(8):
+                i = (d * 8 + k) % locals_
+                out.append("%sint v%d = v%d + %d;" % (pad, i, (i + 1) % locals_, d))
+            out.append("%sp = p + v%d * v%d;" % (pad, d % locals_, (d * 7) % locals_))
+        for d in reversed(range(depth)):
+            out.append("  " * min(d + 1, 15) + "}")
+        out.append("  return p + v0;")
+        out.append("}")
+    out.append("int main() {")
+    out.append("  int s = 0;")
+    for f in range(funcs):
+        out.append("  s = s + f%d(%d);" % (f, f))
+    out.append("  return s;")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    compiler = sys.argv[1]
+    depth = int(sys.argv[2]) if len(sys.argv) > 2 else 500
+    locals_ = int(sys.argv[3]) if len(sys.argv) > 3 else 5000
+    funcs = int(sys.argv[4]) if len(sys.argv) > 4 else 4
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "scopes.sy")
+        with open(path, "w") as f:
+            f.write(generate(depth, locals_, funcs))
+        print("depth %d, %d locals, %d functions, %d bytes" %
+              (depth, locals_, funcs, os.path.getsize(path)), flush=True)
+        return subprocess.call([compiler, "-sema", "--time-report", path])
+
+
+if __name__ == "__main__":
+    sys.exit(main())
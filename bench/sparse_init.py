@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""大而稀疏的数组初值的编译时间和内存。
+
+用法: bench/sparse_init.py <compiler> [--baseline <compiler>] [--sizes MB,...]
+                           [--runs N]
+
+对每个大小（默认 1/4/16/64 MB）生成三种程序：
+  sparse : int a[rows][1024] = {{1}, {2, 3}};，只有开头几个非零元素
+  strided: 每 64 行给出一行开头的几个元素
+  const  : const 的稀疏数组，main 里用常量下标取值，由常量折叠求出
+分别用 -S（汇编）和 -run（字节码解释执行）编译运行 runs 次，取 --stats-json
+中 fold、lower、codegen/bytecode 三个阶段之和的中位数，报告耗时、生成的
+汇编大小和峰值 RSS。给出 --baseline 时用另一个编译器跑同样的程序作对比，
+并检查两者的退出码相同。
+开始前先检查 REJECTED 中的几种错误初值都会报错，而不是被静默丢掉。
+"""
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+COLS = 1024
+PHASES = ["fold", "lower", "codegen", "bytecode"]
+
+# 必须报错的初值：全局变量的初值不是常量、元素过多、花括号没有对齐到子数组
+REJECTED = [
+    "int a = 3;\nint b = a + 1;\nint c[3] = {1, a, 2};\n",
+    "int a[2][2] = {1, 2, 3, 4, 5};\n",
+    "int g[3][4] = {1, 2, {3}, {4, 5}};\n",
+    "int main() {\n  int l[2][2] = {1, 2, 3, 4, 5};\n  return l[0][0];\n}\n",
+]
+
+
+def generate(shape, size_mb):
+    rows = size_mb * 1024 * 1024 // 4 // COLS
+    out = []
+    if shape == "sparse":
+        out.append("int a[%d][%d] = {{1}, {2, 3}};" % (rows, COLS))
+        out.append("int main() { return a[0][0] + a[1][1] + a[%d][%d]; }" %
+                   (rows - 1, COLS - 1))
+    elif shape == "strided":
+        items = []
+        for r in range(0, rows, 64):
+            # 前面的行用 {} 占位，给出的行只写开头几个元素
+            items.append("{%d, %d, %d}" % (r % 97 + 1, r % 89, r % 83 + 2))
+            items += ["{}"] * min(63, rows - r - 1)
+        out.append("int a[%d][%d] = {%s};" % (rows, COLS, ", ".join(items)))
+        out.append("int main() { return a[%d][2] + a[1][0]; }" %
+                   ((rows - 1) // 64 * 64))
+    else:
+        out.append("const int a[%d][%d] = {{1}, {2, 3}};" % (rows, COLS))
+        out.append("int main() { return a[1][1] + a[%d][%d] + a[0][0]; }" %
+                   (rows - 1, COLS - 1))
+    return "\n".join(out) + "\n"
+
+
+def run(compiler, mode, path, out_dir):
+    """返回 (退出码, 各阶段之和 ms, 汇编字节数, 峰值 RSS KB)"""
+    stats = os.path.join(out_dir, "stats.json")
+    asm = os.path.join(out_dir, os.path.basename(path) + ".s")
+    if os.path.exists(asm):
+        os.remove(asm)
+    proc = subprocess.run([compiler, mode, "-o", out_dir, "--stats-json",
+                           stats, path], stdout=subprocess.DEVNULL,
+                          stderr=subprocess.DEVNULL)
+    with open(stats) as f:
+        data = json.load(f)
+    ms = sum(data["phases"][p]["wall_ms"] for p in PHASES
+             if p in data["phases"])
+    size = os.path.getsize(asm) if os.path.exists(asm) else 0
+    return proc.returncode, ms, size, data["peak_rss_kb"]
+
+
+def check_rejected(compiler, out_dir):
+    """返回没有报错的程序个数"""
+    failed = 0
+    path = os.path.join(out_dir, "rejected.sy")
+    for source in REJECTED:
+        if "main" not in source:
+            source += "int main() { return 0; }\n"
+        with open(path, "w") as f:
+            f.write(source)
+        for mode in ["-S", "-run"]:
+            proc = subprocess.run([compiler, mode, "-o", out_dir, path],
+                                  stdout=subprocess.PIPE,
+                                  stderr=subprocess.STDOUT, text=True)
+            if "error" not in proc.stdout:
+                print("accepted with %s:\n%s" % (mode, source))
+                failed += 1
+    return failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="稀疏数组初值的编译开销")
+    parser.add_argument("compiler")
+    parser.add_argument("--baseline", help="作对比的另一个编译器")
+    parser.add_argument("--sizes", default="1,4,16,64", help="数组 MB 数")
+    parser.add_argument("--runs", type=int, default=3)
+    args = parser.parse_args()
+    compilers = [("new", os.path.abspath(args.compiler))]
+    if args.baseline:
+        compilers.append(("base", os.path.abspath(args.baseline)))
+    failed = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        failed += check_rejected(compilers[0][1], tmp)
+        print("%-9s%4s %-9s%-6s%10s%12s%10s" %
+              ("shape", "MB", "compiler", "mode", "ms", "asm bytes", "RSS KB"))
+        for shape in ["sparse", "strided", "const"]:
+            for size in [int(s) for s in args.sizes.split(",")]:
+                path = os.path.join(tmp, "%s%d.sy" % (shape, size))
+                with open(path, "w") as f:
+                    f.write(generate(shape, size))
+                for mode in ["-S", "-run"]:
+                    codes = set()
+                    for name, compiler in compilers:
+                        runs = [run(compiler, mode, path, tmp)
+                                for _ in range(args.runs)]
+                        codes.add(runs[0][0])
+                        print("%-9s%4d %-9s%-6s%10.2f%12d%10d" %
+                              (shape, size, name, mode,
+                               statistics.median(r[1] for r in runs),
+                               runs[0][2], max(r[3] for r in runs)),
+                              flush=True)
+                    if len(codes) > 1:
+                        print("%s %dMB %s: exit codes differ" %
+                              (shape, size, mode))
+                        failed += 1
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""字节码解释器基准：用 -run 执行 bench/kernels 下的计算内核并报告指令吞吐。
+
+用法: bench/vm_kernels.py <compiler> [kernel.sy ...]
+
+不指定内核时运行 bench/kernels/*.sy（矩阵乘法、排序、递归 fib）。
+每个内核用 --stats-json 取得执行的指令数和 run 阶段耗时，输出
+每秒执行的字节码指令数（百万条）。
+"""
+import glob
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def run(compiler, path, tmp):
+    stats = os.path.join(tmp, "stats.json")
+    proc = subprocess.run([compiler, "-run", "--stats-json", stats, path],
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                          universal_newlines=True)
+    if not os.path.exists(stats):
+        sys.stderr.write(proc.stdout + proc.stderr)
+        return None
+    with open(stats) as f:
+        data = json.load(f)
+    os.remove(stats)
+    return data, proc.stdout.strip()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    compiler = sys.argv[1]
+    kernels = sys.argv[2:] or sorted(
+        glob.glob(os.path.join(os.path.dirname(__file__), "kernels", "*.sy")))
+    print("%-12s %14s %10s %12s  %s" %
+          ("kernel", "instructions", "run ms", "M instr/s", "output"))
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for path in kernels:
+            result = run(compiler, path, tmp)
+            name = os.path.splitext(os.path.basename(path))[0]
+            if result is None:
+                print("%-12s failed" % name)
+                failed += 1
+                continue
+            data, output = result
+            count = data["vm_instructions"]
+            ms = data["phases"].get("run", {}).get("wall_ms", 0)
+            rate = count / ms / 1000 if ms > 0 else 0
+            print("%-12s %14d %10.1f %12.1f  %s" %
+                  (name, count, ms, rate, output.replace("\n", " ")),
+                  flush=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,91 @@
+// SysY 运行时库，与 -S 生成的汇编链接：
+//   compiler -O -S -o out prog.sy && cc out/prog.sy.s runtime/sylib.c -o prog
+// 编译器自己也链接这一份：-run 的内置函数和 -jit 的外部符号都调用这里的实现，
+// 三种执行方式的输入输出格式不会不一致
+#include "sylib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int getint(void) {
+  int t = 0;
+  if (scanf("%d", &t) != 1) t = 0;
+  return t;
+}
+
+int getch(void) { return getchar(); }
+
+float getfloat(void) {
+  float f = 0;
+  if (scanf("%a", &f) != 1) f = 0;
+  return f;
+}
+
+int getarray(int a[]) {
+  int n = 0;
+  if (scanf("%d", &n) != 1) n = 0;
+  for (int i = 0; i < n; i++)
+    if (scanf("%d", &a[i]) != 1) break;
+  return n;
+}
+
+int getfarray(float a[]) {
+  int n = 0;
+  if (scanf("%d", &n) != 1) n = 0;
+  for (int i = 0; i < n; i++)
+    if (scanf("%a", &a[i]) != 1) break;
+  return n;
+}
+
+void putint(int a) { printf("%d", a); }
+
+void putch(int a) { putchar(a); }
+
+void putfloat(float a) { printf("%a", a); }
+
+void putarray(int n, int a[]) {
+  printf("%d:", n);
+  for (int i = 0; i < n; i++) printf(" %d", a[i]);
+  putchar('\n');
+}
+
+void putfarray(int n, float a[]) {
+  printf("%d:", n);
+  for (int i = 0; i < n; i++) printf(" %a", a[i]);
+  putchar('\n');
+}
+
+// starttime/stoptime 之间的累计时间，程序退出时打印到标准错误
+static double timer_start, timer_total;
+static int timer_count;
+static int in_process;  // 在编译器进程内运行，由 sylib_end 打印
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(void) {
+  fflush(stdout);
+  if (timer_count == 0) return;
+  long us = (long)(timer_total * 1e6);
+  fprintf(stderr, "TOTAL: %ldH-%ldM-%ldS-%ldus\n", us / 3600000000,
+          us / 60000000 % 60, us / 1000000 % 60, us % 1000000);
+}
+
+void starttime(void) { timer_start = now(); }
+
+void stoptime(void) {
+  timer_total += now() - timer_start;
+  if (timer_count++ == 0 && !in_process) atexit(report);
+}
+
+void sylib_begin(void) {
+  in_process = 1;
+  timer_total = 0;
+  timer_count = 0;
+}
+
+void sylib_end(void) { report(); }
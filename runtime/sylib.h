@@ -0,0 +1,29 @@
+// SysY 运行时库的声明，用 C/C++ 编译器编译 SysY 源文件做对照时 -include 进来；
+// 编译器的 -run、-jit 也通过它调用同一份实现
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int getint(void);
+int getch(void);
+float getfloat(void);
+int getarray(int a[]);
+int getfarray(float a[]);
+void putint(int a);
+void putch(int a);
+void putfloat(float a);
+void putarray(int n, int a[]);
+void putfarray(int n, float a[]);
+void starttime(void);
+void stoptime(void);
+
+// 在编译器进程内运行一个程序的前后调用：清零计时，程序返回后刷新 stdout，
+// 用过 starttime/stoptime 时立即打印 TOTAL（而不是等编译器退出）
+void sylib_begin(void);
+void sylib_end(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,27 @@
+#include "arena.h"
+
+#include <cstdint>
+
+Arena::Arena(size_t blockSize) : blockSize(blockSize) {}
+
+Arena::~Arena() {
+  for (auto it = dtors.rbegin(); it != dtors.rend(); ++it) it->fn(it->obj);
+  for (char *block : blocks) ::operator delete(block);
+}
+
+void *Arena::allocate(size_t size, size_t align) {
+  uintptr_t p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~(align - 1);
+  if (cur == nullptr || p + size > reinterpret_cast<uintptr_t>(end)) {
+    // 超大对象单独占一个块
+    size_t n = size + align > blockSize ? size + align : blockSize;
+    char *block = static_cast<char *>(::operator new(n));
+    blocks.push_back(block);
+    numBlocks++;
+    cur = block;
+    end = block + n;
+    p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~(align - 1);
+  }
+  cur = reinterpret_cast<char *>(p + size);
+  bytesUsed += size;
+  return reinterpret_cast<void *>(p);
+}
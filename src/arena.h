@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// bump 分配器：一次 yyparse() 中创建的所有 AST 节点都从这里分配，
+// Arena 析构时整体释放，节点之间只保存非拥有指针
+class Arena {
+ public:
+  explicit Arena(size_t blockSize = 64 * 1024);
+  ~Arena();
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(size_t size, size_t align);
+
+  template <typename T, typename... Args>
+  T *make(Args &&...args) {
+    T *obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    // 只有带 std::vector 成员的节点需要析构，其余节点随内存块一起丢弃
+    if (!std::is_trivially_destructible<T>::value) {
+      dtors.push_back({obj, [](void *p) { static_cast<T *>(p)->~T(); }});
+    }
+    numObjects++;
+    return obj;
+  }
+
+  size_t numObjects = 0;  // make() 创建的对象数
+  size_t numBlocks = 0;   // 向系统申请的内存块数
+  size_t bytesUsed = 0;   // 已分配给对象的字节数
+
+ private:
+  struct Dtor {
+    void *obj;
+    void (*fn)(void *);
+  };
+  size_t blockSize;
+  std::vector<char *> blocks;
+  std::vector<Dtor> dtors;
+  char *cur = nullptr;
+  char *end = nullptr;
+};
@@ -24,26 +24,14 @@ void SelectStmtAST::accept(Visitor &visitor) { visitor.visit(*this); }
 
 void IterationStmtAST::accept(Visitor &visitor) { visitor.visit(*this); }
 
-void AddExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
-
-void MulExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
+void BinaryExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
 
 void UnaryExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
 
-void PrimaryExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
-
 void NumberAST::accept(Visitor &visitor) { visitor.visit(*this); }
 
 void CallAST::accept(Visitor &visitor) { visitor.visit(*this); }
 
 void LValAST::accept(Visitor &visitor) { visitor.visit(*this); }
 
-void RelExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
-
-void EqExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
-
-void LAndExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
-
-void LOrExpAST::accept(Visitor &visitor) { visitor.visit(*this); }
-
 void BlockItemAST::accept(Visitor &visitor) { visitor.visit(*this); }
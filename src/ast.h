@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "arena.h"
+#include "symbol.h"
 #include "utils.h"
 
 class BaseAST;
@@ -28,18 +30,13 @@ class StmtAST;
 class ReturnStmtAST;
 class SelectStmtAST;
 class IterationStmtAST;
+class ExpAST;
+class BinaryExpAST;
+class UnaryExpAST;
 class LValAST;
-class PrimaryExpAST;
 class NumberAST;
-class UnaryExpAST;
 class CallAST;
 class FuncCParamListAST;
-class MulExpAST;
-class AddExpAST;
-class RelExpAST;
-class EqExpAST;
-class LAndExpAST;
-class LOrExpAST;
 
 class Visitor;
 
@@ -47,19 +44,22 @@ class BaseAST {
  public:
   virtual void accept(Visitor &visitor) = 0;
   BaseAST() = default;
-  virtual ~BaseAST() = default;
+
+ protected:
+  // 节点由 Arena 统一释放，不会通过基类指针 delete
+  ~BaseAST() = default;
 };
 
 class CompUnitAST : public BaseAST {
  public:
-  std::vector<std::unique_ptr<DeclDefAST>> declDefList;
+  std::vector<DeclDefAST *> declDefList;
   void accept(Visitor &visitor) override;
 };
 
 class DeclDefAST : public BaseAST {
  public:
-  std::unique_ptr<DeclAST> Decl = nullptr;
-  std::unique_ptr<FuncDefAST> funcDef = nullptr;
+  DeclAST *Decl = nullptr;
+  FuncDefAST *funcDef = nullptr;
   void accept(Visitor &visitor) override;
 };
 
@@ -67,149 +67,155 @@ class DeclAST : public BaseAST {
  public:
   TYPE bType;
   bool isConst;
-  std::vector<std::unique_ptr<DefAST>> defList;
+  std::vector<DefAST *> defList;
   void accept(Visitor &visitor) override;
 };
 
 class DefListAST {
  public:
-  std::vector<std::unique_ptr<DefAST>> list;
+  std::vector<DefAST *> list;
 };
 
 class DefAST : public BaseAST {
  public:
-  std::unique_ptr<std::string> id;
-  std::vector<std::unique_ptr<AddExpAST>> arrays;
-  std::unique_ptr<InitValAST> initVal;
+  Symbol id;
+  std::vector<ExpAST *> arrays;
+  std::vector<int> dims;  // 常量折叠后各维的长度
+  InitValAST *initVal = nullptr;
+  // 以下由语义分析填写
+  TYPE bType = TYPE_INT;
+  bool isConst = false;
+  bool isGlobal = false;
   void accept(Visitor &visitor) override;
 };
 
 class ArraysAST {
  public:
-  std::vector<std::unique_ptr<AddExpAST>> list;
+  std::vector<ExpAST *> list;
 };
 
 class InitValAST : public BaseAST {
  public:
-  std::unique_ptr<AddExpAST> exp;
-  std::vector<std::unique_ptr<InitValAST>> initValList;
+  ExpAST *exp = nullptr;
+  std::vector<InitValAST *> initValList;
   void accept(Visitor &visitor) override;
 };
 
 class InitValListAST {
  public:
-  std::vector<std::unique_ptr<InitValAST>> list;
+  std::vector<InitValAST *> list;
 };
 
 class FuncDefAST : public BaseAST {
  public:
   TYPE funcType;
-  std::unique_ptr<std::string> id;
-  std::vector<std::unique_ptr<FuncFParamAST>> funcFParamList;
-  std::unique_ptr<BlockAST> block = nullptr;
+  Symbol id;
+  std::vector<FuncFParamAST *> funcFParamList;
+  BlockAST *block = nullptr;  // 运行时库函数没有函数体
   void accept(Visitor &visitor) override;
 };
 
 class FuncFParamListAST {
  public:
-  std::vector<std::unique_ptr<FuncFParamAST>> list;
+  std::vector<FuncFParamAST *> list;
 };
 
 class FuncFParamAST : public BaseAST {
  public:
   TYPE bType;
-  std::unique_ptr<std::string> id;
+  Symbol id;
   bool isArray =
       false;  // 用于区分是否是数组参数，此时一维数组和多维数组expArrays都是empty
-  std::vector<std::unique_ptr<AddExpAST>> arrays;
+  std::vector<ExpAST *> arrays;
+  std::vector<int> dims;  // 常量折叠后第一维之后各维的长度
   void accept(Visitor &visitor) override;
 };
 
 class BlockAST : public BaseAST {
  public:
-  std::vector<std::unique_ptr<BlockItemAST>> blockItemList;
+  std::vector<BlockItemAST *> blockItemList;
   void accept(Visitor &visitor) override;
 };
 
 class BlockItemListAST {
  public:
-  std::vector<std::unique_ptr<BlockItemAST>> list;
+  std::vector<BlockItemAST *> list;
 };
 
 class BlockItemAST : public BaseAST {
  public:
-  std::unique_ptr<DeclAST> decl = nullptr;
-  std::unique_ptr<StmtAST> stmt = nullptr;
+  DeclAST *decl = nullptr;
+  StmtAST *stmt = nullptr;
   void accept(Visitor &visitor) override;
 };
 
 class StmtAST : public BaseAST {
  public:
   STYPE sType;
-  std::unique_ptr<LValAST> lVal = nullptr;
-  std::unique_ptr<AddExpAST> exp = nullptr;
-  std::unique_ptr<ReturnStmtAST> returnStmt = nullptr;
-  std::unique_ptr<SelectStmtAST> selectStmt = nullptr;
-  std::unique_ptr<IterationStmtAST> iterationStmt = nullptr;
-  std::unique_ptr<BlockAST> block = nullptr;
+  LValAST *lVal = nullptr;
+  ExpAST *exp = nullptr;
+  ReturnStmtAST *returnStmt = nullptr;
+  SelectStmtAST *selectStmt = nullptr;
+  IterationStmtAST *iterationStmt = nullptr;
+  BlockAST *block = nullptr;
   void accept(Visitor &visitor) override;
 };
 
 class ReturnStmtAST : public BaseAST {
  public:
-  std::unique_ptr<AddExpAST> exp = nullptr;
+  ExpAST *exp = nullptr;
   void accept(Visitor &visitor) override;
 };
 
 class SelectStmtAST : public BaseAST {
  public:
-  std::unique_ptr<LOrExpAST> cond;
-  std::unique_ptr<StmtAST> ifStmt, elseStmt;
+  ExpAST *cond = nullptr;
+  StmtAST *ifStmt = nullptr, *elseStmt = nullptr;
   void accept(Visitor &visitor) override;
 };
 
 class IterationStmtAST : public BaseAST {
  public:
-  std::unique_ptr<LOrExpAST> cond;
-  std::unique_ptr<StmtAST> stmt;
+  ExpAST *cond = nullptr;
+  StmtAST *stmt = nullptr;
   void accept(Visitor &visitor) override;
 };
 
-class AddExpAST : public BaseAST {
- public:
-  std::unique_ptr<AddExpAST> addExp;
-  std::unique_ptr<MulExpAST> mulExp;
-  AOP op;
-  void accept(Visitor &visitor) override;
-};
+// 表达式统一为二元、一元和叶子（数字、左值、调用）几种紧凑节点，
+// 语法中的 AddExp/MulExp/... 等层次不再生成包装节点
+enum EKIND { EXP_BINARY, EXP_UNARY, EXP_NUMBER, EXP_LVAL, EXP_CALL };
 
-class MulExpAST : public BaseAST {
+class ExpAST : public BaseAST {
  public:
-  std::unique_ptr<UnaryExpAST> unaryExp;
-  std::unique_ptr<MulExpAST> mulExp;
-  MOP op;
-  void accept(Visitor &visitor) override;
+  explicit ExpAST(EKIND kind) : kind(kind) {}
+  EKIND kind;
+  // 源代码中包在该表达式外的括号层数，仅供 Printer 还原原来的分层输出
+  int parens = 0;
+  // 语义分析得到的类型；只有调用 void 函数时是 TYPE_VOID
+  TYPE type = TYPE_VOID;
 };
 
-class UnaryExpAST : public BaseAST {
+class BinaryExpAST : public ExpAST {
  public:
-  std::unique_ptr<PrimaryExpAST> primaryExp;
-  std::unique_ptr<CallAST> call;
-  std::unique_ptr<UnaryExpAST> unaryExp;
-  UOP op;
+  BinaryExpAST(BOP op, ExpAST *lhs, ExpAST *rhs)
+      : ExpAST(EXP_BINARY), op(op), lhs(lhs), rhs(rhs) {}
+  BOP op;
+  ExpAST *lhs;
+  ExpAST *rhs;
   void accept(Visitor &visitor) override;
 };
 
-class PrimaryExpAST : public BaseAST {
+class UnaryExpAST : public ExpAST {
  public:
-  std::unique_ptr<AddExpAST> exp;
-  std::unique_ptr<LValAST> lval;
-  std::unique_ptr<NumberAST> number;
+  UnaryExpAST(UOP op, ExpAST *exp) : ExpAST(EXP_UNARY), op(op), exp(exp) {}
+  UOP op;
+  ExpAST *exp;
   void accept(Visitor &visitor) override;
 };
 
-class NumberAST : public BaseAST {
+class NumberAST : public ExpAST {
  public:
+  NumberAST() : ExpAST(EXP_NUMBER) {}
   bool isInt;
   union {
     int intval;
@@ -218,54 +224,30 @@ class NumberAST : public BaseAST {
   void accept(Visitor &visitor) override;
 };
 
-class LValAST : public BaseAST {
+class LValAST : public ExpAST {
  public:
-  std::unique_ptr<std::string> id;
-  std::vector<std::unique_ptr<AddExpAST>> arrays;
+  LValAST() : ExpAST(EXP_LVAL) {}
+  Symbol id;
+  std::vector<ExpAST *> arrays;
+  // 语义分析解析到的声明，二者恰有一个非空
+  DefAST *def = nullptr;
+  FuncFParamAST *param = nullptr;
+  int rank = 0;  // 下标之后剩下的维数，非 0 表示数组（只能作为实参）
   void accept(Visitor &visitor) override;
 };
 
-class CallAST : public BaseAST {
+class CallAST : public ExpAST {
  public:
-  std::unique_ptr<std::string> id;
-  std::vector<std::unique_ptr<AddExpAST>> funcCParamList;
+  CallAST() : ExpAST(EXP_CALL) {}
+  Symbol id;
+  std::vector<ExpAST *> funcCParamList;
+  FuncDefAST *func = nullptr;  // 语义分析解析到的函数
   void accept(Visitor &visitor) override;
 };
 
 class FuncCParamListAST {
  public:
-  std::vector<std::unique_ptr<AddExpAST>> list;
-};
-
-class RelExpAST : public BaseAST {
- public:
-  std::unique_ptr<AddExpAST> addExp;
-  std::unique_ptr<RelExpAST> relExp;
-  ROP op;
-  void accept(Visitor &visitor) override;
-};
-
-class EqExpAST : public BaseAST {
- public:
-  std::unique_ptr<RelExpAST> relExp;
-  std::unique_ptr<EqExpAST> eqExp;
-  EOP op;
-  void accept(Visitor &visitor) override;
-};
-
-class LAndExpAST : public BaseAST {
- public:
-  // lAndExp不为空则说明有and符号，or类似
-  std::unique_ptr<EqExpAST> eqExp;
-  std::unique_ptr<LAndExpAST> lAndExp;
-  void accept(Visitor &visitor) override;
-};
-
-class LOrExpAST : public BaseAST {
- public:
-  std::unique_ptr<LOrExpAST> lOrExp;
-  std::unique_ptr<LAndExpAST> lAndExp;
-  void accept(Visitor &visitor) override;
+  std::vector<ExpAST *> list;
 };
 
 class Visitor {
@@ -283,17 +265,11 @@ class Visitor {
   virtual void visit(ReturnStmtAST &ast) = 0;
   virtual void visit(SelectStmtAST &ast) = 0;
   virtual void visit(IterationStmtAST &ast) = 0;
-  virtual void visit(AddExpAST &ast) = 0;
-  virtual void visit(MulExpAST &ast) = 0;
+  virtual void visit(BinaryExpAST &ast) = 0;
   virtual void visit(UnaryExpAST &ast) = 0;
-  virtual void visit(PrimaryExpAST &ast) = 0;
   virtual void visit(LValAST &ast) = 0;
   virtual void visit(NumberAST &ast) = 0;
   virtual void visit(CallAST &ast) = 0;
-  virtual void visit(RelExpAST &ast) = 0;
-  virtual void visit(EqExpAST &ast) = 0;
-  virtual void visit(LAndExpAST &ast) = 0;
-  virtual void visit(LOrExpAST &ast) = 0;
 };
 
 
@@ -0,0 +1,312 @@
+#include "ast_cache.h"
+
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <initializer_list>
+#include <unordered_map>
+
+namespace {
+
+const char MAGIC[4] = {'S', 'Y', 'A', 'C'};
+const uint32_t VERSION = 2;
+const uint32_t NUM_SECTIONS = 12;  // FlatAST 的 11 个数组 + 名字表
+
+// 记录大小的指纹，结构体布局变化后旧缓存自动失效
+constexpr uint32_t layoutOf(std::initializer_list<size_t> sizes) {
+  uint32_t h = 17;
+  for (size_t size : sizes) h = h * 31 + size;
+  return h;
+}
+const uint32_t LAYOUT = layoutOf(
+    {sizeof(FlatAST::DeclDef), sizeof(FlatAST::Decl), sizeof(FlatAST::Def),
+     sizeof(FlatAST::InitVal), sizeof(FlatAST::FuncDef),
+     sizeof(FlatAST::FuncFParam), sizeof(FlatAST::Block),
+     sizeof(FlatAST::BlockItem), sizeof(FlatAST::Stmt), sizeof(FlatAST::Exp)});
+
+struct Section {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t layout;
+  uint32_t numSymbols;
+  uint64_t sourceHash;
+  uint64_t sourceSize;
+  uint64_t checksum;  // 头部之后全部内容的哈希
+  Section sections[NUM_SECTIONS];
+};
+
+// 按固定顺序访问 FlatAST 的各个数组
+template <typename F, typename Flat>
+void forEachArray(Flat &flat, F fn) {
+  fn(flat.declDefs);
+  fn(flat.decls);
+  fn(flat.defs);
+  fn(flat.initVals);
+  fn(flat.funcDefs);
+  fn(flat.params);
+  fn(flat.blocks);
+  fn(flat.blockItems);
+  fn(flat.stmts);
+  fn(flat.exps);
+  fn(flat.lists);
+}
+
+// 对所有保存名字的字段调用 fn(Symbol &)
+template <typename F>
+void forEachSymbol(FlatAST &flat, F fn) {
+  for (auto &def : flat.defs) fn(def.id);
+  for (auto &funcDef : flat.funcDefs) fn(funcDef.id);
+  for (auto &param : flat.params) fn(param.id);
+  for (auto &exp : flat.exps)
+    if (exp.kind == EXP_LVAL || exp.kind == EXP_CALL) fn(exp.a);
+}
+
+void pad(std::string &out) { out.resize((out.size() + 7) & ~size_t(7), '\0'); }
+
+}  // namespace
+
+uint64_t hashBytes(const char *data, size_t len, uint64_t seed) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+  uint64_t h = seed ^ (len * m);
+  const char *end = data + (len & ~size_t(7));
+  for (const char *p = data; p != end; p += 8) {
+    uint64_t k;
+    memcpy(&k, p, 8);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+  size_t rest = len & 7;
+  if (rest != 0) {
+    uint64_t k = 0;
+    memcpy(&k, end, rest);
+    h ^= k;
+    h *= m;
+  }
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+// 可执行文件的 GNU build-id：链接器按输出内容算出的摘要，放在 PT_NOTE 段里，
+// 已经映射在内存中，取它不用读文件
+static int findBuildId(dl_phdr_info *info, size_t, void *data) {
+  for (int i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) &ph = info->dlpi_phdr[i];
+    if (ph.p_type != PT_NOTE) continue;
+    const char *p = reinterpret_cast<const char *>(info->dlpi_addr + ph.p_vaddr);
+    const char *end = p + ph.p_memsz;
+    while (p + sizeof(ElfW(Nhdr)) <= end) {
+      auto *note = reinterpret_cast<const ElfW(Nhdr) *>(p);
+      const char *name = p + sizeof(ElfW(Nhdr));
+      const char *desc = name + ((note->n_namesz + 3) & ~3u);
+      if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 &&
+          memcmp(name, "GNU", 4) == 0 && desc + note->n_descsz <= end) {
+        *static_cast<uint64_t *>(data) = hashBytes(desc, note->n_descsz);
+        return 1;
+      }
+      p = desc + ((note->n_descsz + 3) & ~3u);
+    }
+  }
+  return 1;  // 第一个对象就是可执行文件本身，不看共享库
+}
+
+uint64_t compilerHash() {
+  static const uint64_t hash = [] {
+    uint64_t h = 0;
+    dl_iterate_phdr(findBuildId, &h);
+    if (h != 0) return h;
+    // 没有 build-id（链接时没加 --build-id）才退回到对整个可执行文件求哈希
+    int fd = open("/proc/self/exe", O_RDONLY);
+    if (fd < 0) return uint64_t(0);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        h = hashBytes(static_cast<const char *>(p), st.st_size);
+        munmap(p, st.st_size);
+      }
+    }
+    close(fd);
+    return h;
+  }();
+  return hash;
+}
+
+bool replaceFile(const std::string &path, std::string_view data) {
+  static std::atomic<unsigned> serial{0};
+  std::string tmp = path + ".tmp." + std::to_string(getpid()) + "." +
+                    std::to_string(serial++);
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  const char *p = data.data();
+  size_t left = data.size();
+  while (left > 0) {
+    ssize_t n = write(fd, p, left);
+    if (n <= 0) {
+      close(fd);
+      unlink(tmp.c_str());
+      return false;
+    }
+    p += n;
+    left -= n;
+  }
+  close(fd);
+  if (rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::string serializeFlatAST(const FlatAST &flat, uint64_t hash,
+                             uint64_t sourceSize) {
+  // 名字重新编号为 0..n-1，写出的文件与进程内的驻留表无关
+  FlatAST local = flat;
+  std::unordered_map<Symbol, uint32_t> remap;
+  std::vector<Symbol> names;
+  forEachSymbol(local, [&](Symbol &sym) {
+    auto it = remap.emplace(sym, names.size());
+    if (it.second) names.push_back(sym);
+    sym = it.first->second;
+  });
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.layout = LAYOUT;
+  header.numSymbols = names.size();
+  header.sourceHash = hash;
+  header.sourceSize = sourceSize;
+
+  std::string out(sizeof(Header), '\0');
+  int i = 0;
+  forEachArray(local, [&](auto &array) {
+    pad(out);
+    header.sections[i++] = {out.size(), array.size()};
+    out.append(reinterpret_cast<const char *>(array.data()),
+               array.size() * sizeof(array[0]));
+  });
+  pad(out);
+  size_t start = out.size();
+  for (Symbol sym : names) {
+    std::string_view name = interner.name(sym);
+    uint32_t len = name.size();
+    out.append(reinterpret_cast<const char *>(&len), sizeof(len));
+    out.append(name.data(), name.size());
+  }
+  header.sections[i] = {start, out.size() - start};
+  header.checksum =
+      hashBytes(out.data() + sizeof(header), out.size() - sizeof(header));
+  memcpy(&out[0], &header, sizeof(header));
+  return out;
+}
+
+bool deserializeFlatAST(const char *data, size_t size, uint64_t hash,
+                        uint64_t sourceSize, FlatAST &flat) {
+  Header header;
+  if (size < sizeof(header)) return false;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.layout != LAYOUT ||
+      header.sourceHash != hash || header.sourceSize != sourceSize ||
+      header.checksum !=
+          hashBytes(data + sizeof(header), size - sizeof(header)))
+    return false;
+
+  FlatAST result;
+  bool ok = true;
+  int i = 0;
+  forEachArray(result, [&](auto &array) {
+    const Section &sec = header.sections[i++];
+    // 先除后比，count 很大时乘法会溢出
+    if (!ok || sec.offset > size ||
+        sec.count > (size - sec.offset) / sizeof(array[0])) {
+      ok = false;
+      return;
+    }
+    array.resize(sec.count);
+    // 空数组的 data() 可能是空指针
+    if (sec.count > 0)
+      memcpy(array.data(), data + sec.offset, sec.count * sizeof(array[0]));
+  });
+  const Section &names = header.sections[i];
+  if (!ok || names.offset > size || names.count > size - names.offset ||
+      header.numSymbols > names.count / sizeof(uint32_t))
+    return false;
+
+  // 名字表按出现顺序重新驻留，得到文件内编号到进程内 Symbol 的映射
+  std::vector<Symbol> symbols;
+  symbols.reserve(header.numSymbols);
+  const char *p = data + names.offset;
+  const char *end = p + names.count;
+  for (uint32_t n = 0; n < header.numSymbols; n++) {
+    uint32_t len;
+    if (end - p < static_cast<ptrdiff_t>(sizeof(len))) return false;
+    memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    if (static_cast<size_t>(end - p) < len) return false;
+    symbols.push_back(interner.intern(p, len));
+    p += len;
+  }
+  forEachSymbol(result, [&](Symbol &sym) {
+    if (sym >= symbols.size()) {
+      ok = false;
+      return;
+    }
+    sym = symbols[sym];
+  });
+  // 截断或改动过的文件也可能通过上面的大小检查，下标要逐个核对
+  if (!ok || !result.valid(sourceSize)) return false;
+  flat = std::move(result);
+  return true;
+}
+
+ASTCache::ASTCache(std::string dir) : dir(std::move(dir)) {
+  mkdir(this->dir.c_str(), 0755);
+}
+
+std::string ASTCache::path(uint64_t hash) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.ast",
+           static_cast<unsigned long long>(hash));
+  return dir + name;
+}
+
+bool ASTCache::load(std::string_view source, FlatAST &flat) const {
+  uint64_t hash = hashBytes(source.data(), source.size(), compilerHash());
+  int fd = open(path(hash).c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return false;
+  bool ok = deserializeFlatAST(static_cast<const char *>(p), st.st_size, hash,
+                               source.size(), flat);
+  munmap(p, st.st_size);
+  return ok;
+}
+
+bool ASTCache::store(std::string_view source, const FlatAST &flat) const {
+  uint64_t hash = hashBytes(source.data(), source.size(), compilerHash());
+  return replaceFile(path(hash), serializeFlatAST(flat, hash, source.size()));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "flat_ast.h"
+
+// 源文件内容的 64 位哈希（MurmurHash64A），用作缓存键
+uint64_t hashBytes(const char *data, size_t len, uint64_t seed = 0);
+// 编译器的版本指纹，进程内只算一次：缓存的内容由它生成，换了编译器
+// （语法、建树方式等变化）旧缓存就失效。取链接器写入的 GNU build-id，
+// 不必每次启动都读一遍可执行文件；没有 build-id 时才对文件求哈希
+uint64_t compilerHash();
+// 先写临时文件再 rename 成 path，多个进程同时写同一项也不会读到半个文件
+bool replaceFile(const std::string &path, std::string_view data);
+
+// 磁盘上的二进制 AST 缓存：每个源文件对应 <dir>/<哈希>.ast，哈希以
+// compilerHash() 为种子。文件内容是带版本号的 FlatAST 各数组的原样转储
+// 加一张名字表，按 8 字节对齐，可以直接 mmap 后校验并拷入 FlatAST。
+// 名字在写出时重新编号，读入时重新驻留
+class ASTCache {
+ public:
+  explicit ASTCache(std::string dir);
+
+  // 命中且格式、哈希、长度都匹配、内容通过 FlatAST::valid() 时
+  // 填充 flat 并返回 true，否则按未命中处理
+  bool load(std::string_view source, FlatAST &flat) const;
+  bool store(std::string_view source, const FlatAST &flat) const;
+  std::string path(uint64_t hash) const;
+
+ private:
+  std::string dir;
+};
+
+// 序列化为缓存文件格式 / 从映射的缓存文件反序列化
+std::string serializeFlatAST(const FlatAST &flat, uint64_t hash,
+                             uint64_t sourceSize);
+bool deserializeFlatAST(const char *data, size_t size, uint64_t hash,
+                        uint64_t sourceSize, FlatAST &flat);
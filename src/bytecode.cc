@@ -0,0 +1,347 @@
+#include "bytecode.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "cfg.h"
+
+// 算术、比较和条件跳转的操作码与 IR 中的顺序一致，可以直接换算
+static_assert(BC_FTOI - BC_ADD == OP_FTOI - OP_ADD, "arithmetic order");
+static_assert(BC_JGE - BC_JEQ == OP_GE - OP_EQ, "compare order");
+static_assert(BC_JFGE - BC_JFEQ == OP_FGE - OP_FEQ, "compare order");
+
+static const char *const BC_OP_NAMES[NUM_BC_OPS] = {
+#define BC_NAME(name) #name,
+    BC_OPS(BC_NAME)
+#undef BC_NAME
+};
+
+const char *bcOpName(BcOp op) { return BC_OP_NAMES[op]; }
+
+static const char *const BUILTIN_NAMES[NUM_BUILTINS] = {
+    "getint",   "getch",     "getfloat", "getarray",  "getfarray", "putint",
+    "putch",    "putfloat",  "putarray", "putfarray", "starttime", "stoptime",
+};
+
+Builtin builtinOf(Symbol name) {
+  std::string_view str = interner.name(name);
+  for (uint32_t i = 0; i < NUM_BUILTINS; i++)
+    if (str == BUILTIN_NAMES[i]) return Builtin(i);
+  return NUM_BUILTINS;
+}
+
+namespace {
+
+bool isCompare(Opcode op) { return op >= OP_EQ && op <= OP_FGE; }
+
+class FunctionCompiler {
+ public:
+  FunctionCompiler(const Module &module, const Function &func,
+                   BcFunction &out)
+      : module(module), func(func), out(out), cfg(func) {}
+
+  void run();
+
+ private:
+  // 跳转目标先记下块号或边，全部指令生成后再回填
+  struct Fixup {
+    uint32_t insn;
+    bool isC;  // 回填 c 字段，否则回填 d 字段
+    uint32_t block;
+  };
+  struct Stub {
+    uint32_t insn;
+    bool isC;
+    uint32_t from, to;
+  };
+
+  uint32_t reg(Value v) const;
+  void emit(BcOp op, uint32_t d = 0, uint32_t a = 0, uint32_t b = 0,
+            uint32_t c = 0) {
+    out.code.push_back({op, d, a, b, c});
+  }
+  void assignRegisters();
+  void inst(uint32_t index);
+  void terminator(uint32_t block, const Inst &inst, uint32_t next);
+  // 控制流边 from -> to 上 PHI 的并行拷贝
+  void copies(uint32_t from, uint32_t to);
+  bool hasCopies(uint32_t to) const {
+    return func.insts[func.blocks[to].insts[0]].op == OP_PHI;
+  }
+  // 条件跳转的一个目标：边上有拷贝时先跳到函数末尾的拷贝代码
+  void target(uint32_t from, uint32_t to, bool isC);
+
+  const Module &module;
+  const Function &func;
+  BcFunction &out;
+  CFG cfg;
+  std::vector<uint32_t> instReg;
+  std::vector<uint32_t> globalReg;
+  std::vector<uint32_t> useCount;
+  std::vector<bool> fused;  // 合并进使用者的比较和 GEP，不单独生成
+  std::vector<uint32_t> temps;
+  std::vector<uint32_t> blockPC;
+  std::vector<Fixup> fixups;
+  std::vector<Stub> stubs;
+};
+
+uint32_t FunctionCompiler::reg(Value v) const {
+  switch (kindOf(v)) {
+    case VK_INST:
+      return instReg[indexOf(v)];
+    case VK_ARG:
+      return out.paramBase + indexOf(v);
+    case VK_CONST:
+      return indexOf(v);
+    case VK_GLOBAL:
+      return globalReg[indexOf(v)];
+  }
+  return 0;
+}
+
+void FunctionCompiler::assignRegisters() {
+  useCount.assign(func.insts.size(), 0);
+  globalReg.assign(module.globals.size(), CFG::NONE);
+  fused.assign(func.insts.size(), false);
+  instReg.assign(func.insts.size(), 0);
+
+  // 常量占用寄存器 [0, consts.size())
+  out.init.resize(func.consts.size());
+  for (size_t i = 0; i < func.consts.size(); i++) {
+    out.init[i].p = nullptr;
+    memcpy(&out.init[i], &func.consts[i].bits, 4);
+  }
+  for (uint32_t b : cfg.rpo) {
+    for (uint32_t index : func.blocks[b].insts) {
+      forEachOperand(func, func.insts[index], [&](Value v) {
+        if (kindOf(v) == VK_INST) useCount[indexOf(v)]++;
+        if (kindOf(v) != VK_GLOBAL || globalReg[indexOf(v)] != CFG::NONE)
+          return;
+        globalReg[indexOf(v)] = out.init.size();
+        out.globalRegs.push_back({out.init.size(), indexOf(v)});
+        Slot slot;
+        slot.p = nullptr;
+        out.init.push_back(slot);
+      });
+    }
+  }
+  out.paramBase = out.init.size();
+  out.numRegs = out.paramBase + func.params.size();
+
+  for (uint32_t b : cfg.rpo) {
+    for (uint32_t index : func.blocks[b].insts) {
+      const Inst &inst = func.insts[index];
+      // void 调用也占一个寄存器，返回时往里写不会破坏常量
+      if (inst.type != IR_VOID || inst.op == OP_CALL)
+        instReg[index] = out.numRegs++;
+      // 同一块内只用一次的比较和地址计算并入条件跳转和访存指令
+      Value operand = NO_VALUE;
+      if (inst.op == OP_CONDBR || inst.op == OP_LOAD || inst.op == OP_STORE)
+        operand = inst.a;
+      if (operand == NO_VALUE || kindOf(operand) != VK_INST) continue;
+      const Inst &def = func.insts[indexOf(operand)];
+      if (def.block != b || useCount[indexOf(operand)] != 1) continue;
+      if (inst.op == OP_CONDBR ? isCompare(def.op) : def.op == OP_GEP)
+        fused[indexOf(operand)] = true;
+    }
+  }
+}
+
+void FunctionCompiler::inst(uint32_t index) {
+  const Inst &inst = func.insts[index];
+  uint32_t d = instReg[index];
+  switch (inst.op) {
+    case OP_ALLOCA:
+      emit(BC_ALLOCA, d, inst.a);
+      break;
+    case OP_LOAD:
+      if (kindOf(inst.a) == VK_INST && fused[indexOf(inst.a)]) {
+        const Inst &gep = func.insts[indexOf(inst.a)];
+        emit(BC_LOADX, d, reg(gep.a), reg(gep.b), gep.c);
+      } else {
+        emit(BC_LOAD, d, reg(inst.a));
+      }
+      break;
+    case OP_STORE:
+      if (kindOf(inst.a) == VK_INST && fused[indexOf(inst.a)]) {
+        const Inst &gep = func.insts[indexOf(inst.a)];
+        emit(BC_STOREX, reg(inst.b), reg(gep.a), reg(gep.b), gep.c);
+      } else {
+        emit(BC_STORE, 0, reg(inst.a), reg(inst.b));
+      }
+      break;
+    case OP_GEP:
+      emit(BC_GEP, d, reg(inst.a), reg(inst.b), inst.c);
+      break;
+    case OP_ZERO:
+      emit(BC_ZERO, 0, reg(inst.a), inst.b);
+      break;
+    case OP_CALL: {
+      const Function &callee = module.functions[inst.a];
+      uint32_t first = out.args.size();
+      for (uint32_t i = 0; i < inst.c; i++)
+        out.args.push_back(reg(func.lists[inst.b + i]));
+      if (callee.external)
+        emit(BC_CALLEXT, d, builtinOf(callee.name), first, inst.c);
+      else
+        emit(BC_CALL, d, inst.a, first, inst.c);
+      break;
+    }
+    case OP_PHI:
+      break;
+    default:  // 算术、比较和类型转换
+      emit(BcOp(BC_ADD + (inst.op - OP_ADD)), d, reg(inst.a),
+           inst.op == OP_FNEG || inst.op == OP_ITOF || inst.op == OP_FTOI
+               ? 0
+               : reg(inst.b));
+      break;
+  }
+}
+
+void FunctionCompiler::copies(uint32_t from, uint32_t to) {
+  std::vector<std::pair<uint32_t, uint32_t>> moves;  // (目标, 源)
+  for (uint32_t index : func.blocks[to].insts) {
+    const Inst &phi = func.insts[index];
+    if (phi.op != OP_PHI) break;
+    for (uint32_t i = 0; i < phi.c; i++) {
+      if (func.lists[phi.b + 2 * i + 1] != from) continue;
+      uint32_t src = reg(func.lists[phi.b + 2 * i]);
+      if (src != instReg[index]) moves.push_back({instReg[index], src});
+    }
+  }
+  // 某个源同时是另一条拷贝的目标时，先把所有源拷到临时寄存器
+  bool overlap = false;
+  for (auto &move : moves)
+    for (auto &other : moves) overlap = overlap || move.second == other.first;
+  if (!overlap || moves.size() == 1) {
+    for (auto &move : moves) emit(BC_MOV, move.first, move.second);
+    return;
+  }
+  while (temps.size() < moves.size()) temps.push_back(out.numRegs++);
+  for (size_t i = 0; i < moves.size(); i++)
+    emit(BC_MOV, temps[i], moves[i].second);
+  for (size_t i = 0; i < moves.size(); i++)
+    emit(BC_MOV, moves[i].first, temps[i]);
+}
+
+void FunctionCompiler::target(uint32_t from, uint32_t to, bool isC) {
+  uint32_t insn = out.code.size() - 1;
+  if (hasCopies(to))
+    stubs.push_back({insn, isC, from, to});
+  else
+    fixups.push_back({insn, isC, to});
+}
+
+void FunctionCompiler::terminator(uint32_t block, const Inst &inst,
+                                  uint32_t next) {
+  switch (inst.op) {
+    case OP_BR:
+      copies(block, inst.a);
+      if (inst.a != next) {
+        emit(BC_JMP);
+        fixups.push_back({uint32_t(out.code.size() - 1), false, inst.a});
+      }
+      break;
+    case OP_CONDBR:
+      if (kindOf(inst.a) == VK_INST && fused[indexOf(inst.a)]) {
+        const Inst &cmp = func.insts[indexOf(inst.a)];
+        BcOp op = cmp.op >= OP_FEQ ? BcOp(BC_JFEQ + (cmp.op - OP_FEQ))
+                                   : BcOp(BC_JEQ + (cmp.op - OP_EQ));
+        emit(op, 0, reg(cmp.a), reg(cmp.b));
+      } else {
+        emit(BC_JNZ, 0, reg(inst.a));
+      }
+      target(block, inst.b, false);
+      target(block, inst.c, true);
+      break;
+    case OP_RET:
+      if (inst.a == NO_VALUE)
+        emit(BC_RETV);
+      else
+        emit(BC_RET, 0, reg(inst.a));
+      break;
+    default:
+      break;
+  }
+}
+
+void FunctionCompiler::run() {
+  assignRegisters();
+  blockPC.assign(func.blocks.size(), 0);
+  for (size_t i = 0; i < cfg.rpo.size(); i++) {
+    uint32_t b = cfg.rpo[i];
+    uint32_t next = i + 1 < cfg.rpo.size() ? cfg.rpo[i + 1] : CFG::NONE;
+    blockPC[b] = out.code.size();
+    auto &insts = func.blocks[b].insts;
+    for (size_t k = 0; k + 1 < insts.size(); k++)
+      if (!fused[insts[k]]) inst(insts[k]);
+    terminator(b, func.insts[insts.back()], next);
+  }
+  for (auto &stub : stubs) {
+    BcInsn &insn = out.code[stub.insn];
+    (stub.isC ? insn.c : insn.d) = out.code.size();
+    copies(stub.from, stub.to);
+    emit(BC_JMP);
+    fixups.push_back({uint32_t(out.code.size() - 1), false, stub.to});
+  }
+  for (auto &fixup : fixups) {
+    BcInsn &insn = out.code[fixup.insn];
+    (fixup.isC ? insn.c : insn.d) = blockPC[fixup.block];
+  }
+}
+
+}  // namespace
+
+bool compileBytecode(const Module &module, BcProgram &program,
+                     std::string &error) {
+  program = BcProgram();
+  for (auto &global : module.globals) {
+    size_t base = program.data.size();
+    program.globalOffset.push_back(base);
+    program.data.resize(base + global.size, 0);
+    for (auto &run : global.init)
+      std::copy(run.words.begin(), run.words.end(),
+                program.data.begin() + base + run.offset);
+  }
+  program.functions.resize(module.functions.size());
+  for (size_t i = 0; i < module.functions.size(); i++) {
+    const Function &func = module.functions[i];
+    BcFunction &out = program.functions[i];
+    out.name = func.name;
+    out.external = func.external;
+    if (func.external) {
+      if (builtinOf(func.name) == NUM_BUILTINS) {
+        error = "unknown external function '" +
+                std::string(interner.name(func.name)) + "'";
+        return false;
+      }
+      continue;
+    }
+    if (interner.name(func.name) == "main") program.mainIndex = i;
+    FunctionCompiler(module, func, out).run();
+  }
+  if (program.mainIndex < 0) {
+    error = "no main function";
+    return false;
+  }
+  return true;
+}
+
+void dumpBytecode(const BcProgram &program, OutBuffer &out) {
+  char buf[96];
+  for (auto &func : program.functions) {
+    if (func.external) continue;
+    out.write(interner.name(func.name));
+    out.write(buf, snprintf(buf, sizeof(buf),
+                            ": %u regs, %zu constants, params at r%u\n",
+                            func.numRegs, func.init.size(), func.paramBase));
+    for (size_t pc = 0; pc < func.code.size(); pc++) {
+      const BcInsn &insn = func.code[pc];
+      out.write(buf, snprintf(buf, sizeof(buf), "%6zu  %-8s %u, %u, %u, %u\n",
+                              pc, bcOpName(insn.op), insn.d, insn.a, insn.b,
+                              insn.c));
+    }
+    out.put('\n');
+  }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ir.h"
+#include "out_buffer.h"
+
+// 寄存器式字节码。每个函数有固定数量的寄存器：开头是常量和用到的全局变量地址
+// （调用时从 BcFunction::init 整体拷贝），然后是形参，再往后是 SSA 值和
+// 消除 PHI 时用的临时寄存器。每个 SSA 值独占一个寄存器，PHI 翻译成控制流边上的
+// 并行拷贝。指令的 d/a/b/c 字段按操作码解释：
+//   MOV            d = a
+//   算术/比较      d = a op b；FNEG/ITOF/FTOI 只用 a
+//   ALLOCA         d = 栈顶，栈顶上移 a 个字
+//   LOAD / STORE   d = *a / *a = b
+//   GEP            d = a + b * c（c 为立即数步长）
+//   LOADX          d = *(a + b * c)，即 GEP + LOAD
+//   STOREX         *(a + b * c) = d
+//   ZERO           把 a 开始的 b 个字清零
+//   JMP            跳到 d
+//   JNZ            a 非 0 跳到 d，否则跳到 c
+//   J<cmp>         比较 a、b，成立跳到 d，否则跳到 c
+//   CALL           d = 函数 a(args[b, b + c))
+//   CALLEXT        d = 运行时库函数 a(args[b, b + c))
+//   RET            返回 a；RETV 无返回值
+#define BC_OPS(X)                                                          \
+  X(MOV)                                                                   \
+  X(ADD) X(SUB) X(MUL) X(DIV) X(MOD)                                       \
+  X(FADD) X(FSUB) X(FMUL) X(FDIV) X(FNEG)                                  \
+  X(EQ) X(NE) X(LT) X(LE) X(GT) X(GE)                                      \
+  X(FEQ) X(FNE) X(FLT) X(FLE) X(FGT) X(FGE)                                \
+  X(ITOF) X(FTOI)                                                          \
+  X(ALLOCA) X(LOAD) X(STORE) X(GEP) X(LOADX) X(STOREX) X(ZERO)             \
+  X(JMP) X(JNZ)                                                            \
+  X(JEQ) X(JNE) X(JLT) X(JLE) X(JGT) X(JGE)                                \
+  X(JFEQ) X(JFNE) X(JFLT) X(JFLE) X(JFGT) X(JFGE)                          \
+  X(CALL) X(CALLEXT) X(RET) X(RETV)
+
+enum BcOp : uint32_t {
+#define BC_ENUM(name) BC_##name,
+  BC_OPS(BC_ENUM)
+#undef BC_ENUM
+  NUM_BC_OPS
+};
+
+const char *bcOpName(BcOp op);
+
+struct BcInsn {
+  BcOp op;
+  uint32_t d, a, b, c;
+};
+
+union Slot {
+  int32_t i;
+  float f;
+  int32_t *p;
+};
+
+// 运行时库函数，CALLEXT 的 a 字段
+enum Builtin : uint32_t {
+  BUILTIN_GETINT, BUILTIN_GETCH, BUILTIN_GETFLOAT, BUILTIN_GETARRAY,
+  BUILTIN_GETFARRAY, BUILTIN_PUTINT, BUILTIN_PUTCH, BUILTIN_PUTFLOAT,
+  BUILTIN_PUTARRAY, BUILTIN_PUTFARRAY, BUILTIN_STARTTIME, BUILTIN_STOPTIME,
+  NUM_BUILTINS
+};
+// 按名字查找，不是运行时库函数时返回 NUM_BUILTINS
+Builtin builtinOf(Symbol name);
+
+struct BcFunction {
+  Symbol name;
+  bool external = false;
+  uint32_t numRegs = 0;
+  uint32_t paramBase = 0;  // 第一个形参的寄存器
+  std::vector<Slot> init;  // 寄存器 [0, init.size()) 的初值
+  // (寄存器, 全局变量) ：init 中这些寄存器要在加载时填成全局变量的地址
+  std::vector<std::pair<uint32_t, uint32_t>> globalRegs;
+  std::vector<uint32_t> args;  // CALL/CALLEXT 的实参寄存器
+  std::vector<BcInsn> code;
+};
+
+struct BcProgram {
+  std::vector<BcFunction> functions;  // 与 Module::functions 下标一致
+  std::vector<int32_t> data;          // 全局变量的初始内容，按顺序排列
+  std::vector<uint32_t> globalOffset;  // 每个全局变量在 data 中的起始字
+  int mainIndex = -1;
+};
+
+// 把校验过的 IR 编译成字节码；没有 main 或调用了未知的外部函数时返回 false
+bool compileBytecode(const Module &module, BcProgram &program,
+                     std::string &error);
+void dumpBytecode(const BcProgram &program, OutBuffer &out);
@@ -0,0 +1,71 @@
+#include "call_graph.h"
+
+#include <algorithm>
+
+#include "cfg.h"
+
+CallGraph::CallGraph(const Module &module) {
+  size_t n = module.functions.size();
+  callees.resize(n);
+  recursive.assign(n, false);
+  scc.assign(n, CFG::NONE);
+  for (uint32_t f = 0; f < n; f++) {
+    const Function &func = module.functions[f];
+    for (auto &block : func.blocks) {
+      for (uint32_t index : block.insts) {
+        const Inst &inst = func.insts[index];
+        if (inst.op != OP_CALL) continue;
+        if (inst.a == f) recursive[f] = true;
+        if (std::find(callees[f].begin(), callees[f].end(), inst.a) ==
+            callees[f].end())
+          callees[f].push_back(inst.a);
+      }
+    }
+  }
+
+  // 非递归的 Tarjan 算法；SCC 按完成的顺序编号，正好是被调者在前
+  std::vector<uint32_t> low(n), num(n, CFG::NONE), stack;
+  std::vector<bool> onStack(n, false);
+  std::vector<std::pair<uint32_t, uint32_t>> work;
+  uint32_t counter = 0, components = 0;
+  for (uint32_t root = 0; root < n; root++) {
+    if (num[root] != CFG::NONE) continue;
+    work.push_back({root, 0});
+    while (!work.empty()) {
+      auto &top = work.back();
+      uint32_t v = top.first;
+      if (top.second == 0) {
+        num[v] = low[v] = counter++;
+        stack.push_back(v);
+        onStack[v] = true;
+      }
+      if (top.second < callees[v].size()) {
+        uint32_t w = callees[v][top.second++];
+        if (num[w] == CFG::NONE)
+          work.push_back({w, 0});
+        else if (onStack[w])
+          low[v] = std::min(low[v], num[w]);
+        continue;
+      }
+      work.pop_back();
+      if (!work.empty()) {
+        uint32_t parent = work.back().first;
+        low[parent] = std::min(low[parent], low[v]);
+      }
+      if (low[v] != num[v]) continue;
+      size_t first = stack.size();
+      do {
+        first--;
+      } while (stack[first] != v);
+      for (size_t i = first; i < stack.size(); i++) {
+        uint32_t w = stack[i];
+        onStack[w] = false;
+        scc[w] = components;
+        bottomUp.push_back(w);
+        if (stack.size() - first > 1) recursive[w] = true;
+      }
+      stack.resize(first);
+      components++;
+    }
+  }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ir.h"
+
+// 模块的调用图：由 CALL 指令的被调函数下标直接得到（lower 时已把调用解析到
+// 函数定义）。运行时库函数也是图中的结点，只是没有出边
+class CallGraph {
+ public:
+  explicit CallGraph(const Module &module);
+
+  // a、b 在同一个强连通分量里，即互相（或自己）递归
+  bool sameSCC(uint32_t a, uint32_t b) const { return scc[a] == scc[b]; }
+
+  std::vector<std::vector<uint32_t>> callees;  // 去重后的被调函数
+  std::vector<bool> recursive;     // 在调用环上（包括直接自递归）
+  std::vector<uint32_t> bottomUp;  // 被调者先于调用者（SCC 的逆拓扑序）
+
+ private:
+  std::vector<uint32_t> scc;  // 所在强连通分量的编号
+};
@@ -0,0 +1,137 @@
+#include "cfg.h"
+
+#include <algorithm>
+
+CFG::CFG(const Function &func) {
+  size_t n = func.blocks.size();
+  preds.resize(n);
+  succs.resize(n);
+  order.assign(n, NONE);
+  for (uint32_t b = 0; b < n; b++) {
+    if (func.blocks[b].insts.empty()) continue;
+    forEachSuccessor(func.terminator(b), [&](uint32_t succ) {
+      // CONDBR 两个目标相同时只记一条边
+      if (std::find(succs[b].begin(), succs[b].end(), succ) != succs[b].end())
+        return;
+      succs[b].push_back(succ);
+      preds[succ].push_back(b);
+    });
+  }
+  if (n == 0) return;
+
+  // 非递归 DFS 求后序
+  std::vector<uint32_t> post;
+  std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0}};
+  std::vector<bool> visited(n, false);
+  visited[0] = true;
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.second < succs[top.first].size()) {
+      uint32_t succ = succs[top.first][top.second++];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.push_back({succ, 0});
+      }
+    } else {
+      post.push_back(top.first);
+      stack.pop_back();
+    }
+  }
+  rpo.assign(post.rbegin(), post.rend());
+  for (uint32_t i = 0; i < rpo.size(); i++) order[rpo[i]] = i;
+}
+
+DomTree::DomTree(const CFG &cfg) {
+  size_t n = cfg.order.size();
+  idom.assign(n, CFG::NONE);
+  children.resize(n);
+  pre.assign(n, CFG::NONE);
+  post.assign(n, 0);
+  if (cfg.rpo.empty()) return;
+
+  uint32_t entry = cfg.rpo[0];
+  idom[entry] = entry;
+  auto intersect = [&](uint32_t a, uint32_t b) {
+    while (a != b) {
+      while (cfg.order[a] > cfg.order[b]) a = idom[a];
+      while (cfg.order[b] > cfg.order[a]) b = idom[b];
+    }
+    return a;
+  };
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t i = 1; i < cfg.rpo.size(); i++) {
+      uint32_t b = cfg.rpo[i];
+      uint32_t dom = CFG::NONE;
+      for (uint32_t pred : cfg.preds[b]) {
+        if (idom[pred] == CFG::NONE) continue;
+        dom = dom == CFG::NONE ? pred : intersect(pred, dom);
+      }
+      if (dom != idom[b]) {
+        idom[b] = dom;
+        changed = true;
+      }
+    }
+  }
+
+  for (uint32_t b : cfg.rpo)
+    if (b != entry) children[idom[b]].push_back(b);
+
+  // 支配树上的先序/后序编号
+  uint32_t clock = 0;
+  std::vector<std::pair<uint32_t, uint32_t>> stack = {{entry, 0}};
+  pre[entry] = clock++;
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.second < children[top.first].size()) {
+      uint32_t child = children[top.first][top.second++];
+      pre[child] = clock++;
+      stack.push_back({child, 0});
+    } else {
+      post[top.first] = clock++;
+      stack.pop_back();
+    }
+  }
+}
+
+std::vector<std::vector<uint32_t>> DomTree::frontiers(const CFG &cfg) const {
+  std::vector<std::vector<uint32_t>> df(idom.size());
+  for (uint32_t b : cfg.rpo) {
+    if (cfg.preds[b].size() < 2) continue;
+    for (uint32_t pred : cfg.preds[b]) {
+      if (!cfg.reachable(pred)) continue;
+      for (uint32_t runner = pred; runner != idom[b]; runner = idom[runner]) {
+        if (df[runner].empty() || df[runner].back() != b)
+          df[runner].push_back(b);
+      }
+    }
+  }
+  return df;
+}
+
+std::vector<Loop> findLoops(const CFG &cfg, const DomTree &dom) {
+  std::vector<Loop> loops;
+  std::vector<uint32_t> mark(cfg.order.size(), CFG::NONE);
+  for (uint32_t h : cfg.rpo) {
+    std::vector<uint32_t> work;
+    for (uint32_t pred : cfg.preds[h])
+      if (cfg.reachable(pred) && dom.dominates(h, pred)) work.push_back(pred);
+    if (work.empty()) continue;
+    // 从回边的源头逆着边找回头块
+    Loop loop;
+    loop.header = h;
+    loop.blocks.push_back(h);
+    mark[h] = h;
+    while (!work.empty()) {
+      uint32_t b = work.back();
+      work.pop_back();
+      if (mark[b] == h) continue;
+      mark[b] = h;
+      loop.blocks.push_back(b);
+      for (uint32_t pred : cfg.preds[b])
+        if (cfg.reachable(pred)) work.push_back(pred);
+    }
+    loops.push_back(std::move(loop));
+  }
+  return loops;
+}
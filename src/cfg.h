@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ir.h"
+
+// 函数的控制流图：前驱、后继和可达块的逆后序。改动 CFG 后需要重新构造
+class CFG {
+ public:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  explicit CFG(const Function &func);
+
+  bool reachable(uint32_t block) const { return order[block] != NONE; }
+
+  std::vector<std::vector<uint32_t>> preds;
+  std::vector<std::vector<uint32_t>> succs;
+  std::vector<uint32_t> rpo;    // 从入口可达的块，按逆后序
+  std::vector<uint32_t> order;  // 块在 rpo 中的位置，不可达为 NONE
+};
+
+// 支配树（Cooper-Harvey-Kennedy 迭代算法），只包含可达块
+class DomTree {
+ public:
+  explicit DomTree(const CFG &cfg);
+
+  // a 支配 b（包括 a == b），a、b 都须可达；用支配树先序/后序编号 O(1) 判断
+  bool dominates(uint32_t a, uint32_t b) const {
+    return pre[a] <= pre[b] && post[b] <= post[a];
+  }
+  // 每个块的支配边界，按需计算
+  std::vector<std::vector<uint32_t>> frontiers(const CFG &cfg) const;
+
+  std::vector<uint32_t> idom;  // 入口块的 idom 是自己，不可达块为 CFG::NONE
+  std::vector<std::vector<uint32_t>> children;
+
+ private:
+  std::vector<uint32_t> pre, post;
+};
+
+// 自然循环：头块和循环体（包括头块）
+struct Loop {
+  uint32_t header;
+  std::vector<uint32_t> blocks;
+};
+
+// 按回边找出所有自然循环，同一个头块的回边合成一个循环；外层循环在前
+std::vector<Loop> findLoops(const CFG &cfg, const DomTree &dom);
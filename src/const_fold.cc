@@ -0,0 +1,372 @@
+#include "const_fold.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+ConstValue ConstValue::to(TYPE type) const {
+  if (type == TYPE_FLOAT) return ofFloat(asFloat());
+  return ofInt(asInt());
+}
+
+namespace {
+
+bool constant(const ExpAST *exp, ConstValue &value) {
+  if (exp == nullptr || exp->kind != EXP_NUMBER) return false;
+  auto num = static_cast<const NumberAST *>(exp);
+  value = num->isInt ? ConstValue::ofInt(num->intval)
+                     : ConstValue::ofFloat(num->floatval);
+  return true;
+}
+
+bool truthy(ConstValue v) { return v.isInt ? v.intval != 0 : v.floatval != 0; }
+
+// int 运算按 32 位补码回绕；除零和 INT_MIN / -1 不折叠，留到运行时
+bool evalInt(BOP op, int a, int b, int &out) {
+  unsigned ua = a, ub = b;
+  switch (op) {
+    case BOP_MUL: out = static_cast<int>(ua * ub); return true;
+    case BOP_ADD: out = static_cast<int>(ua + ub); return true;
+    case BOP_MINUS: out = static_cast<int>(ua - ub); return true;
+    case BOP_DIV:
+    case BOP_MOD:
+      if (b == 0 || (a == INT_MIN && b == -1)) return false;
+      out = op == BOP_DIV ? a / b : a % b;
+      return true;
+    case BOP_GTE: out = a >= b; return true;
+    case BOP_LTE: out = a <= b; return true;
+    case BOP_GT: out = a > b; return true;
+    case BOP_LT: out = a < b; return true;
+    case BOP_EQ: out = a == b; return true;
+    case BOP_NEQ: out = a != b; return true;
+    default: return false;
+  }
+}
+
+// 有一边是 float 时另一边先转成 float；比较结果是 int，float 不能取模
+bool evalFloat(BOP op, float a, float b, ConstValue &out) {
+  switch (op) {
+    case BOP_MUL: out = ConstValue::ofFloat(a * b); return true;
+    case BOP_ADD: out = ConstValue::ofFloat(a + b); return true;
+    case BOP_MINUS: out = ConstValue::ofFloat(a - b); return true;
+    case BOP_DIV:
+      if (b == 0) return false;
+      out = ConstValue::ofFloat(a / b);
+      return true;
+    case BOP_GTE: out = ConstValue::ofInt(a >= b); return true;
+    case BOP_LTE: out = ConstValue::ofInt(a <= b); return true;
+    case BOP_GT: out = ConstValue::ofInt(a > b); return true;
+    case BOP_LT: out = ConstValue::ofInt(a < b); return true;
+    case BOP_EQ: out = ConstValue::ofInt(a == b); return true;
+    case BOP_NEQ: out = ConstValue::ofInt(a != b); return true;
+    default: return false;
+  }
+}
+
+bool evalBinary(BOP op, ConstValue l, ConstValue r, ConstValue &out) {
+  if (op == BOP_AND || op == BOP_OR) {
+    bool v = op == BOP_AND ? truthy(l) && truthy(r) : truthy(l) || truthy(r);
+    out = ConstValue::ofInt(v);
+    return true;
+  }
+  if (l.isInt && r.isInt) {
+    int v;
+    if (!evalInt(op, l.intval, r.intval, v)) return false;
+    out = ConstValue::ofInt(v);
+    return true;
+  }
+  return evalFloat(op, l.asFloat(), r.asFloat(), out);
+}
+
+// 表达式子树的节点数
+size_t countNodes(const ExpAST *exp) {
+  if (exp == nullptr) return 0;
+  size_t n = 1;
+  switch (exp->kind) {
+    case EXP_BINARY: {
+      auto bin = static_cast<const BinaryExpAST *>(exp);
+      return n + countNodes(bin->lhs) + countNodes(bin->rhs);
+    }
+    case EXP_UNARY:
+      return n + countNodes(static_cast<const UnaryExpAST *>(exp)->exp);
+    case EXP_LVAL:
+      for (auto index : static_cast<const LValAST *>(exp)->arrays)
+        n += countNodes(index);
+      return n;
+    case EXP_CALL:
+      for (auto arg : static_cast<const CallAST *>(exp)->funcCParamList)
+        n += countNodes(arg);
+      return n;
+    case EXP_NUMBER:
+      return n;
+  }
+  return n;
+}
+
+}  // namespace
+
+size_t elementCount(const std::vector<int> &dims, size_t from) {
+  size_t n = 1;
+  for (size_t i = from; i < dims.size(); i++) n *= dims[i];
+  return n;
+}
+
+ConstValue FlatInit::at(size_t pos, ConstValue zero) const {
+  auto it = std::upper_bound(
+      runs.begin(), runs.end(), pos,
+      [](size_t pos, const Run &run) { return pos < run.offset; });
+  if (it == runs.begin()) return zero;
+  --it;
+  size_t i = pos - it->offset;
+  return i < it->values.size() ? it->values[i] : zero;
+}
+
+void FlatInit::set(size_t pos, ConstValue value) {
+  // -0.0f 不是 0，要保留
+  uint32_t bits;
+  if (value.isInt)
+    bits = value.intval;
+  else
+    memcpy(&bits, &value.floatval, sizeof(bits));
+  if (bits == 0) return;
+  if (runs.empty() ||
+      runs.back().offset + runs.back().values.size() != pos)
+    runs.push_back({pos, {}});
+  runs.back().values.push_back(value);
+}
+
+bool flattenInitVal(InitValAST &init, const std::vector<int> &dims,
+                    FlatInit &out) {
+  out.runs.clear();
+  out.size = elementCount(dims);
+  return forEachInit(init, dims, [&](size_t pos, ExpAST *exp) {
+    ConstValue value;
+    if (!constant(exp, value)) return false;
+    out.set(pos, value);
+    return true;
+  });
+}
+
+ExpAST *ConstFolder::fold(ExpAST *exp) {
+  if (exp == nullptr) return nullptr;
+  result = exp;
+  exp->accept(*this);
+  return result;
+}
+
+void ConstFolder::foldAll(std::vector<ExpAST *> &list) {
+  for (auto &exp : list) exp = fold(exp);
+}
+
+ExpAST *ConstFolder::number(ConstValue value) {
+  NumberAST *num = arena.make<NumberAST>();
+  num->isInt = value.isInt;
+  if (value.isInt)
+    num->intval = value.intval;
+  else
+    num->floatval = value.floatval;
+  return num;
+}
+
+void ConstFolder::shape(Symbol id, std::vector<ExpAST *> &arrays,
+                        std::vector<int> &dims) {
+  foldAll(arrays);
+  dims.clear();
+  for (ExpAST *exp : arrays) {
+    ConstValue value;
+    if (!constant(exp, value) || !value.isInt) {
+      error("array size of '" + std::string(interner.name(id)) +
+            "' is not an integer constant");
+      dims.clear();
+      return;
+    }
+    if (value.intval < 0) {
+      error("array size of '" + std::string(interner.name(id)) +
+            "' is negative");
+      dims.clear();
+      return;
+    }
+    dims.push_back(value.intval);
+  }
+}
+
+void ConstFolder::error(const std::string &msg) {
+  errors++;
+  printf("%s: %s\n", filename.c_str(), msg.c_str());
+}
+
+void ConstFolder::visit(CompUnitAST &ast) {
+  scope.enterScope();
+  for (auto declDef : ast.declDefList) declDef->accept(*this);
+  scope.exitScope();
+}
+
+void ConstFolder::visit(DeclDefAST &ast) {
+  if (ast.Decl != nullptr) ast.Decl->accept(*this);
+  if (ast.funcDef != nullptr) ast.funcDef->accept(*this);
+}
+
+void ConstFolder::visit(DeclAST &ast) {
+  declType = ast.bType;
+  declConst = ast.isConst;
+  for (auto def : ast.defList) def->accept(*this);
+}
+
+void ConstFolder::visit(DefAST &ast) {
+  shape(ast.id, ast.arrays, ast.dims);
+  Binding &binding = bindings.emplace_back();
+  binding.isConst = declConst;
+  binding.dims = ast.dims;
+  if (ast.initVal != nullptr) ast.initVal->accept(*this);
+  std::string name(interner.name(ast.id));
+  // 标量用花括号、数组用单个表达式初始化的情况由 Sema 报错；
+  // 数组大小有错时 shape() 已经报过
+  bool checked = ast.initVal != nullptr &&
+                 ast.arrays.size() == ast.dims.size() &&
+                 (ast.initVal->exp != nullptr) == ast.dims.empty();
+  bool allConstant = true;
+  if (checked && !forEachInit(*ast.initVal, ast.dims, [&](size_t, ExpAST *exp) {
+        allConstant = allConstant && exp->kind == EXP_NUMBER;
+        return true;
+      })) {
+    error("initializer of '" + name + "' does not match its shape");
+    binding.isConst = false;
+  } else if (declConst) {
+    binding.zero = ConstValue().to(declType);
+    if (ast.initVal == nullptr ||
+        !flattenInitVal(*ast.initVal, ast.dims, binding.values)) {
+      error("initializer of const '" + name + "' is not a constant expression");
+      binding.isConst = false;
+    }
+  } else if (checked && !inFunction && !allConstant) {
+    error("initializer of global '" + name + "' is not a constant expression");
+  }
+  scope.bind(ast.id, &binding);
+}
+
+void ConstFolder::visit(InitValAST &ast) {
+  if (ast.exp != nullptr) {
+    ast.exp = fold(ast.exp);
+    // 初值按声明类型做隐式转换
+    ConstValue value;
+    if (constant(ast.exp, value) && value.isInt != (declType == TYPE_INT)) {
+      auto num = static_cast<NumberAST *>(ast.exp);
+      value = value.to(declType);
+      num->isInt = value.isInt;
+      if (value.isInt)
+        num->intval = value.intval;
+      else
+        num->floatval = value.floatval;
+    }
+  }
+  for (auto initVal : ast.initValList) initVal->accept(*this);
+}
+
+void ConstFolder::visit(FuncDefAST &ast) {
+  scope.enterScope();
+  inFunction = true;
+  for (auto param : ast.funcFParamList) param->accept(*this);
+  if (ast.block != nullptr) ast.block->accept(*this);
+  inFunction = false;
+  scope.exitScope();
+}
+
+void ConstFolder::visit(FuncFParamAST &ast) {
+  shape(ast.id, ast.arrays, ast.dims);
+  scope.bind(ast.id, &bindings.emplace_back());
+}
+
+void ConstFolder::visit(BlockAST &ast) {
+  scope.enterScope();
+  for (auto item : ast.blockItemList) item->accept(*this);
+  scope.exitScope();
+}
+
+void ConstFolder::visit(BlockItemAST &ast) {
+  if (ast.decl != nullptr) ast.decl->accept(*this);
+  if (ast.stmt != nullptr) ast.stmt->accept(*this);
+}
+
+void ConstFolder::visit(StmtAST &ast) {
+  // 赋值的左值本身不能替换，只折叠下标
+  if (ast.lVal != nullptr) foldAll(ast.lVal->arrays);
+  ast.exp = fold(ast.exp);
+  if (ast.returnStmt != nullptr) ast.returnStmt->accept(*this);
+  if (ast.selectStmt != nullptr) ast.selectStmt->accept(*this);
+  if (ast.iterationStmt != nullptr) ast.iterationStmt->accept(*this);
+  if (ast.block != nullptr) ast.block->accept(*this);
+}
+
+void ConstFolder::visit(ReturnStmtAST &ast) { ast.exp = fold(ast.exp); }
+
+void ConstFolder::visit(SelectStmtAST &ast) {
+  ast.cond = fold(ast.cond);
+  if (ast.ifStmt != nullptr) ast.ifStmt->accept(*this);
+  if (ast.elseStmt != nullptr) ast.elseStmt->accept(*this);
+}
+
+void ConstFolder::visit(IterationStmtAST &ast) {
+  ast.cond = fold(ast.cond);
+  if (ast.stmt != nullptr) ast.stmt->accept(*this);
+}
+
+void ConstFolder::visit(BinaryExpAST &ast) {
+  ast.lhs = fold(ast.lhs);
+  ConstValue l, r, value;
+  // 短路求值：左边已经决定结果时右边不会执行，可以整个丢掉
+  if ((ast.op == BOP_AND || ast.op == BOP_OR) && constant(ast.lhs, l) &&
+      truthy(l) == (ast.op == BOP_OR)) {
+    removed += 1 + countNodes(ast.rhs);
+    result = number(ConstValue::ofInt(ast.op == BOP_OR));
+    return;
+  }
+  ast.rhs = fold(ast.rhs);
+  result = &ast;
+  if (constant(ast.lhs, l) && constant(ast.rhs, r) &&
+      evalBinary(ast.op, l, r, value)) {
+    removed += 2;
+    result = number(value);
+  }
+}
+
+void ConstFolder::visit(UnaryExpAST &ast) {
+  ast.exp = fold(ast.exp);
+  result = &ast;
+  ConstValue value;
+  if (!constant(ast.exp, value)) return;
+  if (ast.op == UOP_MINUS)
+    value = value.isInt ? ConstValue::ofInt(0u - value.intval)
+                        : ConstValue::ofFloat(-value.floatval);
+  else if (ast.op == UOP_NOT)
+    value = ConstValue::ofInt(!truthy(value));
+  removed += 1;
+  result = number(value);
+}
+
+void ConstFolder::visit(LValAST &ast) {
+  foldAll(ast.arrays);
+  result = &ast;
+  const Binding *const *found = scope.find(ast.id);
+  if (found == nullptr || !(*found)->isConst) return;
+  const Binding &binding = **found;
+  // 只有下标全部给出且都是常量时才是一个标量常量
+  if (ast.arrays.size() != binding.dims.size()) return;
+  size_t index = 0;
+  for (size_t i = 0; i < ast.arrays.size(); i++) {
+    ConstValue sub;
+    if (!constant(ast.arrays[i], sub) || !sub.isInt || sub.intval < 0 ||
+        sub.intval >= binding.dims[i])
+      return;
+    index = index * binding.dims[i] + sub.intval;
+  }
+  removed += ast.arrays.size();
+  result = number(binding.values.at(index, binding.zero));
+}
+
+void ConstFolder::visit(NumberAST &ast) { result = &ast; }
+
+void ConstFolder::visit(CallAST &ast) {
+  foldAll(ast.funcCParamList);
+  result = &ast;
+}
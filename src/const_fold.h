@@ -0,0 +1,139 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "arena.h"
+#include "ast.h"
+#include "symtab.h"
+
+// 编译期常量值，按 SysY 语义 int 为 32 位补码、float 为单精度
+struct ConstValue {
+  bool isInt = true;
+  int intval = 0;
+  float floatval = 0;
+
+  static ConstValue ofInt(int v) { return {true, v, 0}; }
+  static ConstValue ofFloat(float v) { return {false, 0, v}; }
+  // 按声明类型做隐式转换：float 转 int 向零截断
+  ConstValue to(TYPE type) const;
+  int asInt() const { return isInt ? intval : static_cast<int>(floatval); }
+  float asFloat() const { return isInt ? static_cast<float>(intval) : floatval; }
+};
+
+// dims[from..] 组成的子数组的元素个数
+size_t elementCount(const std::vector<int> &dims, size_t from = 0);
+
+// 用 init 填充从 base 开始、形状为 dims[depth..] 的子数组。
+// 遇到嵌套的花括号时，对齐到当前位置能整除的最大子数组边界
+template <typename F>
+bool forEachInit(InitValAST &init, const std::vector<int> &dims, size_t depth,
+                 size_t base, F &fn) {
+  size_t end = base + elementCount(dims, depth);
+  size_t pos = base;
+  for (InitValAST *item : init.initValList) {
+    if (pos >= end) return false;
+    if (item->exp != nullptr) {
+      if (!fn(pos++, item->exp)) return false;
+      continue;
+    }
+    size_t k = depth + 1;
+    while (k < dims.size() && (pos - base) % elementCount(dims, k) != 0) k++;
+    if (k == dims.size()) return false;
+    if (!forEachInit(*item, dims, k, pos, fn)) return false;
+    pos += elementCount(dims, k);
+  }
+  return true;
+}
+
+// 按 SysY 的花括号对齐规则遍历初始化列表，对每个给出的元素调用
+// fn(行主序下标, ExpAST *)，fn 返回 false 时停止。
+// 初值的形状与 dims 不符或 fn 返回 false 时返回 false
+template <typename F>
+bool forEachInit(InitValAST &init, const std::vector<int> &dims, F fn) {
+  if (dims.empty()) return init.exp != nullptr && fn(0, init.exp);
+  if (init.exp != nullptr) return false;
+  return forEachInit(init, dims, 0, 0, fn);
+}
+
+// 展开后的数组初值：行主序下按 offset 递增的几段连续的非零元素，
+// 段外的元素都是 0。只存非零元素，大而稀疏的数组不用按整个形状展开
+struct FlatInit {
+  struct Run {
+    size_t offset;
+    std::vector<ConstValue> values;
+  };
+  std::vector<Run> runs;
+  size_t size = 0;  // 元素总数，最后一段之后到 size 都补 0
+
+  // 第 pos 个元素，落在段外时返回 zero
+  ConstValue at(size_t pos, ConstValue zero) const;
+  // 记下第 pos 个元素，pos 要大于之前记过的下标；位模式全 0 的值不记
+  void set(size_t pos, ConstValue value);
+};
+
+// 把初始化列表展开成 FlatInit，耗时与给出的元素个数成正比；
+// 表达式必须已经折叠成 NumberAST，否则返回 false
+bool flattenInitVal(InitValAST &init, const std::vector<int> &dims,
+                    FlatInit &out);
+
+// 常量折叠：把 const 声明和常量子表达式替换成 NumberAST 叶子，
+// 把数组各维长度求成具体整数存进 DefAST::dims / FuncFParamAST::dims。
+// 初始化列表与数组形状不符、全局变量的初值不是常量时报错，
+// 通过检查的初值在翻译成 IR 时都能展开。
+// 新节点从 arena 分配，被替换下来的节点留在原 Arena 中不再引用
+class ConstFolder : public Visitor {
+ public:
+  ConstFolder(Arena &arena, std::string filename)
+      : arena(arena), filename(std::move(filename)) {}
+
+  void visit(CompUnitAST &ast) override;
+  void visit(DeclDefAST &ast) override;
+  void visit(DeclAST &ast) override;
+  void visit(DefAST &ast) override;
+  void visit(InitValAST &ast) override;
+  void visit(FuncDefAST &ast) override;
+  void visit(FuncFParamAST &ast) override;
+  void visit(BlockAST &ast) override;
+  void visit(BlockItemAST &ast) override;
+  void visit(StmtAST &ast) override;
+  void visit(ReturnStmtAST &ast) override;
+  void visit(SelectStmtAST &ast) override;
+  void visit(IterationStmtAST &ast) override;
+  void visit(BinaryExpAST &ast) override;
+  void visit(UnaryExpAST &ast) override;
+  void visit(LValAST &ast) override;
+  void visit(NumberAST &ast) override;
+  void visit(CallAST &ast) override;
+
+  size_t removed = 0;  // 折叠掉的节点数
+  int errors = 0;
+
+ private:
+  // 作用域内的一个名字；非 const 的变量也要登记，用来遮蔽外层的同名常量
+  struct Binding {
+    bool isConst = false;
+    std::vector<int> dims;
+    FlatInit values;  // 标量的 size 为 1
+    ConstValue zero;  // 缺省元素的值，按声明类型
+  };
+
+  // 折叠一个表达式，返回替换后的节点（可能就是原节点）
+  ExpAST *fold(ExpAST *exp);
+  void foldAll(std::vector<ExpAST *> &list);
+  // 折叠数组各维长度表达式，存进 dims
+  void shape(Symbol id, std::vector<ExpAST *> &arrays, std::vector<int> &dims);
+  ExpAST *number(ConstValue value);
+  void error(const std::string &msg);
+
+  Arena &arena;
+  std::string filename;
+  TYPE declType = TYPE_INT;  // 当前声明的类型，初值按它转换
+  bool declConst = false;
+  bool inFunction = false;  // 全局变量的初值必须是常量
+  ExpAST *result = nullptr;  // 表达式 visit 的返回值
+  std::deque<Binding> bindings;
+  ScopedTable<const Binding *> scope;
+};
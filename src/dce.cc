@@ -0,0 +1,39 @@
+#include "pass.h"
+
+bool dce(Module &module, Function &func) {
+  std::vector<bool> live(func.insts.size(), false);
+  std::vector<uint32_t> work;
+  for (auto &block : func.blocks) {
+    for (uint32_t index : block.insts) {
+      switch (func.insts[index].op) {
+        case OP_STORE: case OP_ZERO: case OP_CALL:
+        case OP_BR: case OP_CONDBR: case OP_RET:
+          live[index] = true;
+          work.push_back(index);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  while (!work.empty()) {
+    uint32_t index = work.back();
+    work.pop_back();
+    forEachOperand(func, func.insts[index], [&](Value v) {
+      if (kindOf(v) != VK_INST || live[indexOf(v)]) return;
+      live[indexOf(v)] = true;
+      work.push_back(indexOf(v));
+    });
+  }
+
+  bool changed = false;
+  for (auto &block : func.blocks) {
+    for (uint32_t index : block.insts) {
+      if (live[index]) continue;
+      func.insts[index].op = OP_NOP;
+      changed = true;
+    }
+  }
+  if (changed) removeNops(func);
+  return changed;
+}
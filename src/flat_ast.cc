@@ -0,0 +1,569 @@
+#include "flat_ast.h"
+
+namespace {
+
+// 指针树 -> 连续存储
+class Builder {
+ public:
+  explicit Builder(FlatAST &f) : f(f) {}
+
+  uint32_t decl(DeclAST &ast) {
+    FlatAST::Decl rec{static_cast<uint8_t>(ast.bType), ast.isConst,
+                      list(ast.defList, &Builder::def)};
+    f.decls.push_back(rec);
+    return f.decls.size() - 1;
+  }
+
+  uint32_t def(DefAST &ast) {
+    FlatAST::Def rec{ast.id, list(ast.arrays, &Builder::exp),
+                     ast.initVal ? initVal(*ast.initVal) : FlatAST::NONE};
+    f.defs.push_back(rec);
+    return f.defs.size() - 1;
+  }
+
+  uint32_t initVal(InitValAST &ast) {
+    FlatAST::InitVal rec{ast.exp ? exp(*ast.exp) : FlatAST::NONE,
+                         list(ast.initValList, &Builder::initVal)};
+    f.initVals.push_back(rec);
+    return f.initVals.size() - 1;
+  }
+
+  uint32_t funcDef(FuncDefAST &ast) {
+    FlatAST::Range params = list(ast.funcFParamList, &Builder::param);
+    FlatAST::FuncDef rec{static_cast<uint8_t>(ast.funcType), ast.id, params,
+                         block(*ast.block)};
+    f.funcDefs.push_back(rec);
+    return f.funcDefs.size() - 1;
+  }
+
+  uint32_t param(FuncFParamAST &ast) {
+    FlatAST::FuncFParam rec{static_cast<uint8_t>(ast.bType), ast.isArray,
+                            ast.id, list(ast.arrays, &Builder::exp)};
+    f.params.push_back(rec);
+    return f.params.size() - 1;
+  }
+
+  uint32_t block(BlockAST &ast) {
+    FlatAST::Block rec{list(ast.blockItemList, &Builder::blockItem)};
+    f.blocks.push_back(rec);
+    return f.blocks.size() - 1;
+  }
+
+  uint32_t blockItem(BlockItemAST &ast) {
+    FlatAST::BlockItem rec{ast.decl != nullptr,
+                           ast.decl ? decl(*ast.decl) : stmt(*ast.stmt)};
+    f.blockItems.push_back(rec);
+    return f.blockItems.size() - 1;
+  }
+
+  uint32_t stmt(StmtAST &ast) {
+    FlatAST::Stmt rec{static_cast<uint8_t>(ast.sType), FlatAST::NONE,
+                      FlatAST::NONE, FlatAST::NONE};
+    switch (ast.sType) {
+      case ASS:
+        rec.a = exp(*ast.lVal);
+        rec.b = exp(*ast.exp);
+        break;
+      case EXP:
+        rec.a = exp(*ast.exp);
+        break;
+      case RET:
+        if (ast.returnStmt->exp) rec.a = exp(*ast.returnStmt->exp);
+        break;
+      case BLK:
+        rec.a = block(*ast.block);
+        break;
+      case SELECT:
+        rec.a = exp(*ast.selectStmt->cond);
+        rec.b = stmt(*ast.selectStmt->ifStmt);
+        if (ast.selectStmt->elseStmt) rec.c = stmt(*ast.selectStmt->elseStmt);
+        break;
+      case ITER:
+        rec.a = exp(*ast.iterationStmt->cond);
+        rec.b = stmt(*ast.iterationStmt->stmt);
+        break;
+      default:
+        break;
+    }
+    f.stmts.push_back(rec);
+    return f.stmts.size() - 1;
+  }
+
+  uint32_t exp(ExpAST &ast) {
+    FlatAST::Exp rec{static_cast<uint8_t>(ast.kind), 0, 0,
+                     static_cast<uint32_t>(ast.parens), 0, 0, {0, 0}};
+    switch (ast.kind) {
+      case EXP_BINARY: {
+        auto &binary = static_cast<BinaryExpAST &>(ast);
+        rec.op = binary.op;
+        rec.a = exp(*binary.lhs);
+        rec.b = exp(*binary.rhs);
+        break;
+      }
+      case EXP_UNARY: {
+        auto &unary = static_cast<UnaryExpAST &>(ast);
+        rec.op = unary.op;
+        rec.a = exp(*unary.exp);
+        break;
+      }
+      case EXP_NUMBER: {
+        auto &number = static_cast<NumberAST &>(ast);
+        rec.isInt = number.isInt;
+        memcpy(&rec.a, &number.intval, sizeof(rec.a));
+        break;
+      }
+      case EXP_LVAL: {
+        auto &lVal = static_cast<LValAST &>(ast);
+        rec.a = lVal.id;
+        rec.list = list(lVal.arrays, &Builder::exp);
+        break;
+      }
+      case EXP_CALL: {
+        auto &call = static_cast<CallAST &>(ast);
+        rec.a = call.id;
+        rec.list = list(call.funcCParamList, &Builder::exp);
+        break;
+      }
+    }
+    f.exps.push_back(rec);
+    return f.exps.size() - 1;
+  }
+
+ private:
+  // 先转换全部子节点，再把下标连续追加到 lists
+  template <typename T, typename R>
+  FlatAST::Range list(const std::vector<T *> &children,
+                      uint32_t (Builder::*convert)(R &)) {
+    std::vector<uint32_t> indices;
+    indices.reserve(children.size());
+    for (T *child : children) indices.push_back((this->*convert)(*child));
+    FlatAST::Range range{static_cast<uint32_t>(f.lists.size()),
+                         static_cast<uint32_t>(indices.size())};
+    f.lists.insert(f.lists.end(), indices.begin(), indices.end());
+    return range;
+  }
+
+  FlatAST &f;
+};
+
+// 连续存储 -> 指针树
+class Inflater {
+ public:
+  Inflater(const FlatAST &f, Arena &arena) : f(f), arena(arena) {}
+
+  DeclAST *decl(uint32_t i) {
+    const FlatAST::Decl &rec = f.decls[i];
+    auto ast = arena.make<DeclAST>();
+    ast->bType = static_cast<TYPE>(rec.bType);
+    ast->isConst = rec.isConst;
+    list(rec.defs, ast->defList, &Inflater::def);
+    return ast;
+  }
+
+  DefAST *def(uint32_t i) {
+    const FlatAST::Def &rec = f.defs[i];
+    auto ast = arena.make<DefAST>();
+    ast->id = rec.id;
+    list(rec.arrays, ast->arrays, &Inflater::exp);
+    if (rec.initVal != FlatAST::NONE) ast->initVal = initVal(rec.initVal);
+    return ast;
+  }
+
+  InitValAST *initVal(uint32_t i) {
+    const FlatAST::InitVal &rec = f.initVals[i];
+    auto ast = arena.make<InitValAST>();
+    if (rec.exp != FlatAST::NONE) ast->exp = exp(rec.exp);
+    list(rec.list, ast->initValList, &Inflater::initVal);
+    return ast;
+  }
+
+  FuncDefAST *funcDef(uint32_t i) {
+    const FlatAST::FuncDef &rec = f.funcDefs[i];
+    auto ast = arena.make<FuncDefAST>();
+    ast->funcType = static_cast<TYPE>(rec.funcType);
+    ast->id = rec.id;
+    list(rec.params, ast->funcFParamList, &Inflater::param);
+    ast->block = block(rec.block);
+    return ast;
+  }
+
+  FuncFParamAST *param(uint32_t i) {
+    const FlatAST::FuncFParam &rec = f.params[i];
+    auto ast = arena.make<FuncFParamAST>();
+    ast->bType = static_cast<TYPE>(rec.bType);
+    ast->isArray = rec.isArray;
+    ast->id = rec.id;
+    list(rec.arrays, ast->arrays, &Inflater::exp);
+    return ast;
+  }
+
+  BlockAST *block(uint32_t i) {
+    auto ast = arena.make<BlockAST>();
+    list(f.blocks[i].items, ast->blockItemList, &Inflater::blockItem);
+    return ast;
+  }
+
+  BlockItemAST *blockItem(uint32_t i) {
+    const FlatAST::BlockItem &rec = f.blockItems[i];
+    auto ast = arena.make<BlockItemAST>();
+    if (rec.isDecl)
+      ast->decl = decl(rec.node);
+    else
+      ast->stmt = stmt(rec.node);
+    return ast;
+  }
+
+  StmtAST *stmt(uint32_t i) {
+    const FlatAST::Stmt &rec = f.stmts[i];
+    auto ast = arena.make<StmtAST>();
+    ast->sType = static_cast<STYPE>(rec.sType);
+    switch (ast->sType) {
+      case ASS:
+        ast->lVal = static_cast<LValAST *>(exp(rec.a));
+        ast->exp = exp(rec.b);
+        break;
+      case EXP:
+        ast->exp = exp(rec.a);
+        break;
+      case RET:
+        ast->returnStmt = arena.make<ReturnStmtAST>();
+        if (rec.a != FlatAST::NONE) ast->returnStmt->exp = exp(rec.a);
+        break;
+      case BLK:
+        ast->block = block(rec.a);
+        break;
+      case SELECT:
+        ast->selectStmt = arena.make<SelectStmtAST>();
+        ast->selectStmt->cond = exp(rec.a);
+        ast->selectStmt->ifStmt = stmt(rec.b);
+        if (rec.c != FlatAST::NONE) ast->selectStmt->elseStmt = stmt(rec.c);
+        break;
+      case ITER:
+        ast->iterationStmt = arena.make<IterationStmtAST>();
+        ast->iterationStmt->cond = exp(rec.a);
+        ast->iterationStmt->stmt = stmt(rec.b);
+        break;
+      default:
+        break;
+    }
+    return ast;
+  }
+
+  ExpAST *exp(uint32_t i) {
+    const FlatAST::Exp &rec = f.exps[i];
+    ExpAST *ast = nullptr;
+    switch (rec.kind) {
+      case EXP_BINARY:
+        ast = arena.make<BinaryExpAST>(static_cast<BOP>(rec.op), exp(rec.a),
+                                       exp(rec.b));
+        break;
+      case EXP_UNARY:
+        ast = arena.make<UnaryExpAST>(static_cast<UOP>(rec.op), exp(rec.a));
+        break;
+      case EXP_NUMBER: {
+        auto number = arena.make<NumberAST>();
+        number->isInt = rec.isInt;
+        memcpy(&number->intval, &rec.a, sizeof(rec.a));
+        ast = number;
+        break;
+      }
+      case EXP_LVAL: {
+        auto lVal = arena.make<LValAST>();
+        lVal->id = rec.a;
+        list(rec.list, lVal->arrays, &Inflater::exp);
+        ast = lVal;
+        break;
+      }
+      case EXP_CALL: {
+        auto call = arena.make<CallAST>();
+        call->id = rec.a;
+        list(rec.list, call->funcCParamList, &Inflater::exp);
+        ast = call;
+        break;
+      }
+    }
+    ast->parens = rec.parens;
+    return ast;
+  }
+
+ private:
+  template <typename T, typename R>
+  void list(FlatAST::Range range, std::vector<T *> &children,
+            R *(Inflater::*convert)(uint32_t)) {
+    children.reserve(range.count);
+    for (uint32_t i = 0; i < range.count; i++)
+      children.push_back(
+          static_cast<T *>((this->*convert)(f.lists[range.first + i])));
+  }
+
+  const FlatAST &f;
+  Arena &arena;
+};
+
+// 每层节点或括号在打印等遍里占几个栈帧。合法程序很少超过这个深度，
+// 超过的只是缓存不命中、重新解析
+constexpr uint32_t MAX_DEPTH = 4096;
+
+// 逐条检查记录，不从根出发遍历：损坏的数据可能有环，递归会停不下来
+class Checker {
+ public:
+  Checker(const FlatAST &f, uint64_t sourceSize)
+      : f(f),
+        parens(sourceSize / 2),
+        decls(f.decls.size()),
+        defs(f.defs.size()),
+        initVals(f.initVals.size()),
+        funcDefs(f.funcDefs.size()),
+        params(f.params.size()),
+        blocks(f.blocks.size()),
+        blockItems(f.blockItems.size()),
+        stmts(f.stmts.size()),
+        exps(f.exps.size()) {}
+
+  bool run() {
+    for (auto &rec : f.declDefs)
+      if (!take(rec.isFunc ? funcDefs : decls, rec.node)) return false;
+    for (auto &rec : f.decls)
+      if (rec.bType > TYPE_FLOAT || !list(rec.defs, defs)) return false;
+    for (auto &rec : f.defs)
+      if (!list(rec.arrays, exps) || !optional(initVals, rec.initVal))
+        return false;
+    for (auto &rec : f.initVals)
+      if (!optional(exps, rec.exp) || !list(rec.list, initVals)) return false;
+    for (auto &rec : f.funcDefs)
+      if (rec.funcType > TYPE_FLOAT || !list(rec.params, params) ||
+          !take(blocks, rec.block))
+        return false;
+    for (auto &rec : f.params)
+      if (rec.bType > TYPE_FLOAT || !list(rec.arrays, exps)) return false;
+    for (auto &rec : f.blocks)
+      if (!list(rec.items, blockItems)) return false;
+    for (auto &rec : f.blockItems)
+      if (!take(rec.isDecl ? decls : stmts, rec.node)) return false;
+    for (auto &rec : f.stmts)
+      if (!stmt(rec)) return false;
+    for (auto &rec : f.exps)
+      if (!exp(rec)) return false;
+    return depth();
+  }
+
+ private:
+  // 第一次引用第 i 个节点时返回 true
+  static bool take(std::vector<bool> &used, uint32_t i) {
+    if (i >= used.size() || used[i]) return false;
+    used[i] = true;
+    return true;
+  }
+  static bool optional(std::vector<bool> &used, uint32_t i) {
+    return i == FlatAST::NONE || take(used, i);
+  }
+  bool list(FlatAST::Range range, std::vector<bool> &used) {
+    if (range.first > f.lists.size() ||
+        range.count > f.lists.size() - range.first)
+      return false;
+    for (uint32_t i = 0; i < range.count; i++)
+      if (!take(used, f.lists[range.first + i])) return false;
+    return true;
+  }
+
+  bool stmt(const FlatAST::Stmt &rec) {
+    switch (rec.sType) {
+      case SEMI:
+      case CONT:
+      case BRE:
+        return true;
+      case ASS:
+        return take(exps, rec.a) && f.exps[rec.a].kind == EXP_LVAL &&
+               take(exps, rec.b);
+      case EXP:
+        return take(exps, rec.a);
+      case RET:
+        return optional(exps, rec.a);
+      case BLK:
+        return take(blocks, rec.a);
+      case SELECT:
+        return take(exps, rec.a) && take(stmts, rec.b) &&
+               optional(stmts, rec.c);
+      case ITER:
+        return take(exps, rec.a) && take(stmts, rec.b);
+      default:
+        return false;
+    }
+  }
+
+  bool exp(const FlatAST::Exp &rec) {
+    // 每对括号至少占源文件的两个字节
+    if (rec.parens > parens) return false;
+    parens -= rec.parens;
+    switch (rec.kind) {
+      case EXP_BINARY:
+        return rec.op <= BOP_OR && take(exps, rec.a) && take(exps, rec.b);
+      case EXP_UNARY:
+        return rec.op <= UOP_NOT && take(exps, rec.a);
+      case EXP_NUMBER:
+        return true;
+      case EXP_LVAL:
+      case EXP_CALL:
+        return list(rec.list, exps);
+      default:
+        return false;
+    }
+  }
+
+  // 下标都检查过后从根出发量树深（括号算在内）。toTree 和各遍都按树
+  // 递归，损坏的数据可能把节点串成很深的链，用显式栈遍历，超过 MAX_DEPTH
+  // 层按损坏处理
+  enum class Kind {
+    DECL, DEF, INIT_VAL, FUNC_DEF, PARAM, BLOCK, ITEM, STMT, EXP
+  };
+  struct Node {
+    Kind kind;
+    uint32_t i;
+    uint32_t depth;
+  };
+
+  bool depth() {
+    std::vector<Node> stack;
+    for (auto &rec : f.declDefs)
+      stack.push_back(
+          {rec.isFunc ? Kind::FUNC_DEF : Kind::DECL, rec.node, 1});
+    while (!stack.empty()) {
+      Node node = stack.back();
+      stack.pop_back();
+      // 每对括号也是一层递归
+      uint64_t level = node.depth;
+      if (node.kind == Kind::EXP) level += f.exps[node.i].parens;
+      if (level > MAX_DEPTH) return false;
+      auto push = [&](Kind kind, uint32_t i) {
+        if (i != FlatAST::NONE)
+          stack.push_back({kind, i, static_cast<uint32_t>(level + 1)});
+      };
+      auto pushList = [&](Kind kind, FlatAST::Range range) {
+        for (uint32_t k = 0; k < range.count; k++)
+          push(kind, f.lists[range.first + k]);
+      };
+      switch (node.kind) {
+        case Kind::DECL:
+          pushList(Kind::DEF, f.decls[node.i].defs);
+          break;
+        case Kind::DEF:
+          pushList(Kind::EXP, f.defs[node.i].arrays);
+          push(Kind::INIT_VAL, f.defs[node.i].initVal);
+          break;
+        case Kind::INIT_VAL:
+          push(Kind::EXP, f.initVals[node.i].exp);
+          pushList(Kind::INIT_VAL, f.initVals[node.i].list);
+          break;
+        case Kind::FUNC_DEF:
+          pushList(Kind::PARAM, f.funcDefs[node.i].params);
+          push(Kind::BLOCK, f.funcDefs[node.i].block);
+          break;
+        case Kind::PARAM:
+          pushList(Kind::EXP, f.params[node.i].arrays);
+          break;
+        case Kind::BLOCK:
+          pushList(Kind::ITEM, f.blocks[node.i].items);
+          break;
+        case Kind::ITEM:
+          push(f.blockItems[node.i].isDecl ? Kind::DECL : Kind::STMT,
+               f.blockItems[node.i].node);
+          break;
+        case Kind::STMT: {
+          auto &rec = f.stmts[node.i];
+          switch (rec.sType) {
+            case BLK:
+              push(Kind::BLOCK, rec.a);
+              break;
+            case SELECT:
+              push(Kind::EXP, rec.a);
+              push(Kind::STMT, rec.b);
+              push(Kind::STMT, rec.c);
+              break;
+            case ITER:
+              push(Kind::EXP, rec.a);
+              push(Kind::STMT, rec.b);
+              break;
+            case ASS:
+              push(Kind::EXP, rec.a);
+              push(Kind::EXP, rec.b);
+              break;
+            case EXP:
+            case RET:
+              push(Kind::EXP, rec.a);
+              break;
+            default:
+              break;
+          }
+          break;
+        }
+        case Kind::EXP: {
+          auto &rec = f.exps[node.i];
+          if (rec.kind == EXP_LVAL || rec.kind == EXP_CALL) {
+            pushList(Kind::EXP, rec.list);
+          } else if (rec.kind != EXP_NUMBER) {
+            push(Kind::EXP, rec.a);
+            if (rec.kind == EXP_BINARY) push(Kind::EXP, rec.b);
+          }
+          break;
+        }
+      }
+    }
+    return true;
+  }
+
+  const FlatAST &f;
+  uint64_t parens;  // 还允许出现的括号对数
+  std::vector<bool> decls, defs, initVals, funcDefs, params, blocks,
+      blockItems, stmts, exps;
+};
+
+}  // namespace
+
+FlatAST FlatAST::build(CompUnitAST &root) {
+  FlatAST f;
+  Builder builder(f);
+  f.declDefs.reserve(root.declDefList.size());
+  for (DeclDefAST *declDef : root.declDefList) {
+    if (declDef->funcDef != nullptr)
+      f.declDefs.push_back({1, builder.funcDef(*declDef->funcDef)});
+    else
+      f.declDefs.push_back({0, builder.decl(*declDef->Decl)});
+  }
+  return f;
+}
+
+CompUnitAST *FlatAST::toTree(Arena &arena) const {
+  Inflater inflater(*this, arena);
+  auto root = arena.make<CompUnitAST>();
+  root->declDefList.reserve(declDefs.size());
+  for (const DeclDef &rec : declDefs) {
+    auto declDef = arena.make<DeclDefAST>();
+    if (rec.isFunc)
+      declDef->funcDef = inflater.funcDef(rec.node);
+    else
+      declDef->Decl = inflater.decl(rec.node);
+    root->declDefList.push_back(declDef);
+  }
+  return root;
+}
+
+bool FlatAST::valid(uint64_t sourceSize) const {
+  return Checker(*this, sourceSize).run();
+}
+
+size_t FlatAST::numNodes() const {
+  return declDefs.size() + decls.size() + defs.size() + initVals.size() +
+         funcDefs.size() + params.size() + blocks.size() + blockItems.size() +
+         stmts.size() + exps.size();
+}
+
+size_t FlatAST::bytes() const {
+  return declDefs.size() * sizeof(DeclDef) + decls.size() * sizeof(Decl) +
+         defs.size() * sizeof(Def) + initVals.size() * sizeof(InitVal) +
+         funcDefs.size() * sizeof(FuncDef) + params.size() * sizeof(FuncFParam) +
+         blocks.size() * sizeof(Block) + blockItems.size() * sizeof(BlockItem) +
+         stmts.size() * sizeof(Stmt) + exps.size() * sizeof(Exp) +
+         lists.size() * sizeof(uint32_t);
+}
+
+void FlatAST::clear() { *this = FlatAST(); }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.h"
+
+// 连续存储的 AST：每类节点放在各自的稠密数组里，子节点用 32 位下标引用，
+// 变长的子节点列表统一放在 lists 中，用 Range 表示区间。
+// 所有记录都是定长 POD，整棵树可以按几个缓冲区整体复制、序列化或丢弃。
+// FlatPrinter（printer.h）和 Stats::countNodes 直接按下标遍历这些数组；
+// 常量折叠、语义分析等要改写或标注节点的 Visitor 仍在 toTree() 还原出的
+// 指针树上运行
+class FlatAST {
+ public:
+  static const uint32_t NONE = UINT32_MAX;
+
+  struct Range {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  // isFunc 为真时 node 是 funcDefs 的下标，否则是 decls 的下标
+  struct DeclDef {
+    uint8_t isFunc;
+    uint32_t node;
+  };
+  struct Decl {
+    uint8_t bType;
+    uint8_t isConst;
+    Range defs;
+  };
+  struct Def {
+    Symbol id;
+    Range arrays;
+    uint32_t initVal;
+  };
+  struct InitVal {
+    uint32_t exp;
+    Range list;
+  };
+  struct FuncDef {
+    uint8_t funcType;
+    Symbol id;
+    Range params;
+    uint32_t block;
+  };
+  struct FuncFParam {
+    uint8_t bType;
+    uint8_t isArray;
+    Symbol id;
+    Range arrays;
+  };
+  struct Block {
+    Range items;
+  };
+  // isDecl 为真时 node 是 decls 的下标，否则是 stmts 的下标
+  struct BlockItem {
+    uint8_t isDecl;
+    uint32_t node;
+  };
+  // ReturnStmt/SelectStmt/IterationStmt 与 Stmt 一一对应，直接并入：
+  //   ASS: a=左值(exps) b=表达式   EXP/RET: a=表达式(RET 可为 NONE)
+  //   BLK: a=blocks 下标           SELECT: a=条件 b=if 语句 c=else 语句
+  //   ITER: a=条件 b=循环体
+  struct Stmt {
+    uint8_t sType;
+    uint32_t a, b, c;
+  };
+  // BINARY: a/b 为左右操作数；UNARY: a 为操作数；NUMBER: a 为值的位模式；
+  // LVAL/CALL: a 为名字，list 为下标或实参
+  struct Exp {
+    uint8_t kind;
+    uint8_t op;
+    uint8_t isInt;
+    uint32_t parens;  // 与 ExpAST::parens 一样不设上限
+    uint32_t a, b;
+    Range list;
+  };
+
+  std::vector<DeclDef> declDefs;  // 即 CompUnit 的顶层列表
+  std::vector<Decl> decls;
+  std::vector<Def> defs;
+  std::vector<InitVal> initVals;
+  std::vector<FuncDef> funcDefs;
+  std::vector<FuncFParam> params;
+  std::vector<Block> blocks;
+  std::vector<BlockItem> blockItems;
+  std::vector<Stmt> stmts;
+  std::vector<Exp> exps;
+  std::vector<uint32_t> lists;
+
+  // 从指针树构建
+  static FlatAST build(CompUnitAST &root);
+  // 在 arena 中还原出等价的指针树，供 Visitor 使用
+  CompUnitAST *toTree(Arena &arena) const;
+  // 所有下标和区间都落在对应数组内、枚举值都合法、每个节点至多被引用一次
+  // （因而没有环）、括号总对数不超过源文件长度的一半、树深（每对括号算
+  // 一层）不超过 4096 时返回 true。从缓存文件等处读入的数据要先检查再
+  // toTree，否则下标越界或过深的树会让 toTree 和之后的递归遍历崩溃
+  bool valid(uint64_t sourceSize) const;
+
+  size_t numNodes() const;
+  size_t bytes() const;
+  void clear();
+};
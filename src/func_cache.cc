@@ -0,0 +1,372 @@
+#include "func_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <unordered_map>
+
+#include "ast_cache.h"
+#include "call_graph.h"
+#include "pass.h"
+
+namespace {
+
+const char MAGIC[4] = {'S', 'Y', 'F', 'N'};
+const uint32_t VERSION = 1;
+
+// 文件内容：Header、汇编文本、内联之后的 IR（可以没有）
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint64_t textSize;
+  uint64_t irSize;
+};
+
+// 把 AST 子树按结构写成字节串：节点种类、运算符、类型、名字和常量，
+// 不含指针和驻留表编号，同样的源代码在不同进程里得到同样的字节串。
+// 顺带记下引用到的全局变量和调用的函数
+class Fingerprint : public Visitor {
+ public:
+  std::string bytes;
+  std::vector<const DefAST *> globals;
+  std::vector<const FuncDefAST *> callees;
+
+  template <typename T>
+  void put(T v) {
+    bytes.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  }
+  void name(Symbol sym) {
+    std::string_view s = interner.name(sym);
+    put(static_cast<uint32_t>(s.size()));
+    bytes.append(s.data(), s.size());
+  }
+  void dims(const std::vector<int> &dims) {
+    put(static_cast<uint32_t>(dims.size()));
+    for (int d : dims) put(d);
+  }
+  // 可能为空的子节点前面加一个标记
+  void child(BaseAST *node) {
+    put<uint8_t>(node != nullptr);
+    if (node != nullptr) node->accept(*this);
+  }
+  template <typename T>
+  void children(const std::vector<T *> &list) {
+    put(static_cast<uint32_t>(list.size()));
+    for (T *node : list) node->accept(*this);
+  }
+
+  void visit(CompUnitAST &ast) override { children(ast.declDefList); }
+  void visit(DeclDefAST &ast) override {
+    child(ast.Decl);
+    child(ast.funcDef);
+  }
+  void visit(DeclAST &ast) override {
+    put<uint8_t>(ast.bType);
+    put<uint8_t>(ast.isConst);
+    children(ast.defList);
+  }
+  void visit(DefAST &ast) override {
+    name(ast.id);
+    dims(ast.dims);
+    put<uint8_t>(ast.bType);
+    put<uint8_t>(ast.isConst);
+    child(ast.initVal);
+  }
+  void visit(InitValAST &ast) override {
+    child(ast.exp);
+    children(ast.initValList);
+  }
+  void visit(FuncDefAST &ast) override {
+    put<uint8_t>(ast.funcType);
+    name(ast.id);
+    children(ast.funcFParamList);
+    child(ast.block);
+  }
+  void visit(FuncFParamAST &ast) override {
+    put<uint8_t>(ast.bType);
+    put<uint8_t>(ast.isArray);
+    name(ast.id);
+    dims(ast.dims);
+  }
+  void visit(BlockAST &ast) override { children(ast.blockItemList); }
+  void visit(BlockItemAST &ast) override {
+    child(ast.decl);
+    child(ast.stmt);
+  }
+  void visit(StmtAST &ast) override {
+    put<uint8_t>(ast.sType);
+    child(ast.lVal);
+    child(ast.exp);
+    child(ast.returnStmt);
+    child(ast.selectStmt);
+    child(ast.iterationStmt);
+    child(ast.block);
+  }
+  void visit(ReturnStmtAST &ast) override { child(ast.exp); }
+  void visit(SelectStmtAST &ast) override {
+    child(ast.cond);
+    child(ast.ifStmt);
+    child(ast.elseStmt);
+  }
+  void visit(IterationStmtAST &ast) override {
+    child(ast.cond);
+    child(ast.stmt);
+  }
+  void visit(BinaryExpAST &ast) override {
+    put<uint8_t>(ast.kind);
+    put<uint8_t>(ast.op);
+    put<uint8_t>(ast.type);
+    ast.lhs->accept(*this);
+    ast.rhs->accept(*this);
+  }
+  void visit(UnaryExpAST &ast) override {
+    put<uint8_t>(ast.kind);
+    put<uint8_t>(ast.op);
+    put<uint8_t>(ast.type);
+    ast.exp->accept(*this);
+  }
+  void visit(NumberAST &ast) override {
+    put<uint8_t>(ast.kind);
+    put<uint8_t>(ast.isInt);
+    put(ast.intval);
+  }
+  void visit(LValAST &ast) override {
+    put<uint8_t>(ast.kind);
+    put<uint8_t>(ast.type);
+    name(ast.id);
+    // 同名的局部变量、形参和全局变量生成的代码不同
+    put<uint8_t>(ast.param != nullptr ? 2 : ast.def->isGlobal);
+    put(ast.rank);
+    children(ast.arrays);
+    if (ast.def != nullptr && ast.def->isGlobal) globals.push_back(ast.def);
+  }
+  void visit(CallAST &ast) override {
+    put<uint8_t>(ast.kind);
+    put<uint8_t>(ast.type);
+    name(ast.id);
+    children(ast.funcCParamList);
+    callees.push_back(ast.func);
+  }
+};
+
+template <typename T>
+void put(std::string &bytes, T v) {
+  bytes.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+template <typename T>
+void putArray(std::string &bytes, const std::vector<T> &array) {
+  put(bytes, static_cast<uint32_t>(array.size()));
+  bytes.append(reinterpret_cast<const char *>(array.data()),
+               array.size() * sizeof(T));
+}
+template <typename T>
+bool getArray(const char *&p, const char *end, std::vector<T> &array) {
+  uint32_t count;
+  if (end - p < static_cast<ptrdiff_t>(sizeof(count))) return false;
+  memcpy(&count, p, sizeof(count));
+  p += sizeof(count);
+  if (static_cast<size_t>(end - p) / sizeof(T) < count) return false;
+  array.resize(count);
+  memcpy(array.data(), p, count * sizeof(T));
+  p += count * sizeof(T);
+  return true;
+}
+
+// 函数体的原样转储：指令、常量、操作数列表和各块的指令下标。
+// 指令里的函数和全局变量下标已经包含在键里，可以直接保存
+std::string serializeBody(const Function &func) {
+  std::string bytes;
+  putArray(bytes, func.insts);
+  putArray(bytes, func.consts);
+  putArray(bytes, func.lists);
+  put(bytes, static_cast<uint32_t>(func.blocks.size()));
+  for (auto &block : func.blocks) putArray(bytes, block.insts);
+  return bytes;
+}
+
+bool deserializeBody(const std::string &bytes, Function &func) {
+  const char *p = bytes.data();
+  const char *end = p + bytes.size();
+  Function body;
+  std::vector<uint32_t> blocks;
+  if (!getArray(p, end, body.insts) || !getArray(p, end, body.consts) ||
+      !getArray(p, end, body.lists) || end - p < 4)
+    return false;
+  uint32_t count;
+  memcpy(&count, p, sizeof(count));
+  p += sizeof(count);
+  body.blocks.resize(std::min<size_t>(count, bytes.size()));
+  for (auto &block : body.blocks)
+    if (!getArray(p, end, block.insts)) return false;
+  if (p != end || body.blocks.size() != count) return false;
+  func.insts = std::move(body.insts);
+  func.consts = std::move(body.consts);
+  func.lists = std::move(body.lists);
+  func.blocks = std::move(body.blocks);
+  return true;
+}
+
+}  // namespace
+
+FuncCache::FuncCache(std::string dir, const PassManager *passes)
+    : dir(std::move(dir)), optimize(passes != nullptr) {
+  mkdir(this->dir.c_str(), 0755);
+  std::string options;
+  if (optimize) {
+    options = "-O " + passes->describe();
+    std::string list = "," + passes->describe() + ",";
+    for (size_t at = list.find(",inline,"); at != std::string::npos;
+         at = list.find(",inline,", at + 1))
+      inlinePasses++;
+  }
+  seed = hashBytes(options.data(), options.size(), compilerHash() + VERSION);
+}
+
+std::string FuncCache::path(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.fn",
+           static_cast<unsigned long long>(key));
+  return dir + name;
+}
+
+bool FuncCache::load(uint64_t key, std::string &text, std::string &ir) const {
+  int fd = open(path(key).c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  Header header;
+  bool ok = read(fd, &header, sizeof(header)) == sizeof(header) &&
+            memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+            header.version == VERSION && header.key == key &&
+            header.textSize > 0 && header.textSize < (1ULL << 32) &&
+            header.irSize < (1ULL << 32);
+  if (ok) {
+    text.resize(header.textSize);
+    ir.resize(header.irSize);
+    ok = read(fd, &text[0], text.size()) == static_cast<ssize_t>(text.size()) &&
+         (ir.empty() ||
+          read(fd, &ir[0], ir.size()) == static_cast<ssize_t>(ir.size()));
+  }
+  close(fd);
+  if (!ok) text.clear();
+  return ok;
+}
+
+void FuncCache::lookup(CompUnitAST &root, Module &module, bool skipPasses) {
+  size_t n = module.functions.size();
+  std::unordered_map<Symbol, uint32_t> globalIndex;
+  for (uint32_t i = 0; i < module.globals.size(); i++)
+    globalIndex[module.globals[i].name] = i;
+
+  // 全局声明的指纹；一条声明里的各个变量共用
+  std::unordered_map<const DefAST *, uint64_t> declHash;
+  for (DeclDefAST *item : root.declDefList) {
+    if (item->Decl == nullptr) continue;
+    Fingerprint fp;
+    item->Decl->accept(fp);
+    uint64_t hash = hashBytes(fp.bytes.data(), fp.bytes.size());
+    for (DefAST *def : item->Decl->defList) declHash[def] = hash;
+  }
+
+  // 每个函数自身的指纹，连同它引用的全局声明和被调函数的签名
+  std::vector<uint64_t> base(n, 0);
+  for (DeclDefAST *item : root.declDefList) {
+    if (item->funcDef == nullptr || item->funcDef->block == nullptr) continue;
+    Fingerprint fp;
+    item->funcDef->accept(fp);
+    for (const DefAST *def : fp.globals) {
+      put(fp.bytes, declHash[def]);
+      put(fp.bytes, globalIndex[def->id]);
+    }
+    for (const FuncDefAST *callee : fp.callees) {
+      put(fp.bytes, module.findFunction(callee->id));
+      put<uint8_t>(fp.bytes, callee->funcType);
+      for (FuncFParamAST *param : callee->funcFParamList) {
+        put<uint8_t>(fp.bytes, param->bType);
+        put<uint8_t>(fp.bytes, param->isArray);
+        fp.dims(param->dims);
+      }
+    }
+    int index = module.findFunction(item->funcDef->id);
+    base[index] = hashBytes(fp.bytes.data(), fp.bytes.size());
+  }
+
+  // -O 时一个强连通分量里的函数可能互相内联（lower 出的调用图里还有死代码中
+  // 的调用，分量可能比优化时大），键里统一放整个分量的信息：各函数的指纹和
+  // 源程序调用点数，以及分量外被调函数的键和调用点数。
+  // 同一分量的函数在 bottomUp 中相邻，被调者的分量在前
+  keys.assign(n, 0);
+  CallGraph graph(module);
+  for (size_t i = 0; i < graph.bottomUp.size();) {
+    size_t j = i;
+    while (j < graph.bottomUp.size() &&
+           graph.sameSCC(graph.bottomUp[i], graph.bottomUp[j]))
+      j++;
+    std::string scc;
+    for (size_t k = i; optimize && k < j; k++) {
+      uint32_t f = graph.bottomUp[k];
+      put(scc, base[f]);
+      put(scc, module.functions[f].sourceCalls);
+      for (uint32_t g : graph.callees[f]) {
+        if (graph.sameSCC(f, g)) continue;
+        put(scc, keys[g]);
+        put(scc, module.functions[g].sourceCalls);
+      }
+    }
+    for (; i < j; i++) {
+      uint32_t f = graph.bottomUp[i];
+      if (module.functions[f].external) continue;
+      std::string bytes = scc;
+      put(bytes, f);
+      put(bytes, base[f]);
+      keys[f] = hashBytes(bytes.data(), bytes.size(), seed);
+    }
+  }
+
+  // 只有一个 inline 时，命中的函数直接换成缓存里内联之后的 IR，跳过优化：
+  // 未命中的函数内联它们时看到的与完整编译相同。没有 inline 时不需要 IR；
+  // 有多个 inline 时各次看到的形态不同，只复用汇编
+  bool reuseIR = skipPasses && inlinePasses == 1;
+  skipPasses = skipPasses && inlinePasses <= 1;
+  texts.assign(n, std::string());
+  irs.assign(n, std::string());
+  hit.assign(n, false);
+  for (uint32_t f = 0; f < n; f++) {
+    Function &func = module.functions[f];
+    if (func.external) continue;
+    std::string ir;
+    hit[f] = load(keys[f], texts[f], ir) &&
+             (!reuseIR || deserializeBody(ir, func));
+    if (hit[f]) {
+      hits++;
+      func.cached = skipPasses;
+    } else {
+      misses++;
+      texts[f].clear();
+    }
+  }
+}
+
+void FuncCache::afterPass(const char *name, const Module &module) {
+  if (inlinePasses != 1 || strcmp(name, "inline") != 0) return;
+  for (size_t f = 0; f < keys.size(); f++)
+    if (keys[f] != 0 && !hit[f])
+      irs[f] = serializeBody(module.functions[f]);
+}
+
+void FuncCache::store() const {
+  for (size_t f = 0; f < keys.size(); f++) {
+    if (keys[f] == 0 || hit[f] || texts[f].empty()) continue;
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.key = keys[f];
+    header.textSize = texts[f].size();
+    header.irSize = irs[f].size();
+    std::string data(reinterpret_cast<const char *>(&header), sizeof(header));
+    data += texts[f];
+    data += irs[f];
+    replaceFile(path(keys[f]), data);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "ir.h"
+
+class PassManager;
+
+// 按函数的增量编译缓存：每个函数定义和全局声明按（折叠、语义分析之后的）
+// AST 结构算出指纹，再和函数依赖的其他东西组成键，键相同时生成的汇编与
+// 上次逐字节相同，可以直接复用。键包括：
+//   编译器本身和编译选项（-O 的流水线）、函数在模块中的下标（标号里有它）、
+//   自身的指纹、引用的全局声明的指纹和下标、调用的函数的签名和下标；
+//   -O 时还有所在强连通分量里各函数的指纹、分量外被调函数的键（内联会复制
+//   它们优化后的函数体）和这些函数的源程序调用点数（内联的启发式用到）。
+// 缓存项是 <dir>/<键>.fn，内容是该函数的汇编文本和 inline 之后的 IR；
+// 命中的函数换上这份 IR 后不再优化，未命中的函数照常内联它们
+class FuncCache {
+ public:
+  // passes 为空表示不优化，否则是 -O 的流水线
+  FuncCache(std::string dir, const PassManager *passes);
+
+  // lower 之后调用：算出每个函数的键，命中的把汇编读进 texts。
+  // skipPasses 时命中的函数换上缓存的 IR 并标成 cached，优化 pass 跳过它们
+  void lookup(CompUnitAST &root, Module &module, bool skipPasses);
+  // 作为 PassManager::run 的回调：inline 之后记下未命中函数的 IR
+  void afterPass(const char *name, const Module &module);
+  // 把这次新生成的汇编和 IR 写回缓存
+  void store() const;
+
+  std::vector<std::string> texts;  // 按函数下标，供 emitX86 使用和填写
+  size_t hits = 0;
+  size_t misses = 0;
+
+ private:
+  std::string path(uint64_t key) const;
+  bool load(uint64_t key, std::string &text, std::string &ir) const;
+
+  std::string dir;
+  bool optimize;
+  int inlinePasses = 0;  // 流水线中 inline 出现的次数
+  uint64_t seed;         // 编译器和编译选项的哈希
+  std::vector<uint64_t> keys;  // 按函数下标，0 表示运行时库函数
+  std::vector<std::string> irs;
+  std::vector<bool> hit;
+};
@@ -0,0 +1,242 @@
+#include <climits>
+#include <unordered_map>
+#include <utility>
+
+#include "cfg.h"
+#include "pass.h"
+
+namespace {
+
+struct Key {
+  Opcode op;
+  IRType type;
+  uint32_t a, b, c;
+
+  bool operator==(const Key &other) const {
+    return op == other.op && type == other.type && a == other.a &&
+           b == other.b && c == other.c;
+  }
+};
+
+struct KeyHash {
+  size_t operator()(const Key &key) const {
+    uint64_t h = uint64_t(key.op) << 8 | key.type;
+    h = h * 0x9E3779B97F4A7C15ull ^ key.a;
+    h = h * 0x9E3779B97F4A7C15ull ^ key.b;
+    h = h * 0x9E3779B97F4A7C15ull ^ key.c;
+    return h ^ (h >> 29);
+  }
+};
+
+bool commutative(Opcode op) {
+  switch (op) {
+    case OP_ADD: case OP_MUL: case OP_FADD: case OP_FMUL:
+    case OP_EQ: case OP_NE: case OP_FEQ: case OP_FNE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// 操作数都是常量时求值，结果与运行时一致（整数按补码回绕）；
+// 除以 0 等运行时行为未定义的情况不折叠
+bool fold(Function &func, const Inst &inst, Value &out) {
+  if (inst.op == OP_GEP) return false;
+  bool unary = inst.op == OP_FNEG || inst.op == OP_ITOF || inst.op == OP_FTOI;
+  if (!func.isConst(inst.a) || (!unary && !func.isConst(inst.b))) return false;
+  if (inst.op >= OP_ADD && inst.op <= OP_MOD) {
+    int a = func.intOf(inst.a), b = func.intOf(inst.b);
+    uint32_t ua = a, ub = b;
+    switch (inst.op) {
+      case OP_ADD: out = func.constInt(static_cast<int>(ua + ub)); return true;
+      case OP_SUB: out = func.constInt(static_cast<int>(ua - ub)); return true;
+      case OP_MUL: out = func.constInt(static_cast<int>(ua * ub)); return true;
+      default: break;
+    }
+    if (b == 0 || (a == INT_MIN && b == -1)) return false;
+    out = func.constInt(inst.op == OP_DIV ? a / b : a % b);
+    return true;
+  }
+  if (inst.op >= OP_EQ && inst.op <= OP_GE) {
+    int a = func.intOf(inst.a), b = func.intOf(inst.b);
+    bool r = inst.op == OP_EQ   ? a == b
+             : inst.op == OP_NE ? a != b
+             : inst.op == OP_LT ? a < b
+             : inst.op == OP_LE ? a <= b
+             : inst.op == OP_GT ? a > b
+                                : a >= b;
+    out = func.constInt(r);
+    return true;
+  }
+  if (inst.op == OP_ITOF) {
+    out = func.constFloat(static_cast<float>(func.intOf(inst.a)));
+    return true;
+  }
+  float a = func.floatOf(inst.a);
+  if (inst.op == OP_FTOI) {
+    if (!(a > -2147483649.0f && a < 2147483648.0f)) return false;
+    out = func.constInt(static_cast<int>(a));
+    return true;
+  }
+  if (inst.op == OP_FNEG) {
+    out = func.constFloat(-a);
+    return true;
+  }
+  float b = func.floatOf(inst.b);
+  switch (inst.op) {
+    case OP_FADD: out = func.constFloat(a + b); return true;
+    case OP_FSUB: out = func.constFloat(a - b); return true;
+    case OP_FMUL: out = func.constFloat(a * b); return true;
+    case OP_FDIV: out = func.constFloat(a / b); return true;
+    case OP_FEQ: out = func.constInt(a == b); return true;
+    case OP_FNE: out = func.constInt(a != b); return true;
+    case OP_FLT: out = func.constInt(a < b); return true;
+    case OP_FLE: out = func.constInt(a <= b); return true;
+    case OP_FGT: out = func.constInt(a > b); return true;
+    case OP_FGE: out = func.constInt(a >= b); return true;
+    default: return false;
+  }
+}
+
+// 整数的代数恒等式；浮点因为 NaN 和 -0 不做化简
+bool simplify(Function &func, const Inst &inst, Value &out) {
+  auto isInt = [&](Value v, int n) {
+    return func.isConst(v) && func.typeOf(v) == IR_I32 && func.intOf(v) == n;
+  };
+  switch (inst.op) {
+    case OP_ADD:
+      if (isInt(inst.b, 0)) out = inst.a;
+      break;
+    case OP_SUB:
+      if (isInt(inst.b, 0)) out = inst.a;
+      if (inst.a == inst.b) out = func.constInt(0);
+      break;
+    case OP_MUL:
+      if (isInt(inst.b, 1)) out = inst.a;
+      if (isInt(inst.b, 0)) out = func.constInt(0);
+      break;
+    case OP_DIV:
+      if (isInt(inst.b, 1)) out = inst.a;
+      break;
+    case OP_MOD:
+      if (isInt(inst.b, 1)) out = func.constInt(0);
+      break;
+    case OP_GEP:
+      if (isInt(inst.b, 0)) out = inst.a;
+      break;
+    case OP_EQ: case OP_LE: case OP_GE:
+      if (inst.a == inst.b) out = func.constInt(1);
+      break;
+    case OP_NE: case OP_LT: case OP_GT:
+      if (inst.a == inst.b) out = func.constInt(0);
+      break;
+    default:
+      break;
+  }
+  return out != NO_VALUE;
+}
+
+}  // namespace
+
+bool gvn(Module &module, Function &func) {
+  CFG cfg(func);
+  DomTree dom(cfg);
+  std::vector<Value> repl(func.insts.size(), NO_VALUE);
+  // 支配树上的作用域哈希表：进入子树时记下 log 长度，离开时删掉之后插入的键
+  std::unordered_map<Key, Value, KeyHash> table;
+  std::vector<Key> log;
+  // 块内已知的内存内容：地址 -> 值。遇到 STORE/CALL/ZERO 时全部作废，
+  // 不需要别名分析
+  std::unordered_map<Value, Value> memory;
+  bool changed = false;
+
+  auto visit = [&](uint32_t b) {
+    memory.clear();
+    for (uint32_t index : func.blocks[b].insts) {
+      Inst &inst = func.insts[index];
+      forEachOperand(func, inst, [&](Value &v) { v = resolve(repl, v); });
+      Value self = makeValue(VK_INST, index);
+      Value out = NO_VALUE;
+      switch (inst.op) {
+        case OP_PHI: {
+          // 所有入边（除了自身）都是同一个值时，PHI 就是这个值
+          Value same = NO_VALUE;
+          bool unique = true;
+          for (uint32_t i = 0; i < inst.c && unique; i++) {
+            Value v = func.lists[inst.b + 2 * i];
+            if (v == self || v == same) continue;
+            unique = same == NO_VALUE;
+            same = v;
+          }
+          if (unique && same != NO_VALUE) out = same;
+          break;
+        }
+        case OP_LOAD: {
+          auto it = memory.find(inst.a);
+          if (it != memory.end() && func.typeOf(it->second) == inst.type)
+            out = it->second;
+          else
+            memory[inst.a] = self;
+          break;
+        }
+        case OP_STORE:
+          memory.clear();
+          memory[inst.a] = inst.b;
+          break;
+        case OP_CALL:
+        case OP_ZERO:
+          memory.clear();
+          break;
+        default: {
+          if (!isPure(inst.op)) break;
+          if (commutative(inst.op) && inst.a > inst.b) std::swap(inst.a, inst.b);
+          if (fold(func, inst, out) || simplify(func, inst, out)) break;
+          bool unary =
+              inst.op == OP_FNEG || inst.op == OP_ITOF || inst.op == OP_FTOI;
+          Key key{inst.op, inst.type, inst.a, unary ? 0 : inst.b,
+                  inst.op == OP_GEP ? inst.c : 0};
+          auto it = table.emplace(key, self);
+          if (it.second)
+            log.push_back(key);
+          else
+            out = it.first->second;
+          break;
+        }
+      }
+      if (out != NO_VALUE) {
+        repl[index] = out;
+        inst.op = OP_NOP;
+        changed = true;
+      }
+    }
+  };
+
+  struct Frame {
+    uint32_t block, child;
+    size_t mark;
+  };
+  std::vector<Frame> frames;
+  if (!cfg.rpo.empty()) {
+    frames.push_back({0, 0, log.size()});
+    visit(0);
+  }
+  while (!frames.empty()) {
+    Frame &top = frames.back();
+    if (top.child < dom.children[top.block].size()) {
+      uint32_t child = dom.children[top.block][top.child++];
+      frames.push_back({child, 0, log.size()});
+      visit(child);
+      continue;
+    }
+    while (log.size() > top.mark) {
+      table.erase(log.back());
+      log.pop_back();
+    }
+    frames.pop_back();
+  }
+
+  if (!changed) return false;
+  substitute(func, repl);
+  removeNops(func);
+  return true;
+}
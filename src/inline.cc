@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cstring>
+
+#include "call_graph.h"
+#include "cfg.h"
+#include "pass.h"
+
+namespace {
+
+// 被调函数的指令数上限：总是内联的小函数、循环里的调用、唯一的调用点
+const size_t SMALL_SIZE = 24;
+const size_t LOOP_SIZE = 96;
+const size_t SINGLE_SIZE = 400;
+// 调用者内联后的指令数上限，防止代码膨胀
+const size_t CALLER_LIMIT = 8000;
+// 被调函数 ALLOCA 的总字数上限：内联后它们都留在调用者的栈帧里
+const uint32_t FRAME_LIMIT = 4096;
+
+uint32_t frameWords(const Function &func) {
+  uint32_t words = 0;
+  for (auto &block : func.blocks)
+    for (uint32_t index : block.insts)
+      if (func.insts[index].op == OP_ALLOCA) words += func.insts[index].a;
+  return words;
+}
+
+// 把 callee 的函数体复制进 caller，替换掉 call 这条指令
+void inlineCall(Function &caller, uint32_t callIndex, const Function &callee) {
+  const Inst call = caller.insts[callIndex];
+  uint32_t b = call.block;
+
+  // call 之后的指令挪到新块 rest，后继块 PHI 的入边跟着改
+  uint32_t rest = caller.addBlock();
+  auto &insts = caller.blocks[b].insts;
+  auto at = std::find(insts.begin(), insts.end(), callIndex);
+  caller.blocks[rest].insts.assign(at + 1, insts.end());
+  insts.erase(at, insts.end());
+  for (uint32_t index : caller.blocks[rest].insts) caller.insts[index].block = rest;
+  forEachSuccessor(caller.terminator(rest), [&](uint32_t succ) {
+    for (uint32_t index : caller.blocks[succ].insts) {
+      Inst &phi = caller.insts[index];
+      if (phi.op != OP_PHI) break;
+      for (uint32_t i = 0; i < phi.c; i++)
+        if (caller.lists[phi.b + 2 * i + 1] == b) caller.lists[phi.b + 2 * i + 1] = rest;
+    }
+  });
+
+  // 先给每条指令占好位置，PHI 可能引用后面的指令
+  uint32_t base = caller.blocks.size();
+  for (size_t k = 0; k < callee.blocks.size(); k++) caller.addBlock();
+  std::vector<Value> map(callee.insts.size(), NO_VALUE);
+  for (auto &block : callee.blocks)
+    for (uint32_t index : block.insts)
+      if (callee.insts[index].op != OP_RET) map[index] = caller.create(Inst());
+  auto remap = [&](Value v) -> Value {
+    switch (kindOf(v)) {
+      case VK_INST:
+        return map[indexOf(v)];
+      case VK_ARG:
+        return caller.lists[call.b + indexOf(v)];
+      case VK_CONST: {
+        const Const &c = callee.consts[indexOf(v)];
+        if (c.type != IR_F32) return caller.constInt(c.bits);
+        float f;
+        memcpy(&f, &c.bits, sizeof(f));
+        return caller.constFloat(f);
+      }
+      default:
+        return v;
+    }
+  };
+
+  std::vector<std::pair<Value, uint32_t>> returns;
+  std::vector<uint32_t> allocas;
+  for (uint32_t k = 0; k < callee.blocks.size(); k++) {
+    for (uint32_t index : callee.blocks[k].insts) {
+      Inst inst = callee.insts[index];
+      if (inst.op == OP_RET) {
+        // 返回变成跳到 rest
+        if (inst.a != NO_VALUE) returns.push_back({remap(inst.a), base + k});
+        Inst br;
+        br.op = OP_BR;
+        br.a = rest;
+        caller.append(base + k, br);
+        continue;
+      }
+      if (inst.op == OP_CALL) {
+        std::vector<uint32_t> args;
+        for (uint32_t i = 0; i < inst.c; i++)
+          args.push_back(remap(callee.lists[inst.b + i]));
+        inst.b = caller.addList(args);
+      } else if (inst.op == OP_PHI) {
+        std::vector<uint32_t> list;
+        for (uint32_t i = 0; i < inst.c; i++) {
+          list.push_back(remap(callee.lists[inst.b + 2 * i]));
+          list.push_back(base + callee.lists[inst.b + 2 * i + 1]);
+        }
+        inst.b = caller.addList(list);
+      } else {
+        forEachOperand(caller, inst, [&](Value &v) { v = remap(v); });
+        forEachSuccessor(inst, [&](uint32_t &target) { target += base; });
+      }
+      uint32_t slot = indexOf(map[index]);
+      // ALLOCA 放到调用者的入口块，和调用者自己的栈上变量一样只分配一次
+      inst.block = inst.op == OP_ALLOCA ? 0 : base + k;
+      caller.insts[slot] = inst;
+      if (inst.op == OP_ALLOCA)
+        allocas.push_back(slot);
+      else
+        caller.blocks[base + k].insts.push_back(slot);
+    }
+  }
+  auto &entry = caller.blocks[0].insts;
+  entry.insert(entry.begin(), allocas.begin(), allocas.end());
+
+  Inst br;
+  br.op = OP_BR;
+  br.a = base;
+  caller.append(b, br);
+
+  // 调用的结果：唯一的返回值，或 rest 开头合并各返回值的 PHI
+  caller.insts[callIndex].op = OP_NOP;
+  if (call.type == IR_VOID) return;
+  Value result;
+  if (returns.size() == 1) {
+    result = returns[0].first;
+  } else if (returns.empty()) {
+    // 被调函数不会返回，rest 不可达
+    result = call.type == IR_F32 ? caller.constFloat(0) : caller.constInt(0);
+  } else {
+    result = insertPhi(caller, rest, call.type);
+    setIncoming(caller, caller.insts[indexOf(result)], returns);
+  }
+  std::vector<Value> repl(caller.insts.size(), NO_VALUE);
+  repl[callIndex] = result;
+  substitute(caller, repl);
+}
+
+}  // namespace
+
+bool inlineCalls(Module &module, PassCounts &counts) {
+  CallGraph graph(module);
+  size_t before = counts.inlinedCalls;
+  for (uint32_t f : graph.bottomUp) {
+    Function &caller = module.functions[f];
+    if (caller.external || caller.cached) continue;
+    // 调用点所在块的循环嵌套深度，用来估计调用频率
+    CFG cfg(caller);
+    DomTree dom(cfg);
+    std::vector<uint32_t> depth(caller.blocks.size(), 0);
+    for (const Loop &loop : findLoops(cfg, dom))
+      for (uint32_t b : loop.blocks) depth[b]++;
+    std::vector<std::pair<uint32_t, uint32_t>> sites;
+    for (uint32_t b : cfg.rpo)
+      for (uint32_t index : caller.blocks[b].insts)
+        if (caller.insts[index].op == OP_CALL) sites.push_back({index, depth[b]});
+
+    for (auto &site : sites) {
+      uint32_t g = caller.insts[site.first].a;
+      const Function &callee = module.functions[g];
+      if (callee.external || graph.sameSCC(f, g)) continue;
+      size_t limit = site.second > 0 ? LOOP_SIZE : SMALL_SIZE;
+      // 调用点数按源程序统计，不受其他函数优化到哪一步的影响
+      if (callee.sourceCalls == 1 && !graph.recursive[g])
+        limit = std::max(limit, SINGLE_SIZE);
+      size_t size = callee.size();
+      if (size > limit || caller.size() + size > CALLER_LIMIT) continue;
+      // 入口块有 PHI（入口就是循环头）时不能直接从调用点跳进去
+      if (callee.insts[callee.blocks[0].insts[0]].op == OP_PHI) continue;
+      if (frameWords(callee) > FRAME_LIMIT) continue;
+      inlineCall(caller, site.first, callee);
+      counts.inlinedCalls++;
+    }
+  }
+  return counts.inlinedCalls != before;
+}
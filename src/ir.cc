@@ -0,0 +1,331 @@
+#include "ir.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char *const OPCODE_NAMES[NUM_OPCODES] = {
+    "nop",
+    "add", "sub", "mul", "div", "mod",
+    "fadd", "fsub", "fmul", "fdiv", "fneg",
+    "eq", "ne", "lt", "le", "gt", "ge",
+    "feq", "fne", "flt", "fle", "fgt", "fge",
+    "itof", "ftoi",
+    "alloca", "load", "store", "gep", "zero",
+    "call", "phi",
+    "br", "condbr", "ret",
+};
+
+const char *opcodeName(Opcode op) { return OPCODE_NAMES[op]; }
+
+uint32_t Function::addBlock() {
+  blocks.emplace_back();
+  return blocks.size() - 1;
+}
+
+Value Function::create(const Inst &inst) {
+  insts.push_back(inst);
+  return makeValue(VK_INST, insts.size() - 1);
+}
+
+Value Function::append(uint32_t block, const Inst &inst) {
+  Value v = create(inst);
+  insts.back().block = block;
+  blocks[block].insts.push_back(indexOf(v));
+  return v;
+}
+
+uint32_t Function::addList(const std::vector<uint32_t> &list) {
+  uint32_t first = lists.size();
+  lists.insert(lists.end(), list.begin(), list.end());
+  return first;
+}
+
+Value Function::constInt(int v) {
+  uint64_t key = uint64_t(IR_I32) << 32 | static_cast<uint32_t>(v);
+  auto it = constIndex.emplace(key, consts.size());
+  if (it.second) consts.push_back({IR_I32, static_cast<uint32_t>(v)});
+  return makeValue(VK_CONST, it.first->second);
+}
+
+Value Function::constFloat(float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  uint64_t key = uint64_t(IR_F32) << 32 | bits;
+  auto it = constIndex.emplace(key, consts.size());
+  if (it.second) consts.push_back({IR_F32, bits});
+  return makeValue(VK_CONST, it.first->second);
+}
+
+float Function::floatOf(Value v) const {
+  float f;
+  memcpy(&f, &consts[indexOf(v)].bits, sizeof(f));
+  return f;
+}
+
+IRType Function::typeOf(Value v) const {
+  switch (kindOf(v)) {
+    case VK_INST:
+      return insts[indexOf(v)].type;
+    case VK_ARG:
+      return params[indexOf(v)];
+    case VK_CONST:
+      return consts[indexOf(v)].type;
+    case VK_GLOBAL:
+      return IR_PTR;
+  }
+  return IR_VOID;
+}
+
+size_t Function::size() const {
+  size_t n = 0;
+  for (auto &block : blocks) n += block.insts.size();
+  return n;
+}
+
+int Module::findFunction(Symbol name) const {
+  for (size_t i = 0; i < functions.size(); i++)
+    if (functions[i].name == name) return i;
+  return -1;
+}
+
+size_t Module::size() const {
+  size_t n = 0;
+  for (auto &func : functions) n += func.size();
+  return n;
+}
+
+namespace {
+
+const char *typeName(IRType type) {
+  switch (type) {
+    case IR_VOID: return "void";
+    case IR_I32: return "i32";
+    case IR_F32: return "f32";
+    case IR_PTR: return "ptr";
+  }
+  return "?";
+}
+
+class Dumper {
+ public:
+  Dumper(const Module &module, OutBuffer &out) : module(module), out(out) {}
+
+  void number(long long v) {
+    char buf[24];
+    out.write(buf, snprintf(buf, sizeof(buf), "%lld", v));
+  }
+
+  // float 按能精确还原的最短形式输出，总带小数点以区别于 int
+  void real(float f) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%.9g", f);
+    out.write(buf, n);
+    if (strpbrk(buf, ".en") == nullptr) out.write(".0");
+  }
+
+  void value(const Function &func, Value v) {
+    switch (kindOf(v)) {
+      case VK_INST:
+        out.put('%');
+        number(indexOf(v));
+        break;
+      case VK_ARG:
+        out.write("%a");
+        number(indexOf(v));
+        break;
+      case VK_CONST:
+        if (func.consts[indexOf(v)].type == IR_F32)
+          real(func.floatOf(v));
+        else
+          number(func.intOf(v));
+        break;
+      case VK_GLOBAL:
+        out.put('@');
+        out.write(interner.name(module.globals[indexOf(v)].name));
+        break;
+    }
+  }
+
+  void block(uint32_t b) {
+    out.write("bb");
+    number(b);
+  }
+
+  void inst(const Function &func, uint32_t index) {
+    const Inst &inst = func.insts[index];
+    out.write("  ");
+    if (inst.type != IR_VOID) {
+      out.put('%');
+      number(index);
+      out.write(" = ");
+    }
+    out.write(opcodeName(inst.op));
+    if (inst.type != IR_VOID && inst.op != OP_ALLOCA && inst.op != OP_GEP) {
+      out.put(' ');
+      out.write(typeName(inst.type));
+    }
+    switch (inst.op) {
+      case OP_ALLOCA:
+        out.put(' ');
+        number(inst.a);
+        break;
+      case OP_GEP:
+        out.put(' ');
+        value(func, inst.a);
+        out.write(", ");
+        value(func, inst.b);
+        out.write(" x ");
+        number(inst.c);
+        break;
+      case OP_ZERO:
+        out.put(' ');
+        value(func, inst.a);
+        out.write(", ");
+        number(inst.b);
+        break;
+      case OP_CALL:
+        out.write(" @");
+        out.write(interner.name(module.functions[inst.a].name));
+        out.put('(');
+        for (uint32_t i = 0; i < inst.c; i++) {
+          if (i > 0) out.write(", ");
+          value(func, func.lists[inst.b + i]);
+        }
+        out.put(')');
+        break;
+      case OP_PHI:
+        for (uint32_t i = 0; i < inst.c; i++) {
+          out.write(i > 0 ? ", [" : " [");
+          value(func, func.lists[inst.b + 2 * i]);
+          out.write(", ");
+          block(func.lists[inst.b + 2 * i + 1]);
+          out.put(']');
+        }
+        break;
+      case OP_BR:
+        out.put(' ');
+        block(inst.a);
+        break;
+      case OP_CONDBR:
+        out.put(' ');
+        value(func, inst.a);
+        out.write(", ");
+        block(inst.b);
+        out.write(", ");
+        block(inst.c);
+        break;
+      default: {
+        const char *sep = " ";
+        forEachOperand(func, inst, [&](const Value &v) {
+          out.write(sep);
+          value(func, v);
+          sep = ", ";
+        });
+        break;
+      }
+    }
+    out.put('\n');
+  }
+
+  void function(const Function &func) {
+    out.write(func.external ? "declare " : "define ");
+    out.write(typeName(func.retType));
+    out.write(" @");
+    out.write(interner.name(func.name));
+    out.put('(');
+    for (size_t i = 0; i < func.params.size(); i++) {
+      if (i > 0) out.write(", ");
+      out.write(typeName(func.params[i]));
+      out.write(" %a");
+      number(i);
+    }
+    out.put(')');
+    if (func.external) {
+      out.put('\n');
+      return;
+    }
+    out.write(" {\n");
+    for (size_t b = 0; b < func.blocks.size(); b++) {
+      block(b);
+      out.write(":\n");
+      for (uint32_t index : func.blocks[b].insts) inst(func, index);
+    }
+    out.write("}\n");
+  }
+
+  void global(const Global &g) {
+    out.put('@');
+    out.write(interner.name(g.name));
+    out.write(g.isConst ? " = const [" : " = global [");
+    number(g.size);
+    out.write(" x ");
+    out.write(typeName(g.type));
+    out.write("] ");
+    if (g.init.empty()) {
+      out.write("zeroinitializer\n");
+      return;
+    }
+    // 连续 4 个以上的 0 写成 [n x 0]
+    std::string_view zero = g.type == IR_F32 ? "0.0" : "0";
+    out.put('{');
+    uint32_t pos = 0;
+    auto zeros = [&](uint32_t n) {
+      if (n == 0) return;
+      if (pos > 0) out.write(", ");
+      if (n >= 4) {
+        out.put('[');
+        number(n);
+        out.write(" x ");
+        out.write(zero);
+        out.put(']');
+        return;
+      }
+      for (uint32_t i = 0; i < n; i++) {
+        if (i > 0) out.write(", ");
+        out.write(zero);
+      }
+    };
+    for (auto &run : g.init) {
+      zeros(run.offset - pos);
+      pos = run.offset;
+      for (uint32_t word : run.words) {
+        if (pos++ > 0) out.write(", ");
+        if (g.type == IR_F32) {
+          float f;
+          memcpy(&f, &word, sizeof(f));
+          real(f);
+        } else {
+          number(static_cast<int>(word));
+        }
+      }
+    }
+    zeros(g.size - pos);
+    out.write("}\n");
+  }
+
+ private:
+  const Module &module;
+  OutBuffer &out;
+};
+
+}  // namespace
+
+void dumpFunction(const Module &module, const Function &func, OutBuffer &out) {
+  Dumper(module, out).function(func);
+}
+
+void dumpModule(const Module &module, OutBuffer &out) {
+  Dumper dumper(module, out);
+  for (auto &g : module.globals) dumper.global(g);
+  if (!module.globals.empty()) out.put('\n');
+  for (size_t i = 0; i < module.functions.size(); i++) {
+    if (i > 0 && !module.functions[i].external) out.put('\n');
+    dumper.function(module.functions[i]);
+  }
+}
+
+std::string dumpModule(const Module &module) {
+  OutBuffer out;
+  dumpModule(module, out);
+  return std::move(out.str());
+}
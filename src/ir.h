@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "out_buffer.h"
+#include "symbol.h"
+
+// SSA 中间表示。每个函数的指令、常量和变长操作数列表都存放在稠密数组里，
+// 指令之间用 32 位的 Value 互相引用，没有逐条分配的节点和指针
+
+// 32 位操作数：高 2 位是种类，低 30 位是对应数组中的下标
+using Value = uint32_t;
+enum ValueKind : uint32_t { VK_INST, VK_ARG, VK_CONST, VK_GLOBAL };
+const Value NO_VALUE = ~Value(0);
+
+inline Value makeValue(ValueKind kind, uint32_t index) {
+  return kind << 30 | index;
+}
+inline ValueKind kindOf(Value v) { return static_cast<ValueKind>(v >> 30); }
+inline uint32_t indexOf(Value v) { return v & 0x3fffffff; }
+
+// int 和 float 都占 4 字节，数组和地址运算以 4 字节的字为单位
+enum IRType : uint8_t { IR_VOID, IR_I32, IR_F32, IR_PTR };
+
+// 操作数约定（a/b/c 为 Inst 的三个字段，“值”表示是 Value，其余是原始整数）：
+//   算术/比较     a, b 值；FNEG/ITOF/FTOI 只用 a
+//   ALLOCA        a 为字数
+//   LOAD          a 值（地址）
+//   STORE         a 值（地址），b 值（要存的数）
+//   GEP           a 值（地址），b 值（下标），c 为步长（字数）；结果 = a + b * c
+//   ZERO          a 值（地址），b 为字数；把这段内存清零
+//   CALL          a 为被调函数在 Module 中的下标，lists[b, b + c) 为实参值
+//   PHI           lists[b, b + 2c) 依次为 c 对（值, 前驱块）
+//   BR            a 为目标块
+//   CONDBR        a 值（条件，非 0 为真），b/c 为真/假目标块
+//   RET           a 值，无返回值时为 NO_VALUE
+enum Opcode : uint8_t {
+  OP_NOP,  // 被删除的指令
+  OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+  OP_FADD, OP_FSUB, OP_FMUL, OP_FDIV, OP_FNEG,
+  // 比较的结果是 i32 的 0 或 1
+  OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE,
+  OP_FEQ, OP_FNE, OP_FLT, OP_FLE, OP_FGT, OP_FGE,
+  OP_ITOF, OP_FTOI,
+  OP_ALLOCA, OP_LOAD, OP_STORE, OP_GEP, OP_ZERO,
+  OP_CALL, OP_PHI,
+  OP_BR, OP_CONDBR, OP_RET,
+  NUM_OPCODES
+};
+
+const char *opcodeName(Opcode op);
+inline bool isTerminator(Opcode op) {
+  return op == OP_BR || op == OP_CONDBR || op == OP_RET;
+}
+// 没有副作用、结果只取决于操作数的指令
+inline bool isPure(Opcode op) {
+  return (op >= OP_ADD && op <= OP_FTOI) || op == OP_GEP;
+}
+
+struct Inst {
+  Opcode op = OP_NOP;
+  IRType type = IR_VOID;
+  uint32_t block = 0;  // 所在的基本块
+  uint32_t a = 0, b = 0, c = 0;
+};
+
+struct Const {
+  IRType type;
+  uint32_t bits;  // int 的值或 float 的位模式
+};
+
+struct Block {
+  std::vector<uint32_t> insts;  // 按顺序排列的指令下标，最后一条是终结指令
+};
+
+class Function {
+ public:
+  Symbol name;
+  IRType retType = IR_VOID;
+  std::vector<IRType> params;  // 数组形参为 IR_PTR
+  bool external = false;       // 运行时库函数，只有声明
+  uint32_t sourceCalls = 0;    // 源程序中其他函数调用它的静态调用点数
+  bool cached = false;         // 增量编译时结果取自缓存，优化 pass 跳过它
+
+  std::vector<Inst> insts;
+  std::vector<Block> blocks;  // blocks[0] 是入口块
+  std::vector<Const> consts;
+  std::vector<uint32_t> lists;
+
+  uint32_t addBlock();
+  // 把指令追加到 block 末尾，返回它的值
+  Value append(uint32_t block, const Inst &inst);
+  // 创建指令但不放进任何块，由调用者插入 Block::insts
+  Value create(const Inst &inst);
+  // 把一组值/块号追加到 lists，返回起始下标
+  uint32_t addList(const std::vector<uint32_t> &list);
+
+  Value constInt(int v);
+  Value constFloat(float v);
+  IRType typeOf(Value v) const;
+  bool isConst(Value v) const { return kindOf(v) == VK_CONST; }
+  int intOf(Value v) const { return consts[indexOf(v)].bits; }
+  float floatOf(Value v) const;
+
+  // 块的最后一条指令
+  Inst &terminator(uint32_t block) { return insts[blocks[block].insts.back()]; }
+  const Inst &terminator(uint32_t block) const {
+    return insts[blocks[block].insts.back()];
+  }
+  // 仍在某个块中的指令数
+  size_t size() const;
+
+ private:
+  std::unordered_map<uint64_t, uint32_t> constIndex;
+};
+
+// 全局变量初值中连续的一段非零字，从第 offset 个字开始
+struct GlobalRun {
+  uint32_t offset;
+  std::vector<uint32_t> words;
+};
+
+// 全局变量；init 是按 offset 递增的几段初值，段外的字都是 0，
+// 为空表示全部为 0
+struct Global {
+  Symbol name;
+  IRType type;  // 元素类型
+  uint32_t size = 1;
+  bool isConst = false;
+  std::vector<GlobalRun> init;
+};
+
+class Module {
+ public:
+  std::vector<Function> functions;
+  std::vector<Global> globals;
+
+  // 返回函数下标，不存在时返回 -1
+  int findFunction(Symbol name) const;
+  size_t size() const;
+};
+
+// 对指令的每个“值”操作数调用 fn(Value &)，func/inst 为 const 时是 const Value &
+template <typename Fn, typename I, typename F>
+void forEachOperand(Fn &func, I &inst, F fn) {
+  switch (inst.op) {
+    case OP_NOP:
+    case OP_ALLOCA:
+    case OP_BR:
+      break;
+    case OP_FNEG:
+    case OP_ITOF:
+    case OP_FTOI:
+    case OP_LOAD:
+    case OP_ZERO:
+    case OP_CONDBR:
+      fn(inst.a);
+      break;
+    case OP_RET:
+      if (inst.a != NO_VALUE) fn(inst.a);
+      break;
+    case OP_CALL:
+      for (uint32_t i = 0; i < inst.c; i++) fn(func.lists[inst.b + i]);
+      break;
+    case OP_PHI:
+      for (uint32_t i = 0; i < inst.c; i++) fn(func.lists[inst.b + 2 * i]);
+      break;
+    default:  // 二元运算、比较、STORE、GEP
+      fn(inst.a);
+      fn(inst.b);
+      break;
+  }
+}
+
+// 对终结指令的每个后继块调用 fn(uint32_t &)
+template <typename I, typename F>
+void forEachSuccessor(I &inst, F fn) {
+  if (inst.op == OP_BR) {
+    fn(inst.a);
+  } else if (inst.op == OP_CONDBR) {
+    fn(inst.b);
+    fn(inst.c);
+  }
+}
+
+// 文本形式，类似 LLVM IR
+void dumpFunction(const Module &module, const Function &func, OutBuffer &out);
+void dumpModule(const Module &module, OutBuffer &out);
+std::string dumpModule(const Module &module);
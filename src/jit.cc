@@ -0,0 +1,159 @@
+#include "jit.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "out_buffer.h"
+#include "sylib.h"
+#include "x86.h"
+#include "x86_asm.h"
+
+namespace {
+
+// 运行时库：直接绑定到编译器链接进来的 runtime/sylib.c
+const struct {
+  const char *name;
+  void *address;
+} RUNTIME[] = {
+    {"getint", reinterpret_cast<void *>(getint)},
+    {"getch", reinterpret_cast<void *>(getch)},
+    {"getfloat", reinterpret_cast<void *>(getfloat)},
+    {"getarray", reinterpret_cast<void *>(getarray)},
+    {"getfarray", reinterpret_cast<void *>(getfarray)},
+    {"putint", reinterpret_cast<void *>(putint)},
+    {"putch", reinterpret_cast<void *>(putch)},
+    {"putfloat", reinterpret_cast<void *>(putfloat)},
+    {"putarray", reinterpret_cast<void *>(putarray)},
+    {"putfarray", reinterpret_cast<void *>(putfarray)},
+    {"starttime", reinterpret_cast<void *>(starttime)},
+    {"stoptime", reinterpret_cast<void *>(stoptime)},
+};
+
+// 跳板：jmp *0(%rip)，后面紧跟 8 字节的目标地址。
+// 运行时库离映射的内存可能超过 ±2GB，call rel32 够不着
+const size_t THUNK_SIZE = 16;
+
+// 程序用的栈：和新进程一样从全 0 的内存开始，栈溢出也不会踩到编译器自己的栈。
+// 最低一页不可访问，溢出时直接出错
+const size_t STACK_SIZE = size_t(256) << 20;
+
+// push %rbp; mov %rsp,%rbp; mov %rdi,%rsp; call *%rsi; mov %rbp,%rsp;
+// pop %rbp; ret
+const uint8_t TRAMPOLINE[] = {0x55, 0x48, 0x89, 0xe5, 0x48, 0x89, 0xfc, 0xff,
+                              0xd6, 0x48, 0x89, 0xec, 0x5d, 0xc3};
+
+size_t roundUp(size_t n, size_t unit) { return (n + unit - 1) / unit * unit; }
+
+}  // namespace
+
+JIT::~JIT() {
+  if (memory != nullptr) munmap(memory, mapped);
+  if (stack != nullptr) munmap(stack, STACK_SIZE);
+}
+
+bool JIT::load(const Module &module, std::string &error, ThreadPool *pool,
+               std::vector<std::string> *texts) {
+  OutBuffer text;
+  emitX86(module, text, pool, texts);
+  AsmObject object;
+  if (!assembleX86(text.str(), object, error)) return false;
+
+  // 模块里没有定义的符号只能是运行时库函数，每个分配一个跳板
+  std::unordered_map<std::string, uint32_t> thunks;
+  std::vector<void *> targets;
+  for (auto &fixup : object.fixups) {
+    if (object.symbols.count(fixup.symbol) || thunks.count(fixup.symbol)) continue;
+    void *address = nullptr;
+    for (auto &entry : RUNTIME)
+      if (fixup.symbol == entry.name) address = entry.address;
+    if (address == nullptr) {
+      error = "undefined symbol '" + fixup.symbol + "'";
+      return false;
+    }
+    thunks.emplace(fixup.symbol,
+                   object.size[AsmObject::TEXT] + THUNK_SIZE * targets.size());
+    targets.push_back(address);
+  }
+  size_t thunkEnd = object.size[AsmObject::TEXT] + THUNK_SIZE * targets.size();
+  codeBytes = thunkEnd + sizeof(TRAMPOLINE);
+
+  // 各节按页对齐依次排开，装好后代码页改成只读可执行，只读数据页改成只读
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t start[AsmObject::NUM_SECTIONS];
+  size_t offset = 0;
+  for (int s = 0; s < AsmObject::NUM_SECTIONS; s++) {
+    start[s] = offset;
+    offset += roundUp(s == AsmObject::TEXT ? codeBytes : object.size[s], page);
+  }
+  if (offset > (size_t(1) << 31)) {
+    error = "program too large for -jit";
+    return false;
+  }
+  mapped = std::max(offset, page);
+  void *p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    mapped = 0;
+    error = "cannot map memory for -jit";
+    return false;
+  }
+  memory = static_cast<uint8_t *>(p);
+  for (int s = 0; s < AsmObject::NUM_SECTIONS; s++)
+    if (!object.bytes[s].empty())
+      memcpy(memory + start[s], object.bytes[s].data(), object.bytes[s].size());
+  for (size_t i = 0; i < targets.size(); i++) {
+    uint8_t *thunk = memory + object.size[AsmObject::TEXT] + THUNK_SIZE * i;
+    static const uint8_t JMP[] = {0xff, 0x25, 0, 0, 0, 0};
+    memcpy(thunk, JMP, sizeof(JMP));
+    memcpy(thunk + sizeof(JMP), &targets[i], sizeof(void *));
+  }
+  memcpy(memory + thunkEnd, TRAMPOLINE, sizeof(TRAMPOLINE));
+
+  for (auto &fixup : object.fixups) {
+    int64_t target;
+    auto symbol = object.symbols.find(fixup.symbol);
+    if (symbol != object.symbols.end())
+      target = start[symbol->second.section] + symbol->second.offset;
+    else
+      target = start[AsmObject::TEXT] + thunks[fixup.symbol];
+    int64_t where = start[fixup.section] + fixup.offset;
+    int32_t value = static_cast<int32_t>(target + fixup.addend - where);
+    memcpy(memory + where, &value, sizeof(value));
+  }
+
+  auto entryPoint = object.symbols.find("main");
+  if (entryPoint == object.symbols.end() ||
+      entryPoint->second.section != AsmObject::TEXT) {
+    error = "no main function";
+    return false;
+  }
+  if (mprotect(memory, roundUp(codeBytes, page), PROT_READ | PROT_EXEC) != 0 ||
+      (object.size[AsmObject::RODATA] > 0 &&
+       mprotect(memory + start[AsmObject::RODATA],
+                roundUp(object.size[AsmObject::RODATA], page), PROT_READ) != 0)) {
+    error = "cannot make -jit code executable";
+    return false;
+  }
+  entry = reinterpret_cast<int (*)()>(memory + entryPoint->second.offset);
+  trampoline = reinterpret_cast<int (*)(void *, int (*)())>(memory + thunkEnd);
+
+  p = mmap(nullptr, STACK_SIZE, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    error = "cannot map stack for -jit";
+    return false;
+  }
+  stack = static_cast<uint8_t *>(p);
+  mprotect(stack, page, PROT_NONE);
+  return true;
+}
+
+void JIT::run(int &exitCode) {
+  sylib_begin();
+  exitCode = trampoline(stack + STACK_SIZE, entry);
+  sylib_end();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ir.h"
+
+class ThreadPool;
+
+// -jit：用 x86 后端生成汇编，在进程内汇编成机器码并装进可执行的内存，
+// 运行时库函数直接绑定到本进程里的实现，不经过汇编器、链接器和新进程。
+// 运行时库与 -run 共用编译器里链接的 runtime/sylib.c
+class JIT {
+ public:
+  JIT() = default;
+  ~JIT();
+  JIT(const JIT &) = delete;
+  JIT &operator=(const JIT &) = delete;
+
+  // 生成并装载整个模块；符号无法解析、地址超出 ±2GB 等情况返回 false。
+  // pool、texts 的含义同 emitX86
+  bool load(const Module &module, std::string &error,
+            ThreadPool *pool = nullptr,
+            std::vector<std::string> *texts = nullptr);
+  // 在单独映射的栈上调用 main，exitCode 为其返回值
+  void run(int &exitCode);
+
+  size_t codeBytes = 0;  // 机器码字节数（含运行时库的跳板）
+
+ private:
+  uint8_t *memory = nullptr;
+  size_t mapped = 0;
+  uint8_t *stack = nullptr;
+  int (*entry)() = nullptr;
+  // 切到 stackTop 上调用 main 再切回来
+  int (*trampoline)(void *stackTop, int (*main)()) = nullptr;
+};
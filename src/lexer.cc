@@ -0,0 +1,383 @@
+#include "lexer.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "symbol.h"
+
+namespace {
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+bool isAlpha(char c) { return (c | 0x20) >= 'a' && (c | 0x20) <= 'z'; }
+bool isHex(char c) {
+  return isDigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+// 下面的扫描函数都依赖内容之后的 '\0' 填充：'\0' 不属于任何字符类，
+// 连续的一串字符最晚在 end 处停下，16 字节的加载不会越过填充区
+#ifdef __SSE2__
+__m128i load(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+unsigned bytesEqual(__m128i v, char c) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+// 字节在 [lo, hi] 中的位掩码；高位为 1 的字节按有符号比较是负数，不会落入
+__m128i inRange(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+unsigned digitMask(__m128i v) { return _mm_movemask_epi8(inRange(v, '0', '9')); }
+
+unsigned identMask(__m128i v) {
+  __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  __m128i ident = _mm_or_si128(inRange(lower, 'a', 'z'), inRange(v, '0', '9'));
+  ident = _mm_or_si128(ident, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+  return _mm_movemask_epi8(ident);
+}
+#endif
+
+const char *digitEnd(const char *p) {
+#ifdef __SSE2__
+  for (;; p += 16) {
+    unsigned stop = ~digitMask(load(p)) & 0xFFFF;
+    if (stop != 0) return p + __builtin_ctz(stop);
+  }
+#else
+  while (isDigit(*p)) p++;
+  return p;
+#endif
+}
+
+const char *identEnd(const char *p) {
+#ifdef __SSE2__
+  for (;; p += 16) {
+    unsigned stop = ~identMask(load(p)) & 0xFFFF;
+    if (stop != 0) return p + __builtin_ctz(stop);
+  }
+#else
+  while (isAlpha(*p) || isDigit(*p) || *p == '_') p++;
+  return p;
+#endif
+}
+
+// 跳过空格、制表符、回车和换行，line 加上其中的换行数
+const char *spaceEnd(const char *p, int &line) {
+#ifdef __SSE2__
+  for (;; p += 16) {
+    __m128i v = load(p);
+    unsigned newlines = bytesEqual(v, '\n');
+    unsigned space = newlines | bytesEqual(v, ' ') | bytesEqual(v, '\t') |
+                     bytesEqual(v, '\r');
+    unsigned stop = ~space & 0xFFFF;
+    if (stop != 0) {
+      unsigned k = __builtin_ctz(stop);
+      line += __builtin_popcount(newlines & ((1u << k) - 1));
+      return p + k;
+    }
+    line += __builtin_popcount(newlines);
+  }
+#else
+  for (;; p++) {
+    if (*p == '\n')
+      line++;
+    else if (*p != ' ' && *p != '\t' && *p != '\r')
+      return p;
+  }
+#endif
+}
+
+// p 之后第一个换行，没有时返回 nullptr
+const char *findNewline(const char *p, const char *end) {
+#ifdef __SSE2__
+  for (; p < end; p += 16) {
+    unsigned newlines = bytesEqual(load(p), '\n');
+    if (newlines != 0) return p + __builtin_ctz(newlines);
+  }
+  return nullptr;
+#else
+  const void *q = memchr(p, '\n', end - p);
+  return static_cast<const char *>(q);
+#endif
+}
+
+// p 之后第一个 "*/" 的下一个字节，line 加上其间的换行数；
+// 没有 "*/" 时返回 nullptr，line 不变
+const char *commentEnd(const char *p, const char *end, int &line) {
+  int lines = 0;
+#ifdef __SSE2__
+  for (; p < end; p += 16) {
+    __m128i v = load(p);
+    unsigned close = bytesEqual(v, '*') & bytesEqual(load(p + 1), '/');
+    unsigned newlines = bytesEqual(v, '\n');
+    if (close != 0) {
+      unsigned k = __builtin_ctz(close);
+      line += lines + __builtin_popcount(newlines & ((1u << k) - 1));
+      return p + k + 2;
+    }
+    lines += __builtin_popcount(newlines);
+  }
+#else
+  for (; p + 1 < end; p++) {
+    if (p[0] == '*' && p[1] == '/') {
+      line += lines;
+      return p + 2;
+    }
+    if (*p == '\n') lines++;
+  }
+#endif
+  return nullptr;
+}
+
+const char *hexEnd(const char *p) {
+  while (isHex(*p)) p++;
+  return p;
+}
+
+// [Ee][-+]?[0-9]+ 或 [Pp][-+]?[0-9]+ 的末尾，不匹配时返回 nullptr
+const char *exponentEnd(const char *p, char letter) {
+  if ((*p | 0x20) != letter) return nullptr;
+  p++;
+  if (*p == '+' || *p == '-') p++;
+  return isDigit(*p) ? digitEnd(p) : nullptr;
+}
+
+const char *suffixEnd(const char *p) {
+  return *p == 'f' || *p == 'F' || *p == 'l' || *p == 'L' ? p + 1 : p;
+}
+
+// DEC_FLOAT_LIT 的最长匹配，不匹配时返回 nullptr
+const char *decFloatEnd(const char *p) {
+  const char *q = digitEnd(p);
+  if (*q == '.') {
+    const char *r = digitEnd(q + 1);
+    if (q == p && r == q + 1) return nullptr;
+    q = r;
+    if (const char *e = exponentEnd(q, 'e')) q = e;
+    return suffixEnd(q);
+  }
+  if (q == p) return nullptr;
+  q = exponentEnd(q, 'e');
+  return q != nullptr ? suffixEnd(q) : nullptr;
+}
+
+// HEX_FLOAT_LIT 的最长匹配（指数不可省略），p 指向 "0x"
+const char *hexFloatEnd(const char *p) {
+  const char *h = p + 2;
+  const char *q = hexEnd(h);
+  if (*q == '.') {
+    const char *r = hexEnd(q + 1);
+    if (q == h && r == q + 1) return nullptr;
+    q = r;
+  } else if (q == h) {
+    return nullptr;
+  }
+  q = exponentEnd(q, 'p');
+  return q != nullptr ? suffixEnd(q) : nullptr;
+}
+
+// 与 strtol(text, nullptr, 0) 赋给 int 的结果相同；
+// 位数不多、不可能溢出 long 时直接累加
+int intValue(const char *p, const char *end) {
+  int base = 10;
+  const char *digits = p;
+  if (p[0] == '0' && end - p > 1) {
+    if ((p[1] | 0x20) == 'x') {
+      base = 16;
+      digits = p + 2;
+    } else {
+      base = 8;
+    }
+  }
+  if (end - digits > (base == 16 ? 15 : 18)) return strtol(p, nullptr, 0);
+  uint64_t value = 0;
+  for (const char *q = digits; q < end; q++) {
+    int d = isDigit(*q) ? *q - '0' : (*q | 0x20) - 'a' + 10;
+    value = value * base + d;
+  }
+  return static_cast<long>(value);
+}
+
+const float kPow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                        1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+// 与 strtof 相同的值。十进制且有效数字不超过 2^24、十的指数在 ±10 以内时，
+// 两个因子都能精确表示为 float，一次乘除即得到正确舍入的结果（Clinger 快速路径）
+float floatValue(const char *p, const char *end) {
+  if (end - p > 1 && (p[1] | 0x20) == 'x') return strtof(p, nullptr);
+  uint64_t mantissa = 0;
+  int digits = 0, exp10 = 0;
+  const char *q = p;
+  for (; isDigit(*q); q++) {
+    if (mantissa != 0 || *q != '0') digits++;
+    mantissa = mantissa * 10 + (*q - '0');
+  }
+  if (*q == '.') {
+    for (q++; isDigit(*q); q++) {
+      if (mantissa != 0 || *q != '0') digits++;
+      mantissa = mantissa * 10 + (*q - '0');
+      exp10--;
+    }
+  }
+  if (digits > 19) return strtof(p, nullptr);
+  if ((*q | 0x20) == 'e') {
+    q++;
+    bool negative = *q == '-';
+    if (*q == '+' || *q == '-') q++;
+    int e = 0;
+    for (; isDigit(*q); q++) {
+      if (e > 1000) return strtof(p, nullptr);
+      e = e * 10 + (*q - '0');
+    }
+    exp10 += negative ? -e : e;
+  }
+  if (mantissa == 0) return 0.0f;
+  while (mantissa % 10 == 0) {
+    mantissa /= 10;
+    exp10++;
+  }
+  if (mantissa > (1u << 24) || exp10 < -10 || exp10 > 10)
+    return strtof(p, nullptr);
+  float value = static_cast<float>(mantissa);
+  return exp10 < 0 ? value / kPow10[-exp10] : value * kPow10[exp10];
+}
+
+struct Keyword {
+  const char *text;
+  size_t len;
+  int code;
+};
+
+// 长度和前两个字符的完美哈希：10 个关键字落在 16 个槽中互不冲突
+unsigned keywordHash(const char *s, size_t len) {
+  return ((len << 1) + static_cast<uint8_t>(s[0]) +
+          (static_cast<uint8_t>(s[1]) << 2)) & 15;
+}
+
+struct KeywordTable {
+  KeywordTable() {
+    static const Keyword keywords[] = {
+        {"int", 3, INTTYPE},   {"float", 5, FLOATTYPE}, {"void", 4, VOID},
+        {"const", 5, CONST},   {"return", 6, RETURN},   {"if", 2, IF},
+        {"else", 4, ELSE},     {"while", 5, WHILE},     {"break", 5, BREAK},
+        {"continue", 8, CONTINUE}};
+    for (const Keyword &kw : keywords) slots[keywordHash(kw.text, kw.len)] = kw;
+  }
+  Keyword slots[16] = {};
+};
+
+const KeywordTable keywordTable;
+
+}  // namespace
+
+void Lexer::skip() {
+  for (;;) {
+    cur = spaceEnd(cur, line);
+    // 注释不完整（// 之后没有换行、/* 没有闭合）时 flex 只匹配出一个 '/'
+    if (cur[0] != '/') return;
+    if (cur[1] == '/') {
+      const char *newline = findNewline(cur + 2, end);
+      if (newline == nullptr) return;
+      cur = newline;
+    } else if (cur[1] == '*') {
+      const char *close = commentEnd(cur + 2, end, line);
+      if (close == nullptr) return;
+      cur = close;
+    } else {
+      return;
+    }
+  }
+}
+
+int Lexer::number(YYSTYPE &lval) {
+  const char *p = cur;
+  bool hex = p[0] == '0' && (p[1] | 0x20) == 'x';
+  // INT 的三种写法，以及 FLOAT_LIT 的最长匹配，取较长的一个
+  const char *intEnd = p;
+  if (hex && isHex(p[2])) {
+    intEnd = hexEnd(p + 2);
+  } else if (p[0] == '0') {
+    for (intEnd = p + 1; *intEnd >= '0' && *intEnd <= '7';) intEnd++;
+  } else if (p[0] != '.') {
+    intEnd = digitEnd(p);
+  }
+  const char *floatEnd = hex ? hexFloatEnd(p) : decFloatEnd(p);
+  if (floatEnd != nullptr && floatEnd > intEnd) {
+    cur = floatEnd;
+    lval.float_val = floatValue(p, floatEnd);
+    return FLOAT;
+  }
+  cur = intEnd;
+  lval.int_val = intValue(p, intEnd);
+  return INT;
+}
+
+int Lexer::identifier(YYSTYPE &lval) {
+  const char *begin = cur;
+  cur = identEnd(cur + 1);
+  size_t len = cur - begin;
+  if (len >= 2 && len <= 8) {
+    const Keyword &kw = keywordTable.slots[keywordHash(begin, len)];
+    if (kw.len == len && memcmp(kw.text, begin, len) == 0) return kw.code;
+  }
+  lval.token = interner.intern(begin, len);
+  return ID;
+}
+
+int Lexer::next(YYSTYPE &lval, YYLTYPE &lloc) {
+  for (;;) {
+    skip();
+    if (cur >= end) return 0;
+    lloc.first_line = lloc.last_line = line;
+    char c = *cur;
+    if (isDigit(c) || (c == '.' && isDigit(cur[1]))) return number(lval);
+    if (isAlpha(c) || c == '_') return identifier(lval);
+    cur++;
+    switch (c) {
+      case '(': return LP;
+      case ')': return RP;
+      case '[': return LB;
+      case ']': return RB;
+      case '{': return LC;
+      case '}': return RC;
+      case ',': return COMMA;
+      case ';': return SEMICOLON;
+      case '-': return MINUS;
+      case '+': return ADD;
+      case '*': return MUL;
+      case '/': return DIV;
+      case '%': return MOD;
+      case '>':
+      case '<':
+      case '=':
+      case '!':
+        if (*cur == '=') {
+          cur++;
+          return c == '>' ? GTE : c == '<' ? LTE : c == '=' ? EQ : NEQ;
+        }
+        return c == '>' ? GT : c == '<' ? LT : c == '=' ? ASSIGN : NOT;
+      case '&':
+      case '|':
+        if (*cur == c) {
+          cur++;
+          return c == '&' ? AND : OR;
+        }
+        break;
+      default:
+        break;
+    }
+    // tokens.l 中 "." 规则的报错，之后继续扫描
+    char text[2] = {c, '\0'};
+    printf("Error type A :Mysterious character \"%s\"\n\t at Line %d\n", text,
+           line);
+  }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "parser.tab.hpp"
+
+// 手写的词法分析器，可代替 flex 生成的扫描器：按 tokens.l 的规则（最长匹配，
+// 等长时取前面的规则）切分，得到的 token 种类、语义值和行号与 flex 相同，
+// 包括 "Mysterious character" 报错、未闭合的 /* 和文件末尾没有换行的 //
+// 都退化成 DIV。空白、注释、标识符和数字串用 SSE2 一次比较 16 字节，
+// 换行数按位计数；关键字查一张完美哈希表；常见的整数和浮点数直接算出值，
+// 超出快速路径的才交给 strtol/strtof。不维护列号，lloc 只填行号
+class Lexer {
+ public:
+  // [begin, end) 是源文件内容，end 之后至少有 SourceFile::PADDING 个 '\0'
+  Lexer(const char *begin, const char *end) : cur(begin), end(end) {}
+
+  // 返回 token 编码，文件结束时返回 0 且不改动 lloc
+  int next(YYSTYPE &lval, YYLTYPE &lloc);
+
+ private:
+  // 跳过空白和注释，遇到 token 的开头或文件末尾时停下
+  void skip();
+  int number(YYSTYPE &lval);
+  int identifier(YYSTYPE &lval);
+
+  const char *cur;
+  const char *end;
+  int line = 1;
+};
@@ -0,0 +1,117 @@
+#include <algorithm>
+
+#include "cfg.h"
+#include "pass.h"
+
+namespace {
+
+// 保证每个循环头只有一个来自循环外的前驱，且它只有这一个后继；返回是否改了 CFG
+bool insertPreheaders(Function &func) {
+  CFG cfg(func);
+  DomTree dom(cfg);
+  bool changed = false;
+  for (const Loop &loop : findLoops(cfg, dom)) {
+    uint32_t h = loop.header;
+    std::vector<uint32_t> outside;
+    for (uint32_t pred : cfg.preds[h])
+      if (cfg.reachable(pred) && !dom.dominates(h, pred)) outside.push_back(pred);
+    if (outside.empty() ||
+        (outside.size() == 1 && cfg.succs[outside[0]].size() == 1))
+      continue;
+
+    uint32_t pre = func.addBlock();
+    for (uint32_t pred : outside) {
+      forEachSuccessor(func.terminator(pred), [&](uint32_t &target) {
+        if (target == h) target = pre;
+      });
+    }
+    // 头块 PHI 中来自循环外的入边合并到前置块的 PHI
+    for (uint32_t index : func.blocks[h].insts) {
+      if (func.insts[index].op != OP_PHI) break;
+      std::vector<std::pair<Value, uint32_t>> kept, moved;
+      Inst phi = func.insts[index];
+      for (uint32_t i = 0; i < phi.c; i++) {
+        Value v = func.lists[phi.b + 2 * i];
+        uint32_t pred = func.lists[phi.b + 2 * i + 1];
+        bool out = std::find(outside.begin(), outside.end(), pred) != outside.end();
+        (out ? moved : kept).push_back({v, pred});
+      }
+      Value v = moved.empty() ? NO_VALUE : moved[0].first;
+      for (auto &entry : moved)
+        if (entry.first != v) v = NO_VALUE;
+      if (v == NO_VALUE && !moved.empty()) {
+        v = insertPhi(func, pre, phi.type);
+        setIncoming(func, func.insts[indexOf(v)], moved);
+      }
+      if (!moved.empty()) kept.push_back({v, pre});
+      setIncoming(func, func.insts[index], kept);
+    }
+    Inst br;
+    br.op = OP_BR;
+    br.a = h;
+    func.append(pre, br);
+    changed = true;
+  }
+  return changed;
+}
+
+// 提前执行不会出错的纯运算：除法和取模只在除数是非 0、非 -1 的常量时
+bool hoistable(const Function &func, const Inst &inst) {
+  if (!isPure(inst.op)) return false;
+  if (inst.op != OP_DIV && inst.op != OP_MOD) return true;
+  return func.isConst(inst.b) && func.intOf(inst.b) != 0 &&
+         func.intOf(inst.b) != -1;
+}
+
+}  // namespace
+
+bool licm(Module &module, Function &func) {
+  bool changed = insertPreheaders(func);
+  CFG cfg(func);
+  DomTree dom(cfg);
+  std::vector<Loop> loops = findLoops(cfg, dom);
+  // 内层循环先做，提出来的指令落在外层循环里还能继续外提
+  std::stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+    return a.blocks.size() < b.blocks.size();
+  });
+
+  std::vector<bool> inLoop(func.blocks.size(), false);
+  for (const Loop &loop : loops) {
+    uint32_t pre = CFG::NONE;
+    for (uint32_t pred : cfg.preds[loop.header])
+      if (cfg.reachable(pred) && !dom.dominates(loop.header, pred)) pre = pred;
+    if (pre == CFG::NONE) continue;
+
+    for (uint32_t b : loop.blocks) inLoop[b] = true;
+    std::vector<uint32_t> blocks = loop.blocks;
+    std::sort(blocks.begin(), blocks.end(), [&](uint32_t a, uint32_t b) {
+      return cfg.order[a] < cfg.order[b];
+    });
+    std::vector<uint32_t> hoisted;
+    for (uint32_t b : blocks) {
+      auto &insts = func.blocks[b].insts;
+      size_t k = 0;
+      for (uint32_t index : insts) {
+        Inst &inst = func.insts[index];
+        bool invariant = hoistable(func, inst);
+        forEachOperand(func, inst, [&](Value v) {
+          if (kindOf(v) == VK_INST && inLoop[func.insts[indexOf(v)].block])
+            invariant = false;
+        });
+        if (!invariant) {
+          insts[k++] = index;
+          continue;
+        }
+        inst.block = pre;
+        hoisted.push_back(index);
+      }
+      insts.resize(k);
+    }
+    for (uint32_t b : loop.blocks) inLoop[b] = false;
+    if (hoisted.empty()) continue;
+    auto &preInsts = func.blocks[pre].insts;
+    preInsts.insert(preInsts.end() - 1, hoisted.begin(), hoisted.end());
+    changed = true;
+  }
+  return changed;
+}
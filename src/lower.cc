@@ -0,0 +1,460 @@
+#include "lower.h"
+
+#include <cstring>
+
+#include "const_fold.h"
+
+namespace {
+
+IRType irType(TYPE type) {
+  switch (type) {
+    case TYPE_INT: return IR_I32;
+    case TYPE_FLOAT: return IR_F32;
+    default: return IR_VOID;
+  }
+}
+
+std::string quoted(Symbol id) { return "'" + std::string(interner.name(id)) + "'"; }
+
+bool isCompare(Opcode op) { return op >= OP_EQ && op <= OP_FGE; }
+
+// 整数比较与浮点比较的操作码按相同顺序排列
+Opcode compareOp(BOP op, bool isFloat) {
+  Opcode base = isFloat ? OP_FEQ : OP_EQ;
+  switch (op) {
+    case BOP_EQ: return base;
+    case BOP_NEQ: return Opcode(base + 1);
+    case BOP_LT: return Opcode(base + 2);
+    case BOP_LTE: return Opcode(base + 3);
+    case BOP_GT: return Opcode(base + 4);
+    default: return Opcode(base + 5);  // BOP_GTE
+  }
+}
+
+Opcode arithOp(BOP op, bool isFloat) {
+  switch (op) {
+    case BOP_ADD: return isFloat ? OP_FADD : OP_ADD;
+    case BOP_MINUS: return isFloat ? OP_FSUB : OP_SUB;
+    case BOP_MUL: return isFloat ? OP_FMUL : OP_MUL;
+    case BOP_DIV: return isFloat ? OP_FDIV : OP_DIV;
+    default: return OP_MOD;
+  }
+}
+
+// 位模式全 0 的常量（-0.0f 不算）
+bool zeroConstant(const ExpAST *exp) {
+  if (exp->kind != EXP_NUMBER) return false;
+  auto num = static_cast<const NumberAST *>(exp);
+  uint32_t bits;
+  if (num->isInt)
+    bits = num->intval;
+  else
+    memcpy(&bits, &num->floatval, sizeof(bits));
+  return bits == 0;
+}
+
+}  // namespace
+
+Value Lowering::emit(Opcode op, IRType type, uint32_t a, uint32_t b,
+                     uint32_t c) {
+  Inst inst;
+  inst.op = op;
+  inst.type = type;
+  inst.a = a;
+  inst.b = b;
+  inst.c = c;
+  return fn().append(cur, inst);
+}
+
+void Lowering::jump(uint32_t target) {
+  emit(OP_BR, IR_VOID, target);
+  startBlock(fn().addBlock());
+}
+
+Value Lowering::alloca(uint32_t words) {
+  Inst inst;
+  inst.op = OP_ALLOCA;
+  inst.type = IR_PTR;
+  inst.a = words;
+  Value v = fn().create(inst);
+  allocas.push_back(indexOf(v));
+  return v;
+}
+
+uint32_t Lowering::functionIndex(FuncDefAST *func) {
+  auto it = funcs.find(func);
+  if (it != funcs.end()) return it->second;
+  // 第一次调用到的运行时库函数
+  Function decl;
+  decl.name = func->id;
+  decl.retType = irType(func->funcType);
+  decl.external = true;
+  for (auto param : func->funcFParamList)
+    decl.params.push_back(param->isArray ? IR_PTR : irType(param->bType));
+  module.functions.push_back(std::move(decl));
+  funcs[func] = module.functions.size() - 1;
+  return module.functions.size() - 1;
+}
+
+Value Lowering::convert(Value v, IRType type) {
+  IRType from = fn().typeOf(v);
+  if (from == type) return v;
+  if (type == IR_F32) {
+    if (fn().isConst(v)) return fn().constFloat(fn().intOf(v));
+    return emit(OP_ITOF, IR_F32, v);
+  }
+  if (fn().isConst(v)) return fn().constInt(static_cast<int>(fn().floatOf(v)));
+  return emit(OP_FTOI, IR_I32, v);
+}
+
+Value Lowering::exp(ExpAST *ast) {
+  ast->accept(*this);
+  return result;
+}
+
+Value Lowering::address(LValAST &ast) {
+  Value base;
+  std::vector<int> dims;
+  if (ast.def != nullptr) {
+    base = vars.at(ast.def);
+    dims = ast.def->dims;
+  } else {
+    base = vars.at(ast.param);
+    if (ast.param->isArray) {
+      // 数组形参的第一维长度未知，不参与步长计算
+      dims.push_back(0);
+      dims.insert(dims.end(), ast.param->dims.begin(), ast.param->dims.end());
+    }
+  }
+  for (size_t i = 0; i < ast.arrays.size(); i++) {
+    Value index = convert(exp(ast.arrays[i]), IR_I32);
+    if (fn().isConst(index) && fn().intOf(index) == 0) continue;
+    base = emit(OP_GEP, IR_PTR, base, index, elementCount(dims, i + 1));
+  }
+  return base;
+}
+
+void Lowering::cond(ExpAST *ast, uint32_t t, uint32_t f) {
+  if (ast->kind == EXP_BINARY) {
+    auto &bin = static_cast<BinaryExpAST &>(*ast);
+    if (bin.op == BOP_AND || bin.op == BOP_OR) {
+      uint32_t rhs = fn().addBlock();
+      if (bin.op == BOP_AND)
+        cond(bin.lhs, rhs, f);
+      else
+        cond(bin.lhs, t, rhs);
+      startBlock(rhs);
+      cond(bin.rhs, t, f);
+      return;
+    }
+  }
+  if (ast->kind == EXP_UNARY) {
+    auto &unary = static_cast<UnaryExpAST &>(*ast);
+    if (unary.op == UOP_NOT) {
+      cond(unary.exp, f, t);
+      return;
+    }
+  }
+  if (ast->kind == EXP_NUMBER) {
+    auto &num = static_cast<NumberAST &>(*ast);
+    bool truth = num.isInt ? num.intval != 0 : num.floatval != 0;
+    emit(OP_BR, IR_VOID, truth ? t : f);
+    return;
+  }
+  Value v = exp(ast);
+  if (fn().typeOf(v) == IR_F32)
+    v = emit(OP_FNE, IR_I32, v, fn().constFloat(0));
+  else if (kindOf(v) != VK_INST || !isCompare(fn().insts[indexOf(v)].op))
+    v = emit(OP_NE, IR_I32, v, fn().constInt(0));
+  emit(OP_CONDBR, IR_VOID, v, t, f);
+}
+
+void Lowering::visit(CompUnitAST &ast) {
+  // 先给所有函数占好下标，函数体里可以调用后面定义的函数
+  for (auto declDef : ast.declDefList) {
+    FuncDefAST *func = declDef->funcDef;
+    if (func == nullptr) continue;
+    Function decl;
+    decl.name = func->id;
+    decl.retType = irType(func->funcType);
+    for (auto param : func->funcFParamList)
+      decl.params.push_back(param->isArray ? IR_PTR : irType(param->bType));
+    module.functions.push_back(std::move(decl));
+    funcs[func] = module.functions.size() - 1;
+  }
+  for (auto declDef : ast.declDefList) declDef->accept(*this);
+}
+
+void Lowering::visit(DeclDefAST &ast) {
+  if (ast.Decl != nullptr) ast.Decl->accept(*this);
+  if (ast.funcDef != nullptr) ast.funcDef->accept(*this);
+}
+
+void Lowering::visit(DeclAST &ast) {
+  for (auto def : ast.defList) def->accept(*this);
+}
+
+void Lowering::visit(DefAST &ast) {
+  IRType type = irType(ast.bType);
+  uint32_t words = elementCount(ast.dims);
+  if (!inFunction) {
+    // 全局变量的初值已经由常量折叠求出
+    Global global;
+    global.name = ast.id;
+    global.type = type;
+    global.size = words;
+    global.isConst = ast.isConst;
+    if (ast.initVal != nullptr) {
+      FlatInit values;
+      if (!flattenInitVal(*ast.initVal, ast.dims, values))
+        error("initializer of global " + quoted(ast.id) +
+              " is not a constant of the declared shape");
+      for (auto &run : values.runs) {
+        GlobalRun &out = global.init.emplace_back();
+        out.offset = run.offset;
+        out.words.resize(run.values.size());
+        for (size_t i = 0; i < run.values.size(); i++) {
+          if (type == IR_F32)
+            memcpy(&out.words[i], &run.values[i].floatval, 4);
+          else
+            out.words[i] = run.values[i].intval;
+        }
+      }
+    }
+    module.globals.push_back(std::move(global));
+    vars[&ast] = makeValue(VK_GLOBAL, module.globals.size() - 1);
+    return;
+  }
+
+  Value addr = alloca(words == 0 ? 1 : words);
+  vars[&ast] = addr;
+  if (ast.initVal == nullptr) return;
+  if (ast.dims.empty()) {
+    emit(OP_STORE, IR_VOID, addr, convert(exp(ast.initVal->exp), type));
+    return;
+  }
+  // 局部数组：先整体清零，再逐个写入给出的元素，清零后常量 0 不用再写
+  size_t given = 0;
+  bool ok = forEachInit(*ast.initVal, ast.dims, [&](size_t, ExpAST *) {
+    given++;
+    return true;
+  });
+  if (!ok) {
+    error("initializer of " + quoted(ast.id) + " does not match its shape");
+    return;
+  }
+  bool zeroed = given < words;
+  if (zeroed) emit(OP_ZERO, IR_VOID, addr, words);
+  ok = forEachInit(*ast.initVal, ast.dims, [&](size_t pos, ExpAST *init) {
+    if (zeroed && zeroConstant(init)) return true;
+    Value v = convert(exp(init), type);
+    Value elem = pos == 0 ? addr
+                          : emit(OP_GEP, IR_PTR, addr, fn().constInt(pos), 1);
+    emit(OP_STORE, IR_VOID, elem, v);
+    return true;
+  });
+  if (!ok)
+    error("initializer of " + quoted(ast.id) + " does not match its shape");
+}
+
+void Lowering::visit(InitValAST &ast) {}
+
+void Lowering::visit(FuncDefAST &ast) {
+  current = funcs.at(&ast);
+  inFunction = true;
+  allocas.clear();
+  startBlock(fn().addBlock());
+  for (size_t i = 0; i < ast.funcFParamList.size(); i++) {
+    FuncFParamAST *param = ast.funcFParamList[i];
+    Value arg = makeValue(VK_ARG, i);
+    if (param->isArray) {
+      vars[param] = arg;
+    } else {
+      Value addr = alloca(1);
+      emit(OP_STORE, IR_VOID, addr, arg);
+      vars[param] = addr;
+    }
+  }
+  for (auto item : ast.block->blockItemList) item->accept(*this);
+
+  // 从函数末尾落出时返回 0（SysY 中这是未定义行为，main 约定返回 0）
+  IRType ret = fn().retType;
+  if (ret == IR_VOID)
+    emit(OP_RET, IR_VOID, NO_VALUE);
+  else
+    emit(OP_RET, IR_VOID, ret == IR_F32 ? fn().constFloat(0) : fn().constInt(0));
+
+  auto &entry = fn().blocks[0].insts;
+  entry.insert(entry.begin(), allocas.begin(), allocas.end());
+  inFunction = false;
+}
+
+void Lowering::visit(FuncFParamAST &ast) {}
+
+void Lowering::visit(BlockAST &ast) {
+  for (auto item : ast.blockItemList) item->accept(*this);
+}
+
+void Lowering::visit(BlockItemAST &ast) {
+  if (ast.decl != nullptr) ast.decl->accept(*this);
+  if (ast.stmt != nullptr) ast.stmt->accept(*this);
+}
+
+void Lowering::visit(StmtAST &ast) {
+  switch (ast.sType) {
+    case ASS: {
+      Value addr = address(*ast.lVal);
+      Value v = convert(exp(ast.exp), irType(ast.lVal->type));
+      emit(OP_STORE, IR_VOID, addr, v);
+      break;
+    }
+    case EXP:
+      exp(ast.exp);
+      break;
+    case CONT:
+      jump(loops.back().first);
+      break;
+    case BRE:
+      jump(loops.back().second);
+      break;
+    case RET:
+      ast.returnStmt->accept(*this);
+      break;
+    case BLK:
+      ast.block->accept(*this);
+      break;
+    case SELECT:
+      ast.selectStmt->accept(*this);
+      break;
+    case ITER:
+      ast.iterationStmt->accept(*this);
+      break;
+    case SEMI:
+      break;
+  }
+}
+
+void Lowering::visit(ReturnStmtAST &ast) {
+  Value v = NO_VALUE;
+  if (ast.exp != nullptr) v = convert(exp(ast.exp), fn().retType);
+  emit(OP_RET, IR_VOID, v);
+  startBlock(fn().addBlock());
+}
+
+void Lowering::visit(SelectStmtAST &ast) {
+  uint32_t thenBlock = fn().addBlock();
+  uint32_t elseBlock = ast.elseStmt != nullptr ? fn().addBlock() : 0;
+  uint32_t end = fn().addBlock();
+  cond(ast.cond, thenBlock, ast.elseStmt != nullptr ? elseBlock : end);
+  startBlock(thenBlock);
+  ast.ifStmt->accept(*this);
+  emit(OP_BR, IR_VOID, end);
+  if (ast.elseStmt != nullptr) {
+    startBlock(elseBlock);
+    ast.elseStmt->accept(*this);
+    emit(OP_BR, IR_VOID, end);
+  }
+  startBlock(end);
+}
+
+void Lowering::visit(IterationStmtAST &ast) {
+  uint32_t head = fn().addBlock();
+  uint32_t body = fn().addBlock();
+  uint32_t end = fn().addBlock();
+  emit(OP_BR, IR_VOID, head);
+  startBlock(head);
+  cond(ast.cond, body, end);
+  loops.push_back({head, end});
+  startBlock(body);
+  ast.stmt->accept(*this);
+  emit(OP_BR, IR_VOID, head);
+  loops.pop_back();
+  startBlock(end);
+}
+
+void Lowering::visit(BinaryExpAST &ast) {
+  if (ast.op == BOP_AND || ast.op == BOP_OR) {
+    // 作为值使用的逻辑运算：短路分支后用 PHI 合并出 0/1
+    uint32_t t = fn().addBlock();
+    uint32_t f = fn().addBlock();
+    uint32_t join = fn().addBlock();
+    cond(&ast, t, f);
+    startBlock(t);
+    emit(OP_BR, IR_VOID, join);
+    startBlock(f);
+    emit(OP_BR, IR_VOID, join);
+    startBlock(join);
+    uint32_t list = fn().addList({fn().constInt(1), t, fn().constInt(0), f});
+    result = emit(OP_PHI, IR_I32, 0, list, 2);
+    return;
+  }
+  Value l = exp(ast.lhs);
+  Value r = exp(ast.rhs);
+  bool isFloat = fn().typeOf(l) == IR_F32 || fn().typeOf(r) == IR_F32;
+  if (isFloat) {
+    l = convert(l, IR_F32);
+    r = convert(r, IR_F32);
+  }
+  switch (ast.op) {
+    case BOP_MUL:
+    case BOP_DIV:
+    case BOP_MOD:
+    case BOP_ADD:
+    case BOP_MINUS:
+      result = emit(arithOp(ast.op, isFloat), isFloat ? IR_F32 : IR_I32, l, r);
+      break;
+    default:
+      result = emit(compareOp(ast.op, isFloat), IR_I32, l, r);
+      break;
+  }
+}
+
+void Lowering::visit(UnaryExpAST &ast) {
+  Value v = exp(ast.exp);
+  bool isFloat = fn().typeOf(v) == IR_F32;
+  switch (ast.op) {
+    case UOP_ADD:
+      result = v;
+      break;
+    case UOP_MINUS:
+      result = isFloat ? emit(OP_FNEG, IR_F32, v)
+                       : emit(OP_SUB, IR_I32, fn().constInt(0), v);
+      break;
+    case UOP_NOT:
+      result = isFloat ? emit(OP_FEQ, IR_I32, v, fn().constFloat(0))
+                       : emit(OP_EQ, IR_I32, v, fn().constInt(0));
+      break;
+  }
+}
+
+void Lowering::visit(LValAST &ast) {
+  Value addr = address(ast);
+  // 下标不全的数组作为实参传递首地址
+  result = ast.rank > 0 ? addr : emit(OP_LOAD, irType(ast.type), addr);
+}
+
+void Lowering::visit(NumberAST &ast) {
+  result = ast.isInt ? fn().constInt(ast.intval) : fn().constFloat(ast.floatval);
+}
+
+void Lowering::visit(CallAST &ast) {
+  uint32_t callee = functionIndex(ast.func);
+  if (callee != current) module.functions[callee].sourceCalls++;
+  std::vector<uint32_t> args;
+  for (size_t i = 0; i < ast.funcCParamList.size(); i++) {
+    Value v = exp(ast.funcCParamList[i]);
+    IRType type = module.functions[callee].params[i];
+    args.push_back(type == IR_PTR ? v : convert(v, type));
+  }
+  uint32_t list = fn().addList(args);
+  result = emit(OP_CALL, module.functions[callee].retType, callee, list,
+                args.size());
+}
+
+Module lowerProgram(CompUnitAST &root, std::vector<std::string> &errors) {
+  Module module;
+  Lowering lowering(module);
+  lowering.visit(root);
+  errors = std::move(lowering.errors);
+  return module;
+}
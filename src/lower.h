@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+#include "ir.h"
+
+// 把经过常量折叠和语义分析的 AST 翻译成 IR：
+// 局部变量和标量形参都放在入口块的 ALLOCA 里（之后由 mem2reg 提升为 SSA 值），
+// if/while 翻译成基本块之间的边，&& / || 翻译成短路分支，
+// 算术和比较按 sema 给出的类型插入 int/float 转换。
+// return/break/continue 之后的语句落在新开的不可达块里，由 CFG 化简删除
+class Lowering : public Visitor {
+ public:
+  explicit Lowering(Module &module) : module(module) {}
+
+  void visit(CompUnitAST &ast) override;
+  void visit(DeclDefAST &ast) override;
+  void visit(DeclAST &ast) override;
+  void visit(DefAST &ast) override;
+  void visit(InitValAST &ast) override;
+  void visit(FuncDefAST &ast) override;
+  void visit(FuncFParamAST &ast) override;
+  void visit(BlockAST &ast) override;
+  void visit(BlockItemAST &ast) override;
+  void visit(StmtAST &ast) override;
+  void visit(ReturnStmtAST &ast) override;
+  void visit(SelectStmtAST &ast) override;
+  void visit(IterationStmtAST &ast) override;
+  void visit(BinaryExpAST &ast) override;
+  void visit(UnaryExpAST &ast) override;
+  void visit(LValAST &ast) override;
+  void visit(NumberAST &ast) override;
+  void visit(CallAST &ast) override;
+
+  // 常量折叠漏掉的初值错误；不为空时 module 不完整
+  std::vector<std::string> errors;
+
+ private:
+  Function &fn() { return module.functions[current]; }
+  Value emit(Opcode op, IRType type, uint32_t a = 0, uint32_t b = 0,
+             uint32_t c = 0);
+  // 结束当前块并转到新块
+  void jump(uint32_t target);
+  void startBlock(uint32_t block) { cur = block; }
+  Value alloca(uint32_t words);
+  uint32_t functionIndex(FuncDefAST *func);
+  void error(std::string msg) { errors.push_back(std::move(msg)); }
+
+  Value exp(ExpAST *ast);
+  Value convert(Value v, IRType type);
+  // 左值的地址；下标不全时是子数组的首地址
+  Value address(LValAST &ast);
+  // 按条件跳到 t 或 f，&& / || / ! 展开成短路分支
+  void cond(ExpAST *ast, uint32_t t, uint32_t f);
+
+  Module &module;
+  bool inFunction = false;
+  uint32_t current = 0;     // 当前函数在 module 中的下标
+  uint32_t cur = 0;         // 当前基本块
+  Value result = NO_VALUE;  // 表达式 visit 的返回值
+  std::vector<uint32_t> allocas;  // 当前函数的 ALLOCA，最后统一放到入口块开头
+  std::unordered_map<const void *, Value> vars;  // DefAST/FuncFParamAST -> 地址
+  std::unordered_map<const FuncDefAST *, uint32_t> funcs;
+  std::vector<std::pair<uint32_t, uint32_t>> loops;  // (continue, break) 目标
+};
+
+// 整个编译单元翻译成一个 Module，出错时错误信息追加到 errors
+Module lowerProgram(CompUnitAST &root, std::vector<std::string> &errors);
@@ -1,45 +1,568 @@
-#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
-
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "ast.h"
+#include "ast_cache.h"
+#include "bytecode.h"
+#include "const_fold.h"
+#include "flat_ast.h"
+#include "func_cache.h"
+#include "ir.h"
+#include "jit.h"
+#include "lower.h"
+#include "parse_context.h"
+#include "pass.h"
 #include "printer.h"
+#include "sema.h"
+#include "stats.h"
+#include "thread_pool.h"
+#include "verify.h"
+#include "vm.h"
+#include "x86.h"
 
-extern std::unique_ptr<CompUnitAST> root;
-extern int yyparse();
-extern void initFileName(char *);
-extern FILE *yyin;
 void preprocess(std::string srcFileName);
 
-int main(int argc, char **argv) {
-  assert(argc >= 2);
-  char *filename;
+struct Options {
   bool print_ast = false;
-  if (argc == 2) {
-    filename = argv[1];
-  } else if (argc == 3) {
-    print_ast = true;
-    filename = argv[2];
-  }
-  yyin = fopen(filename, "r");
-  if (yyin == nullptr) {
-    std::cout << "yyin open " << filename << " failed" << std::endl;
+  bool lex_only = false;  // 只跑词法分析并报告吞吐量
+  bool dump_tokens = false;  // -lex 时把 token 流写到 <name>.tokens.txt
+  bool fast_lexer = false;   // 用手写的 SIMD 词法分析器代替 flex
+  bool use_mmap = true;
+  bool rd_parser = false;  // 用手写的递归下降分析器代替 yyparse()
+  bool flat = false;  // 建成 FlatAST 后从数组直接输出，需要树的遍再还原
+  bool fold = false;  // 常量折叠
+  bool sema = false;  // 语义分析
+  bool ir = false;    // 翻译成 IR 并校验，输出 <name>.ir.txt
+  bool bc = false;    // 输出字节码 <name>.bc.txt
+  bool run = false;   // 用字节码解释器执行
+  bool emit_asm = false;  // 输出 x86-64 汇编 <name>.s
+  bool jit = false;  // 在进程内生成机器码并执行
+  bool optimize = false;  // 在 IR 上运行优化流水线
+  PassManager passes;
+  const char *cache_dir = nullptr;
+  const char *func_cache_dir = nullptr;  // 按函数缓存生成的汇编
+  std::string out_dir = "./example";
+  bool time_report = false;  // 各阶段耗时和峰值内存
+  bool stats = false;        // 另加堆分配、Arena 用量和 AST 节点数
+  const char *stats_json = nullptr;  // JSON 格式的统计写到这里，"-" 为标准输出
+};
+
+// 单个文件的编译结果
+struct Result {
+  bool ok = false;
+  double ms = 0;
+  std::string error;
+  int exitCode = 0;  // -run/-jit 时 main 的返回值
+};
+
+static void usage(const char *prog) {
+  std::cout << "usage: " << prog
+            << " [-ast] [-lex] [-tokens] [-no-mmap] [-fast-lex] [-rd] [-flat] [-fold]\n"
+               "       [-sema] [-ir] [-bc] [-run] [-S] [-jit] [-O] [-passes=<a,b,...>]\n"
+               "       [-no-<pass>] [-verify-each] [-ast-cache <dir>] [-func-cache <dir>]\n"
+               "       [-o <dir>] [-j <threads>] <file>\n"
+            << "       " << prog
+            << " -batch <list|dir> [-j <threads>] [options]\n"
+            << "       [--time-report] [--stats] [--stats-json <file|->]"
+            << std::endl;
+}
+
+// 打开 path 并用 fill 写入内容，失败时返回错误信息
+template <typename F>
+static std::string writeFile(const std::string &path, F fill) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return "open " + path + " failed";
+  OutBuffer out(fd);
+  fill(out);
+  out.flush();
+  close(fd);
+  return out.failed() ? "write " + path + " failed" : "";
+}
+
+// IR 需要折叠出的数组维数和语义分析的类型、名字解析结果
+static bool wantIR(const Options &opt) {
+  return opt.ir || opt.bc || opt.run || opt.emit_asm || opt.jit ||
+         opt.optimize;
+}
+
+static std::string baseName(const std::string &path) {
+  size_t slash = path.rfind('/');
+  return slash != std::string::npos ? path.substr(slash + 1) : path;
+}
+
+// 编译一个文件，-ast 时输出到 <out_dir>/<outName>.ast.txt，
+// -ir/-bc/-S 时输出到 <out_dir>/<outName>.ir.txt/.bc.txt/.s；
+// stats 不为空时记录各阶段耗时和节点数；pool 不为空时 AST 输出、优化和
+// 代码生成按顶层声明或函数并行
+static Result compileFile(const Options &opt, const std::string &path,
+                          const std::string &outName, Stats *stats,
+                          ThreadPool *pool = nullptr) {
+  Result result;
+  auto start = std::chrono::steady_clock::now();
+  auto finish = [&](bool ok, std::string error) {
+    std::chrono::duration<double, std::milli> ms =
+        std::chrono::steady_clock::now() - start;
+    result.ok = ok;
+    result.ms = ms.count();
+    result.error = std::move(error);
+    return result;
+  };
+
+  ParseContext ctx(baseName(path));
+  if (stats != nullptr) stats->files++;
+  {
+    auto timer = Stats::time(stats, "open");
+    if (!ctx.open(path.c_str(), opt.use_mmap, opt.fast_lexer))
+      return finish(false, "open " + path + " failed");
+  }
+
+  if (opt.lex_only) {
+    size_t tokens = 0;
+    if (opt.dump_tokens) {
+      std::string error = writeFile(
+          opt.out_dir + "/" + outName + ".tokens.txt",
+          [&](OutBuffer &out) { tokens = ctx.lex(&out); });
+      if (!error.empty()) return finish(false, error);
+    } else {
+      auto timer = Stats::time(stats, "scan");
+      tokens = ctx.lex();
+    }
+    finish(true, "");
+    std::cerr << "lexed " << tokens << " tokens, " << ctx.bytes << " bytes in "
+              << result.ms << " ms ("
+              << ctx.bytes / (result.ms / 1000) / (1024 * 1024) << " MB/s, "
+              << (opt.use_mmap ? "mmap" : "stdio") << ", "
+              << (opt.fast_lexer ? "simd" : "flex") << ")" << std::endl;
+    return result;
+  }
+
+  // 常量折叠、语义分析和 IR 要改写或标注指针树；只输出 AST 时
+  // 缓存命中或 -flat 的 FlatAST 由 FlatPrinter 直接输出，不再还原成树
+  bool needTree = opt.fold || opt.sema || wantIR(opt);
+  CompUnitAST *root = nullptr;
+  FlatAST flat;
+  bool haveFlat = false;
+  if (opt.cache_dir != nullptr) {
+    auto timer = Stats::time(stats, "cache");
+    haveFlat = ASTCache(opt.cache_dir).load(ctx.text(), flat);
+  }
+  if (!haveFlat) {
+    // 扫描和语法分析交替进行：按 yylex 在这次解析中所占的比例把
+    // 总时间分成 scan 和 parse 两个阶段，两者之和就是解析的实际耗时
+    Stats parse;
+    ctx.timeScan = stats != nullptr;
+    {
+      auto timer = Stats::time(stats != nullptr ? &parse : nullptr, "parse");
+      root = ctx.parse(opt.rd_parser);
+    }
+    if (stats != nullptr) {
+      const Stats::Phase &total = parse.phases[0];
+      double scan = ctx.scanFraction();
+      stats->addPhase("scan", total.wallMs * scan, total.cpuMs * scan);
+      stats->addPhase("parse", total.wallMs * (1 - scan),
+                      total.cpuMs * (1 - scan));
+    }
+    if (root == nullptr)
+      return finish(false, std::to_string(ctx.errors) + " syntax error(s)");
+    if (opt.cache_dir != nullptr) {
+      auto timer = Stats::time(stats, "cache");
+      ASTCache(opt.cache_dir).store(ctx.text(), FlatAST::build(*root));
+    }
+  }
+
+  Arena flatArena;
+  if (opt.flat && root != nullptr) {
+    auto timer = Stats::time(stats, "flat");
+    flat = FlatAST::build(*root);
+    root = nullptr;
+  }
+  if (root == nullptr && needTree) {
+    auto timer = Stats::time(stats, opt.flat ? "flat" : "cache");
+    root = flat.toTree(opt.flat ? flatArena : ctx.arena);
+  }
+  if (opt.fold || wantIR(opt)) {
+    auto timer = Stats::time(stats, "fold");
+    ConstFolder folder(ctx.arena, ctx.filename);
+    folder.visit(*root);
+    if (folder.errors > 0)
+      return finish(false, std::to_string(folder.errors) + " semantic error(s)");
+    if (stats != nullptr)
+      stats->foldedNodes += folder.removed;
+    else if (opt.fold)
+      std::cerr << ctx.filename << ": constant folding removed "
+                << folder.removed << " nodes" << std::endl;
+  }
+  if (opt.sema || wantIR(opt)) {
+    auto timer = Stats::time(stats, "sema");
+    Sema sema(ctx.arena, ctx.filename);
+    sema.visit(*root);
+    if (sema.errors > 0)
+      return finish(false, std::to_string(sema.errors) + " semantic error(s)");
+  }
+  if (stats != nullptr) {
+    stats->addArena(ctx.arena);
+    stats->addArena(flatArena);
+    if (root != nullptr)
+      stats->countNodes(*root);
+    else
+      stats->countNodes(flat);
+  }
+
+  if (opt.print_ast) {
+    auto timer = Stats::time(stats, "print");
+    std::string error =
+        writeFile(opt.out_dir + "/" + outName + ".ast.txt", [&](OutBuffer &out) {
+          if (root == nullptr && pool != nullptr) {
+            printASTParallel(flat, *pool, out);
+          } else if (root == nullptr) {
+            FlatPrinter printer(flat, out);
+            printer.compUnit();
+          } else if (pool != nullptr) {
+            printASTParallel(*root, *pool, out);
+          } else {
+            Printer printer(out);
+            printer.visit(*root);
+          }
+          out.put('\n');
+        });
+    if (!error.empty()) return finish(false, error);
+  }
+
+  if (wantIR(opt)) {
+    Module module;
+    std::vector<std::string> errors;
+    {
+      auto timer = Stats::time(stats, "lower");
+      module = lowerProgram(*root, errors);
+    }
+    if (!errors.empty()) {
+      for (auto &error : errors)
+        std::cerr << ctx.filename << ": " << error << std::endl;
+      return finish(false, std::to_string(errors.size()) + " semantic error(s)");
+    }
+    {
+      auto timer = Stats::time(stats, "verify");
+      verifyModule(module, errors);
+    }
+    if (!errors.empty()) {
+      for (auto &error : errors)
+        std::cerr << ctx.filename << ": " << error << std::endl;
+      return finish(false, std::to_string(errors.size()) + " IR error(s)");
+    }
+    // 只输出汇编时，命中缓存的函数连优化也跳过
+    std::unique_ptr<FuncCache> funcCache;
+    if (opt.func_cache_dir != nullptr && (opt.emit_asm || opt.jit)) {
+      auto timer = Stats::time(stats, "cache");
+      funcCache = std::make_unique<FuncCache>(
+          opt.func_cache_dir, opt.optimize ? &opt.passes : nullptr);
+      funcCache->lookup(*root, module,
+                        opt.optimize && !opt.ir && !opt.bc && !opt.run);
+      if (stats != nullptr) {
+        stats->funcCacheHits += funcCache->hits;
+        stats->funcCacheMisses += funcCache->misses;
+      }
+    }
+    std::vector<std::string> *texts = funcCache ? &funcCache->texts : nullptr;
+    if (opt.optimize) {
+      bool ok;
+      {
+        auto timer = Stats::time(stats, "opt");
+        PassHook hook;
+        if (funcCache)
+          hook = [&](const char *name, const Module &m) {
+            funcCache->afterPass(name, m);
+          };
+        ok = opt.passes.run(module, stats, errors, pool, hook);
+      }
+      if (!ok) {
+        for (auto &error : errors)
+          std::cerr << ctx.filename << ": " << error << std::endl;
+        return finish(false, "optimization produced invalid IR");
+      }
+    }
+    std::string error;
+    if (opt.ir) {
+      auto timer = Stats::time(stats, "print");
+      error = writeFile(opt.out_dir + "/" + outName + ".ir.txt",
+                        [&](OutBuffer &out) { dumpModule(module, out); });
+      if (!error.empty()) return finish(false, error);
+    }
+    if (opt.emit_asm) {
+      auto timer = Stats::time(stats, "codegen");
+      error = writeFile(opt.out_dir + "/" + outName + ".s", [&](OutBuffer &out) {
+        emitX86(module, out, pool, texts);
+      });
+      if (!error.empty()) return finish(false, error);
+    }
+    if (funcCache && !opt.jit) {
+      auto timer = Stats::time(stats, "cache");
+      funcCache->store();
+    }
+    if (opt.jit) {
+      JIT jit;
+      {
+        auto timer = Stats::time(stats, "jit");
+        if (!jit.load(module, error, pool, texts)) return finish(false, error);
+      }
+      if (funcCache) {
+        auto timer = Stats::time(stats, "cache");
+        funcCache->store();
+      }
+      if (stats != nullptr) {
+        stats->jitCodeBytes += jit.codeBytes;
+        stats->jitFirstInsnMs = processMs();
+      }
+      auto timer = Stats::time(stats, "run");
+      jit.run(result.exitCode);
+    }
+    if (!opt.bc && !opt.run) return finish(true, "");
+
+    BcProgram program;
+    {
+      auto timer = Stats::time(stats, "bytecode");
+      if (!compileBytecode(module, program, error))
+        return finish(false, error);
+    }
+    if (opt.bc) {
+      auto timer = Stats::time(stats, "print");
+      error = writeFile(opt.out_dir + "/" + outName + ".bc.txt",
+                        [&](OutBuffer &out) { dumpBytecode(program, out); });
+      if (!error.empty()) return finish(false, error);
+    }
+    if (opt.run) {
+      auto timer = Stats::time(stats, "run");
+      VM vm(program);
+      if (!vm.run(result.exitCode, error)) return finish(false, error);
+      if (stats != nullptr) stats->vmInstructions += vm.executed;
+    }
+  }
+  return finish(true, "");
+}
+
+// 目录则递归收集其中的 .sy/.c 文件，否则按行读取文件列表（# 开头为注释）
+static bool collectFiles(const char *arg, std::vector<std::string> &files) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  if (fs::is_directory(arg, ec)) {
+    for (auto it = fs::recursive_directory_iterator(arg, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+      if (!it->is_regular_file(ec)) continue;
+      std::string ext = it->path().extension().string();
+      if (ext == ".sy" || ext == ".c") files.push_back(it->path().string());
+    }
+    std::sort(files.begin(), files.end());
+    return !ec;
+  }
+  std::ifstream list(arg);
+  if (!list) return false;
+  std::string line;
+  while (std::getline(list, line)) {
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') continue;
+    size_t end = line.find_last_not_of(" \t\r");
+    files.push_back(line.substr(begin, end - begin + 1));
+  }
+  return true;
+}
+
+// 输出文件名：默认用文件名，文件名重复时改用去掉开头 "./"、"../" 并把 '/'
+// 换成 '_' 的路径
+static std::vector<std::string> outputNames(
+    const std::vector<std::string> &files) {
+  std::unordered_map<std::string, int> count;
+  for (auto &file : files) count[baseName(file)]++;
+  std::vector<std::string> names;
+  for (auto &file : files) {
+    std::string name = baseName(file);
+    if (count[name] > 1) {
+      name = file;
+      name.erase(0, name.find_first_not_of("./"));
+      std::replace(name.begin(), name.end(), '/', '_');
+    }
+    names.push_back(name);
+  }
+  return names;
+}
+
+static bool wantStats(const Options &opt) {
+  return opt.time_report || opt.stats || opt.stats_json != nullptr;
+}
+
+static void reportStats(const Options &opt, const Stats &stats) {
+  if (opt.time_report || opt.stats) stats.print(std::cerr, opt.stats);
+  if (opt.stats_json == nullptr) return;
+  if (strcmp(opt.stats_json, "-") == 0) {
+    stats.printJSON(std::cout);
+    return;
+  }
+  std::ofstream json(opt.stats_json);
+  stats.printJSON(json);
+  if (!json) std::cout << "write " << opt.stats_json << " failed" << std::endl;
+}
+
+static int runBatch(const Options &opt, const char *input, unsigned threads) {
+  std::vector<std::string> files;
+  if (!collectFiles(input, files)) {
+    std::cout << "read " << input << " failed" << std::endl;
     return -1;
   }
-  std::string filename_out = strcpy(filename, strrchr(filename, '/') + 1);
+  std::vector<std::string> names = outputNames(files);
+  std::vector<Result> results(files.size());
+
+  auto start = std::chrono::steady_clock::now();
+  std::mutex log;
+  std::atomic<size_t> failed{0};
+  Stats total_stats;
+  {
+    ThreadPool pool(threads);
+    threads = pool.size();
+    for (size_t i = 0; i < files.size(); i++) {
+      pool.submit([&, i] {
+        Stats stats;
+        results[i] = compileFile(opt, files[i], names[i],
+                                 wantStats(opt) ? &stats : nullptr);
+        std::lock_guard<std::mutex> lock(log);
+        total_stats.merge(stats);
+        if (results[i].ok) return;
+        failed++;
+        std::cout << "FAIL " << files[i] << ": " << results[i].error
+                  << std::endl;
+      });
+    }
+    pool.wait();
+  }
+  std::chrono::duration<double, std::milli> wall =
+      std::chrono::steady_clock::now() - start;
+
+  double total = 0, slowest = 0;
+  size_t slowest_index = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    total += results[i].ms;
+    if (results[i].ms > slowest) {
+      slowest = results[i].ms;
+      slowest_index = i;
+    }
+  }
+  std::cout << "batch: " << files.size() << " files, "
+            << files.size() - failed << " ok, " << failed << " failed, "
+            << threads << " threads\n"
+            << "time: " << wall.count() << " ms wall, " << total
+            << " ms summed";
+  if (!files.empty())
+    std::cout << ", " << total / files.size() << " ms avg, slowest "
+              << files[slowest_index] << " (" << slowest << " ms)";
+  std::cout << std::endl;
+  if (wantStats(opt)) reportStats(opt, total_stats);
+  return failed == 0 ? 0 : 1;
+}
 
-  initFileName(filename);
+int main(int argc, char **argv) {
+  char *filename = nullptr;
+  const char *batch = nullptr;
+  unsigned threads = 0;
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-ast") == 0)
+      opt.print_ast = true;
+    else if (strcmp(argv[i], "-lex") == 0)
+      opt.lex_only = true;
+    else if (strcmp(argv[i], "-tokens") == 0)
+      opt.lex_only = opt.dump_tokens = true;
+    else if (strcmp(argv[i], "-fast-lex") == 0)
+      opt.fast_lexer = true;
+    else if (strcmp(argv[i], "-no-mmap") == 0)
+      opt.use_mmap = false;
+    else if (strcmp(argv[i], "-rd") == 0)
+      opt.rd_parser = true;
+    else if (strcmp(argv[i], "-flat") == 0)
+      opt.flat = true;
+    else if (strcmp(argv[i], "-fold") == 0)
+      opt.fold = true;
+    else if (strcmp(argv[i], "-sema") == 0)
+      opt.sema = true;
+    else if (strcmp(argv[i], "-ir") == 0)
+      opt.ir = true;
+    else if (strcmp(argv[i], "-bc") == 0)
+      opt.bc = true;
+    else if (strcmp(argv[i], "-run") == 0)
+      opt.run = true;
+    else if (strcmp(argv[i], "-S") == 0)
+      opt.emit_asm = true;
+    else if (strcmp(argv[i], "-jit") == 0)
+      opt.jit = true;
+    else if (strcmp(argv[i], "-O") == 0)
+      opt.optimize = true;
+    else if (strncmp(argv[i], "-passes=", 8) == 0) {
+      std::string error;
+      if (!opt.passes.setPipeline(argv[i] + 8, error)) {
+        std::cout << error << std::endl;
+        return -1;
+      }
+      opt.optimize = true;
+    } else if (strncmp(argv[i], "-no-", 4) == 0 &&
+               opt.passes.disable(argv[i] + 4))
+      continue;
+    else if (strcmp(argv[i], "-verify-each") == 0)
+      opt.passes.verifyEach = true;
+    else if (strcmp(argv[i], "-ast-cache") == 0 && i + 1 < argc)
+      opt.cache_dir = argv[++i];
+    else if (strcmp(argv[i], "-func-cache") == 0 && i + 1 < argc)
+      opt.func_cache_dir = argv[++i];
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      opt.out_dir = argv[++i];
+    else if (strcmp(argv[i], "-batch") == 0 && i + 1 < argc)
+      batch = argv[++i];
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--time-report") == 0)
+      opt.time_report = true;
+    else if (strcmp(argv[i], "--stats") == 0)
+      opt.stats = true;
+    else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc)
+      opt.stats_json = argv[++i];
+    else
+      filename = argv[i];
+  }
+  // 被执行的程序共用标准输入输出，-run/-jit 只能用于单个文件
+  if ((filename == nullptr) == (batch == nullptr) ||
+      (batch != nullptr && (opt.run || opt.jit))) {
+    usage(argv[0]);
+    return -1;
+  }
+  // 缓存键是源文件内容的哈希，需要整个文件在内存中
+  if (opt.cache_dir != nullptr) opt.use_mmap = true;
+  if (wantStats(opt)) enableAllocCounting();
 
-  yyparse();
+  if (batch != nullptr) {
+    std::error_code ec;
+    std::filesystem::create_directories(opt.out_dir, ec);
+    return runBatch(opt, batch, threads);
+  }
 
-  if (print_ast) {
-    std::ofstream outfile;
-    outfile.open("./example/" + filename_out + ".ast.txt", std::ios::out |
-    std::ios::trunc);
-    Printer printer;
-    outfile << printer.visit(*root) << std::endl;
+  // 单个文件默认串行；-j 大于 1 时 AST 输出、各函数的优化和代码生成分给线程池
+  std::unique_ptr<ThreadPool> pool;
+  if (threads > 1) pool = std::make_unique<ThreadPool>(threads);
+  Stats stats;
+  Result result = compileFile(opt, filename, baseName(filename),
+                              wantStats(opt) ? &stats : nullptr, pool.get());
+  if (!result.ok) {
+    std::cout << result.error << std::endl;
+    return -1;
   }
-  return 0;
+  if (wantStats(opt)) reportStats(opt, stats);
+  return result.exitCode;
 }
@@ -0,0 +1,167 @@
+#include <algorithm>
+
+#include "cfg.h"
+#include "pass.h"
+
+namespace {
+
+const uint32_t NONE = CFG::NONE;
+
+}  // namespace
+
+bool mem2reg(Module &module, Function &func) {
+  CFG cfg(func);
+  DomTree dom(cfg);
+
+  // var[i]：ALLOCA i 提升后的变量编号；只有 1 个字、地址只用于 LOAD/STORE 的才能提升
+  std::vector<uint32_t> var(func.insts.size(), NONE);
+  std::vector<uint32_t> allocas;
+  for (uint32_t b : cfg.rpo) {
+    for (uint32_t index : func.blocks[b].insts) {
+      const Inst &inst = func.insts[index];
+      if (inst.op == OP_ALLOCA && inst.a == 1) {
+        var[index] = allocas.size();
+        allocas.push_back(index);
+      }
+    }
+  }
+  if (allocas.empty()) return false;
+
+  std::vector<bool> promotable(allocas.size(), true);
+  std::vector<IRType> type(allocas.size(), IR_VOID);
+  std::vector<std::vector<uint32_t>> defBlocks(allocas.size());
+  for (uint32_t b = 0; b < func.blocks.size(); b++) {
+    for (uint32_t index : func.blocks[b].insts) {
+      const Inst &inst = func.insts[index];
+      auto varOf = [&](Value v) {
+        return kindOf(v) == VK_INST ? var[indexOf(v)] : NONE;
+      };
+      if (inst.op == OP_LOAD && varOf(inst.a) != NONE) {
+        type[varOf(inst.a)] = inst.type;
+        continue;
+      }
+      if (inst.op == OP_STORE && varOf(inst.a) != NONE &&
+          varOf(inst.b) == NONE) {
+        type[varOf(inst.a)] = func.typeOf(inst.b);
+        auto &defs = defBlocks[varOf(inst.a)];
+        if (defs.empty() || defs.back() != b) defs.push_back(b);
+        continue;
+      }
+      forEachOperand(func, inst, [&](Value v) {
+        if (varOf(v) != NONE) promotable[varOf(v)] = false;
+      });
+    }
+  }
+
+  if (std::find(promotable.begin(), promotable.end(), true) == promotable.end())
+    return false;
+
+  // 在迭代支配边界上放 PHI
+  std::vector<std::vector<uint32_t>> df = dom.frontiers(cfg);
+  std::vector<uint32_t> phiVar(func.insts.size(), NONE);
+  std::vector<uint32_t> hasPhi(func.blocks.size(), NONE);
+  for (uint32_t v = 0; v < allocas.size(); v++) {
+    if (!promotable[v] || type[v] == IR_VOID) continue;
+    std::vector<uint32_t> work;
+    for (uint32_t b : defBlocks[v])
+      if (cfg.reachable(b)) work.push_back(b);
+    while (!work.empty()) {
+      uint32_t b = work.back();
+      work.pop_back();
+      for (uint32_t f : df[b]) {
+        if (hasPhi[f] == v) continue;
+        hasPhi[f] = v;
+        Value phi = insertPhi(func, f, type[v]);
+        std::vector<std::pair<Value, uint32_t>> entries;
+        // 来自不可达前驱的入边不会被重命名填写，先放未定义值
+        Value undef = type[v] == IR_F32 ? func.constFloat(0) : func.constInt(0);
+        for (uint32_t pred : cfg.preds[f]) entries.push_back({undef, pred});
+        setIncoming(func, func.insts[indexOf(phi)], entries);
+        phiVar.resize(func.insts.size(), NONE);
+        phiVar[indexOf(phi)] = v;
+        work.push_back(f);
+      }
+    }
+  }
+
+  // 沿支配树先序重命名：每个变量一个当前值栈，离开子树时弹回
+  std::vector<Value> repl(func.insts.size(), NO_VALUE);
+  std::vector<std::vector<Value>> stack(allocas.size());
+  for (uint32_t v = 0; v < allocas.size(); v++) {
+    Value undef = type[v] == IR_F32 ? func.constFloat(0) : func.constInt(0);
+    stack[v].push_back(undef);
+  }
+  std::vector<uint32_t> pushed;  // 依次压栈的变量
+  auto promoted = [&](Value addr) {
+    if (kindOf(addr) != VK_INST || var[indexOf(addr)] == NONE) return NONE;
+    uint32_t v = var[indexOf(addr)];
+    return promotable[v] ? v : NONE;
+  };
+  auto rename = [&](uint32_t b) {
+    for (uint32_t index : func.blocks[b].insts) {
+      Inst &inst = func.insts[index];
+      if (inst.op == OP_PHI && phiVar.size() > index && phiVar[index] != NONE) {
+        stack[phiVar[index]].push_back(makeValue(VK_INST, index));
+        pushed.push_back(phiVar[index]);
+      } else if (inst.op == OP_LOAD && promoted(inst.a) != NONE) {
+        repl[index] = stack[promoted(inst.a)].back();
+        inst.op = OP_NOP;
+      } else if (inst.op == OP_STORE && promoted(inst.a) != NONE) {
+        stack[promoted(inst.a)].push_back(inst.b);
+        pushed.push_back(promoted(inst.a));
+        inst.op = OP_NOP;
+      } else if (inst.op == OP_ALLOCA && promoted(makeValue(VK_INST, index)) !=
+                                             NONE) {
+        inst.op = OP_NOP;
+      }
+    }
+    for (uint32_t succ : cfg.succs[b]) {
+      for (uint32_t index : func.blocks[succ].insts) {
+        Inst &phi = func.insts[index];
+        if (phi.op != OP_PHI) break;
+        if (phiVar.size() <= index || phiVar[index] == NONE) continue;
+        for (uint32_t i = 0; i < phi.c; i++)
+          if (func.lists[phi.b + 2 * i + 1] == b)
+            func.lists[phi.b + 2 * i] = stack[phiVar[index]].back();
+      }
+    }
+  };
+  // (块, 下一个要访问的孩子, 进入块前 pushed 的长度)
+  struct Frame {
+    uint32_t block, child;
+    size_t mark;
+  };
+  std::vector<Frame> frames;
+  frames.push_back({0, 0, pushed.size()});
+  rename(0);
+  while (!frames.empty()) {
+    Frame &top = frames.back();
+    if (top.child < dom.children[top.block].size()) {
+      uint32_t child = dom.children[top.block][top.child++];
+      frames.push_back({child, 0, pushed.size()});
+      rename(child);
+      continue;
+    }
+    while (pushed.size() > top.mark) {
+      stack[pushed.back()].pop_back();
+      pushed.pop_back();
+    }
+    frames.pop_back();
+  }
+
+  // 不可达块中对已提升变量的访问：读到的是未定义值
+  for (uint32_t b = 0; b < func.blocks.size(); b++) {
+    if (cfg.reachable(b)) continue;
+    for (uint32_t index : func.blocks[b].insts) {
+      Inst &inst = func.insts[index];
+      uint32_t v = inst.op == OP_LOAD || inst.op == OP_STORE ? promoted(inst.a)
+                                                             : NONE;
+      if (v == NONE) continue;
+      if (inst.op == OP_LOAD) repl[index] = stack[v][0];
+      inst.op = OP_NOP;
+    }
+  }
+  substitute(func, repl);
+  removeNops(func);
+  return true;
+}
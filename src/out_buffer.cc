@@ -0,0 +1,76 @@
+#include "out_buffer.h"
+
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+static const int SPACES_LEN = 256;
+static const char SPACES[SPACES_LEN + 1] =
+    "                                                                "
+    "                                                                "
+    "                                                                "
+    "                                                                ";
+
+OutBuffer::OutBuffer(int fd, size_t capacity) : fd(fd), capacity(capacity) {
+  buf.reserve(fd >= 0 ? capacity + SPACES_LEN : 4096);
+}
+
+OutBuffer::~OutBuffer() { flush(); }
+
+void OutBuffer::indent(int n) {
+  while (n > SPACES_LEN) {
+    write(SPACES, SPACES_LEN);
+    n -= SPACES_LEN;
+  }
+  if (n > 0) write(SPACES, n);
+}
+
+void OutBuffer::writev(const std::vector<std::string> &pieces) {
+  if (fd < 0) {
+    for (auto &piece : pieces) buf.append(piece);
+    return;
+  }
+  std::vector<iovec> iov;
+  iov.reserve(pieces.size() + 1);
+  if (!buf.empty()) iov.push_back({buf.data(), buf.size()});
+  for (auto &piece : pieces)
+    if (!piece.empty())
+      iov.push_back({const_cast<char *>(piece.data()), piece.size()});
+  // 每次最多 IOV_MAX 段；写了一部分时跳过已写完的段并调整当前段
+  size_t i = 0;
+  while (i < iov.size() && !error) {
+    int count = std::min<size_t>(iov.size() - i, IOV_MAX);
+    ssize_t n = ::writev(fd, &iov[i], count);
+    if (n < 0) {
+      if (errno != EINTR) error = true;
+      continue;
+    }
+    while (i < iov.size() && static_cast<size_t>(n) >= iov[i].iov_len)
+      n -= iov[i++].iov_len;
+    if (n > 0) {
+      iov[i].iov_base = static_cast<char *>(iov[i].iov_base) + n;
+      iov[i].iov_len -= n;
+    }
+  }
+  buf.clear();
+}
+
+void OutBuffer::flush() {
+  if (fd < 0) return;
+  const char *p = buf.data();
+  size_t left = buf.size();
+  while (left > 0) {
+    ssize_t n = ::write(fd, p, left);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      error = true;
+      break;
+    }
+    p += n;
+    left -= n;
+  }
+  buf.clear();
+}
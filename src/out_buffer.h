@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 输出缓冲区：绑定 fd 时写满 capacity 就刷到 fd，内存占用与输出大小无关；
+// fd 为 -1 时内容全部留在内存中，可通过 str() 取出
+class OutBuffer {
+ public:
+  explicit OutBuffer(int fd = -1, size_t capacity = 1 << 20);
+  ~OutBuffer();
+  OutBuffer(const OutBuffer &) = delete;
+  OutBuffer &operator=(const OutBuffer &) = delete;
+
+  void write(const char *s, size_t n) {
+    buf.append(s, n);
+    if (fd >= 0 && buf.size() >= capacity) flush();
+  }
+  void write(std::string_view s) { write(s.data(), s.size()); }
+  void put(char c) {
+    buf.push_back(c);
+    if (fd >= 0 && buf.size() >= capacity) flush();
+  }
+  // 输出 n 个空格，取自预先填好的空格表
+  void indent(int n);
+  // 依次输出各段：绑定 fd 时连同缓冲区中已有的内容用 writev 一起写出，
+  // 各段不再复制进缓冲区
+  void writev(const std::vector<std::string> &pieces);
+  void flush();
+
+  std::string &str() { return buf; }
+  // 写 fd 时出错则置位
+  bool failed() const { return error; }
+
+ private:
+  int fd;
+  size_t capacity;
+  std::string buf;
+  bool error = false;
+};
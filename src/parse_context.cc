@@ -0,0 +1,135 @@
+#include "parse_context.h"
+
+#include <chrono>
+
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+
+#include "lexer.h"
+#include "parser.tab.hpp"
+#include "rd_parser.h"
+
+// flex 生成的可重入扫描器接口
+extern int yylex_init_extra(ParseContext *ctx, yyscan_t *scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern ParseContext *yyget_extra(yyscan_t scanner);
+extern int flexLex(YYSTYPE *lval, YYLTYPE *lloc, yyscan_t scanner);
+extern bool scanBuffer(char *base, size_t size, yyscan_t scanner);
+extern void scanFile(FILE *in, yyscan_t scanner);
+
+// rdtsc 比 steady_clock 便宜一半以上；只用来算 scan 占 parse() 的比例，
+// 不必换算成时间
+static uint64_t ticks() {
+#ifdef __x86_64__
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+static int nextToken(ParseContext *ctx, YYSTYPE *lval, YYLTYPE *lloc,
+                     yyscan_t scanner) {
+  if (ctx->lexer) return ctx->lexer->next(*lval, *lloc);
+  return flexLex(lval, lloc, scanner);
+}
+
+int yylex(YYSTYPE *lval, YYLTYPE *lloc, yyscan_t scanner) {
+  ParseContext *ctx = yyget_extra(scanner);
+  if (!ctx->timeScan || --ctx->untilSample != 0)
+    return nextToken(ctx, lval, lloc, scanner);
+  // 每个 token 都读两次时钟的开销与快速 Lexer 扫描本身相当，所以只抽样：
+  // 间隔在 1..31 之间随机（平均 16），不会和生成代码的重复模式对齐
+  ctx->sampleSeed = ctx->sampleSeed * 6364136223846793005u + 1442695040888963407u;
+  ctx->untilSample = 1 + (ctx->sampleSeed >> 33) % 31;
+  uint64_t start = ticks();
+  int code = nextToken(ctx, lval, lloc, scanner);
+  ctx->scanTicks += (ticks() - start) * 16;
+  return code;
+}
+
+// 与 parser.y 中 %token 的声明顺序一致，下标是 token 编码减去 INT
+const char *const kTokenNames[] = {
+    "INT",      "FLOAT",    "ID",     "GTE",       "LTE",    "GT",
+    "LT",       "EQ",       "NEQ",    "INTTYPE",   "FLOATTYPE", "VOID",
+    "CONST",    "RETURN",   "IF",     "ELSE",      "WHILE",  "BREAK",
+    "CONTINUE", "LP",       "RP",     "LB",        "RB",     "LC",
+    "RC",       "COMMA",    "SEMICOLON", "NOT",    "POS",    "NEG",
+    "ASSIGN",   "MINUS",    "ADD",    "MUL",       "DIV",    "MOD",
+    "AND",      "OR"};
+static_assert(sizeof(kTokenNames) / sizeof(kTokenNames[0]) == OR - INT + 1,
+              "token table out of date");
+
+const char *tokenName(int code) {
+  if (code == 0) return "end of file";
+  if (code < INT || code > OR) return "invalid token";
+  return kTokenNames[code - INT];
+}
+
+ParseContext::ParseContext(std::string filename)
+    : filename(std::move(filename)) {
+  yylex_init_extra(this, &scanner);
+}
+
+ParseContext::~ParseContext() {
+  yylex_destroy(scanner);
+  if (file != nullptr) fclose(file);
+}
+
+bool ParseContext::open(const char *path, bool useMmap, bool fastLexer) {
+  if (fastLexer) {
+    if (!source.open(path, useMmap)) return false;
+    bytes = source.size();
+    lexer = std::make_unique<Lexer>(source.data(), source.data() + bytes);
+    return true;
+  }
+  if (useMmap) {
+    if (!source.open(path) ||
+        !scanBuffer(source.data(), source.bufferSize(), scanner))
+      return false;
+    bytes = source.size();
+    return true;
+  }
+  file = fopen(path, "r");
+  if (file == nullptr) return false;
+  fseek(file, 0, SEEK_END);
+  bytes = ftell(file);
+  rewind(file);
+  scanFile(file, scanner);
+  return true;
+}
+
+CompUnitAST *ParseContext::parse(bool handWritten) {
+  uint64_t start = timeScan ? ticks() : 0;
+  CompUnitAST *root = nullptr;
+  if (handWritten)
+    root = parseRecursiveDescent(*this, scanner);
+  else if (yyparse(scanner, this, &root) != 0)
+    root = nullptr;
+  if (timeScan) parseTicks += ticks() - start;
+  return errors != 0 ? nullptr : root;
+}
+
+size_t ParseContext::lex(OutBuffer *out) {
+  YYSTYPE lval;
+  YYLTYPE lloc;
+  size_t tokens = 0;
+  int code;
+  while ((code = yylex(&lval, &lloc, scanner)) != 0) {
+    tokens++;
+    if (out == nullptr) continue;
+    char buf[64];
+    out->write(buf, snprintf(buf, sizeof(buf), "%d %s", lloc.first_line,
+                             tokenName(code)));
+    if (code == INT) {
+      out->write(buf, snprintf(buf, sizeof(buf), " %d", lval.int_val));
+    } else if (code == FLOAT) {
+      out->write(buf, snprintf(buf, sizeof(buf), " %a", lval.float_val));
+    } else if (code == ID) {
+      out->put(' ');
+      out->write(interner.name(lval.token));
+    }
+    out->put('\n');
+  }
+  return tokens;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "ast.h"
+#include "out_buffer.h"
+#include "source.h"
+
+typedef void *yyscan_t;
+union YYSTYPE;
+struct YYLTYPE;
+class Lexer;
+
+// 语法分析器取 token 的入口：按 ParseContext 的选择转给 flex 或手写的 Lexer
+int yylex(YYSTYPE *lval, YYLTYPE *lloc, yyscan_t scanner);
+// token 编码在 parser.y 中的名字，与 bison 报错时的写法相同
+const char *tokenName(int code);
+
+// 一次解析的全部状态：扫描器、输入缓冲区、Arena 和出错信息。
+// 词法/语法分析器都是可重入的，每个线程各用一个 ParseContext 即可并发解析
+class ParseContext {
+ public:
+  explicit ParseContext(std::string filename);
+  ~ParseContext();
+  ParseContext(const ParseContext &) = delete;
+  ParseContext &operator=(const ParseContext &) = delete;
+
+  // 打开源文件并把扫描器挂到输入上，useMmap 为 false 时走 stdio；
+  // fastLexer 时改用手写的 Lexer（lexer.h），它总在 SourceFile 的缓冲区上扫描
+  bool open(const char *path, bool useMmap = true, bool fastLexer = false);
+  // 解析整个编译单元，语法错误时返回 nullptr；节点归 arena 所有。
+  // handWritten 时用递归下降分析器（rd_parser.h）代替 yyparse()
+  CompUnitAST *parse(bool handWritten = false);
+  // 只做词法分析，返回 token 数；out 不为空时每行写出一个 token：
+  // 行号、名字，以及 INT/FLOAT/ID 的值（浮点数用 %a 写出全部位）
+  size_t lex(OutBuffer *out = nullptr);
+  // timeScan 时 parse() 中取 token 所占的时间比例，在 [0, 1] 之内
+  double scanFraction() const {
+    if (parseTicks == 0 || scanTicks >= parseTicks) return parseTicks ? 1 : 0;
+    return double(scanTicks) / parseTicks;
+  }
+  // 源文件内容，仅 mmap/read 方式打开时可用
+  std::string_view text() const {
+    return std::string_view(source.data(), source.size());
+  }
+
+  std::string filename;
+  Arena arena;
+  size_t bytes = 0;  // 输入字节数
+  int column = 1;    // 扫描器维护的当前列号
+  int errors = 0;
+  // 语法分析边解析边取 token，扫描时间无法单独计时：为 true 时 yylex
+  // 抽样累计取 token 的时钟周期，parse() 累计总周期，见 scanFraction()
+  bool timeScan = false;
+  std::unique_ptr<Lexer> lexer;  // 非空时代替 flex
+
+ private:
+  yyscan_t scanner = nullptr;
+  SourceFile source;
+  FILE *file = nullptr;
+  uint64_t scanTicks = 0;   // 按抽样间隔放大后的估计值
+  uint64_t parseTicks = 0;
+  uint32_t untilSample = 1;  // 再取几个 token 计一次时
+  uint64_t sampleSeed = 0;
+
+  friend int yylex(YYSTYPE *lval, YYLTYPE *lloc, yyscan_t scanner);
+};
@@ -1,19 +1,23 @@
 %define parse.error verbose
+%define api.pure full
 %locations
+%param {yyscan_t scanner}
+%parse-param {ParseContext *ctx} {CompUnitAST **root}
+
+%code requires {
+    #include "ast.h"
+    typedef void *yyscan_t;
+    class ParseContext;
+}
+
 %{
     #include "ast.h"
+    #include "parse_context.h"
     #include "utils.h"
     #include <memory>
     #include <cstring>
     #include <stdarg.h>
     using namespace std;
-    unique_ptr<CompUnitAST> root; /* the top level root node of our final AST */
-
-    extern int yylineno;
-    extern int yylex();
-    extern void yyerror(const char *s);
-    extern void initFileName(char *name);
-    char filename[100];
 %}
 
 %union {
@@ -35,22 +39,15 @@
     ReturnStmtAST* returnStmt;
     SelectStmtAST* selectStmt;
     IterationStmtAST* iterationStmt;
+    ExpAST* exp;
     LValAST* lVal;
-    PrimaryExpAST* primaryExp;
     NumberAST* number;
-    UnaryExpAST* unaryExp;
     CallAST* call;
     FuncCParamListAST* funcCParamList;
-    MulExpAST* mulExp;
-    AddExpAST* addExp;
-    RelExpAST* relExp;
-    EqExpAST* eqExp;
-    LAndExpAST* lAndExp;
-    LOrExpAST* lOrExp;
 
     TYPE ty;
     UOP op;
-	std::string *token;
+	Symbol token;
 	int int_val;
 	float float_val;
 };
@@ -75,17 +72,10 @@
 %type <selectStmt> SelectStmt;
 %type <iterationStmt> IterationStmt;
 %type <lVal> LVal;
-%type <primaryExp> PrimaryExp;
 %type <number> Number;
-%type <unaryExp> UnaryExp;
 %type <call> Call;
 %type <funcCParamList> FuncCParamList;
-%type <mulExp> MulExp;
-%type <addExp> Exp AddExp;
-%type <relExp> RelExp;
-%type <eqExp> EqExp;
-%type <lAndExp> LAndExp;
-%type <lOrExp> Cond LOrExp;
+%type <exp> Exp Cond PrimaryExp UnaryExp MulExp AddExp RelExp EqExp LAndExp LOrExp;
 
 %type <ty> BType VoidType
 %type <op> UnaryOp
@@ -114,10 +104,16 @@
 
 %start Program
 
+%code {
+    extern int yylex(YYSTYPE *lval, YYLTYPE *lloc, yyscan_t scanner);
+    void yyerror(YYLTYPE *loc, yyscan_t scanner, ParseContext *ctx,
+                 CompUnitAST **root, const char *msg);
+}
+
 %%
 Program
 	: CompUnit {
-    root = unique_ptr<CompUnitAST>($1);
+    *root = $1;
 	}
 	;
 
@@ -125,36 +121,36 @@ Program
 CompUnit
 	:CompUnit DeclDef {
 		$$ = $1;
-	  $$->declDefList.push_back(unique_ptr<DeclDefAST>($2));
+	  $$->declDefList.push_back($2);
 	}
 	| DeclDef {
-    $$ = new CompUnitAST();
-    $$->declDefList.push_back(unique_ptr<DeclDefAST>($1));
+    $$ = ctx->arena.make<CompUnitAST>();
+    $$->declDefList.push_back($1);
 	}
 	;
 
 //声明或者函数定义
 DeclDef
 	: Decl {
-		$$ = new DeclDefAST();
-		$$->Decl = unique_ptr<DeclAST>($1);
+		$$ = ctx->arena.make<DeclDefAST>();
+		$$->Decl = $1;
 	}
 	|FuncDef {
-    $$ =  new DeclDefAST();
-		$$->funcDef = unique_ptr<FuncDefAST>($1);
+    $$ =  ctx->arena.make<DeclDefAST>();
+		$$->funcDef = $1;
 	}
   ;
 
 // 变量或常量声明
 Decl
 	:	CONST BType DefList SEMICOLON {
-    $$ = new DeclAST();
+    $$ = ctx->arena.make<DeclAST>();
     $$->isConst = true;
 		$$->bType = $2;
 		$$->defList.swap($3->list);
 	}
   | BType DefList SEMICOLON {
-    $$ = new DeclAST();
+    $$ = ctx->arena.make<DeclAST>();
     $$->isConst = false;
 		$$->bType = $1;
 		$$->defList.swap($2->list);
@@ -174,62 +170,62 @@ BType
 // 定义列表
 DefList
 	:Def {
-		$$ = new DefListAST();
-    $$->list.push_back(unique_ptr<DefAST>($1));
+		$$ = ctx->arena.make<DefListAST>();
+    $$->list.push_back($1);
 	}				
 	| DefList COMMA Def {
  		$$ = $1;
-    $$->list.push_back(unique_ptr<DefAST>($3));
+    $$->list.push_back($3);
 	}
 	;
 
 // 定义
 Def
 	: ID Arrays ASSIGN InitVal {
-		$$ = new DefAST();
-		$$->id = unique_ptr<string>($1);
+		$$ = ctx->arena.make<DefAST>();
+		$$->id = $1;
 		$$->arrays.swap($2->list);
-		$$->initVal = unique_ptr<InitValAST>($4);
+		$$->initVal = $4;
 	}
   | ID ASSIGN InitVal {
-		$$ = new DefAST();
-		$$->id = unique_ptr<string>($1);
-		$$->initVal = unique_ptr<InitValAST>($3);
+		$$ = ctx->arena.make<DefAST>();
+		$$->id = $1;
+		$$->initVal = $3;
   }
   | ID Arrays {
-    $$ = new DefAST();
-	  $$->id = unique_ptr<string>($1);
+    $$ = ctx->arena.make<DefAST>();
+	  $$->id = $1;
 	  $$->arrays.swap($2->list);
   }
   | ID {
-    $$ = new DefAST();
-    $$->id = unique_ptr<string>($1);
+    $$ = ctx->arena.make<DefAST>();
+    $$->id = $1;
   }
 	;
 
 // 数组
 Arrays
 	: LB Exp RB {
-		$$ = new ArraysAST();
-		$$->list.push_back(unique_ptr<AddExpAST>($2));
+		$$ = ctx->arena.make<ArraysAST>();
+		$$->list.push_back($2);
 	}
   |Arrays LB Exp RB {
 		$$ = $1;
-		$$->list.push_back(unique_ptr<AddExpAST>($3));
+		$$->list.push_back($3);
 	}
 	;
 
 // 变量或常量初值
 InitVal
 	: Exp {
-		$$ = new InitValAST();
-		$$->exp = unique_ptr<AddExpAST>($1);
+		$$ = ctx->arena.make<InitValAST>();
+		$$->exp = $1;
 	}		
 	| LC RC	{
-		$$ = new InitValAST();
+		$$ = ctx->arena.make<InitValAST>();
 	}	
 	| LC InitValList RC {
-		$$ = new InitValAST();
+		$$ = ctx->arena.make<InitValAST>();
 		$$->initValList.swap($2->list);
 	}	
 	;
@@ -238,41 +234,41 @@ InitVal
 InitValList
 	: InitValList COMMA InitVal {
 		$$ = $1;
-		$$->list.push_back(unique_ptr<InitValAST>($3));
+		$$->list.push_back($3);
 	}
 	| InitVal {
-		$$  = new InitValListAST();
-		$$->list.push_back(unique_ptr<InitValAST>($1));
+		$$  = ctx->arena.make<InitValListAST>();
+		$$->list.push_back($1);
 	}
 	;
 
 // 函数定义
 FuncDef
 	: BType ID LP FuncFParamList RP Block {
-		$$ = new FuncDefAST();
+		$$ = ctx->arena.make<FuncDefAST>();
 		$$->funcType = $1;
-		$$->id = unique_ptr<string>($2);
+		$$->id = $2;
 		$$->funcFParamList.swap($4->list);
-		$$->block = unique_ptr<BlockAST>($6);
+		$$->block = $6;
 	}
  	| BType ID LP RP Block {
-		$$ = new FuncDefAST();
+		$$ = ctx->arena.make<FuncDefAST>();
 		$$->funcType = $1;
-		$$->id = unique_ptr<string>($2);
-		$$->block = unique_ptr<BlockAST>($5);
+		$$->id = $2;
+		$$->block = $5;
 	}
   |VoidType ID LP FuncFParamList RP Block {
-		$$ = new FuncDefAST();
+		$$ = ctx->arena.make<FuncDefAST>();
 		$$->funcType = $1;
-		$$->id = unique_ptr<string>($2);
+		$$->id = $2;
 		$$->funcFParamList.swap($4->list);
-		$$->block = unique_ptr<BlockAST>($6);
+		$$->block = $6;
 	}
  	| VoidType ID LP RP Block {
-		$$ = new FuncDefAST();
+		$$ = ctx->arena.make<FuncDefAST>();
 		$$->funcType = $1;
-		$$->id = unique_ptr<string>($2);
-		$$->block = unique_ptr<BlockAST>($5);
+		$$->id = $2;
+		$$->block = $5;
 	}
 	;
 
@@ -285,33 +281,33 @@ VoidType
 // 函数形参列表
 FuncFParamList
 	: FuncFParam {
-		$$ = new FuncFParamListAST();
-		$$->list.push_back(unique_ptr<FuncFParamAST>($1));
+		$$ = ctx->arena.make<FuncFParamListAST>();
+		$$->list.push_back($1);
 	}	
 	| FuncFParamList COMMA FuncFParam {
 		$$ = $1;
-		$$->list.push_back(unique_ptr<FuncFParamAST>($3));
+		$$->list.push_back($3);
 	}	
 	;
 
 // 函数形参
 FuncFParam
 	:	BType ID {
-		$$ = new FuncFParamAST();
+		$$ = ctx->arena.make<FuncFParamAST>();
 		$$->bType = $1;
-		$$->id = unique_ptr<string>($2);
+		$$->id = $2;
 		$$->isArray = false;
 	}
 	| BType ID LB RB	{
-		$$ = new FuncFParamAST();
+		$$ = ctx->arena.make<FuncFParamAST>();
 		$$->bType = $1;
-		$$->id = unique_ptr<string>($2);
+		$$->id = $2;
 		$$->isArray = true;
 	}
 	| BType ID LB RB Arrays {
-		$$ = new FuncFParamAST();
+		$$ = ctx->arena.make<FuncFParamAST>();
 		$$->bType = $1;
-		$$->id = unique_ptr<string>($2);
+		$$->id = $2;
 		$$->isArray = true;
 		$$->arrays.swap($5->list);
 	}	
@@ -320,10 +316,10 @@ FuncFParam
 // 语句块
 Block
 	: LC RC {
-		$$ = new BlockAST();
+		$$ = ctx->arena.make<BlockAST>();
 	}
 	| LC BlockItemList RC {
-		$$ = new BlockAST();
+		$$ = ctx->arena.make<BlockAST>();
 		$$->blockItemList.swap($2->list);
 	}	
 	;
@@ -331,24 +327,24 @@ Block
 // 语句块项列表
 BlockItemList
 	: BlockItem	{
-		$$ = new BlockItemListAST();
-		$$->list.push_back(unique_ptr<BlockItemAST>($1));
+		$$ = ctx->arena.make<BlockItemListAST>();
+		$$->list.push_back($1);
 	}
 	| BlockItemList BlockItem {
 		$$ = $1;
-		$$->list.push_back(unique_ptr<BlockItemAST>($2));
+		$$->list.push_back($2);
 	}		
 	;
 
 // 语句块项
 BlockItem
 	: Decl {
-		$$ = new BlockItemAST();
-		$$->decl = unique_ptr<DeclAST>($1);
+		$$ = ctx->arena.make<BlockItemAST>();
+		$$->decl = $1;
 	}
 	| Stmt {
-		$$ = new BlockItemAST();
-		$$->stmt = unique_ptr<StmtAST>($1);
+		$$ = ctx->arena.make<BlockItemAST>();
+		$$->stmt = $1;
 	}	
 	| 
 	;
@@ -356,79 +352,79 @@ BlockItem
 // 语句，根据type判断是何种类型的Stmt
 Stmt 
 	: LVal ASSIGN Exp SEMICOLON {
-		$$ = new StmtAST();
-		$$->lVal = unique_ptr<LValAST>($1);
-		$$->exp = unique_ptr<AddExpAST>($3);
+		$$ = ctx->arena.make<StmtAST>();
+		$$->lVal = $1;
+		$$->exp = $3;
 		$$->sType = STYPE::ASS;
 	}
 	| Exp SEMICOLON {
-		$$ = new StmtAST();
-		$$->exp = unique_ptr<AddExpAST>($1); 
+		$$ = ctx->arena.make<StmtAST>();
+		$$->exp = $1; 
 		$$->sType = STYPE::EXP;
 	}
 	| SEMICOLON {
-		$$ = new StmtAST();
+		$$ = ctx->arena.make<StmtAST>();
 		$$->sType = STYPE::SEMI;
 	}
 	| SelectStmt {
-		$$ = new StmtAST();
-		$$->selectStmt = unique_ptr<SelectStmtAST>($1);
+		$$ = ctx->arena.make<StmtAST>();
+		$$->selectStmt = $1;
 		$$->sType = STYPE::SELECT;
 	}
 	| IterationStmt {
-		$$ = new StmtAST();
-		$$->iterationStmt = unique_ptr<IterationStmtAST>($1);
+		$$ = ctx->arena.make<StmtAST>();
+		$$->iterationStmt = $1;
 		$$->sType = STYPE::ITER;
 	}
 	| BREAK SEMICOLON {
-		$$ = new StmtAST();
+		$$ = ctx->arena.make<StmtAST>();
 		$$->sType = STYPE::BRE;
 	}
 	| CONTINUE SEMICOLON {
-		$$ = new StmtAST();
+		$$ = ctx->arena.make<StmtAST>();
 		$$->sType = STYPE::CONT;
 	} 
 	| ReturnStmt {
-		$$ = new StmtAST();
-		$$->returnStmt = unique_ptr<ReturnStmtAST>($1);
+		$$ = ctx->arena.make<StmtAST>();
+		$$->returnStmt = $1;
 		$$->sType = STYPE::RET; 
 	}
 	| Block {
-		$$ = new StmtAST();
-		$$->block = unique_ptr<BlockAST>($1);
+		$$ = ctx->arena.make<StmtAST>();
+		$$->block = $1;
 		$$->sType = STYPE::BLK;
 	}
 	;
 
 ReturnStmt 
 	: RETURN SEMICOLON {
-		$$ = new ReturnStmtAST();
+		$$ = ctx->arena.make<ReturnStmtAST>();
 	}
 	| RETURN Exp SEMICOLON {
-		$$ = new ReturnStmtAST();
-		$$->exp = unique_ptr<AddExpAST>($2);	
+		$$ = ctx->arena.make<ReturnStmtAST>();
+		$$->exp = $2;	
 	}
 	;
 
 SelectStmt 
 	: IF LP Cond RP Stmt	 %prec LOWER_THEN_ELSE {
-		$$ = new SelectStmtAST();
-		$$->cond = unique_ptr<LOrExpAST>($3);
-		$$->ifStmt = unique_ptr<StmtAST>($5);
+		$$ = ctx->arena.make<SelectStmtAST>();
+		$$->cond = $3;
+		$$->ifStmt = $5;
 	}
 	| IF LP Cond RP Stmt ELSE Stmt {
-		$$ = new SelectStmtAST();
-		$$->cond = unique_ptr<LOrExpAST>($3);
-		$$->ifStmt = unique_ptr<StmtAST>($5);
-		$$->elseStmt = unique_ptr<StmtAST>($7);
+		$$ = ctx->arena.make<SelectStmtAST>();
+		$$->cond = $3;
+		$$->ifStmt = $5;
+		$$->elseStmt = $7;
 	}
 	;
 
 IterationStmt 
 	:	WHILE LP Cond RP Stmt {
-		$$ = new IterationStmtAST();
-		$$->cond = unique_ptr<LOrExpAST>($3);
-		$$->stmt = unique_ptr<StmtAST>($5);
+		$$ = ctx->arena.make<IterationStmtAST>();
+		$$->cond = $3;
+		$$->stmt = $5;
 	}
 	;
 
@@ -450,12 +446,12 @@ Cond
 // 左值表达式
 LVal
 	:	ID {
-		$$ = new LValAST();
-		$$->id = unique_ptr<string>($1);
+		$$ = ctx->arena.make<LValAST>();
+		$$->id = $1;
 	}
 	| ID Arrays {
-		$$ = new LValAST();
-		$$->id = unique_ptr<string>($1);
+		$$ = ctx->arena.make<LValAST>();
+		$$->id = $1;
 		$$->arrays.swap($2->list);
 	}
 	;
@@ -463,28 +459,26 @@ LVal
 // 基本表达式
 PrimaryExp
 	: LP Exp RP {
-		$$ = new PrimaryExpAST();
-		$$->exp = unique_ptr<AddExpAST>($2);		
+		$$ = $2;
+		$$->parens++;
 	}
 	| LVal {
-		$$ = new PrimaryExpAST();
-		$$->lval = unique_ptr<LValAST>($1);		
+		$$ = $1;
 	}	
 	| Number	{
-		$$ = new PrimaryExpAST();
-		$$->number = unique_ptr<NumberAST>($1);		
+		$$ = $1;
 	}		
 	;
 
 // 数值
 Number
 	:	INT {
-		$$ = new NumberAST();
+		$$ = ctx->arena.make<NumberAST>();
 		$$->isInt = true;
 		$$->intval = $1;		
 	}		
   | FLOAT {
-		$$ = new NumberAST();
+		$$ = ctx->arena.make<NumberAST>();
 		$$->isInt = false;
 		$$->floatval = $1;		
 	}		
@@ -493,29 +487,25 @@ Number
 // 一元表达式
 UnaryExp
 	: PrimaryExp	{
-		$$ = new UnaryExpAST();
-		$$->primaryExp = unique_ptr<PrimaryExpAST>($1);				
+		$$ = $1;
 	}					
 	| Call {
-		$$ = new UnaryExpAST();
-		$$->call = unique_ptr<CallAST>($1);				
+		$$ = $1;
 	}
 	| UnaryOp UnaryExp {
-		$$ = new UnaryExpAST();
-		$$->op = $1;
-		$$->unaryExp = unique_ptr<UnaryExpAST>($2);
+		$$ = ctx->arena.make<UnaryExpAST>($1, $2);
 	}		
 	;
 
 //函数调用
 Call
 	: ID LP RP {
-		$$ = new CallAST();
-		$$->id = unique_ptr<string>($1);
+		$$ = ctx->arena.make<CallAST>();
+		$$->id = $1;
 	}
 	| ID LP FuncCParamList RP {
-		$$ = new CallAST();
-		$$->id = unique_ptr<string>($1);
+		$$ = ctx->arena.make<CallAST>();
+		$$->id = $1;
 		$$->funcCParamList.swap($3->list);
 	}
 	;	
@@ -536,146 +526,100 @@ UnaryOp
 // 函数实参表
 FuncCParamList
 	: Exp {
-		$$ = new FuncCParamListAST();
-		$$->list.push_back(unique_ptr<AddExpAST>($1));
+		$$ = ctx->arena.make<FuncCParamListAST>();
+		$$->list.push_back($1);
 	}
 	| FuncCParamList COMMA Exp {
 		$$ = (FuncCParamListAST*) $1;
-		$$->list.push_back(unique_ptr<AddExpAST>($3));
+		$$->list.push_back($3);
 	}
 	;
 				
 //乘除模表达式
 MulExp
 	: UnaryExp {
-		$$ = new MulExpAST();
-		$$->unaryExp = unique_ptr<UnaryExpAST>($1);	
+		$$ = $1;
 	}		
 	| MulExp MUL UnaryExp {
-		$$ = new MulExpAST();
-		$$->mulExp = unique_ptr<MulExpAST>($1);
-		$$->op = MOP_MUL;
-		$$->unaryExp = unique_ptr<UnaryExpAST>($3);		
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_MUL, $1, $3);
 	}	
 	| MulExp DIV UnaryExp {
-		$$ = new MulExpAST();
-		$$->mulExp = unique_ptr<MulExpAST>($1);
-		$$->op = MOP_DIV;
-		$$->unaryExp = unique_ptr<UnaryExpAST>($3);			
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_DIV, $1, $3);
 	}	
 	| MulExp MOD UnaryExp {
-		$$ = new MulExpAST();
-		$$->mulExp = unique_ptr<MulExpAST>($1);
-		$$->op = MOP_MOD;
-		$$->unaryExp = unique_ptr<UnaryExpAST>($3);	
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_MOD, $1, $3);
 	}	
 	;
 
 // 加减表达式
 AddExp
 	: MulExp	{
-		$$ = new AddExpAST();
-		$$->mulExp = unique_ptr<MulExpAST>($1);		
+		$$ = $1;
 	}			
 	| AddExp ADD MulExp {
-		$$ = new AddExpAST();
-		$$->addExp = unique_ptr<AddExpAST>($1);
-		$$->op = AOP_ADD;
-		$$->mulExp = unique_ptr<MulExpAST>($3);	
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_ADD, $1, $3);
 	}
 	| AddExp MINUS MulExp {
-		$$ = new AddExpAST();
-		$$->addExp = unique_ptr<AddExpAST>($1);
-		$$->op = AOP_MINUS;
-		$$->mulExp = unique_ptr<MulExpAST>($3);	
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_MINUS, $1, $3);
 	}
 	;
 
 // 关系表达式
 RelExp
 	: AddExp	{
-		$$ = new RelExpAST();
-		$$->addExp = unique_ptr<AddExpAST>($1);	
+		$$ = $1;
 	}				
 	| RelExp GTE AddExp{
-		$$ = new RelExpAST();
-		$$->relExp = unique_ptr<RelExpAST>($1);
-		$$->op = ROP_GTE;
-		$$->addExp = unique_ptr<AddExpAST>($3);	
-	}  //分析关系运算符号自身值保存在$2中
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_GTE, $1, $3);
+	}
 	| RelExp LTE AddExp{
-		$$ = new RelExpAST();
-		$$->relExp = unique_ptr<RelExpAST>($1);
-		$$->op = ROP_LTE;
-		$$->addExp = unique_ptr<AddExpAST>($3);		
-	}  //分析关系运算符号自身值保存在$2中
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_LTE, $1, $3);
+	}
 	| RelExp GT AddExp {
-		$$ = new RelExpAST();
-		$$->relExp = unique_ptr<RelExpAST>($1);
-		$$->op = ROP_GT;
-		$$->addExp = unique_ptr<AddExpAST>($3);	
-	}  //分析关系运算符号自身值保存在$2中
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_GT, $1, $3);
+	}
 	| RelExp LT AddExp {
-		$$ = new RelExpAST();
-		$$->relExp = unique_ptr<RelExpAST>($1);
-		$$->op = ROP_LT;
-		$$->addExp = unique_ptr<AddExpAST>($3);	
-	}	  //分析关系运算符号自身值保存在$2中
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_LT, $1, $3);
+	}
 	;
 
 // 相等性表达式
 EqExp
 	: RelExp	{
-		$$ = new EqExpAST();
-		$$->relExp = unique_ptr<RelExpAST>($1);
+		$$ = $1;
 	}				
 	|EqExp EQ RelExp{
-		$$ = new EqExpAST();
-		$$->eqExp = unique_ptr<EqExpAST>($1);
-		$$->op = EOP_EQ;
-		$$->relExp = unique_ptr<RelExpAST>($3);
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_EQ, $1, $3);
 	} 	
 	| EqExp NEQ RelExp{
-		$$ = new EqExpAST();
-		$$->eqExp = unique_ptr<EqExpAST>($1);
-		$$->op = EOP_NEQ;
-		$$->relExp = unique_ptr<RelExpAST>($3);
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_NEQ, $1, $3);
 	} 	
 	;
 
 // 逻辑与表达式
 LAndExp
 	: EqExp {
-		$$ = new LAndExpAST();
-		$$->eqExp = unique_ptr<EqExpAST>($1);		
+		$$ = $1;
 	}		
 	| LAndExp AND EqExp {
-		$$ = new LAndExpAST();
-		$$->lAndExp = unique_ptr<LAndExpAST>($1);
-		$$->eqExp = unique_ptr<EqExpAST>($3);
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_AND, $1, $3);
 	} 	
 	;
 
 // 逻辑或表达式
 LOrExp
 	:	LAndExp {
-		$$ = new LOrExpAST();
-		$$->lAndExp = unique_ptr<LAndExpAST>($1);
+		$$ = $1;
 	}				
 	| LOrExp OR LAndExp {
-		$$ = new LOrExpAST();
-		$$->lOrExp = unique_ptr<LOrExpAST>($1);
-		$$->lAndExp = unique_ptr<LAndExpAST>($3);
+		$$ = ctx->arena.make<BinaryExpAST>(BOP_OR, $1, $3);
 	} 	
 	;
 %%
 
-void initFileName(char *name){
-    strcpy(filename, name);
+void yyerror(YYLTYPE *loc, yyscan_t scanner, ParseContext *ctx,
+             CompUnitAST **root, const char *msg) {
+    ctx->errors++;
+    printf("%s:%d ", ctx->filename.c_str(), loc->first_line);
+    printf("%s\n", msg);
 }
-
-void yyerror(const char* fmt) {
-    printf("%s:%d ", filename, yylloc.first_line);
-    printf("%s\n", fmt);
-}
-
@@ -0,0 +1,289 @@
+#include "pass.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "cfg.h"
+#include "thread_pool.h"
+#include "verify.h"
+
+namespace {
+
+struct PassInfo {
+  const char *name;
+  PassFn fn;
+  ModulePassFn moduleFn;
+};
+
+const PassInfo PASSES[] = {
+    {"simplifycfg", simplifyCFG, nullptr},
+    {"mem2reg", mem2reg, nullptr},
+    {"tre", nullptr, tailRecursion},
+    {"inline", nullptr, inlineCalls},
+    {"gvn", gvn, nullptr},
+    {"licm", licm, nullptr},
+    {"dce", dce, nullptr},
+};
+
+// 内联放在 mem2reg 之后，被内联的函数体已经是 SSA 形式，
+// 内联后的代码再经过 GVN、LICM 和 DCE
+const char *const DEFAULT_PIPELINE[] = {
+    "simplifycfg", "mem2reg", "tre", "inline", "gvn", "licm", "dce", "simplifycfg",
+};
+
+// 对每个有函数体且不取自缓存的函数调用 fn；有线程池时大函数先提交，
+// 减少最后的长尾
+template <typename F>
+void forEachFunction(Module &module, ThreadPool *pool, F fn) {
+  if (pool == nullptr || pool->size() <= 1) {
+    for (auto &func : module.functions)
+      if (!func.external && !func.cached) fn(func);
+    return;
+  }
+  std::vector<Function *> funcs;
+  for (auto &func : module.functions)
+    if (!func.external && !func.cached) funcs.push_back(&func);
+  std::stable_sort(funcs.begin(), funcs.end(), [](Function *a, Function *b) {
+    return a->insts.size() > b->insts.size();
+  });
+  for (Function *func : funcs) pool->submit([func, &fn] { fn(*func); });
+  pool->wait();
+}
+
+}  // namespace
+
+bool PassManager::find(const std::string &name, Pass &pass) {
+  for (auto &info : PASSES) {
+    if (name == info.name) {
+      pass = {info.name, info.fn, info.moduleFn};
+      return true;
+    }
+  }
+  return false;
+}
+
+PassManager::PassManager() {
+  for (const char *name : DEFAULT_PIPELINE) {
+    Pass pass;
+    find(name, pass);
+    pipeline.push_back(pass);
+  }
+}
+
+bool PassManager::setPipeline(const std::string &list, std::string &error) {
+  std::vector<Pass> passes;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) end = list.size();
+    std::string name = list.substr(begin, end - begin);
+    Pass pass;
+    if (!name.empty()) {
+      if (!find(name, pass)) {
+        error = "unknown pass '" + name + "'";
+        return false;
+      }
+      passes.push_back(pass);
+    }
+    begin = end + 1;
+  }
+  pipeline = std::move(passes);
+  return true;
+}
+
+bool PassManager::disable(const std::string &name) {
+  Pass pass;
+  if (!find(name, pass)) return false;
+  pipeline.erase(
+      std::remove_if(pipeline.begin(), pipeline.end(),
+                     [&](const Pass &p) { return p.name == pass.name; }),
+      pipeline.end());
+  return true;
+}
+
+std::string PassManager::describe() const {
+  std::string list;
+  for (auto &pass : pipeline) {
+    if (!list.empty()) list += ',';
+    list += pass.name;
+  }
+  return list;
+}
+
+bool PassManager::run(Module &module, Stats *stats,
+                      std::vector<std::string> &errors, ThreadPool *pool,
+                      const PassHook &hook) const {
+  PassCounts counts;
+  for (auto &pass : pipeline) {
+    size_t before = module.size();
+    auto start = std::chrono::steady_clock::now();
+    if (pass.moduleFn != nullptr) {
+      pass.moduleFn(module, counts);
+    } else {
+      PassFn fn = pass.fn;
+      forEachFunction(module, pool, [&](Function &func) { fn(module, func); });
+    }
+    std::chrono::duration<double, std::milli> ms =
+        std::chrono::steady_clock::now() - start;
+    if (stats != nullptr)
+      stats->addPass(pass.name, ms.count(), before, module.size());
+    if (hook) hook(pass.name, module);
+    if (verifyEach) {
+      size_t first = errors.size();
+      if (!verifyModule(module, errors)) {
+        errors.insert(errors.begin() + first,
+                      std::string("invalid IR after ") + pass.name);
+        return false;
+      }
+    }
+  }
+  forEachFunction(module, pool, compactFunction);
+  if (stats != nullptr) {
+    stats->inlinedCalls += counts.inlinedCalls;
+    stats->tailCalls += counts.tailCalls;
+  }
+  return true;
+}
+
+Value resolve(std::vector<Value> &repl, Value v) {
+  auto replaced = [&](Value x) {
+    return kindOf(x) == VK_INST && indexOf(x) < repl.size() &&
+           repl[indexOf(x)] != NO_VALUE;
+  };
+  Value root = v;
+  while (replaced(root)) root = repl[indexOf(root)];
+  // 路径压缩
+  while (replaced(v)) {
+    Value next = repl[indexOf(v)];
+    repl[indexOf(v)] = root;
+    v = next;
+  }
+  return root;
+}
+
+void substitute(Function &func, std::vector<Value> &repl) {
+  for (auto &block : func.blocks)
+    for (uint32_t index : block.insts)
+      forEachOperand(func, func.insts[index],
+                     [&](Value &v) { v = resolve(repl, v); });
+}
+
+void removeNops(Function &func) {
+  for (auto &block : func.blocks) {
+    auto &insts = block.insts;
+    insts.erase(std::remove_if(insts.begin(), insts.end(),
+                               [&](uint32_t index) {
+                                 return func.insts[index].op == OP_NOP;
+                               }),
+                insts.end());
+  }
+}
+
+Value incoming(const Function &func, const Inst &phi, uint32_t pred) {
+  for (uint32_t i = 0; i < phi.c; i++)
+    if (func.lists[phi.b + 2 * i + 1] == pred) return func.lists[phi.b + 2 * i];
+  return NO_VALUE;
+}
+
+void removeIncoming(Function &func, uint32_t block, uint32_t pred) {
+  for (uint32_t index : func.blocks[block].insts) {
+    Inst &phi = func.insts[index];
+    if (phi.op != OP_PHI) break;
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < phi.c; i++) {
+      if (func.lists[phi.b + 2 * i + 1] == pred) continue;
+      func.lists[phi.b + 2 * k] = func.lists[phi.b + 2 * i];
+      func.lists[phi.b + 2 * k + 1] = func.lists[phi.b + 2 * i + 1];
+      k++;
+    }
+    phi.c = k;
+  }
+}
+
+void setIncoming(Function &func, Inst &phi,
+                 const std::vector<std::pair<Value, uint32_t>> &entries) {
+  // 入边变多时在 lists 末尾另开一段，旧的一段由 compactFunction 回收
+  if (entries.size() > phi.c) phi.b = func.lists.size();
+  func.lists.resize(std::max<size_t>(func.lists.size(),
+                                     phi.b + 2 * entries.size()));
+  for (size_t i = 0; i < entries.size(); i++) {
+    func.lists[phi.b + 2 * i] = entries[i].first;
+    func.lists[phi.b + 2 * i + 1] = entries[i].second;
+  }
+  phi.c = entries.size();
+}
+
+Value insertPhi(Function &func, uint32_t block, IRType type) {
+  Inst inst;
+  inst.op = OP_PHI;
+  inst.type = type;
+  inst.block = block;
+  inst.b = func.lists.size();
+  Value v = func.create(inst);
+  auto &insts = func.blocks[block].insts;
+  insts.insert(insts.begin(), indexOf(v));
+  return v;
+}
+
+void removeBlocks(Function &func, const std::vector<bool> &dead) {
+  std::vector<uint32_t> index(func.blocks.size(), CFG::NONE);
+  uint32_t next = 0;
+  for (uint32_t b = 0; b < func.blocks.size(); b++)
+    if (!dead[b]) index[b] = next++;
+
+  std::vector<Block> blocks;
+  for (uint32_t b = 0; b < func.blocks.size(); b++) {
+    if (dead[b]) {
+      for (uint32_t i : func.blocks[b].insts) func.insts[i].op = OP_NOP;
+      continue;
+    }
+    for (uint32_t i : func.blocks[b].insts) {
+      Inst &inst = func.insts[i];
+      inst.block = index[b];
+      if (inst.op == OP_PHI) {
+        uint32_t k = 0;
+        for (uint32_t e = 0; e < inst.c; e++) {
+          uint32_t pred = func.lists[inst.b + 2 * e + 1];
+          if (dead[pred]) continue;
+          func.lists[inst.b + 2 * k] = func.lists[inst.b + 2 * e];
+          func.lists[inst.b + 2 * k + 1] = index[pred];
+          k++;
+        }
+        inst.c = k;
+      }
+      forEachSuccessor(inst, [&](uint32_t &target) { target = index[target]; });
+    }
+    blocks.push_back(std::move(func.blocks[b]));
+  }
+  func.blocks = std::move(blocks);
+}
+
+void compactFunction(Function &func) {
+  std::vector<uint32_t> index(func.insts.size(), CFG::NONE);
+  std::vector<Inst> insts;
+  std::vector<uint32_t> lists;
+  for (auto &block : func.blocks) {
+    for (uint32_t &i : block.insts) {
+      Inst inst = func.insts[i];
+      uint32_t words = inst.op == OP_CALL ? inst.c
+                       : inst.op == OP_PHI ? 2 * inst.c
+                                           : 0;
+      if (inst.op == OP_CALL || inst.op == OP_PHI) {
+        uint32_t first = lists.size();
+        lists.insert(lists.end(), func.lists.begin() + inst.b,
+                     func.lists.begin() + inst.b + words);
+        inst.b = first;
+      }
+      index[i] = insts.size();
+      i = insts.size();
+      insts.push_back(inst);
+    }
+  }
+  func.insts = std::move(insts);
+  func.lists = std::move(lists);
+  for (auto &inst : func.insts) {
+    forEachOperand(func, inst, [&](Value &v) {
+      if (kindOf(v) == VK_INST) v = makeValue(VK_INST, index[indexOf(v)]);
+    });
+  }
+}
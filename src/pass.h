@@ -0,0 +1,93 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ir.h"
+#include "stats.h"
+
+class ThreadPool;
+
+// 作用在单个函数上的优化，返回是否改动了函数。
+// 每个 pass 结束时 IR 仍须能通过 verifyFunction
+using PassFn = bool (*)(Module &module, Function &func);
+
+// 跨函数优化报告的计数
+struct PassCounts {
+  size_t inlinedCalls = 0;  // 被内联的调用点
+  size_t tailCalls = 0;     // 改写成循环的自递归尾调用
+};
+// 作用在整个模块上的优化（需要调用图的那些），返回是否改动了模块
+using ModulePassFn = bool (*)(Module &module, PassCounts &counts);
+
+// CFG 化简：常量条件分支、不可达块、单前驱单后继块合并、空转发块
+bool simplifyCFG(Module &module, Function &func);
+// 把只通过 LOAD/STORE 访问的标量 ALLOCA 提升为 SSA 值（Cytron 等的 PHI 插入）
+bool mem2reg(Module &module, Function &func);
+// 支配树上的全局值编号：纯运算去重、常量折叠和代数化简，块内的冗余 LOAD 消除
+bool gvn(Module &module, Function &func);
+// 把循环中操作数都在循环外定义的纯运算提到前置块
+bool licm(Module &module, Function &func);
+// 从有副作用的指令出发标记活跃指令，删除其余的（包括死 PHI 环）
+bool dce(Module &module, Function &func);
+// 自递归的尾调用改成跳回函数开头的循环，形参变成循环头的 PHI
+bool tailRecursion(Module &module, PassCounts &counts);
+// 按调用图自底向上内联：小函数、只有一个调用点的函数，循环里的调用放宽限制
+bool inlineCalls(Module &module, PassCounts &counts);
+
+// 每个 pass 之后的回调，参数是 pass 的名字和当时的模块
+using PassHook = std::function<void(const char *name, const Module &module)>;
+
+// 按顺序运行的优化流水线：函数级 pass 对每个函数各运行一次，模块级 pass 运行一次
+class PassManager {
+ public:
+  PassManager();  // 默认流水线
+
+  // 用逗号分隔的 pass 名字替换流水线；有未知名字时返回 false
+  bool setPipeline(const std::string &list, std::string &error);
+  // 从流水线中去掉某个 pass 的所有出现；名字未知时返回 false
+  bool disable(const std::string &name);
+  // 流水线中的 pass 名字，逗号分隔（与 -passes= 的格式相同）
+  std::string describe() const;
+  // 运行流水线，stats 不为空时记录每个 pass 的耗时和指令数变化。
+  // verifyEach 时每个 pass 之后校验，出错时把错误追加到 errors 并返回 false。
+  // pool 不为空时函数级 pass 把各函数分给线程池并行处理（模块级 pass 是屏障），
+  // 函数级 pass 只改自己的函数，结果与串行相同
+  bool run(Module &module, Stats *stats, std::vector<std::string> &errors,
+           ThreadPool *pool = nullptr, const PassHook &hook = nullptr) const;
+
+  bool verifyEach = false;
+
+ private:
+  struct Pass {
+    const char *name;
+    PassFn fn;  // 为空时是模块级的 moduleFn
+    ModulePassFn moduleFn;
+  };
+  static bool find(const std::string &name, Pass &pass);
+
+  std::vector<Pass> pipeline;
+};
+
+// pass 共用的 IR 改写工具
+
+// 沿替换链找到 v 最终被替换成的值；repl[i] 为 NO_VALUE 表示指令 i 没有被替换
+Value resolve(std::vector<Value> &repl, Value v);
+// 把所有操作数按 repl 替换
+void substitute(Function &func, std::vector<Value> &repl);
+// 把 OP_NOP 指令从所在块中拿掉
+void removeNops(Function &func);
+// PHI 在 pred 这条入边上的值，没有时返回 NO_VALUE
+Value incoming(const Function &func, const Inst &phi, uint32_t pred);
+// 删掉 block 中所有 PHI 来自 pred 的入边
+void removeIncoming(Function &func, uint32_t block, uint32_t pred);
+// 把 PHI 的入边换成 entries 中的 (值, 前驱块)
+void setIncoming(Function &func, Inst &phi,
+                 const std::vector<std::pair<Value, uint32_t>> &entries);
+// 在 block 开头插入 PHI，入边先不填
+Value insertPhi(Function &func, uint32_t block, IRType type);
+// 删除 dead 中标记的块（入口块不能删），其余块按原顺序重新编号
+void removeBlocks(Function &func, const std::vector<bool> &dead);
+// 丢掉已删除的指令和不再引用的操作数列表，按块顺序重新编号
+void compactFunction(Function &func);
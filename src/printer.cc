@@ -1,461 +1,693 @@
 #include "printer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+
+#include "flat_ast.h"
+#include "thread_pool.h"
 #include "utils.h"
 
-// ref:
-// https://stackoverflow.com/questions/2342162/stdstring-formatting-like-sprintf
-template <typename... Args>
-std::string strfmt(const std::string &format, Args... args) {
-  int size_s = std::snprintf(nullptr, 0, format.c_str(), args...) +
-               1;  // Extra space for '\0'
-  if (size_s <= 0) {
-    throw std::runtime_error("Error during formatting.");
+std::string printAST(CompUnitAST &ast) {
+  OutBuffer out;
+  Printer printer(out);
+  printer.visit(ast);
+  return std::move(out.str());
+}
+
+// n 个顶层声明按顺序分成若干段，各段在 pool 上用 makePrinter 建的 P 从深度 2
+// 开始 declDef(i) 写进各自的内存缓冲区，再和开头的 "CompUnit:\n" 一起按顺序写出
+template <typename P, typename F>
+static void printParallel(size_t n, ThreadPool &pool, OutBuffer &out,
+                          F makePrinter) {
+  // 连续的几个声明合成一块，块数取线程数的几倍以便负载均衡，
+  // 又不至于每个小函数都付一次任务和缓冲区的开销
+  size_t blocks = std::min(n, size_t(pool.size()) * 8);
+  std::vector<std::vector<std::string>> chunks(blocks);
+  for (size_t b = 0; b < blocks; b++) {
+    pool.submit([&, b] {
+      OutBuffer chunk;
+      P printer = makePrinter(chunk);
+      printer.depth = 2;
+      for (size_t i = n * b / blocks, e = n * (b + 1) / blocks; i < e; i++) {
+        printer.declDef(i);
+        // 攒到 1MB 就另起一段，避免 string 扩容时反复复制整块文本
+        if (chunk.str().size() >= (1 << 20)) {
+          chunks[b].push_back(std::move(chunk.str()));
+          chunk.str() = std::string();
+          chunk.str().reserve(1 << 20);
+        }
+      }
+      chunks[b].push_back(std::move(chunk.str()));
+    });
   }
-  auto size = static_cast<size_t>(size_s);
-  std::unique_ptr<char[]> buf(new char[size]);
-  std::snprintf(buf.get(), size, format.c_str(), args...);
-  return std::string(buf.get(),
-                     buf.get() + size - 1);  // We don't want the '\0' inside
+  pool.wait();
+  std::vector<std::string> pieces;
+  for (auto &segments : chunks)
+    for (auto &segment : segments) pieces.push_back(std::move(segment));
+  out.write("CompUnit:\n");
+  out.writev(pieces);
+}
+
+void printASTParallel(CompUnitAST &ast, ThreadPool &pool, OutBuffer &out) {
+  // 按下标输出第 i 个顶层声明的 Printer
+  struct TreePrinter : Printer {
+    TreePrinter(OutBuffer &out, CompUnitAST &ast) : Printer(out), ast(ast) {}
+    void declDef(size_t i) { visit(*ast.declDefList[i]); }
+    CompUnitAST &ast;
+  };
+  printParallel<TreePrinter>(
+      ast.declDefList.size(), pool, out,
+      [&](OutBuffer &chunk) { return TreePrinter(chunk, ast); });
+}
+
+void printASTParallel(const FlatAST &f, ThreadPool &pool, OutBuffer &out) {
+  printParallel<FlatPrinter>(
+      f.declDefs.size(), pool, out,
+      [&](OutBuffer &chunk) { return FlatPrinter(f, chunk); });
+}
+
+const char *const PrinterBase::LEVEL_NAMES[] = {
+    "LOrExp:\n", "LAndExp:\n",   "EqExp:\n",     "RelExp:\n",
+    "AddExp:\n", "MulExp:\n", "UnaryExp:\n", "PrimaryExp:\n"};
+
+void PrinterBase::id(Symbol sym) {
+  line("id:");
+  out.write(interner.name(sym));
+  out.put('\n');
 }
 
-std::string Printer::visit(CompUnitAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "CompUnit:\n";
+void PrinterBase::integer(long long val) {
+  char buf[24];
+  auto res = std::to_chars(buf, buf + sizeof(buf), val);
+  out.write(buf, res.ptr - buf);
+}
+
+void Printer::visit(CompUnitAST &ast) {
+  line("CompUnit:\n");
   depth += 2;
   for (auto &i : ast.declDefList) {
-    ans += visit(*i);
+    visit(*i);
   }
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(DeclDefAST &ast) {
-  std::string ans = "";
+void Printer::visit(DeclDefAST &ast) {
   if (ast.Decl != nullptr) {
-    ans += visit(*ast.Decl);
+    visit(*ast.Decl);
   } else {
-    ans += visit(*ast.funcDef);
+    visit(*ast.funcDef);
   }
-  return ans;
 }
 
-std::string Printer::visit(DeclAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "Decl:\n";
+void Printer::visit(DeclAST &ast) {
+  line("Decl:\n");
   depth += 2;
   if (ast.isConst) {
-    ans += strfmt("%*s", depth, "");
-    ans += "const\n";
+    line("const\n");
   }
-  ans += strfmt("%*s", depth, "");
   if (ast.bType == TYPE_INT)
-    ans += "BType:int\n";
+    line("BType:int\n");
   else
-    ans += "BType:float\n";
+    line("BType:float\n");
   for (auto &def : ast.defList) {
-    ans += visit(*def);
+    visit(*def);
   }
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(DefAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "Def:\n";
+void Printer::visit(DefAST &ast) {
+  line("Def:\n");
   depth += 2;
-  ans += strfmt("%*s", depth, "");
-  ans += "id:" + *(ast.id) + "\n";
+  id(ast.id);
   if (!ast.arrays.empty()) {
-    ans += strfmt("%*s", depth, "");
-    ans += "Arrays:\n";
+    line("Arrays:\n");
     depth += 2;
     for (auto &i : ast.arrays) {
-      ans += visit(*i);
+      visit(*i);
     }
     depth -= 2;
   }
-  if (ast.initVal != nullptr) ans += visit(*ast.initVal);
+  if (ast.initVal != nullptr) visit(*ast.initVal);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(InitValAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "InitValAST:";
+void Printer::visit(InitValAST &ast) {
+  line("InitValAST:");
   depth += 2;
   if (ast.exp != nullptr) {
-    ans += "\n";
-    ans += visit(*ast.exp);
+    out.put('\n');
+    visit(*ast.exp);
   } else if (!ast.initValList.empty()) {
-    ans += "\n";
-    ans += strfmt("%*s", depth, "");
-    ans += "InitValList:\n";
+    out.put('\n');
+    line("InitValList:\n");
     depth += 2;
     for (auto &initVal : ast.initValList) {
-      ans += visit(*initVal);
+      visit(*initVal);
     }
     depth -= 2;
   } else {
-    ans += "{}\n";
+    out.write("{}\n");
   }
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(FuncDefAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "FuncDef:\n";
+void Printer::visit(FuncDefAST &ast) {
+  line("FuncDef:\n");
   depth += 2;
-  ans += strfmt("%*s", depth, "");
   if (ast.funcType == TYPE_VOID)
-    ans += "funcType:void\n";
+    line("funcType:void\n");
   else if (ast.funcType == TYPE_INT)
-    ans += "funcType:int\n";
+    line("funcType:int\n");
   else
-    ans += "funcType:float\n";
-  ans += strfmt("%*s", depth, "");
-  ans += "id:" + *ast.id + "\n";
+    line("funcType:float\n");
+  id(ast.id);
   if (!ast.funcFParamList.empty()) {
-    ans += strfmt("%*s", depth, "");
-    ans += "FuncFParamList:\n";
+    line("FuncFParamList:\n");
     depth += 2;
     for (auto &i : ast.funcFParamList) {
-      ans += visit(*i);
+      visit(*i);
     }
     depth -= 2;
   }
-  ans += visit(*ast.block);
+  visit(*ast.block);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(FuncFParamAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "FuncFParam:\n";
+void Printer::visit(FuncFParamAST &ast) {
+  line("FuncFParam:\n");
   depth += 2;
-  ans += strfmt("%*s", depth, "");
   if (ast.bType == TYPE_INT)
-    ans += "BType:int\n";
+    line("BType:int\n");
   else
-    ans += "BType:float\n";
-  ans += strfmt("%*s", depth, "");
-  ans += "id:" + *ast.id + "\n";
+    line("BType:float\n");
+  id(ast.id);
   if (ast.isArray) {
-    ans += strfmt("%*s", depth, "");
-    ans += "Array:[]\n";
+    line("Array:[]\n");
   }
   if (!ast.arrays.empty()) {
-    ans += strfmt("%*s", depth, "");
-    ans += "Arrays:\n";
+    line("Arrays:\n");
     depth += 2;
     for (auto &i : ast.arrays) {
-      ans += visit(*i);
+      visit(*i);
     }
     depth -= 2;
   }
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(BlockAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "Block:\n";
+void Printer::visit(BlockAST &ast) {
+  line("Block:\n");
   depth += 2;
   if (!ast.blockItemList.empty()) {
-    ans += strfmt("%*s", depth, "");
-    ans += "BlockItemList:\n";
+    line("BlockItemList:\n");
     depth += 2;
     for (auto &i : ast.blockItemList) {
-      ans += visit(*i);
+      visit(*i);
     }
     depth -= 2;
   }
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(BlockItemAST &ast) {
-  std::string ans = "";
+void Printer::visit(BlockItemAST &ast) {
   if (ast.decl != nullptr) {
-    ans += visit(*ast.decl);
+    visit(*ast.decl);
   } else {
-    ans += visit(*ast.stmt);
+    visit(*ast.stmt);
   }
-  return ans;
 }
 
-std::string Printer::visit(StmtAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "Stmt:";
+void Printer::visit(StmtAST &ast) {
+  line("Stmt:");
   switch (ast.sType) {
     case SEMI:
-      ans += "semicolon\n";
+      out.write("semicolon\n");
       break;
     case ASS:
-      ans += "\n";
+      out.put('\n');
       depth += 2;
-      ans += visit(*ast.lVal);
-      ans += visit(*ast.exp);
+      visit(*ast.lVal);
+      visit(*ast.exp);
       depth -= 2;
       break;
     case EXP:
-      ans += "\n";
+      out.put('\n');
       depth += 2;
-      ans += visit(*ast.exp);
+      visit(*ast.exp);
       depth -= 2;
       break;
     case CONT:
-      ans += "continue\n";
+      out.write("continue\n");
       break;
     case BRE:
-      ans += "break\n";
+      out.write("break\n");
       break;
     case RET:
-      ans += "\n";
+      out.put('\n');
       depth += 2;
-      ans += visit(*ast.returnStmt);
+      visit(*ast.returnStmt);
       depth -= 2;
       break;
     case BLK:
-      ans += "\n";
+      out.put('\n');
       depth += 2;
-      ans += visit(*ast.block);
+      visit(*ast.block);
       depth -= 2;
       break;
     case SELECT:
-      ans += "\n";
+      out.put('\n');
       depth += 2;
-      ans += visit(*ast.selectStmt);
+      visit(*ast.selectStmt);
       depth -= 2;
       break;
     case ITER:
-      ans += "\n";
+      out.put('\n');
       depth += 2;
-      ans += visit(*ast.iterationStmt);
+      visit(*ast.iterationStmt);
       depth -= 2;
       break;
   }
-  return ans;
 }
 
-std::string Printer::visit(ReturnStmtAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "return:";
+void Printer::visit(ReturnStmtAST &ast) {
+  line("return:");
   if (ast.exp == nullptr)
-    ans += "void\n";
+    out.write("void\n");
   else {
-    ans += "\n";
+    out.put('\n');
     depth += 2;
-    ans += visit(*ast.exp);
+    visit(*ast.exp);
     depth -= 2;
   }
-  return ans;
 }
 
-std::string Printer::visit(SelectStmtAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "SelectStmt:\n";
+void Printer::visit(SelectStmtAST &ast) {
+  line("SelectStmt:\n");
   depth += 2;
-  ans += visit(*ast.cond);
-  ans += visit(*ast.ifStmt);
-  if (ast.elseStmt != nullptr) ans += visit(*ast.elseStmt);
+  exp(*ast.cond, L_LOR, ast.cond->parens);
+  visit(*ast.ifStmt);
+  if (ast.elseStmt != nullptr) visit(*ast.elseStmt);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(IterationStmtAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "IterationStmt:\n";
+void Printer::visit(IterationStmtAST &ast) {
+  line("IterationStmt:\n");
   depth += 2;
-  ans += visit(*ast.cond);
-  ans += visit(*ast.stmt);
+  exp(*ast.cond, L_LOR, ast.cond->parens);
+  visit(*ast.stmt);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(AddExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "AddExp:\n";
+void Printer::visit(ExpAST &ast) { exp(ast, L_ADD, ast.parens); }
+
+void Printer::exp(ExpAST &ast, int level, int parens) {
+  this->level(level);
   depth += 2;
-  if (ast.addExp != nullptr) {
-    ans += visit(*ast.addExp);
-    ans += strfmt("%*s", depth, "");
-    ans += "AOP:";
-    if (ast.op == AOP_ADD)
-      ans += "+\n";
+  if (level == L_PRIMARY) {
+    // 括号对应 PrimaryExp -> Exp，剩下的都是叶子；
+    // 没有括号却落到这一层的表达式（如变换后生成的）从 LOrExp 重新开始
+    if (parens > 0)
+      exp(ast, L_ADD, parens - 1);
+    else if (ast.kind == EXP_LVAL)
+      visit(static_cast<LValAST &>(ast));
+    else if (ast.kind == EXP_NUMBER)
+      visit(static_cast<NumberAST &>(ast));
     else
-      ans += "-\n";
+      exp(ast, L_LOR, 0);
+  } else if (level == L_UNARY) {
+    if (parens == 0 && ast.kind == EXP_CALL) {
+      visit(static_cast<CallAST &>(ast));
+    } else if (parens == 0 && ast.kind == EXP_UNARY) {
+      auto &unary = static_cast<UnaryExpAST &>(ast);
+      unaryOp(unary.op);
+      exp(*unary.exp, L_UNARY, unary.exp->parens);
+    } else {
+      exp(ast, L_PRIMARY, parens);
+    }
+  } else if (parens == 0 && ast.kind == EXP_BINARY &&
+             opLevel(static_cast<BinaryExpAST &>(ast).op) == level) {
+    auto &binary = static_cast<BinaryExpAST &>(ast);
+    exp(*binary.lhs, level, binary.lhs->parens);
+    binaryOp(binary.op);
+    exp(*binary.rhs, level + 1, binary.rhs->parens);
+  } else {
+    exp(ast, level + 1, parens);
   }
-  ans += visit(*ast.mulExp);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(MulExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "MulExp:\n";
-  depth += 2;
-  if (ast.mulExp != nullptr) {
-    ans += visit(*ast.mulExp);
-    ans += strfmt("%*s", depth, "");
-    ans += "MOP:";
-    if (ast.op == MOP_MUL)
-      ans += "*\n";
-    else if (ast.op == MOP_DIV)
-      ans += "/\n";
-    else
-      ans += "%\n";
+void PrinterBase::unaryOp(UOP op) {
+  line("UnaryOp:");
+  if (op == UOP_ADD) out.write("+\n");
+  if (op == UOP_MINUS) out.write("-\n");
+  if (op == UOP_NOT) out.write("!\n");
+}
+
+void PrinterBase::binaryOp(BOP op) {
+  switch (op) {
+    case BOP_ADD: line("AOP:+\n"); break;
+    case BOP_MINUS: line("AOP:-\n"); break;
+    case BOP_MUL: line("MOP:*\n"); break;
+    case BOP_DIV: line("MOP:/\n"); break;
+    case BOP_MOD: line("MOP:%\n"); break;
+    case BOP_GTE: line("RelOP:>=\n"); break;
+    case BOP_LTE: line("RelOP:<=\n"); break;
+    case BOP_GT: line("RelOP:>\n"); break;
+    case BOP_LT: line("RelOP:<\n"); break;
+    case BOP_EQ: line("EqOP:==\n"); break;
+    case BOP_NEQ: line("EqOP:!=\n"); break;
+    case BOP_AND: line("AND_OP:&&"); break;
+    case BOP_OR: line("OR_OP:||"); break;
   }
-  ans += visit(*ast.unaryExp);
-  depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(UnaryExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "UnaryExp:\n";
-  depth += 2;
-  if (ast.primaryExp != nullptr) {
-    ans += visit(*ast.primaryExp);
-  } else if (ast.call != nullptr) {
-    ans += visit(*ast.call);
-  } else {
-    ans += strfmt("%*s", depth, "");
-    ans += "UnaryOp:";
-    if (ast.op == UOP_ADD) ans += "+\n";
-    if (ast.op == UOP_MINUS) ans += "-\n";
-    if (ast.op == UOP_NOT) ans += "!\n";
-    ans += visit(*ast.unaryExp);
+PrinterBase::Level PrinterBase::opLevel(BOP op) {
+  switch (op) {
+    case BOP_MUL:
+    case BOP_DIV:
+    case BOP_MOD:
+      return L_MUL;
+    case BOP_ADD:
+    case BOP_MINUS:
+      return L_ADD;
+    case BOP_GTE:
+    case BOP_LTE:
+    case BOP_GT:
+    case BOP_LT:
+      return L_REL;
+    case BOP_EQ:
+    case BOP_NEQ:
+      return L_EQ;
+    case BOP_AND:
+      return L_LAND;
+    default:
+      return L_LOR;
   }
-  depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(PrimaryExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "PrimaryExp:\n";
-  depth += 2;
-  if (ast.exp != nullptr) {
-    ans += visit(*ast.exp);
-  } else if (ast.lval != nullptr) {
-    ans += visit(*ast.lval);
+void PrinterBase::number(bool isInt, int intval, float floatval) {
+  line("number:");
+  if (isInt) {
+    integer(intval);
   } else {
-    ans += visit(*ast.number);
+    // 与 std::to_string(float) 的 "%f" 格式保持一致
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), "%f", floatval);
+    out.write(buf, n);
   }
-  depth -= 2;
-  return ans;
+  out.put('\n');
 }
 
-std::string Printer::visit(CallAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "Call:\n";
+void Printer::visit(CallAST &ast) {
+  line("Call:\n");
   depth += 2;
-  ans += strfmt("%*s", depth, "");
-  ans += "id:" + (*ast.id) + "\n";
+  id(ast.id);
   if (!ast.funcCParamList.empty()) {
-    ans += strfmt("%*s", depth, "");
-    ans += "FuncCParamList:" + std::to_string(ast.funcCParamList.size()) + "\n";
+    line("FuncCParamList:");
+    integer(ast.funcCParamList.size());
+    out.put('\n');
     depth += 2;
     for (auto &i : ast.funcCParamList) {
-      ans += visit(*i);
+      visit(*i);
     }
     depth -= 2;
   }
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(LValAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "LVal:\n";
+void Printer::visit(LValAST &ast) {
+  line("LVal:\n");
   depth += 2;
-  ans += strfmt("%*s", depth, "");
-  ans += "id:" + (*ast.id) + "\n";
+  id(ast.id);
   if (!ast.arrays.empty()) {
-    ans += "Arrays:\n";
+    out.write("Arrays:\n");
     depth += 2;
     for (auto &i : ast.arrays) {
-      ans += visit(*i);
+      visit(*i);
     }
     depth -= 2;
   }
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(NumberAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "number:";
-  if (ast.isInt)
-    ans += std::to_string(ast.intval) + "\n";
+void Printer::visit(NumberAST &ast) {
+  number(ast.isInt, ast.intval, ast.floatval);
+}
+
+template <typename F>
+void FlatPrinter::each(uint32_t first, uint32_t count, F visit) {
+  for (uint32_t k = 0; k < count; k++) visit(f.lists[first + k]);
+}
+
+void FlatPrinter::compUnit() {
+  line("CompUnit:\n");
+  depth += 2;
+  for (uint32_t i = 0; i < f.declDefs.size(); i++) declDef(i);
+  depth -= 2;
+}
+
+void FlatPrinter::declDef(uint32_t i) {
+  const FlatAST::DeclDef &rec = f.declDefs[i];
+  if (rec.isFunc)
+    funcDef(rec.node);
   else
-    ans += std::to_string(ast.floatval) + "\n";
-  return ans;
+    decl(rec.node);
 }
 
-std::string Printer::visit(RelExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "RelExp:\n";
+void FlatPrinter::decl(uint32_t i) {
+  const FlatAST::Decl &rec = f.decls[i];
+  line("Decl:\n");
   depth += 2;
-  if (ast.relExp != nullptr) {
-    ans += visit(*ast.relExp);
-    ans += strfmt("%*s", depth, "");
-    ans += "RelOP:";
-    if (ast.op == ROP_GTE)
-      ans += ">=\n";
-    else if (ast.op == ROP_LTE)
-      ans += "<=\n";
-    else if (ast.op == ROP_GT)
-      ans += ">\n";
-    else if (ast.op == ROP_LT)
-      ans += "<\n";
+  if (rec.isConst) line("const\n");
+  if (rec.bType == TYPE_INT)
+    line("BType:int\n");
+  else
+    line("BType:float\n");
+  each(rec.defs.first, rec.defs.count, [&](uint32_t d) { def(d); });
+  depth -= 2;
+}
+
+void FlatPrinter::def(uint32_t i) {
+  const FlatAST::Def &rec = f.defs[i];
+  line("Def:\n");
+  depth += 2;
+  id(rec.id);
+  if (rec.arrays.count > 0) {
+    line("Arrays:\n");
+    depth += 2;
+    each(rec.arrays.first, rec.arrays.count, [&](uint32_t e) { exp(e); });
+    depth -= 2;
   }
-  ans += visit(*ast.addExp);
+  if (rec.initVal != FlatAST::NONE) initVal(rec.initVal);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(EqExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "EqExp:\n";
+void FlatPrinter::initVal(uint32_t i) {
+  const FlatAST::InitVal &rec = f.initVals[i];
+  line("InitValAST:");
   depth += 2;
-  if (ast.eqExp != nullptr) {
-    ans += visit(*ast.eqExp);
-    ans += strfmt("%*s", depth, "");
-    ans += "EqOP:";
-    if (ast.op == EOP_EQ)
-      ans += "==\n";
-    else
-      ans += "!=\n";
+  if (rec.exp != FlatAST::NONE) {
+    out.put('\n');
+    exp(rec.exp);
+  } else if (rec.list.count > 0) {
+    out.put('\n');
+    line("InitValList:\n");
+    depth += 2;
+    each(rec.list.first, rec.list.count, [&](uint32_t v) { initVal(v); });
+    depth -= 2;
+  } else {
+    out.write("{}\n");
   }
-  ans += visit(*ast.relExp);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(LAndExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "LAndExp:\n";
+void FlatPrinter::funcDef(uint32_t i) {
+  const FlatAST::FuncDef &rec = f.funcDefs[i];
+  line("FuncDef:\n");
   depth += 2;
-  if (ast.lAndExp != nullptr) {
-    ans += visit(*ast.lAndExp);
-    ans += strfmt("%*s", depth, "");
-    ans += "AND_OP:&&";
+  if (rec.funcType == TYPE_VOID)
+    line("funcType:void\n");
+  else if (rec.funcType == TYPE_INT)
+    line("funcType:int\n");
+  else
+    line("funcType:float\n");
+  id(rec.id);
+  if (rec.params.count > 0) {
+    line("FuncFParamList:\n");
+    depth += 2;
+    each(rec.params.first, rec.params.count, [&](uint32_t p) { param(p); });
+    depth -= 2;
   }
-  ans += visit(*ast.eqExp);
+  block(rec.block);
   depth -= 2;
-  return ans;
 }
 
-std::string Printer::visit(LOrExpAST &ast) {
-  std::string ans = strfmt("%*s", depth, "");
-  ans += "LOrExp:\n";
+void FlatPrinter::param(uint32_t i) {
+  const FlatAST::FuncFParam &rec = f.params[i];
+  line("FuncFParam:\n");
   depth += 2;
-  if (ast.lOrExp != nullptr) {
-    ans += visit(*ast.lOrExp);
-    ans += strfmt("%*s", depth, "");
-    ans += "OR_OP:||";
+  if (rec.bType == TYPE_INT)
+    line("BType:int\n");
+  else
+    line("BType:float\n");
+  id(rec.id);
+  if (rec.isArray) line("Array:[]\n");
+  if (rec.arrays.count > 0) {
+    line("Arrays:\n");
+    depth += 2;
+    each(rec.arrays.first, rec.arrays.count, [&](uint32_t e) { exp(e); });
+    depth -= 2;
+  }
+  depth -= 2;
+}
+
+void FlatPrinter::block(uint32_t i) {
+  const FlatAST::Range &items = f.blocks[i].items;
+  line("Block:\n");
+  depth += 2;
+  if (items.count > 0) {
+    line("BlockItemList:\n");
+    depth += 2;
+    each(items.first, items.count, [&](uint32_t b) {
+      const FlatAST::BlockItem &item = f.blockItems[b];
+      if (item.isDecl)
+        decl(item.node);
+      else
+        stmt(item.node);
+    });
+    depth -= 2;
+  }
+  depth -= 2;
+}
+
+void FlatPrinter::stmt(uint32_t i) {
+  const FlatAST::Stmt &rec = f.stmts[i];
+  line("Stmt:");
+  switch (rec.sType) {
+    case SEMI:
+      out.write("semicolon\n");
+      return;
+    case CONT:
+      out.write("continue\n");
+      return;
+    case BRE:
+      out.write("break\n");
+      return;
+    default:
+      break;
+  }
+  out.put('\n');
+  depth += 2;
+  switch (rec.sType) {
+    case ASS:
+      lVal(rec.a);
+      exp(rec.b);
+      break;
+    case EXP:
+      exp(rec.a);
+      break;
+    case RET:
+      line("return:");
+      if (rec.a == FlatAST::NONE) {
+        out.write("void\n");
+      } else {
+        out.put('\n');
+        depth += 2;
+        exp(rec.a);
+        depth -= 2;
+      }
+      break;
+    case BLK:
+      block(rec.a);
+      break;
+    case SELECT:
+      line("SelectStmt:\n");
+      depth += 2;
+      exp(rec.a, L_LOR, f.exps[rec.a].parens);
+      stmt(rec.b);
+      if (rec.c != FlatAST::NONE) stmt(rec.c);
+      depth -= 2;
+      break;
+    case ITER:
+      line("IterationStmt:\n");
+      depth += 2;
+      exp(rec.a, L_LOR, f.exps[rec.a].parens);
+      stmt(rec.b);
+      depth -= 2;
+      break;
+    default:
+      break;
+  }
+  depth -= 2;
+}
+
+void FlatPrinter::exp(uint32_t i) { exp(i, L_ADD, f.exps[i].parens); }
+
+void FlatPrinter::exp(uint32_t i, int level, uint32_t parens) {
+  const FlatAST::Exp &rec = f.exps[i];
+  this->level(level);
+  depth += 2;
+  if (level == L_PRIMARY) {
+    if (parens > 0) {
+      exp(i, L_ADD, parens - 1);
+    } else if (rec.kind == EXP_LVAL) {
+      lVal(i);
+    } else if (rec.kind == EXP_NUMBER) {
+      int intval;
+      float floatval;
+      memcpy(&intval, &rec.a, sizeof(intval));
+      memcpy(&floatval, &rec.a, sizeof(floatval));
+      number(rec.isInt, intval, floatval);
+    } else {
+      exp(i, L_LOR, 0);
+    }
+  } else if (level == L_UNARY) {
+    if (parens == 0 && rec.kind == EXP_CALL) {
+      call(i);
+    } else if (parens == 0 && rec.kind == EXP_UNARY) {
+      unaryOp(static_cast<UOP>(rec.op));
+      exp(rec.a, L_UNARY, f.exps[rec.a].parens);
+    } else {
+      exp(i, L_PRIMARY, parens);
+    }
+  } else if (parens == 0 && rec.kind == EXP_BINARY &&
+             opLevel(static_cast<BOP>(rec.op)) == level) {
+    exp(rec.a, level, f.exps[rec.a].parens);
+    binaryOp(static_cast<BOP>(rec.op));
+    exp(rec.b, level + 1, f.exps[rec.b].parens);
+  } else {
+    exp(i, level + 1, parens);
+  }
+  depth -= 2;
+}
+
+void FlatPrinter::call(uint32_t i) {
+  const FlatAST::Exp &rec = f.exps[i];
+  line("Call:\n");
+  depth += 2;
+  id(rec.a);
+  if (rec.list.count > 0) {
+    line("FuncCParamList:");
+    integer(rec.list.count);
+    out.put('\n');
+    depth += 2;
+    each(rec.list.first, rec.list.count, [&](uint32_t e) { exp(e); });
+    depth -= 2;
+  }
+  depth -= 2;
+}
+
+void FlatPrinter::lVal(uint32_t i) {
+  const FlatAST::Exp &rec = f.exps[i];
+  line("LVal:\n");
+  depth += 2;
+  id(rec.a);
+  if (rec.list.count > 0) {
+    out.write("Arrays:\n");
+    depth += 2;
+    each(rec.list.first, rec.list.count, [&](uint32_t e) { exp(e); });
+    depth -= 2;
   }
-  ans += visit(*ast.lAndExp);
   depth -= 2;
-  return ans;
 }
@@ -1,32 +1,101 @@
 #pragma once
 #include "ast.h"
+#include "out_buffer.h"
 
-class Printer {
+class FlatAST;
+
+// 两种 Printer 共用的缩进、叶子和运算符的输出
+class PrinterBase {
  public:
+  explicit PrinterBase(OutBuffer &out) : out(out) {}
+  // 表达式的兼容视图：按原语法的 LOrExp ... PrimaryExp 层次还原包装节点
+  enum Level {
+    L_LOR, L_LAND, L_EQ, L_REL, L_ADD, L_MUL, L_UNARY, L_PRIMARY
+  };
   int depth = 0;
-  std::string visit(CompUnitAST &ast);
-  std::string visit(DeclDefAST &ast);
-  std::string visit(DeclAST &ast);
-  std::string visit(DefAST &ast);
-  std::string visit(InitValAST &ast);
-  std::string visit(FuncDefAST &ast);
-  std::string visit(FuncFParamAST &ast);
-  std::string visit(BlockAST &ast);
-  std::string visit(BlockItemAST &ast);
-  std::string visit(StmtAST &ast);
-  std::string visit(ReturnStmtAST &ast);
-  std::string visit(SelectStmtAST &ast);
-  std::string visit(IterationStmtAST &ast);
-  std::string visit(AddExpAST &ast);
-  std::string visit(LValAST &ast);
-  std::string visit(MulExpAST &ast);
-  std::string visit(UnaryExpAST &ast);
-  std::string visit(PrimaryExpAST &ast);
-  std::string visit(CallAST &ast);
-  std::string visit(NumberAST &ast);
-  std::string visit(RelExpAST &ast);
-  std::string visit(EqExpAST &ast);
-  std::string visit(LAndExpAST &ast);
-  std::string visit(LOrExpAST &ast);
+
+ protected:
+  // 缩进到当前深度后输出 s
+  void line(std::string_view s) {
+    out.indent(depth);
+    out.write(s);
+  }
+  void level(int level) { line(LEVEL_NAMES[level]); }
+  void id(Symbol sym);
+  void integer(long long val);
+  void number(bool isInt, int intval, float floatval);
+  void unaryOp(UOP op);
+  void binaryOp(BOP op);
+  static Level opLevel(BOP op);
+
+  static const char *const LEVEL_NAMES[];
+  OutBuffer &out;
+};
+
+// 把 AST 直接流式写入 OutBuffer，不再为每棵子树拼接临时字符串
+class Printer : public PrinterBase {
+ public:
+  explicit Printer(OutBuffer &out) : PrinterBase(out) {}
+  void visit(CompUnitAST &ast);
+  void visit(DeclDefAST &ast);
+  void visit(DeclAST &ast);
+  void visit(DefAST &ast);
+  void visit(InitValAST &ast);
+  void visit(FuncDefAST &ast);
+  void visit(FuncFParamAST &ast);
+  void visit(BlockAST &ast);
+  void visit(BlockItemAST &ast);
+  void visit(StmtAST &ast);
+  void visit(ReturnStmtAST &ast);
+  void visit(SelectStmtAST &ast);
+  void visit(IterationStmtAST &ast);
+  // 表达式按 Exp（AddExp）层次输出
+  void visit(ExpAST &ast);
+  void visit(LValAST &ast);
+  void visit(CallAST &ast);
+  void visit(NumberAST &ast);
+
+ private:
+  void exp(ExpAST &ast, int level, int parens);
 };
 
+// 直接按下标遍历 FlatAST 的各个数组输出，不还原指针树，
+// 内容与 Printer 逐字节相同。参数都是对应数组的下标
+class FlatPrinter : public PrinterBase {
+ public:
+  FlatPrinter(const FlatAST &f, OutBuffer &out) : PrinterBase(out), f(f) {}
+  void compUnit();
+  void declDef(uint32_t i);
+  void decl(uint32_t i);
+  void def(uint32_t i);
+  void initVal(uint32_t i);
+  void funcDef(uint32_t i);
+  void param(uint32_t i);
+  void block(uint32_t i);
+  void stmt(uint32_t i);
+  // 表达式按 Exp（AddExp）层次输出
+  void exp(uint32_t i);
+
+ private:
+  void exp(uint32_t i, int level, uint32_t parens);
+  void lVal(uint32_t i);
+  void call(uint32_t i);
+  // 输出 lists 中 first 开始的 count 个下标对应的节点
+  template <typename F>
+  void each(uint32_t first, uint32_t count, F visit);
+
+  const FlatAST &f;
+};
+
+// 整棵树输出到内存字符串，与流式输出内容相同
+std::string printAST(CompUnitAST &ast);
+
+class ThreadPool;
+
+// 并行输出：DeclDefAST 按顺序分成若干段，各段在 pool 上从深度 2 开始写进
+// 各自的内存缓冲区，再和开头的 "CompUnit:\n" 一起按顺序用一次
+// OutBuffer::writev 写出，内容与串行的 Printer 逐字节相同
+// （输出期间整份文本都在内存中）
+void printASTParallel(CompUnitAST &ast, ThreadPool &pool, OutBuffer &out);
+// 同上，直接从 FlatAST 输出
+void printASTParallel(const FlatAST &f, ThreadPool &pool, OutBuffer &out);
@@ -0,0 +1,439 @@
+#include "rd_parser.h"
+
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+#include "parse_context.h"
+#include "parser.tab.hpp"
+
+namespace {
+
+// 二元运算符的优先级，与 Cond -> LOrExp -> ... -> MulExp 的层次对应，
+// 0 表示不是二元运算符。Exp 只到 AddExp，即优先级不低于 kAddPrec
+const int kAddPrec = 5;
+
+int precedence(int code) {
+  switch (code) {
+    case OR: return 1;
+    case AND: return 2;
+    case EQ: case NEQ: return 3;
+    case GTE: case LTE: case GT: case LT: return 4;
+    case ADD: case MINUS: return 5;
+    case MUL: case DIV: case MOD: return 6;
+    default: return 0;
+  }
+}
+
+BOP binaryOp(int code) {
+  switch (code) {
+    case OR: return BOP_OR;
+    case AND: return BOP_AND;
+    case EQ: return BOP_EQ;
+    case NEQ: return BOP_NEQ;
+    case GTE: return BOP_GTE;
+    case LTE: return BOP_LTE;
+    case GT: return BOP_GT;
+    case LT: return BOP_LT;
+    case ADD: return BOP_ADD;
+    case MINUS: return BOP_MINUS;
+    case MUL: return BOP_MUL;
+    case DIV: return BOP_DIV;
+    default: return BOP_MOD;
+  }
+}
+
+struct Token {
+  int code;
+  YYSTYPE val;
+  int line;
+};
+
+class Parser {
+ public:
+  Parser(ParseContext &ctx, yyscan_t scanner) : ctx(ctx), scanner(scanner) {}
+
+  CompUnitAST *compUnit() {
+    auto root = make<CompUnitAST>();
+    do {
+      DeclDefAST *declDef = this->declDef();
+      if (declDef == nullptr) return nullptr;
+      root->declDefList.push_back(declDef);
+    } while (peek().code != 0);
+    return root;
+  }
+
+ private:
+  template <typename T, typename... Args>
+  T *make(Args &&...args) {
+    return ctx.arena.make<T>(std::forward<Args>(args)...);
+  }
+
+  // 最多向前看 3 个 token（函数定义和声明要看到 "BType ID (" 才能区分）
+  Token &peek(int k = 0) {
+    while (count <= k) {
+      Token &token = ring[(head + count) & (kLookahead - 1)];
+      YYLTYPE loc;
+      loc.first_line = lastLine;
+      token.code = yylex(&token.val, &loc, scanner);
+      // 文件结束时扫描器不更新位置，bison 报告的是最后一个 token 的行号
+      token.line = lastLine = loc.first_line;
+      count++;
+    }
+    return ring[(head + k) & (kLookahead - 1)];
+  }
+
+  Token next() {
+    Token token = peek();
+    head = (head + 1) & (kLookahead - 1);
+    count--;
+    return token;
+  }
+
+  bool accept(int code) {
+    if (peek().code != code) return false;
+    next();
+    return true;
+  }
+
+  // 与 yyerror 的输出格式相同，expected 为空时不列出期望的 token
+  std::nullptr_t error(std::initializer_list<int> expected = {}) {
+    const Token &token = peek();
+    std::string msg = "syntax error, unexpected ";
+    msg += tokenName(token.code);
+    const char *sep = ", expecting ";
+    for (int code : expected) {
+      msg += sep;
+      msg += tokenName(code);
+      sep = " or ";
+    }
+    ctx.errors++;
+    printf("%s:%d %s\n", ctx.filename.c_str(), token.line, msg.c_str());
+    return nullptr;
+  }
+
+  bool expect(int code) {
+    if (accept(code)) return true;
+    error({code});
+    return false;
+  }
+
+  bool bType(TYPE &type) {
+    if (accept(INTTYPE)) {
+      type = TYPE_INT;
+      return true;
+    }
+    if (accept(FLOATTYPE)) {
+      type = TYPE_FLOAT;
+      return true;
+    }
+    error({INTTYPE, FLOATTYPE});
+    return false;
+  }
+
+  bool isBType(int code) { return code == INTTYPE || code == FLOATTYPE; }
+
+  DeclDefAST *declDef() {
+    int code = peek().code;
+    bool isFunc = code == VOID ||
+                  (isBType(code) && peek(1).code == ID && peek(2).code == LP);
+    auto declDef = make<DeclDefAST>();
+    if (isFunc) {
+      declDef->funcDef = funcDef();
+      if (declDef->funcDef == nullptr) return nullptr;
+    } else {
+      declDef->Decl = decl();
+      if (declDef->Decl == nullptr) return nullptr;
+    }
+    return declDef;
+  }
+
+  // Decl -> [CONST] BType Def {COMMA Def} SEMICOLON
+  DeclAST *decl() {
+    auto decl = make<DeclAST>();
+    decl->isConst = accept(CONST);
+    if (!bType(decl->bType)) return nullptr;
+    do {
+      DefAST *def = this->def();
+      if (def == nullptr) return nullptr;
+      decl->defList.push_back(def);
+    } while (accept(COMMA));
+    if (!expect(SEMICOLON)) return nullptr;
+    return decl;
+  }
+
+  // Def -> ID {LB Exp RB} [ASSIGN InitVal]
+  DefAST *def() {
+    if (peek().code != ID) return error({ID});
+    auto def = make<DefAST>();
+    def->id = next().val.token;
+    if (!arrays(def->arrays)) return nullptr;
+    if (accept(ASSIGN)) {
+      def->initVal = initVal();
+      if (def->initVal == nullptr) return nullptr;
+    }
+    return def;
+  }
+
+  // {LB Exp RB}，直接追加到节点自己的数组里
+  bool arrays(std::vector<ExpAST *> &list) {
+    while (accept(LB)) {
+      ExpAST *exp = this->exp();
+      if (exp == nullptr || !expect(RB)) return false;
+      list.push_back(exp);
+    }
+    return true;
+  }
+
+  // InitVal -> Exp | LC [InitVal {COMMA InitVal}] RC
+  InitValAST *initVal() {
+    auto initVal = make<InitValAST>();
+    if (!accept(LC)) {
+      initVal->exp = exp();
+      return initVal->exp != nullptr ? initVal : nullptr;
+    }
+    if (accept(RC)) return initVal;
+    do {
+      InitValAST *item = this->initVal();
+      if (item == nullptr) return nullptr;
+      initVal->initValList.push_back(item);
+    } while (accept(COMMA));
+    if (!expect(RC)) return nullptr;
+    return initVal;
+  }
+
+  // FuncDef -> (BType | VOID) ID LP [FuncFParam {COMMA FuncFParam}] RP Block
+  FuncDefAST *funcDef() {
+    auto funcDef = make<FuncDefAST>();
+    if (accept(VOID))
+      funcDef->funcType = TYPE_VOID;
+    else if (!bType(funcDef->funcType))
+      return nullptr;
+    if (peek().code != ID) return error({ID});
+    funcDef->id = next().val.token;
+    if (!expect(LP)) return nullptr;
+    if (!accept(RP)) {
+      if (!isBType(peek().code)) return error({INTTYPE, FLOATTYPE, RP});
+      do {
+        FuncFParamAST *param = funcFParam();
+        if (param == nullptr) return nullptr;
+        funcDef->funcFParamList.push_back(param);
+      } while (accept(COMMA));
+      if (!expect(RP)) return nullptr;
+    }
+    if (peek().code != LC) return error({LC});
+    funcDef->block = block();
+    return funcDef->block != nullptr ? funcDef : nullptr;
+  }
+
+  // FuncFParam -> BType ID [LB RB {LB Exp RB}]
+  FuncFParamAST *funcFParam() {
+    auto param = make<FuncFParamAST>();
+    if (!bType(param->bType)) return nullptr;
+    if (peek().code != ID) return error({ID});
+    param->id = next().val.token;
+    if (accept(LB)) {
+      if (!expect(RB)) return nullptr;
+      param->isArray = true;
+      if (!arrays(param->arrays)) return nullptr;
+    }
+    return param;
+  }
+
+  // Block -> LC {Decl | Stmt} RC，调用者已确认当前是 LC
+  BlockAST *block() {
+    next();
+    auto block = make<BlockAST>();
+    while (!accept(RC)) {
+      auto item = make<BlockItemAST>();
+      int code = peek().code;
+      if (code == CONST || isBType(code)) {
+        item->decl = decl();
+        if (item->decl == nullptr) return nullptr;
+      } else {
+        item->stmt = stmt();
+        if (item->stmt == nullptr) return nullptr;
+      }
+      block->blockItemList.push_back(item);
+    }
+    return block;
+  }
+
+  StmtAST *stmt() {
+    auto stmt = make<StmtAST>();
+    switch (peek().code) {
+      case SEMICOLON:
+        next();
+        stmt->sType = STYPE::SEMI;
+        return stmt;
+      case LC:
+        stmt->sType = STYPE::BLK;
+        stmt->block = block();
+        return stmt->block != nullptr ? stmt : nullptr;
+      case IF:
+        stmt->sType = STYPE::SELECT;
+        stmt->selectStmt = selectStmt();
+        return stmt->selectStmt != nullptr ? stmt : nullptr;
+      case WHILE:
+        stmt->sType = STYPE::ITER;
+        stmt->iterationStmt = iterationStmt();
+        return stmt->iterationStmt != nullptr ? stmt : nullptr;
+      case BREAK:
+      case CONTINUE:
+        stmt->sType = next().code == BREAK ? STYPE::BRE : STYPE::CONT;
+        return expect(SEMICOLON) ? stmt : nullptr;
+      case RETURN:
+        next();
+        stmt->sType = STYPE::RET;
+        stmt->returnStmt = make<ReturnStmtAST>();
+        if (accept(SEMICOLON)) return stmt;
+        stmt->returnStmt->exp = exp();
+        if (stmt->returnStmt->exp == nullptr || !expect(SEMICOLON))
+          return nullptr;
+        return stmt;
+      case ID:
+        // "ID (" 是调用，否则先读出左值：后面是 ASSIGN 就是赋值语句，
+        // 不是的话它就是表达式语句中第一个运算数
+        if (peek(1).code != LP) {
+          LValAST *lVal = this->lVal();
+          if (lVal == nullptr) return nullptr;
+          if (accept(ASSIGN)) {
+            stmt->sType = STYPE::ASS;
+            stmt->lVal = lVal;
+            stmt->exp = exp();
+          } else {
+            stmt->sType = STYPE::EXP;
+            stmt->exp = binary(lVal, kAddPrec);
+          }
+          if (stmt->exp == nullptr || !expect(SEMICOLON)) return nullptr;
+          return stmt;
+        }
+        break;
+      default:
+        break;
+    }
+    stmt->sType = STYPE::EXP;
+    stmt->exp = exp();
+    if (stmt->exp == nullptr || !expect(SEMICOLON)) return nullptr;
+    return stmt;
+  }
+
+  // IF LP Cond RP Stmt [ELSE Stmt]，ELSE 与最近的 IF 结合
+  SelectStmtAST *selectStmt() {
+    next();
+    auto select = make<SelectStmtAST>();
+    if (!expect(LP) || (select->cond = cond()) == nullptr || !expect(RP))
+      return nullptr;
+    if ((select->ifStmt = stmt()) == nullptr) return nullptr;
+    if (accept(ELSE) && (select->elseStmt = stmt()) == nullptr) return nullptr;
+    return select;
+  }
+
+  IterationStmtAST *iterationStmt() {
+    next();
+    auto iter = make<IterationStmtAST>();
+    if (!expect(LP) || (iter->cond = cond()) == nullptr || !expect(RP))
+      return nullptr;
+    if ((iter->stmt = stmt()) == nullptr) return nullptr;
+    return iter;
+  }
+
+  ExpAST *exp() { return binary(unary(), kAddPrec); }
+  ExpAST *cond() { return binary(unary(), 1); }
+
+  // 优先级爬升：lhs 之后连续读入优先级不低于 minPrec 的运算符，
+  // 右侧运算数只吸收优先级更高的运算符，所以同级运算左结合
+  ExpAST *binary(ExpAST *lhs, int minPrec) {
+    if (lhs == nullptr) return nullptr;
+    for (;;) {
+      int code = peek().code;
+      int prec = precedence(code);
+      if (prec < minPrec || prec == 0) return lhs;
+      next();
+      ExpAST *rhs = binary(unary(), prec + 1);
+      if (rhs == nullptr) return nullptr;
+      lhs = make<BinaryExpAST>(binaryOp(code), lhs, rhs);
+    }
+  }
+
+  // UnaryExp -> (ADD | MINUS | NOT) UnaryExp | PrimaryExp | Call
+  ExpAST *unary() {
+    UOP op;
+    switch (peek().code) {
+      case ADD: op = UOP_ADD; break;
+      case MINUS: op = UOP_MINUS; break;
+      case NOT: op = UOP_NOT; break;
+      default: return primary();
+    }
+    next();
+    ExpAST *exp = unary();
+    if (exp == nullptr) return nullptr;
+    return make<UnaryExpAST>(op, exp);
+  }
+
+  ExpAST *primary() {
+    switch (peek().code) {
+      case LP: {
+        next();
+        ExpAST *exp = this->exp();
+        if (exp == nullptr || !expect(RP)) return nullptr;
+        exp->parens++;
+        return exp;
+      }
+      case INT: {
+        auto number = make<NumberAST>();
+        number->isInt = true;
+        number->intval = next().val.int_val;
+        return number;
+      }
+      case FLOAT: {
+        auto number = make<NumberAST>();
+        number->isInt = false;
+        number->floatval = next().val.float_val;
+        return number;
+      }
+      case ID:
+        if (peek(1).code == LP) return call();
+        return lVal();
+      default:
+        return error();
+    }
+  }
+
+  // LVal -> ID {LB Exp RB}
+  LValAST *lVal() {
+    auto lVal = make<LValAST>();
+    lVal->id = next().val.token;
+    return arrays(lVal->arrays) ? lVal : nullptr;
+  }
+
+  // Call -> ID LP [Exp {COMMA Exp}] RP
+  CallAST *call() {
+    auto call = make<CallAST>();
+    call->id = next().val.token;
+    next();
+    if (accept(RP)) return call;
+    do {
+      ExpAST *arg = exp();
+      if (arg == nullptr) return nullptr;
+      call->funcCParamList.push_back(arg);
+    } while (accept(COMMA));
+    return expect(RP) ? call : nullptr;
+  }
+
+  static const int kLookahead = 4;  // 环形缓冲区，取 2 的幂
+
+  ParseContext &ctx;
+  yyscan_t scanner;
+  Token ring[kLookahead];
+  int head = 0;
+  int count = 0;
+  int lastLine = 1;
+};
+
+}  // namespace
+
+CompUnitAST *parseRecursiveDescent(ParseContext &ctx, yyscan_t scanner) {
+  return Parser(ctx, scanner).compUnit();
+}
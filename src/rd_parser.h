@@ -0,0 +1,13 @@
+#pragma once
+
+#include "ast.h"
+
+typedef void *yyscan_t;
+class ParseContext;
+
+// 手写的递归下降语法分析器，可代替 yyparse()：
+// 语句和声明按 parser.y 的产生式逐个展开，表达式用优先级爬升，
+// 每个运算数只在成为运算符的操作数时才建节点，不经过 bison 的值栈。
+// 接受的语言、构造的 CompUnitAST 和出错时的行号与 parser.y 一致
+// （报错信息中的期望 token 可能列得比 bison 少），遇到第一个错误即停止
+CompUnitAST *parseRecursiveDescent(ParseContext &ctx, yyscan_t scanner);
@@ -0,0 +1,321 @@
+#include "sema.h"
+
+#include <cstdio>
+
+namespace {
+
+std::string quoted(Symbol id) { return "'" + std::string(interner.name(id)) + "'"; }
+
+// 运行时库函数的原型，参数类型后带 [] 表示数组参数
+struct Builtin {
+  TYPE ret;
+  const char *name;
+  std::vector<std::pair<TYPE, bool>> params;
+};
+
+const Builtin BUILTINS[] = {
+    {TYPE_INT, "getint", {}},
+    {TYPE_INT, "getch", {}},
+    {TYPE_FLOAT, "getfloat", {}},
+    {TYPE_INT, "getarray", {{TYPE_INT, true}}},
+    {TYPE_INT, "getfarray", {{TYPE_FLOAT, true}}},
+    {TYPE_VOID, "putint", {{TYPE_INT, false}}},
+    {TYPE_VOID, "putch", {{TYPE_INT, false}}},
+    {TYPE_VOID, "putfloat", {{TYPE_FLOAT, false}}},
+    {TYPE_VOID, "putarray", {{TYPE_INT, false}, {TYPE_INT, true}}},
+    {TYPE_VOID, "putfarray", {{TYPE_INT, false}, {TYPE_FLOAT, true}}},
+    {TYPE_VOID, "starttime", {}},
+    {TYPE_VOID, "stoptime", {}},
+};
+
+int rankOf(const FuncFParamAST &param) {
+  return param.isArray ? param.arrays.size() + 1 : 0;
+}
+
+}  // namespace
+
+Sema::Sema(Arena &arena, std::string filename)
+    : filename(std::move(filename)) {
+  declareBuiltins(arena);
+}
+
+void Sema::declareBuiltins(Arena &arena) {
+  scope.enterScope();
+  for (const Builtin &builtin : BUILTINS) {
+    FuncDefAST *func = arena.make<FuncDefAST>();
+    func->funcType = builtin.ret;
+    func->id = interner.intern(builtin.name);
+    for (auto &type : builtin.params) {
+      FuncFParamAST *param = arena.make<FuncFParamAST>();
+      param->bType = type.first;
+      param->id = interner.intern("");
+      param->isArray = type.second;
+      func->funcFParamList.push_back(param);
+    }
+    Entry entry;
+    entry.func = func;
+    scope.bind(func->id, entry);
+  }
+}
+
+void Sema::declare(Symbol id, const Entry &entry) {
+  if (!scope.bind(id, entry)) error("redefinition of " + quoted(id));
+}
+
+void Sema::scalar(ExpAST *exp, const char *what) {
+  exp->accept(*this);
+  if (exp->type == TYPE_VOID)
+    error(std::string(what) + " has type void");
+  else if (exp->kind == EXP_LVAL && static_cast<LValAST *>(exp)->rank != 0)
+    error(std::string(what) + " is an array");
+}
+
+void Sema::error(const std::string &msg) {
+  errors++;
+  printf("%s: %s\n", filename.c_str(), msg.c_str());
+}
+
+void Sema::visit(CompUnitAST &ast) {
+  scope.enterScope();
+  for (auto declDef : ast.declDefList) declDef->accept(*this);
+  scope.exitScope();
+}
+
+void Sema::visit(DeclDefAST &ast) {
+  if (ast.Decl != nullptr) ast.Decl->accept(*this);
+  if (ast.funcDef != nullptr) ast.funcDef->accept(*this);
+}
+
+void Sema::visit(DeclAST &ast) {
+  declType = ast.bType;
+  declConst = ast.isConst;
+  for (auto def : ast.defList) def->accept(*this);
+}
+
+void Sema::visit(DefAST &ast) {
+  ast.bType = declType;
+  ast.isConst = declConst;
+  ast.isGlobal = global;
+  for (auto exp : ast.arrays) {
+    scalar(exp, "array size");
+    if (exp->type == TYPE_FLOAT)
+      error("size of array " + quoted(ast.id) + " has type float");
+  }
+  if (ast.initVal != nullptr) {
+    if (ast.arrays.empty() && ast.initVal->exp == nullptr)
+      error("scalar " + quoted(ast.id) + " initialized with a list");
+    else if (!ast.arrays.empty() && ast.initVal->exp != nullptr)
+      error("array " + quoted(ast.id) + " must be initialized with a list");
+    ast.initVal->accept(*this);
+  } else if (declConst) {
+    error("const " + quoted(ast.id) + " is not initialized");
+  }
+  // 名字在初值之后才可见
+  Entry entry;
+  entry.def = &ast;
+  declare(ast.id, entry);
+}
+
+void Sema::visit(InitValAST &ast) {
+  if (ast.exp != nullptr) scalar(ast.exp, "initializer");
+  for (auto initVal : ast.initValList) initVal->accept(*this);
+}
+
+void Sema::visit(FuncDefAST &ast) {
+  // 先声明函数本身，函数体内可以递归调用
+  Entry entry;
+  entry.func = &ast;
+  declare(ast.id, entry);
+  func = &ast;
+  global = false;
+  // 形参和函数体最外层的声明在同一个作用域
+  scope.enterScope();
+  for (auto param : ast.funcFParamList) param->accept(*this);
+  if (ast.block != nullptr)
+    for (auto item : ast.block->blockItemList) item->accept(*this);
+  scope.exitScope();
+  global = true;
+  func = nullptr;
+}
+
+void Sema::visit(FuncFParamAST &ast) {
+  for (auto exp : ast.arrays) {
+    scalar(exp, "array size");
+    if (exp->type == TYPE_FLOAT)
+      error("size of array " + quoted(ast.id) + " has type float");
+  }
+  Entry entry;
+  entry.param = &ast;
+  declare(ast.id, entry);
+}
+
+void Sema::visit(BlockAST &ast) {
+  scope.enterScope();
+  for (auto item : ast.blockItemList) item->accept(*this);
+  scope.exitScope();
+}
+
+void Sema::visit(BlockItemAST &ast) {
+  if (ast.decl != nullptr) ast.decl->accept(*this);
+  if (ast.stmt != nullptr) ast.stmt->accept(*this);
+}
+
+void Sema::visit(StmtAST &ast) {
+  switch (ast.sType) {
+    case ASS:
+      ast.lVal->accept(*this);
+      if (ast.lVal->rank != 0)
+        error("assignment to array " + quoted(ast.lVal->id));
+      else if (ast.lVal->def != nullptr && ast.lVal->def->isConst)
+        error("assignment of read-only variable " + quoted(ast.lVal->id));
+      scalar(ast.exp, "assigned value");
+      break;
+    case EXP:
+      ast.exp->accept(*this);
+      break;
+    case CONT:
+      if (loops == 0) error("continue statement not within a loop");
+      break;
+    case BRE:
+      if (loops == 0) error("break statement not within a loop");
+      break;
+    case RET:
+      ast.returnStmt->accept(*this);
+      break;
+    case BLK:
+      ast.block->accept(*this);
+      break;
+    case SELECT:
+      ast.selectStmt->accept(*this);
+      break;
+    case ITER:
+      ast.iterationStmt->accept(*this);
+      break;
+    case SEMI:
+      break;
+  }
+}
+
+void Sema::visit(ReturnStmtAST &ast) {
+  if (ast.exp != nullptr) {
+    scalar(ast.exp, "return value");
+    if (func->funcType == TYPE_VOID)
+      error("return with a value in void function " + quoted(func->id));
+  } else if (func->funcType != TYPE_VOID) {
+    error("return without a value in function " + quoted(func->id));
+  }
+}
+
+void Sema::visit(SelectStmtAST &ast) {
+  scalar(ast.cond, "condition");
+  ast.ifStmt->accept(*this);
+  if (ast.elseStmt != nullptr) ast.elseStmt->accept(*this);
+}
+
+void Sema::visit(IterationStmtAST &ast) {
+  scalar(ast.cond, "condition");
+  loops++;
+  ast.stmt->accept(*this);
+  loops--;
+}
+
+void Sema::visit(BinaryExpAST &ast) {
+  scalar(ast.lhs, "operand");
+  scalar(ast.rhs, "operand");
+  switch (ast.op) {
+    case BOP_MOD:
+      if (ast.lhs->type == TYPE_FLOAT || ast.rhs->type == TYPE_FLOAT)
+        error("operands of % must be int");
+      ast.type = TYPE_INT;
+      break;
+    case BOP_MUL:
+    case BOP_DIV:
+    case BOP_ADD:
+    case BOP_MINUS:
+      // int 与 float 混合运算时 int 隐式转换为 float
+      ast.type = ast.lhs->type == TYPE_FLOAT || ast.rhs->type == TYPE_FLOAT
+                     ? TYPE_FLOAT
+                     : TYPE_INT;
+      break;
+    default:
+      ast.type = TYPE_INT;
+      break;
+  }
+}
+
+void Sema::visit(UnaryExpAST &ast) {
+  scalar(ast.exp, "operand");
+  ast.type = ast.op == UOP_NOT ? TYPE_INT : ast.exp->type;
+}
+
+void Sema::visit(LValAST &ast) {
+  // 出错时按 int 标量处理，避免连带报错
+  ast.type = TYPE_INT;
+  for (auto exp : ast.arrays) {
+    scalar(exp, "array subscript");
+    if (exp->type == TYPE_FLOAT) error("array subscript has type float");
+  }
+  const Entry *entry = scope.find(ast.id);
+  if (entry == nullptr || entry->func != nullptr) {
+    error(quoted(ast.id) + (entry == nullptr ? " was not declared"
+                                             : " is a function"));
+    return;
+  }
+  resolved++;
+  int rank;
+  if (entry->def != nullptr) {
+    ast.def = entry->def;
+    ast.type = entry->def->bType;
+    rank = entry->def->arrays.size();
+  } else {
+    ast.param = entry->param;
+    ast.type = entry->param->bType;
+    rank = rankOf(*entry->param);
+  }
+  ast.rank = rank - ast.arrays.size();
+  if (ast.rank < 0) {
+    error("subscripted value " + quoted(ast.id) + " is not an array");
+    ast.rank = 0;
+  }
+}
+
+void Sema::visit(NumberAST &ast) { ast.type = ast.isInt ? TYPE_INT : TYPE_FLOAT; }
+
+void Sema::visit(CallAST &ast) {
+  ast.type = TYPE_INT;
+  const Entry *entry = scope.find(ast.id);
+  if (entry == nullptr || entry->func == nullptr) {
+    error(quoted(ast.id) + (entry == nullptr ? " was not declared"
+                                             : " is not a function"));
+    for (auto arg : ast.funcCParamList) arg->accept(*this);
+    return;
+  }
+  resolved++;
+  ast.func = entry->func;
+  ast.type = ast.func->funcType;
+  auto &params = ast.func->funcFParamList;
+  if (params.size() != ast.funcCParamList.size()) {
+    error("function " + quoted(ast.id) + " expects " +
+          std::to_string(params.size()) + " argument(s), " +
+          std::to_string(ast.funcCParamList.size()) + " given");
+  }
+  for (size_t i = 0; i < ast.funcCParamList.size(); i++) {
+    ExpAST *arg = ast.funcCParamList[i];
+    if (i >= params.size()) {
+      arg->accept(*this);
+      continue;
+    }
+    const FuncFParamAST &param = *params[i];
+    if (!param.isArray) {
+      // 标量实参在 int 和 float 之间隐式转换
+      scalar(arg, "argument");
+      continue;
+    }
+    arg->accept(*this);
+    auto lVal = arg->kind == EXP_LVAL ? static_cast<LValAST *>(arg) : nullptr;
+    if (lVal == nullptr || lVal->rank != rankOf(param) ||
+        lVal->type != param.bType)
+      error("argument " + std::to_string(i + 1) + " of " + quoted(ast.id) +
+            " does not match the array parameter");
+  }
+}
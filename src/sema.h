@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+
+#include "arena.h"
+#include "ast.h"
+#include "symtab.h"
+
+// 语义分析：把 LValAST/CallAST 中的名字解析到 DefAST/FuncFParamAST/FuncDefAST，
+// 给每个表达式标上类型，并检查 int/float 混用、数组下标和维数、实参、
+// 给常量赋值、return 与函数类型、循环外的 break/continue 等错误。
+// 运行时库函数（getint、putarray 等）在最外层作用域预先声明
+class Sema : public Visitor {
+ public:
+  Sema(Arena &arena, std::string filename);
+
+  void visit(CompUnitAST &ast) override;
+  void visit(DeclDefAST &ast) override;
+  void visit(DeclAST &ast) override;
+  void visit(DefAST &ast) override;
+  void visit(InitValAST &ast) override;
+  void visit(FuncDefAST &ast) override;
+  void visit(FuncFParamAST &ast) override;
+  void visit(BlockAST &ast) override;
+  void visit(BlockItemAST &ast) override;
+  void visit(StmtAST &ast) override;
+  void visit(ReturnStmtAST &ast) override;
+  void visit(SelectStmtAST &ast) override;
+  void visit(IterationStmtAST &ast) override;
+  void visit(BinaryExpAST &ast) override;
+  void visit(UnaryExpAST &ast) override;
+  void visit(LValAST &ast) override;
+  void visit(NumberAST &ast) override;
+  void visit(CallAST &ast) override;
+
+  int errors = 0;
+  size_t resolved = 0;  // 解析到声明的名字引用数
+
+ private:
+  // 一个名字绑定到的声明，三者恰有一个非空
+  struct Entry {
+    DefAST *def = nullptr;
+    FuncFParamAST *param = nullptr;
+    FuncDefAST *func = nullptr;
+  };
+
+  void declareBuiltins(Arena &arena);
+  void declare(Symbol id, const Entry &entry);
+  // 检查一个只能是 int/float 标量的表达式
+  void scalar(ExpAST *exp, const char *what);
+  void error(const std::string &msg);
+
+  std::string filename;
+  ScopedTable<Entry> scope;
+  FuncDefAST *func = nullptr;  // 当前所在的函数
+  int loops = 0;               // 当前所在循环的层数
+  TYPE declType = TYPE_INT;
+  bool declConst = false;
+  bool global = true;
+};
@@ -0,0 +1,134 @@
+#include "cfg.h"
+#include "pass.h"
+
+namespace {
+
+// 条件是常量或两个目标相同的 CONDBR 改成 BR
+bool foldBranches(Function &func) {
+  bool changed = false;
+  for (uint32_t b = 0; b < func.blocks.size(); b++) {
+    Inst &term = func.terminator(b);
+    if (term.op != OP_CONDBR) continue;
+    uint32_t target = term.b;
+    if (term.b != term.c) {
+      if (!func.isConst(term.a)) continue;
+      bool taken = func.typeOf(term.a) == IR_F32 ? func.floatOf(term.a) != 0
+                                                 : func.intOf(term.a) != 0;
+      target = taken ? term.b : term.c;
+      removeIncoming(func, taken ? term.c : term.b, b);
+    }
+    term.op = OP_BR;
+    term.a = target;
+    term.b = term.c = 0;
+    changed = true;
+  }
+  return changed;
+}
+
+bool removeUnreachable(Function &func) {
+  CFG cfg(func);
+  if (cfg.rpo.size() == func.blocks.size()) return false;
+  std::vector<bool> dead(func.blocks.size());
+  for (uint32_t b = 0; b < func.blocks.size(); b++) dead[b] = !cfg.reachable(b);
+  removeBlocks(func, dead);
+  return true;
+}
+
+// 块的唯一前驱只有它这一个后继时，把它接到前驱末尾
+bool mergeBlocks(Function &func) {
+  CFG cfg(func);
+  std::vector<uint32_t> into(func.blocks.size());  // 块被并入了哪个块
+  for (uint32_t b = 0; b < into.size(); b++) into[b] = b;
+  auto find = [&](uint32_t b) {
+    while (into[b] != b) b = into[b];
+    return b;
+  };
+  std::vector<bool> dead(func.blocks.size(), false);
+  std::vector<Value> repl(func.insts.size(), NO_VALUE);
+  bool changed = false;
+  for (uint32_t b : cfg.rpo) {
+    if (b == 0 || cfg.preds[b].size() != 1) continue;
+    uint32_t p = find(cfg.preds[b][0]);
+    if (p == b) continue;
+    Inst &term = func.terminator(p);
+    if (term.op != OP_BR || term.a != b) continue;
+
+    term.op = OP_NOP;
+    auto &dst = func.blocks[p].insts;
+    dst.pop_back();
+    for (uint32_t index : func.blocks[b].insts) {
+      Inst &inst = func.insts[index];
+      if (inst.op == OP_PHI) {
+        // 只有一个前驱，PHI 就是那条入边的值
+        repl[index] = func.lists[inst.b];
+        inst.op = OP_NOP;
+        continue;
+      }
+      inst.block = p;
+      dst.push_back(index);
+    }
+    func.blocks[b].insts.clear();
+    // 后继块 PHI 的入边从 b 改成 p
+    for (uint32_t succ : cfg.succs[b]) {
+      for (uint32_t index : func.blocks[succ].insts) {
+        Inst &phi = func.insts[index];
+        if (phi.op != OP_PHI) break;
+        for (uint32_t i = 0; i < phi.c; i++)
+          if (func.lists[phi.b + 2 * i + 1] == b) func.lists[phi.b + 2 * i + 1] = p;
+      }
+    }
+    into[b] = p;
+    dead[b] = true;
+    changed = true;
+  }
+  if (!changed) return false;
+  substitute(func, repl);
+  removeBlocks(func, dead);
+  return true;
+}
+
+// 只有一条 BR 的块：让前驱直接跳到它的目标（目标块有 PHI 时不做）
+bool skipForwarders(Function &func) {
+  size_t n = func.blocks.size();
+  std::vector<uint32_t> forward(n, CFG::NONE);
+  for (uint32_t b = 1; b < n; b++) {
+    auto &insts = func.blocks[b].insts;
+    if (insts.size() == 1 && func.insts[insts[0]].op == OP_BR &&
+        func.insts[insts[0]].a != b)
+      forward[b] = func.insts[insts[0]].a;
+  }
+  // 沿转发链找最终目标；遇到环（空的死循环）时不转发
+  std::vector<uint32_t> final(n, CFG::NONE);
+  for (uint32_t b = 0; b < n; b++) {
+    if (forward[b] == CFG::NONE) continue;
+    uint32_t t = b;
+    size_t steps = 0;
+    while (forward[t] != CFG::NONE && steps++ <= n) t = forward[t];
+    if (forward[t] != CFG::NONE) continue;
+    if (func.insts[func.blocks[t].insts[0]].op == OP_PHI) continue;
+    final[b] = t;
+  }
+  bool changed = false;
+  for (uint32_t b = 0; b < n; b++) {
+    forEachSuccessor(func.terminator(b), [&](uint32_t &target) {
+      if (final[target] == CFG::NONE || final[target] == target) return;
+      target = final[target];
+      changed = true;
+    });
+  }
+  return changed;
+}
+
+}  // namespace
+
+bool simplifyCFG(Module &module, Function &func) {
+  bool changed = false;
+  for (bool again = true; again;) {
+    again = foldBranches(func);
+    again = removeUnreachable(func) || again;
+    again = mergeBlocks(func) || again;
+    again = skipForwarders(func) || again;
+    changed = changed || again;
+  }
+  return changed;
+}
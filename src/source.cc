@@ -0,0 +1,67 @@
+#include "source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+
+SourceFile::~SourceFile() {
+  if (mapLength != 0)
+    munmap(base, mapLength);
+  else
+    free(base);
+}
+
+bool SourceFile::open(const char *path, bool useMmap) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return false;
+  }
+
+  if (useMmap && S_ISREG(st.st_mode)) {
+    // 先保留一段匿名零页，再把文件映射到开头：
+    // 文件末页剩余部分和多出的页都是 0，末尾的 PADDING 个 '\0' 因此总是存在
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = st.st_size;
+    size_t len = (size + PADDING + page - 1) / page * page;
+    void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED &&
+        (size == 0 || mmap(p, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED)) {
+      madvise(p, len, MADV_SEQUENTIAL);
+      base = static_cast<char *>(p);
+      length = size;
+      mapLength = len;
+      close(fd);
+      return true;
+    }
+    if (p != MAP_FAILED) munmap(p, len);
+  }
+
+  size_t cap = S_ISREG(st.st_mode) ? st.st_size + PADDING : 64 * 1024;
+  base = static_cast<char *>(malloc(cap));
+  length = 0;
+  for (;;) {
+    if (length + PADDING >= cap) {
+      cap *= 2;
+      base = static_cast<char *>(realloc(base, cap));
+    }
+    ssize_t n = read(fd, base + length, cap - PADDING - length);
+    if (n < 0) {
+      close(fd);
+      return false;
+    }
+    if (n == 0) break;
+    length += n;
+  }
+  memset(base + length, 0, PADDING);
+  close(fd);
+  return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+// 源文件缓冲区：普通文件直接 mmap，词法分析器在映射上原地扫描。
+// flex 的 yy_scan_buffer 要求末尾有两个 '\0'，且扫描时会临时改写缓冲区，
+// 因此映射为可写的私有映射（写时复制，不会影响磁盘文件）。
+// 内容之后至少有 PADDING 个 '\0'，手写词法分析器的向量加载可以越过末尾
+class SourceFile {
+ public:
+  static const size_t PADDING = 64;
+
+  SourceFile() = default;
+  ~SourceFile();
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+
+  // useMmap 为 false 或文件不可映射（管道等）时退回到 read()
+  bool open(const char *path, bool useMmap = true);
+
+  char *data() const { return base; }
+  size_t size() const { return length; }
+  // 包含末尾两个 '\0' 的长度，直接交给 yy_scan_buffer
+  size_t bufferSize() const { return length + 2; }
+  bool mapped() const { return mapLength != 0; }
+
+ private:
+  char *base = nullptr;
+  size_t length = 0;
+  size_t mapLength = 0;
+};
@@ -0,0 +1,441 @@
+#include "stats.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+#include "flat_ast.h"
+
+static std::atomic<bool> countingAllocs{false};
+static std::atomic<uint64_t> numAllocs{0};
+static std::atomic<uint64_t> allocBytes{0};
+
+// 替换全局 operator new；new[] 和 nothrow 版本都会转调这里
+void *operator new(size_t size) {
+  if (countingAllocs.load(std::memory_order_relaxed)) {
+    numAllocs.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  void *p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+// 不内联，免得 GCC 在调用点把 new/delete 看成 malloc/free 而误报不匹配
+[[gnu::noinline]] void operator delete(void *p) noexcept { free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept { free(p); }
+
+void enableAllocCounting() { countingAllocs = true; }
+
+AllocCounts allocCounts() {
+  AllocCounts counts;
+  counts.count = numAllocs.load();
+  counts.bytes = allocBytes.load();
+  return counts;
+}
+
+// Linux 上 ru_maxrss 在 exec 之后保留父进程 fork 时的值，被脚本启动时
+// 会报出脚本自己的内存，所以优先读本进程地址空间的 VmHWM
+long peakRSS() {
+  if (FILE *status = fopen("/proc/self/status", "r")) {
+    char line[256];
+    long kb = 0;
+    while (fgets(line, sizeof(line), status) != nullptr)
+      if (sscanf(line, "VmHWM: %ld", &kb) == 1) break;
+    fclose(status);
+    if (kb > 0) return kb;
+  }
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_maxrss;
+}
+
+static double wallNow() {
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static const double processStart = wallNow();
+
+double processMs() { return wallNow() - processStart; }
+
+// 当前线程的 CPU 时间，批量模式下各线程互不干扰
+static double cpuNow() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+Stats::Timer::Timer(Stats *stats, const char *phase)
+    : stats(stats), phase(phase) {
+  if (stats == nullptr) return;
+  wall = wallNow();
+  cpu = cpuNow();
+}
+
+Stats::Timer::~Timer() {
+  if (stats == nullptr) return;
+  stats->addPhase(phase, wallNow() - wall, cpuNow() - cpu);
+}
+
+void Stats::addPhase(const char *name, double wallMs, double cpuMs) {
+  for (auto &phase : phases) {
+    if (phase.name == name) {
+      phase.wallMs += wallMs;
+      phase.cpuMs += cpuMs;
+      return;
+    }
+  }
+  phases.push_back({name, wallMs, cpuMs});
+}
+
+void Stats::addArena(const Arena &arena) {
+  arenaObjects += arena.numObjects;
+  arenaBlocks += arena.numBlocks;
+  arenaBytes += arena.bytesUsed;
+}
+
+void Stats::addPass(const char *name, double wallMs, size_t before,
+                    size_t after) {
+  passes.push_back({name, wallMs, before, after});
+}
+
+void Stats::merge(const Stats &other) {
+  files += other.files;
+  for (auto &phase : other.phases)
+    addPhase(phase.name.c_str(), phase.wallMs, phase.cpuMs);
+  for (size_t i = 0; i < other.passes.size(); i++) {
+    const Pass &pass = other.passes[i];
+    if (i >= passes.size() || passes[i].name != pass.name) {
+      passes.push_back(pass);
+      continue;
+    }
+    passes[i].wallMs += pass.wallMs;
+    passes[i].before += pass.before;
+    passes[i].after += pass.after;
+  }
+  for (auto &node : other.nodes) nodes[node.first] += node.second;
+  arenaObjects += other.arenaObjects;
+  arenaBlocks += other.arenaBlocks;
+  arenaBytes += other.arenaBytes;
+  foldedNodes += other.foldedNodes;
+  inlinedCalls += other.inlinedCalls;
+  tailCalls += other.tailCalls;
+  vmInstructions += other.vmInstructions;
+  jitCodeBytes += other.jitCodeBytes;
+  jitFirstInsnMs = std::max(jitFirstInsnMs, other.jitFirstInsnMs);
+  funcCacheHits += other.funcCacheHits;
+  funcCacheMisses += other.funcCacheMisses;
+}
+
+namespace {
+
+// 二元运算符在原语法中所属的层次
+const char *levelName(BOP op) {
+  switch (op) {
+    case BOP_MUL:
+    case BOP_DIV:
+    case BOP_MOD:
+      return "BinaryExpAST/MulExpAST";
+    case BOP_ADD:
+    case BOP_MINUS:
+      return "BinaryExpAST/AddExpAST";
+    case BOP_GTE:
+    case BOP_LTE:
+    case BOP_GT:
+    case BOP_LT:
+      return "BinaryExpAST/RelExpAST";
+    case BOP_EQ:
+    case BOP_NEQ:
+      return "BinaryExpAST/EqExpAST";
+    case BOP_AND:
+      return "BinaryExpAST/LAndExpAST";
+    case BOP_OR:
+      return "BinaryExpAST/LOrExpAST";
+  }
+  return "BinaryExpAST/?";
+}
+
+class NodeCounter : public Visitor {
+ public:
+  explicit NodeCounter(std::map<std::string, size_t> &nodes) : nodes(nodes) {}
+
+  void visit(CompUnitAST &ast) override {
+    nodes["CompUnitAST"]++;
+    for (auto declDef : ast.declDefList) declDef->accept(*this);
+  }
+  void visit(DeclDefAST &ast) override {
+    nodes["DeclDefAST"]++;
+    if (ast.Decl != nullptr) ast.Decl->accept(*this);
+    if (ast.funcDef != nullptr) ast.funcDef->accept(*this);
+  }
+  void visit(DeclAST &ast) override {
+    nodes["DeclAST"]++;
+    for (auto def : ast.defList) def->accept(*this);
+  }
+  void visit(DefAST &ast) override {
+    nodes["DefAST"]++;
+    exps(ast.arrays);
+    if (ast.initVal != nullptr) ast.initVal->accept(*this);
+  }
+  void visit(InitValAST &ast) override {
+    nodes["InitValAST"]++;
+    exp(ast.exp);
+    for (auto initVal : ast.initValList) initVal->accept(*this);
+  }
+  void visit(FuncDefAST &ast) override {
+    nodes["FuncDefAST"]++;
+    for (auto param : ast.funcFParamList) param->accept(*this);
+    if (ast.block != nullptr) ast.block->accept(*this);
+  }
+  void visit(FuncFParamAST &ast) override {
+    nodes["FuncFParamAST"]++;
+    exps(ast.arrays);
+  }
+  void visit(BlockAST &ast) override {
+    nodes["BlockAST"]++;
+    for (auto item : ast.blockItemList) item->accept(*this);
+  }
+  void visit(BlockItemAST &ast) override {
+    nodes["BlockItemAST"]++;
+    if (ast.decl != nullptr) ast.decl->accept(*this);
+    if (ast.stmt != nullptr) ast.stmt->accept(*this);
+  }
+  void visit(StmtAST &ast) override {
+    nodes["StmtAST"]++;
+    exp(ast.lVal);
+    exp(ast.exp);
+    if (ast.returnStmt != nullptr) ast.returnStmt->accept(*this);
+    if (ast.selectStmt != nullptr) ast.selectStmt->accept(*this);
+    if (ast.iterationStmt != nullptr) ast.iterationStmt->accept(*this);
+    if (ast.block != nullptr) ast.block->accept(*this);
+  }
+  void visit(ReturnStmtAST &ast) override {
+    nodes["ReturnStmtAST"]++;
+    exp(ast.exp);
+  }
+  void visit(SelectStmtAST &ast) override {
+    nodes["SelectStmtAST"]++;
+    exp(ast.cond);
+    if (ast.ifStmt != nullptr) ast.ifStmt->accept(*this);
+    if (ast.elseStmt != nullptr) ast.elseStmt->accept(*this);
+  }
+  void visit(IterationStmtAST &ast) override {
+    nodes["IterationStmtAST"]++;
+    exp(ast.cond);
+    if (ast.stmt != nullptr) ast.stmt->accept(*this);
+  }
+  void visit(BinaryExpAST &ast) override {
+    nodes["BinaryExpAST"]++;
+    nodes[levelName(ast.op)]++;
+    exp(ast.lhs);
+    exp(ast.rhs);
+  }
+  void visit(UnaryExpAST &ast) override {
+    nodes["UnaryExpAST"]++;
+    exp(ast.exp);
+  }
+  void visit(LValAST &ast) override {
+    nodes["LValAST"]++;
+    exps(ast.arrays);
+  }
+  void visit(NumberAST &ast) override { nodes["NumberAST"]++; }
+  void visit(CallAST &ast) override {
+    nodes["CallAST"]++;
+    exps(ast.funcCParamList);
+  }
+
+ private:
+  void exp(ExpAST *ast) {
+    if (ast != nullptr) ast->accept(*this);
+  }
+  void exps(const std::vector<ExpAST *> &list) {
+    for (auto ast : list) exp(ast);
+  }
+
+  std::map<std::string, size_t> &nodes;
+};
+
+// JSON 字符串转义，名字里只会出现可打印字符
+void quote(std::ostream &os, const std::string &s) {
+  os << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') os << '\\';
+    os << c;
+  }
+  os << '"';
+}
+
+}  // namespace
+
+void Stats::countNodes(CompUnitAST &root) {
+  NodeCounter counter(nodes);
+  root.accept(counter);
+}
+
+void Stats::countNodes(const FlatAST &f) {
+  // 与按树计数的结果相同：没有出现的类型不记
+  auto add = [&](const std::string &name, size_t n) {
+    if (n > 0) nodes[name] += n;
+  };
+  add("CompUnitAST", 1);
+  add("DeclDefAST", f.declDefs.size());
+  add("DeclAST", f.decls.size());
+  add("DefAST", f.defs.size());
+  add("InitValAST", f.initVals.size());
+  add("FuncDefAST", f.funcDefs.size());
+  add("FuncFParamAST", f.params.size());
+  add("BlockAST", f.blocks.size());
+  add("BlockItemAST", f.blockItems.size());
+  add("StmtAST", f.stmts.size());
+  for (auto &rec : f.stmts) {
+    if (rec.sType == RET) add("ReturnStmtAST", 1);
+    if (rec.sType == SELECT) add("SelectStmtAST", 1);
+    if (rec.sType == ITER) add("IterationStmtAST", 1);
+  }
+  static const char *const kinds[] = {"BinaryExpAST", "UnaryExpAST",
+                                      "NumberAST", "LValAST", "CallAST"};
+  for (auto &rec : f.exps) {
+    add(kinds[rec.kind], 1);
+    if (rec.kind == EXP_BINARY) add(levelName(static_cast<BOP>(rec.op)), 1);
+  }
+}
+
+void Stats::print(std::ostream &os, bool full) const {
+  double wall = 0, cpu = 0;
+  for (auto &phase : phases) {
+    wall += phase.wallMs;
+    cpu += phase.cpuMs;
+  }
+  std::ios::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(3);
+  os << "===== time report (" << files << " file" << (files == 1 ? "" : "s")
+     << ") =====\n";
+  os << std::left << std::setw(12) << "phase" << std::right << std::setw(12)
+     << "wall ms" << std::setw(12) << "cpu ms" << std::setw(8) << "%"
+     << "\n";
+  for (auto &phase : phases) {
+    os << std::left << std::setw(12) << phase.name << std::right
+       << std::setw(12) << phase.wallMs << std::setw(12) << phase.cpuMs
+       << std::setw(8) << std::setprecision(1)
+       << (wall > 0 ? phase.wallMs * 100 / wall : 0) << std::setprecision(3)
+       << "\n";
+  }
+  os << std::left << std::setw(12) << "total" << std::right << std::setw(12)
+     << wall << std::setw(12) << cpu << "\n";
+  os << "peak RSS: " << peakRSS() << " KB\n";
+  if (!passes.empty()) {
+    os << "===== passes =====\n";
+    os << std::left << std::setw(12) << "pass" << std::right << std::setw(12)
+       << "wall ms" << std::setw(12) << "insts" << std::setw(10) << "delta"
+       << "\n";
+    for (auto &pass : passes) {
+      os << std::left << std::setw(12) << pass.name << std::right
+         << std::setw(12) << pass.wallMs << std::setw(12) << pass.after
+         << std::setw(10)
+         << static_cast<long long>(pass.after) -
+                static_cast<long long>(pass.before)
+         << "\n";
+    }
+    for (auto &pass : passes) {
+      if (pass.name != "inline" || pass.before == 0) continue;
+      os << "inline: " << inlinedCalls << " call sites, code growth "
+         << std::setprecision(1)
+         << 100.0 * (static_cast<double>(pass.after) - pass.before) / pass.before
+         << "%" << std::setprecision(3) << "\n";
+    }
+    if (tailCalls > 0) os << "tre: " << tailCalls << " tail calls\n";
+  }
+  if (vmInstructions > 0) {
+    double runMs = 0;
+    for (auto &phase : phases)
+      if (phase.name == "run") runMs = phase.wallMs;
+    os << "vm: " << vmInstructions << " instructions, " << std::setprecision(1)
+       << (runMs > 0 ? vmInstructions / runMs / 1000 : 0)
+       << " M instructions/s\n"
+       << std::setprecision(3);
+  }
+  if (jitCodeBytes > 0)
+    os << "jit: " << jitCodeBytes << " bytes of code, first instruction at "
+       << jitFirstInsnMs << " ms\n";
+  if (funcCacheHits + funcCacheMisses > 0)
+    os << "func cache: " << funcCacheHits << " hits, " << funcCacheMisses
+       << " misses (" << std::setprecision(1)
+       << 100.0 * funcCacheHits / (funcCacheHits + funcCacheMisses)
+       << "% hit)\n" << std::setprecision(3);
+  if (full) {
+    AllocCounts allocs = allocCounts();
+    os << "heap: " << allocs.count << " allocations, " << allocs.bytes
+       << " bytes\n";
+    os << "arena: " << arenaObjects << " objects, " << arenaBlocks
+       << " blocks, " << arenaBytes << " bytes\n";
+    os << "===== AST nodes =====\n";
+    size_t total = 0;
+    for (auto &node : nodes) {
+      bool level = node.first.find('/') != std::string::npos;
+      if (!level) total += node.second;
+      os << std::left << std::setw(28)
+         << (level ? "  " + node.first.substr(node.first.find('/') + 1)
+                   : node.first)
+         << std::right << std::setw(10) << node.second << "\n";
+    }
+    os << std::left << std::setw(28) << "total" << std::right << std::setw(10)
+       << total << "\n";
+    if (foldedNodes > 0)
+      os << "constant folding removed " << foldedNodes << " nodes\n";
+  }
+  os.flags(flags);
+}
+
+void Stats::printJSON(std::ostream &os) const {
+  AllocCounts allocs = allocCounts();
+  os << "{\n  \"files\": " << files << ",\n  \"phases\": {";
+  const char *sep = "\n";
+  for (auto &phase : phases) {
+    os << sep << "    ";
+    quote(os, phase.name);
+    os << ": {\"wall_ms\": " << phase.wallMs << ", \"cpu_ms\": " << phase.cpuMs
+       << "}";
+    sep = ",\n";
+  }
+  os << "\n  },\n  \"peak_rss_kb\": " << peakRSS()
+     << ",\n  \"heap\": {\"allocations\": " << allocs.count
+     << ", \"bytes\": " << allocs.bytes << "},\n  \"arena\": {\"objects\": "
+     << arenaObjects << ", \"blocks\": " << arenaBlocks
+     << ", \"bytes\": " << arenaBytes << "},\n  \"folded_nodes\": "
+     << foldedNodes << ",\n  \"vm_instructions\": " << vmInstructions
+     << ",\n  \"inlined_calls\": " << inlinedCalls
+     << ",\n  \"tail_calls\": " << tailCalls
+     << ",\n  \"jit_code_bytes\": " << jitCodeBytes
+     << ",\n  \"jit_first_insn_ms\": " << jitFirstInsnMs
+     << ",\n  \"func_cache_hits\": " << funcCacheHits
+     << ",\n  \"func_cache_misses\": " << funcCacheMisses
+     << ",\n  \"passes\": [";
+  sep = "\n";
+  for (auto &pass : passes) {
+    os << sep << "    {\"name\": ";
+    quote(os, pass.name);
+    os << ", \"wall_ms\": " << pass.wallMs
+       << ", \"insts_before\": " << pass.before
+       << ", \"insts_after\": " << pass.after << "}";
+    sep = ",\n";
+  }
+  os << (passes.empty() ? "" : "\n  ") << "],\n  \"nodes\": {";
+  sep = "\n";
+  for (auto &node : nodes) {
+    os << sep << "    ";
+    quote(os, node.first);
+    os << ": " << node.second;
+    sep = ",\n";
+  }
+  os << "\n  }\n}\n";
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "ast.h"
+
+class FlatAST;
+
+// 进程内 operator new 的调用次数和申请字节数（只统计开启之后的分配）
+struct AllocCounts {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+};
+void enableAllocCounting();
+AllocCounts allocCounts();
+
+// 峰值常驻内存，单位 KB
+long peakRSS();
+
+// 进程启动（静态初始化）以来经过的墙钟毫秒数
+double processMs();
+
+// 编译统计：各阶段的墙钟/CPU 时间、Arena 用量和各类 AST 节点数。
+// 批量模式下每个文件各记一份，最后 merge 到一起输出
+class Stats {
+ public:
+  // 作用域计时器，析构时把经过的时间累加到对应阶段
+  class Timer {
+   public:
+    Timer(Stats *stats, const char *phase);
+    ~Timer();
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+   private:
+    Stats *stats;
+    const char *phase;
+    double wall;
+    double cpu;
+  };
+  // stats 为空时计时器什么也不做
+  static Timer time(Stats *stats, const char *phase) { return {stats, phase}; }
+
+  struct Phase {
+    std::string name;
+    double wallMs = 0;
+    double cpuMs = 0;
+  };
+
+  // 优化流水线中一个 pass 的耗时和运行前后整个模块的指令数
+  struct Pass {
+    std::string name;
+    double wallMs = 0;
+    size_t before = 0;
+    size_t after = 0;
+  };
+
+  void addPhase(const char *name, double wallMs, double cpuMs);
+  void addPass(const char *name, double wallMs, size_t before, size_t after);
+  void addArena(const Arena &arena);
+  // 遍历整棵树，按节点类型计数；二元表达式另按原语法层次（MulExp...LOrExp）计数
+  void countNodes(CompUnitAST &root);
+  // 同上，直接扫描 FlatAST 的各个数组
+  void countNodes(const FlatAST &f);
+  void merge(const Stats &other);
+
+  // 人类可读的报告；full 为 false 时只输出时间和峰值内存
+  void print(std::ostream &os, bool full) const;
+  void printJSON(std::ostream &os) const;
+
+  size_t files = 0;
+  std::vector<Phase> phases;  // 按第一次出现的顺序
+  std::vector<Pass> passes;   // 按流水线顺序，合并时按位置累加
+  std::map<std::string, size_t> nodes;
+  size_t arenaObjects = 0;
+  size_t arenaBlocks = 0;
+  size_t arenaBytes = 0;
+  size_t foldedNodes = 0;  // 常量折叠去掉的节点数
+  size_t inlinedCalls = 0;  // 内联的调用点数
+  size_t tailCalls = 0;     // 改写成循环的尾递归调用数
+  uint64_t vmInstructions = 0;  // -run 时解释器执行的指令数
+  size_t jitCodeBytes = 0;      // -jit 时装载的机器码字节数
+  double jitFirstInsnMs = 0;    // -jit 时从进程启动到执行第一条生成的指令
+  size_t funcCacheHits = 0;     // -func-cache 时汇编取自缓存的函数数
+  size_t funcCacheMisses = 0;   // -func-cache 时重新生成的函数数
+};
@@ -0,0 +1,100 @@
+#include "symbol.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+Interner interner;
+
+static const size_t CHUNK_SIZE = 64 * 1024;
+
+// FNV-1a
+static uint32_t hashStr(const char *str, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= static_cast<unsigned char>(str[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+Interner::Interner() : slots(1024, 0) {}
+
+Interner::~Interner() {
+  for (char *chunk : chunks) delete[] chunk;
+  for (Entry *segment : segments) delete[] segment;
+}
+
+size_t Interner::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return numEntries;
+}
+
+size_t Interner::poolBytes() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return poolUsed;
+}
+
+Symbol Interner::intern(const char *str, size_t len) {
+  uint32_t h = hashStr(str, len);
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t mask = slots.size() - 1;
+  for (size_t i = h & mask;; i = (i + 1) & mask) {
+    uint32_t slot = slots[i];
+    if (slot == 0) break;
+    const Entry &e = entry(slot - 1);
+    if (e.hash == h && e.len == len && memcmp(e.str, str, len) == 0)
+      return slot - 1;
+  }
+  if (numEntries == MAX_SYMBOLS) {
+    // 没有办法返回出错的 Symbol，与内存耗尽一样处理
+    std::cerr << "too many distinct identifiers (" << MAX_SYMBOLS << ")"
+              << std::endl;
+    std::abort();
+  }
+  Symbol sym = numEntries;
+  size_t k = segmentOf(sym);
+  if (segments[k] == nullptr) segments[k] = new Entry[SEGMENT_SIZE << k];
+  segments[k][sym + SEGMENT_SIZE - (SEGMENT_SIZE << k)] = {
+      store(str, len), static_cast<uint32_t>(len), h};
+  numEntries++;
+  if (numEntries * 2 > slots.size()) {
+    grow();
+  } else {
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+      if (slots[i] == 0) {
+        slots[i] = sym + 1;
+        break;
+      }
+    }
+  }
+  return sym;
+}
+
+const char *Interner::store(const char *str, size_t len) {
+  if (chunkCur == nullptr || chunkCur + len + 1 > chunkEnd) {
+    size_t n = len + 1 > CHUNK_SIZE ? len + 1 : CHUNK_SIZE;
+    chunkCur = new char[n];
+    chunkEnd = chunkCur + n;
+    chunks.push_back(chunkCur);
+  }
+  char *dst = chunkCur;
+  memcpy(dst, str, len);
+  dst[len] = '\0';
+  chunkCur += len + 1;
+  poolUsed += len + 1;
+  return dst;
+}
+
+void Interner::grow() {
+  slots.assign(slots.size() * 2, 0);
+  size_t mask = slots.size() - 1;
+  for (Symbol sym = 0; sym < numEntries; sym++) {
+    for (size_t i = entry(sym).hash & mask;; i = (i + 1) & mask) {
+      if (slots[i] == 0) {
+        slots[i] = sym + 1;
+        break;
+      }
+    }
+  }
+}
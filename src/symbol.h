@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// 标识符驻留后的编号，名字比较退化为整数比较
+using Symbol = uint32_t;
+
+// 全局标识符表：每个名字只在字符串池中保存一次，
+// 池按块分配，已返回的 string_view 在表的生命周期内始终有效。
+// intern() 加锁，可被多个解析线程同时调用；条目按段存放，段一旦分配就不再
+// 移动，name() 读取已拿到的 Symbol 时不需要加锁
+class Interner {
+ public:
+  Interner();
+  ~Interner();
+  Interner(const Interner &) = delete;
+  Interner &operator=(const Interner &) = delete;
+
+  Symbol intern(const char *str, size_t len);
+  Symbol intern(std::string_view str) { return intern(str.data(), str.size()); }
+  std::string_view name(Symbol sym) const {
+    const Entry &e = entry(sym);
+    return std::string_view(e.str, e.len);
+  }
+  size_t size() const;
+  size_t poolBytes() const;
+
+ private:
+  struct Entry {
+    const char *str;
+    uint32_t len;
+    uint32_t hash;
+  };
+  // 第 k 段有 SEGMENT_SIZE << k 个条目，段表大小固定而容量随段数倍增，
+  // MAX_SEGMENTS 段放得下 slots 中 Symbol + 1 能表示的几乎全部编号
+  static const size_t SEGMENT_BITS = 12;
+  static const size_t SEGMENT_SIZE = 1 << SEGMENT_BITS;
+  static const size_t MAX_SEGMENTS = 20;
+  static const size_t MAX_SYMBOLS = ((size_t(1) << MAX_SEGMENTS) - 1)
+                                    << SEGMENT_BITS;
+
+  // sym + SEGMENT_SIZE 的最高位是第 SEGMENT_BITS + k 位时 sym 在第 k 段
+  static size_t segmentOf(Symbol sym) {
+    return 63 - __builtin_clzll(sym + SEGMENT_SIZE) - SEGMENT_BITS;
+  }
+  const Entry &entry(Symbol sym) const {
+    size_t k = segmentOf(sym);
+    return segments[k][sym + SEGMENT_SIZE - (SEGMENT_SIZE << k)];
+  }
+  const char *store(const char *str, size_t len);
+  void grow();
+
+  mutable std::mutex mutex;
+  Entry *segments[MAX_SEGMENTS] = {};
+  size_t numEntries = 0;
+  std::vector<uint32_t> slots;  // 开放寻址表，存 Symbol + 1，0 表示空位
+  std::vector<char *> chunks;
+  char *chunkCur = nullptr;
+  char *chunkEnd = nullptr;
+  size_t poolUsed = 0;
+};
+
+extern Interner interner;
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "symbol.h"
+
+// 作用域符号表：所有作用域共用一张线性探测的开放定址表，键是 Symbol，
+// 每个键只保存当前可见的绑定。内层的绑定覆盖外层时把旧值记进 undo 日志，
+// 退出作用域时按相反顺序恢复，因此查找和进出作用域都是 O(1) 均摊，
+// 与嵌套层数和同名变量个数无关
+template <typename V>
+class ScopedTable {
+ public:
+  explicit ScopedTable(size_t capacity = 64) {
+    size_t n = 16;
+    while (n < capacity * 2) n *= 2;
+    slots.resize(n);
+  }
+
+  void enterScope() { marks.push_back(log.size()); }
+
+  void exitScope() {
+    size_t mark = marks.back();
+    marks.pop_back();
+    while (log.size() > mark) {
+      Undo &undo = log.back();
+      size_t i = slotOf(undo.key);
+      if (undo.shadowed) {
+        slots[i].depth = undo.depth;
+        slots[i].value = undo.value;
+      } else {
+        erase(i);
+      }
+      log.pop_back();
+    }
+  }
+
+  // 当前作用域层数，最外层为 0
+  uint32_t depth() const { return marks.size(); }
+
+  // 在当前作用域绑定 sym。当前作用域已有同名绑定时不修改并返回 false
+  bool bind(Symbol sym, const V &value) {
+    size_t i = slotOf(sym);
+    if (slots[i].key == sym) {
+      if (slots[i].depth == depth()) return false;
+      log.push_back({sym, true, slots[i].depth, slots[i].value});
+      slots[i].depth = depth();
+      slots[i].value = value;
+      return true;
+    }
+    if ((used + 1) * 2 > slots.size()) {
+      grow();
+      i = slotOf(sym);
+    }
+    slots[i] = {sym, depth(), value};
+    used++;
+    log.push_back({sym, false, 0, V()});
+    return true;
+  }
+
+  // 当前可见的绑定，没有时返回 nullptr
+  const V *find(Symbol sym) const {
+    const Slot &slot = slots[slotOf(sym)];
+    return slot.key == sym ? &slot.value : nullptr;
+  }
+
+  size_t size() const { return used; }
+
+ private:
+  static constexpr Symbol EMPTY = ~Symbol(0);
+
+  struct Slot {
+    Symbol key = EMPTY;
+    uint32_t depth = 0;
+    V value = V();
+  };
+  struct Undo {
+    Symbol key;
+    bool shadowed;  // false 表示绑定前没有这个键，恢复时删除
+    uint32_t depth;
+    V value;
+  };
+
+  size_t home(Symbol sym) const {
+    return (sym * 0x9E3779B9u) & (slots.size() - 1);
+  }
+
+  // sym 所在的槽，不存在时返回探测链上第一个空槽
+  size_t slotOf(Symbol sym) const {
+    size_t mask = slots.size() - 1;
+    size_t i = home(sym);
+    while (slots[i].key != sym && slots[i].key != EMPTY) i = (i + 1) & mask;
+    return i;
+  }
+
+  // 线性探测的删除：把后面探测链上的元素往前挪，不留墓碑
+  void erase(size_t i) {
+    size_t mask = slots.size() - 1;
+    size_t j = i;
+    for (;;) {
+      slots[i].key = EMPTY;
+      for (;;) {
+        j = (j + 1) & mask;
+        if (slots[j].key == EMPTY) {
+          used--;
+          return;
+        }
+        size_t k = home(slots[j].key);
+        // k 在 (i, j] 之间（循环意义下）的元素不能挪到 i
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+        break;
+      }
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+
+  void grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    for (const Slot &slot : old)
+      if (slot.key != EMPTY) slots[slotOf(slot.key)] = slot;
+  }
+
+  std::vector<Slot> slots;
+  size_t used = 0;
+  std::vector<Undo> log;
+  std::vector<size_t> marks;  // 每层作用域开始时 log 的长度
+};
@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+
+// 当前线程所属的线程池及其 worker 编号
+static thread_local ThreadPool *currentPool = nullptr;
+static thread_local unsigned currentWorker = 0;
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  for (unsigned i = 0; i < threads; i++)
+    queues.push_back(std::make_unique<Queue>());
+  for (unsigned i = 0; i < threads; i++)
+    workers.emplace_back([this, i] { run(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  unsigned target = currentPool == this ? currentWorker
+                                        : next++ % queues.size();
+  pending++;
+  queued++;
+  {
+    std::lock_guard<std::mutex> lock(queues[target]->mutex);
+    queues[target]->tasks.push_back(std::move(task));
+  }
+  // 与 run() 中先加 sleepers 再检查 queued 相对：两边都是顺序一致的原子操作，
+  // 至少有一边能看到对方，所以不会漏掉唤醒；没有 worker 睡眠时不碰全局锁
+  if (sleepers > 0) {
+    std::lock_guard<std::mutex> lock(mutex);
+    wake.notify_one();
+  }
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this] { return pending == 0; });
+}
+
+bool ThreadPool::pop(unsigned self, std::function<void()> &task) {
+  {
+    Queue &own = *queues[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (unsigned i = 1; i < queues.size(); i++) {
+    Queue &victim = *queues[(self + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(unsigned self) {
+  currentPool = this;
+  currentWorker = self;
+  for (;;) {
+    std::function<void()> task;
+    if (pop(self, task)) {
+      queued--;
+      task();
+      if (--pending == 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.notify_all();
+      }
+      continue;
+    }
+    // 所有队列都空了才睡眠；queued 先于入队增加，被唤醒后可能要再试几次
+    std::unique_lock<std::mutex> lock(mutex);
+    sleepers++;
+    wake.wait(lock, [this] { return stop || queued > 0; });
+    sleepers--;
+    if (stop && queued == 0) return;
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：每个 worker 有自己的双端队列，从队尾取自己的任务，
+// 自己的队列空了就从其他 worker 的队首偷任务。提交和取任务只锁对应的队列，
+// 计数用原子变量；worker 只在所有队列都空了时才在全局条件变量上睡眠
+class ThreadPool {
+ public:
+  // threads 为 0 时使用 std::thread::hardware_concurrency()
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // 在 worker 线程内提交的任务放进该 worker 自己的队列，否则轮流分配
+  void submit(std::function<void()> task);
+  // 阻塞直到所有已提交的任务（包括任务中再提交的）执行完。
+  // 不能在 worker 线程（即任务内部）调用：调用者自己的任务没执行完，会死锁
+  void wait();
+  unsigned size() const { return workers.size(); }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+  void run(unsigned self);
+  bool pop(unsigned self, std::function<void()> &task);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex mutex;  // 只保护睡眠/唤醒和 stop
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::atomic<size_t> queued{0};     // 还在队列里的任务数（入队前就加上）
+  std::atomic<size_t> pending{0};    // 提交了但还没执行完的任务数
+  std::atomic<unsigned> sleepers{0};  // 在 wake 上睡眠的 worker 数
+  std::atomic<unsigned> next{0};
+  bool stop = false;
+};
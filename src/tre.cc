@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "pass.h"
+
+namespace {
+
+// 地址是否一定不指向当前栈帧：改成循环后，栈上的数组在各次“调用”间共用，
+// 不能再传给下一次调用
+bool outsideFrame(const Function &func, Value v) {
+  while (kindOf(v) == VK_INST && func.insts[indexOf(v)].op == OP_GEP)
+    v = func.insts[indexOf(v)].a;
+  return kindOf(v) == VK_ARG || kindOf(v) == VK_GLOBAL;
+}
+
+// 块末尾是 call self; ret 结果 的尾调用时返回 CALL 的下标
+uint32_t tailCall(const Function &func, uint32_t self, const Block &block) {
+  if (block.insts.size() < 2) return NO_VALUE;
+  const Inst &ret = func.insts[block.insts.back()];
+  uint32_t index = block.insts[block.insts.size() - 2];
+  const Inst &call = func.insts[index];
+  if (ret.op != OP_RET || call.op != OP_CALL || call.a != self) return NO_VALUE;
+  if (ret.a != (call.type == IR_VOID ? NO_VALUE : makeValue(VK_INST, index)))
+    return NO_VALUE;
+  for (uint32_t i = 0; i < call.c; i++) {
+    Value arg = func.lists[call.b + i];
+    if (func.typeOf(arg) == IR_PTR && !outsideFrame(func, arg)) return NO_VALUE;
+  }
+  return index;
+}
+
+uint32_t eliminate(Function &func, uint32_t self) {
+  std::vector<uint32_t> calls;
+  for (auto &block : func.blocks) {
+    uint32_t index = tailCall(func, self, block);
+    if (index != NO_VALUE) calls.push_back(index);
+  }
+  if (calls.empty()) return 0;
+
+  // 入口块只留下 ALLOCA，其余指令挪到新的循环头
+  uint32_t header = func.addBlock();
+  auto &entry = func.blocks[0].insts;
+  auto split = std::stable_partition(entry.begin(), entry.end(), [&](uint32_t i) {
+    return func.insts[i].op == OP_ALLOCA;
+  });
+  std::vector<uint32_t> moved(split, entry.end());
+  entry.erase(split, entry.end());
+  for (uint32_t index : moved) func.insts[index].block = header;
+  func.blocks[header].insts = std::move(moved);
+  forEachSuccessor(func.terminator(header), [&](uint32_t succ) {
+    for (uint32_t index : func.blocks[succ].insts) {
+      Inst &phi = func.insts[index];
+      if (phi.op != OP_PHI) break;
+      for (uint32_t i = 0; i < phi.c; i++)
+        if (func.lists[phi.b + 2 * i + 1] == 0) func.lists[phi.b + 2 * i + 1] = header;
+    }
+  });
+  Inst br;
+  br.op = OP_BR;
+  br.a = header;
+  func.append(0, br);
+
+  // 形参换成循环头的 PHI：第一次从入口进来是实参，之后是尾调用的实参
+  std::vector<Value> phis;
+  for (uint32_t i = 0; i < func.params.size(); i++)
+    phis.push_back(insertPhi(func, header, func.params[i]));
+  for (auto &block : func.blocks) {
+    for (uint32_t index : block.insts) {
+      forEachOperand(func, func.insts[index], [&](Value &v) {
+        if (kindOf(v) == VK_ARG) v = phis[indexOf(v)];
+      });
+    }
+  }
+  std::vector<std::vector<std::pair<Value, uint32_t>>> entries(phis.size());
+  for (uint32_t i = 0; i < phis.size(); i++)
+    entries[i].push_back({makeValue(VK_ARG, i), 0});
+  for (uint32_t index : calls) {
+    Inst &call = func.insts[index];
+    uint32_t b = call.block;
+    for (uint32_t i = 0; i < phis.size(); i++)
+      entries[i].push_back({func.lists[call.b + i], b});
+    auto &insts = func.blocks[b].insts;
+    func.insts[insts.back()].op = OP_NOP;
+    call.op = OP_NOP;
+    insts.resize(insts.size() - 2);
+    func.append(b, br);
+  }
+  for (uint32_t i = 0; i < phis.size(); i++)
+    setIncoming(func, func.insts[indexOf(phis[i])], entries[i]);
+  return calls.size();
+}
+
+}  // namespace
+
+bool tailRecursion(Module &module, PassCounts &counts) {
+  size_t before = counts.tailCalls;
+  for (uint32_t f = 0; f < module.functions.size(); f++) {
+    Function &func = module.functions[f];
+    if (!func.external && !func.cached) counts.tailCalls += eliminate(func, f);
+  }
+  return counts.tailCalls != before;
+}
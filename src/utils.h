@@ -4,13 +4,15 @@ enum STYPE { SEMI, ASS, EXP, CONT, BRE, RET, BLK, SELECT, ITER };
 
 enum UOP { UOP_ADD, UOP_MINUS, UOP_NOT };
 
-enum AOP { AOP_ADD, AOP_MINUS };
-
-enum MOP { MOP_MUL, MOP_DIV, MOP_MOD };
-
-enum ROP { ROP_GTE, ROP_LTE, ROP_GT, ROP_LT };
-
-enum EOP { EOP_EQ, EOP_NEQ };
+// 二元运算符，按优先级从高到低排列
+enum BOP {
+  BOP_MUL, BOP_DIV, BOP_MOD,
+  BOP_ADD, BOP_MINUS,
+  BOP_GTE, BOP_LTE, BOP_GT, BOP_LT,
+  BOP_EQ, BOP_NEQ,
+  BOP_AND,
+  BOP_OR
+};
 
 enum TYPE { TYPE_VOID, TYPE_INT, TYPE_FLOAT };
 
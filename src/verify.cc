@@ -0,0 +1,288 @@
+#include "verify.h"
+
+#include <algorithm>
+
+#include "cfg.h"
+
+namespace {
+
+class Verifier {
+ public:
+  Verifier(const Module &module, const Function &func,
+           std::vector<std::string> &errors)
+      : module(module), func(func), errors(errors) {}
+
+  bool run();
+
+ private:
+  void fail(uint32_t block, uint32_t inst, const std::string &msg);
+  bool checkValue(uint32_t block, uint32_t index, Value v);
+  bool expect(uint32_t block, uint32_t index, Value v, IRType type);
+  void checkInst(uint32_t block, uint32_t index);
+  void checkDominance(uint32_t block, uint32_t index);
+
+  const Module &module;
+  const Function &func;
+  std::vector<std::string> &errors;
+  std::vector<uint32_t> owner;     // 指令所在的块，不在任何块中为 NONE
+  std::vector<uint32_t> position;  // 指令在块中的位置
+  const CFG *cfg = nullptr;
+  const DomTree *dom = nullptr;
+  bool ok = true;
+};
+
+void Verifier::fail(uint32_t block, uint32_t inst, const std::string &msg) {
+  ok = false;
+  std::string where = "@" + std::string(interner.name(func.name));
+  if (block != CFG::NONE) where += " bb" + std::to_string(block);
+  if (inst != CFG::NONE) where += " %" + std::to_string(inst);
+  errors.push_back(where + ": " + msg);
+}
+
+bool Verifier::checkValue(uint32_t block, uint32_t index, Value v) {
+  uint32_t i = indexOf(v);
+  bool valid = false;
+  switch (kindOf(v)) {
+    case VK_INST:
+      valid = i < func.insts.size() && owner[i] != CFG::NONE &&
+              func.insts[i].type != IR_VOID;
+      break;
+    case VK_ARG:
+      valid = i < func.params.size();
+      break;
+    case VK_CONST:
+      valid = i < func.consts.size();
+      break;
+    case VK_GLOBAL:
+      valid = i < module.globals.size();
+      break;
+  }
+  if (!valid) fail(block, index, "invalid operand " + std::to_string(v));
+  return valid;
+}
+
+bool Verifier::expect(uint32_t block, uint32_t index, Value v, IRType type) {
+  if (!checkValue(block, index, v)) return false;
+  if (func.typeOf(v) == type) return true;
+  fail(block, index, "operand type mismatch");
+  return false;
+}
+
+void Verifier::checkInst(uint32_t b, uint32_t index) {
+  const Inst &inst = func.insts[index];
+  auto wantType = [&](IRType type) {
+    if (inst.type != type) fail(b, index, "result type mismatch");
+  };
+  switch (inst.op) {
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+      wantType(IR_I32);
+      expect(b, index, inst.a, IR_I32);
+      expect(b, index, inst.b, IR_I32);
+      break;
+    case OP_FADD: case OP_FSUB: case OP_FMUL: case OP_FDIV:
+      wantType(IR_F32);
+      expect(b, index, inst.a, IR_F32);
+      expect(b, index, inst.b, IR_F32);
+      break;
+    case OP_FNEG:
+      wantType(IR_F32);
+      expect(b, index, inst.a, IR_F32);
+      break;
+    case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+      wantType(IR_I32);
+      expect(b, index, inst.a, IR_I32);
+      expect(b, index, inst.b, IR_I32);
+      break;
+    case OP_FEQ: case OP_FNE: case OP_FLT: case OP_FLE: case OP_FGT:
+    case OP_FGE:
+      wantType(IR_I32);
+      expect(b, index, inst.a, IR_F32);
+      expect(b, index, inst.b, IR_F32);
+      break;
+    case OP_ITOF:
+      wantType(IR_F32);
+      expect(b, index, inst.a, IR_I32);
+      break;
+    case OP_FTOI:
+      wantType(IR_I32);
+      expect(b, index, inst.a, IR_F32);
+      break;
+    case OP_ALLOCA:
+      wantType(IR_PTR);
+      if (inst.a == 0) fail(b, index, "alloca of zero words");
+      break;
+    case OP_LOAD:
+      if (inst.type != IR_I32 && inst.type != IR_F32)
+        fail(b, index, "load must produce i32 or f32");
+      expect(b, index, inst.a, IR_PTR);
+      break;
+    case OP_STORE:
+      wantType(IR_VOID);
+      expect(b, index, inst.a, IR_PTR);
+      if (checkValue(b, index, inst.b) && func.typeOf(inst.b) != IR_I32 &&
+          func.typeOf(inst.b) != IR_F32)
+        fail(b, index, "store of a non-scalar value");
+      break;
+    case OP_GEP:
+      wantType(IR_PTR);
+      expect(b, index, inst.a, IR_PTR);
+      expect(b, index, inst.b, IR_I32);
+      break;
+    case OP_ZERO:
+      wantType(IR_VOID);
+      expect(b, index, inst.a, IR_PTR);
+      break;
+    case OP_CALL: {
+      if (inst.a >= module.functions.size()) {
+        fail(b, index, "call to unknown function");
+        break;
+      }
+      const Function &callee = module.functions[inst.a];
+      wantType(callee.retType);
+      if (inst.c != callee.params.size()) {
+        fail(b, index, "wrong number of arguments");
+        break;
+      }
+      for (uint32_t i = 0; i < inst.c; i++)
+        expect(b, index, func.lists[inst.b + i], callee.params[i]);
+      break;
+    }
+    case OP_PHI: {
+      if (inst.type == IR_VOID) fail(b, index, "phi of type void");
+      if (!cfg->reachable(b)) break;
+      auto &preds = cfg->preds[b];
+      if (inst.c != preds.size()) {
+        fail(b, index, "phi does not have one value per predecessor");
+        break;
+      }
+      std::vector<uint32_t> seen;
+      for (uint32_t i = 0; i < inst.c; i++) {
+        expect(b, index, func.lists[inst.b + 2 * i], inst.type);
+        uint32_t pred = func.lists[inst.b + 2 * i + 1];
+        if (std::find(preds.begin(), preds.end(), pred) == preds.end() ||
+            std::find(seen.begin(), seen.end(), pred) != seen.end())
+          fail(b, index, "phi incoming block bb" + std::to_string(pred) +
+                             " is not a distinct predecessor");
+        seen.push_back(pred);
+      }
+      break;
+    }
+    case OP_BR:
+      break;
+    case OP_CONDBR:
+      expect(b, index, inst.a, IR_I32);
+      break;
+    case OP_RET:
+      if (inst.a == NO_VALUE) {
+        if (func.retType != IR_VOID) fail(b, index, "missing return value");
+      } else if (func.retType == IR_VOID) {
+        fail(b, index, "return value in void function");
+      } else {
+        expect(b, index, inst.a, func.retType);
+      }
+      break;
+    case OP_NOP:
+    case NUM_OPCODES:
+      fail(b, index, "deleted instruction in a block");
+      break;
+  }
+}
+
+void Verifier::checkDominance(uint32_t b, uint32_t index) {
+  const Inst &inst = func.insts[index];
+  auto check = [&](Value v, uint32_t useBlock, bool atEnd) {
+    if (kindOf(v) != VK_INST) return;
+    uint32_t def = indexOf(v);
+    if (def >= func.insts.size() || owner[def] == CFG::NONE) return;
+    uint32_t defBlock = owner[def];
+    bool dominated;
+    if (!cfg->reachable(defBlock))
+      dominated = false;
+    else if (defBlock == useBlock)
+      dominated = atEnd || position[def] < position[index];
+    else
+      dominated = dom->dominates(defBlock, useBlock);
+    if (!dominated)
+      fail(b, index, "use of %" + std::to_string(def) +
+                         " is not dominated by its definition");
+  };
+  if (inst.op == OP_PHI) {
+    for (uint32_t i = 0; i < inst.c; i++) {
+      uint32_t pred = func.lists[inst.b + 2 * i + 1];
+      if (pred < func.blocks.size() && cfg->reachable(pred))
+        check(func.lists[inst.b + 2 * i], pred, true);
+    }
+  } else {
+    forEachOperand(func, inst, [&](const Value &v) { check(v, b, false); });
+  }
+}
+
+bool Verifier::run() {
+  if (func.external) {
+    if (!func.blocks.empty()) fail(CFG::NONE, CFG::NONE, "external with body");
+    return ok;
+  }
+  if (func.blocks.empty()) {
+    fail(CFG::NONE, CFG::NONE, "function has no blocks");
+    return ok;
+  }
+  owner.assign(func.insts.size(), CFG::NONE);
+  position.assign(func.insts.size(), 0);
+  for (uint32_t b = 0; b < func.blocks.size(); b++) {
+    auto &insts = func.blocks[b].insts;
+    if (insts.empty()) {
+      fail(b, CFG::NONE, "empty block");
+      continue;
+    }
+    bool phis = true;
+    for (uint32_t i = 0; i < insts.size(); i++) {
+      uint32_t index = insts[i];
+      if (index >= func.insts.size()) {
+        fail(b, CFG::NONE, "bad instruction index");
+        return ok;
+      }
+      if (owner[index] != CFG::NONE) {
+        fail(b, index, "instruction appears in two places");
+        return ok;
+      }
+      owner[index] = b;
+      position[index] = i;
+      const Inst &inst = func.insts[index];
+      if (inst.block != b) fail(b, index, "wrong block field");
+      if (isTerminator(inst.op) != (i + 1 == insts.size()))
+        fail(b, index, "block must end with exactly one terminator");
+      forEachSuccessor(inst, [&](uint32_t target) {
+        if (target >= func.blocks.size()) fail(b, index, "branch to bad block");
+      });
+      if (inst.op == OP_PHI && !phis) fail(b, index, "phi after non-phi");
+      if (inst.op != OP_PHI) phis = false;
+    }
+  }
+  // 块结构有错时 CFG 不可信，不再继续
+  if (!ok) return ok;
+
+  CFG graph(func);
+  DomTree tree(graph);
+  cfg = &graph;
+  dom = &tree;
+  for (uint32_t b = 0; b < func.blocks.size(); b++)
+    for (uint32_t index : func.blocks[b].insts) checkInst(b, index);
+  if (!ok) return ok;
+  for (uint32_t b : graph.rpo)
+    for (uint32_t index : func.blocks[b].insts) checkDominance(b, index);
+  return ok;
+}
+
+}  // namespace
+
+bool verifyFunction(const Module &module, const Function &func,
+                    std::vector<std::string> &errors) {
+  return Verifier(module, func, errors).run();
+}
+
+bool verifyModule(const Module &module, std::vector<std::string> &errors) {
+  bool ok = true;
+  for (auto &func : module.functions)
+    ok = verifyFunction(module, func, errors) && ok;
+  return ok;
+}
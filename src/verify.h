@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ir.h"
+
+// IR 校验：块以唯一的终结指令结尾、PHI 只在块首且与前驱一一对应、
+// 操作数下标和类型合法、实参与被调函数匹配、SSA 值的定义支配所有使用。
+// 发现的问题追加到 errors，没有问题时返回 true
+bool verifyFunction(const Module &module, const Function &func,
+                    std::vector<std::string> &errors);
+bool verifyModule(const Module &module, std::vector<std::string> &errors);
@@ -0,0 +1,305 @@
+#include "vm.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "sylib.h"
+
+namespace {
+
+const size_t REG_SLOTS = size_t(1) << 22;
+const size_t DATA_WORDS = size_t(1) << 25;
+const size_t MAX_FRAMES = size_t(1) << 20;
+
+// 有符号溢出按补码回绕，与生成的机器码行为一致
+inline int32_t wrap(uint32_t v) { return static_cast<int32_t>(v); }
+
+}  // namespace
+
+VM::VM(const BcProgram &program)
+    : program(program),
+      data(program.data),
+      regStack(new Slot[REG_SLOTS]),
+      dataStack(new int32_t[DATA_WORDS]),
+      frames(new Frame[MAX_FRAMES]) {
+  inits.resize(program.functions.size());
+  for (size_t i = 0; i < program.functions.size(); i++) {
+    const BcFunction &func = program.functions[i];
+    inits[i] = func.init;
+    for (auto &global : func.globalRegs)
+      inits[i][global.first].p = data.data() + program.globalOffset[global.second];
+  }
+}
+
+// 运行时库函数都转给 runtime/sylib.c，与 -S、-jit 用的是同一份实现
+Slot VM::builtin(uint32_t id, const Slot *args) {
+  Slot result;
+  result.p = nullptr;
+  switch (id) {
+    case BUILTIN_GETINT:
+      result.i = getint();
+      break;
+    case BUILTIN_GETCH:
+      result.i = getch();
+      break;
+    case BUILTIN_GETFLOAT:
+      result.f = getfloat();
+      break;
+    case BUILTIN_GETARRAY:
+      result.i = getarray(args[0].p);
+      break;
+    case BUILTIN_GETFARRAY:
+      result.i = getfarray(reinterpret_cast<float *>(args[0].p));
+      break;
+    case BUILTIN_PUTINT:
+      putint(args[0].i);
+      break;
+    case BUILTIN_PUTCH:
+      putch(args[0].i);
+      break;
+    case BUILTIN_PUTFLOAT:
+      putfloat(args[0].f);
+      break;
+    case BUILTIN_PUTARRAY:
+      putarray(args[0].i, args[1].p);
+      break;
+    case BUILTIN_PUTFARRAY:
+      putfarray(args[0].i, reinterpret_cast<float *>(args[1].p));
+      break;
+    case BUILTIN_STARTTIME:
+      starttime();
+      break;
+    case BUILTIN_STOPTIME:
+      stoptime();
+      break;
+  }
+  return result;
+}
+
+bool VM::run(int &exitCode, std::string &error) {
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+  const BcFunction *func = &program.functions[program.mainIndex];
+  const BcInsn *ip = func->code.data();
+  Slot *r = regStack.get();
+  Slot *regEnd = r + REG_SLOTS;
+  int32_t *sp = dataStack.get();
+  int32_t *spEnd = sp + DATA_WORDS;
+  Frame *fp = frames.get();
+  Frame *fpEnd = fp + MAX_FRAMES;
+  uint64_t count = 0;
+  Slot value;
+  std::copy(inits[program.mainIndex].begin(), inits[program.mainIndex].end(), r);
+  sylib_begin();
+
+#define R(field) r[ip->field]
+
+#ifdef VM_COMPUTED_GOTO
+#define BC_LABEL(name) &&L_##name,
+  static const void *const labels[NUM_BC_OPS] = {BC_OPS(BC_LABEL)};
+#undef BC_LABEL
+#define CASE(name) L_##name
+#define DISPATCH()         \
+  do {                     \
+    count++;               \
+    goto *labels[ip->op];  \
+  } while (0)
+#else
+#define CASE(name) case BC_##name
+#define DISPATCH() \
+  do {             \
+    count++;       \
+    goto dispatch; \
+  } while (0)
+#endif
+#define NEXT() \
+  do {           \
+    ip++;        \
+    DISPATCH();  \
+  } while (0)
+#define JUMP_IF(name, cond)                                   \
+  CASE(name):                                                 \
+  ip = func->code.data() + ((cond) ? ip->d : ip->c);          \
+  DISPATCH();
+
+  DISPATCH();
+#ifndef VM_COMPUTED_GOTO
+dispatch:
+  switch (ip->op) {
+#endif
+    CASE(MOV):
+      R(d) = R(a);
+      NEXT();
+    CASE(ADD):
+      R(d).i = wrap(uint32_t(R(a).i) + uint32_t(R(b).i));
+      NEXT();
+    CASE(SUB):
+      R(d).i = wrap(uint32_t(R(a).i) - uint32_t(R(b).i));
+      NEXT();
+    CASE(MUL):
+      R(d).i = wrap(uint32_t(R(a).i) * uint32_t(R(b).i));
+      NEXT();
+    CASE(DIV):
+      R(d).i = R(a).i / R(b).i;
+      NEXT();
+    CASE(MOD):
+      R(d).i = R(a).i % R(b).i;
+      NEXT();
+    CASE(FADD):
+      R(d).f = R(a).f + R(b).f;
+      NEXT();
+    CASE(FSUB):
+      R(d).f = R(a).f - R(b).f;
+      NEXT();
+    CASE(FMUL):
+      R(d).f = R(a).f * R(b).f;
+      NEXT();
+    CASE(FDIV):
+      R(d).f = R(a).f / R(b).f;
+      NEXT();
+    CASE(FNEG):
+      R(d).f = -R(a).f;
+      NEXT();
+    CASE(EQ):
+      R(d).i = R(a).i == R(b).i;
+      NEXT();
+    CASE(NE):
+      R(d).i = R(a).i != R(b).i;
+      NEXT();
+    CASE(LT):
+      R(d).i = R(a).i < R(b).i;
+      NEXT();
+    CASE(LE):
+      R(d).i = R(a).i <= R(b).i;
+      NEXT();
+    CASE(GT):
+      R(d).i = R(a).i > R(b).i;
+      NEXT();
+    CASE(GE):
+      R(d).i = R(a).i >= R(b).i;
+      NEXT();
+    CASE(FEQ):
+      R(d).i = R(a).f == R(b).f;
+      NEXT();
+    CASE(FNE):
+      R(d).i = R(a).f != R(b).f;
+      NEXT();
+    CASE(FLT):
+      R(d).i = R(a).f < R(b).f;
+      NEXT();
+    CASE(FLE):
+      R(d).i = R(a).f <= R(b).f;
+      NEXT();
+    CASE(FGT):
+      R(d).i = R(a).f > R(b).f;
+      NEXT();
+    CASE(FGE):
+      R(d).i = R(a).f >= R(b).f;
+      NEXT();
+    CASE(ITOF):
+      R(d).f = static_cast<float>(R(a).i);
+      NEXT();
+    CASE(FTOI):
+      R(d).i = static_cast<int32_t>(R(a).f);
+      NEXT();
+    CASE(ALLOCA):
+      if (sp + ip->a > spEnd) goto overflow;
+      R(d).p = sp;
+      sp += ip->a;
+      NEXT();
+    CASE(LOAD):
+      R(d).i = *R(a).p;
+      NEXT();
+    CASE(STORE):
+      *R(a).p = R(b).i;
+      NEXT();
+    CASE(GEP):
+      R(d).p = R(a).p + ptrdiff_t(R(b).i) * ip->c;
+      NEXT();
+    CASE(LOADX):
+      R(d).i = R(a).p[ptrdiff_t(R(b).i) * ip->c];
+      NEXT();
+    CASE(STOREX):
+      R(a).p[ptrdiff_t(R(b).i) * ip->c] = R(d).i;
+      NEXT();
+    CASE(ZERO):
+      memset(R(a).p, 0, size_t(ip->b) * 4);
+      NEXT();
+    CASE(JMP):
+      ip = func->code.data() + ip->d;
+      DISPATCH();
+    JUMP_IF(JNZ, R(a).i != 0)
+    JUMP_IF(JEQ, R(a).i == R(b).i)
+    JUMP_IF(JNE, R(a).i != R(b).i)
+    JUMP_IF(JLT, R(a).i < R(b).i)
+    JUMP_IF(JLE, R(a).i <= R(b).i)
+    JUMP_IF(JGT, R(a).i > R(b).i)
+    JUMP_IF(JGE, R(a).i >= R(b).i)
+    JUMP_IF(JFEQ, R(a).f == R(b).f)
+    JUMP_IF(JFNE, R(a).f != R(b).f)
+    JUMP_IF(JFLT, R(a).f < R(b).f)
+    JUMP_IF(JFLE, R(a).f <= R(b).f)
+    JUMP_IF(JFGT, R(a).f > R(b).f)
+    JUMP_IF(JFGE, R(a).f >= R(b).f)
+    CASE(CALL): {
+      const BcFunction *callee = &program.functions[ip->a];
+      Slot *callRegs = r + func->numRegs;
+      if (callRegs + callee->numRegs > regEnd || fp == fpEnd) goto overflow;
+      std::copy(inits[ip->a].begin(), inits[ip->a].end(), callRegs);
+      const uint32_t *args = func->args.data() + ip->b;
+      for (uint32_t i = 0; i < ip->c; i++)
+        callRegs[callee->paramBase + i] = r[args[i]];
+      *fp++ = {ip + 1, r, func, sp, ip->d};
+      func = callee;
+      r = callRegs;
+      ip = callee->code.data();
+      DISPATCH();
+    }
+    CASE(CALLEXT): {
+      Slot args[2];
+      for (uint32_t i = 0; i < ip->c; i++) args[i] = r[func->args[ip->b + i]];
+      R(d) = builtin(ip->a, args);
+      NEXT();
+    }
+    CASE(RET):
+      value = R(a);
+      goto ret;
+    CASE(RETV):
+      value.p = nullptr;
+      goto ret;
+#ifndef VM_COMPUTED_GOTO
+    default:
+      break;
+  }
+#endif
+
+ret:
+  if (fp == frames.get()) {
+    exitCode = value.i;
+    executed += count;
+    sylib_end();
+    return true;
+  }
+  fp--;
+  ip = fp->ret;
+  r = fp->regs;
+  func = fp->func;
+  sp = fp->sp;
+  r[fp->dst] = value;
+  DISPATCH();
+
+overflow:
+  executed += count;
+  fflush(stdout);
+  error = "stack overflow in '" + std::string(interner.name(func->name)) + "'";
+  return false;
+
+#undef R
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+#undef JUMP_IF
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bytecode.h"
+
+// 字节码解释器。GCC/Clang 下用 computed goto 做线索化分派，
+// 其它编译器退回 switch。调用栈、寄存器栈和 ALLOCA 用的数据栈都是预先分配的
+// 连续内存，SysY 函数调用不会递归调用 C++ 函数
+class VM {
+ public:
+  explicit VM(const BcProgram &program);
+
+  // 从 main 开始执行，exitCode 为 main 的返回值；栈溢出时返回 false
+  bool run(int &exitCode, std::string &error);
+
+  uint64_t executed = 0;  // 分派执行的指令条数
+
+ private:
+  struct Frame {
+    const BcInsn *ret;  // 调用者的下一条指令
+    Slot *regs;
+    const BcFunction *func;
+    int32_t *sp;
+    uint32_t dst;
+  };
+
+  // 执行运行时库函数，args 为实参
+  Slot builtin(uint32_t id, const Slot *args);
+
+  const BcProgram &program;
+  std::vector<int32_t> data;  // 全局变量
+  std::vector<std::vector<Slot>> inits;  // 填好全局变量地址的寄存器初值
+  std::unique_ptr<Slot[]> regStack;
+  std::unique_ptr<int32_t[]> dataStack;
+  std::unique_ptr<Frame[]> frames;
+};
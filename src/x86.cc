@@ -0,0 +1,1142 @@
+#include "x86.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include "cfg.h"
+#include "pass.h"
+#include "thread_pool.h"
+
+namespace {
+
+enum Reg : uint8_t {
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15,
+  XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+  XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15,
+  NUM_REGS,
+  NO_REG = NUM_REGS
+};
+
+const char *const REG64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp",
+                             "rsi", "rdi", "r8",  "r9",  "r10", "r11",
+                             "r12", "r13", "r14", "r15"};
+const char *const REG32[] = {"eax", "ecx", "edx",  "ebx",  "esp",  "ebp",
+                             "esi", "edi", "r8d",  "r9d",  "r10d", "r11d",
+                             "r12d", "r13d", "r14d", "r15d"};
+const char *const XMM[] = {"xmm0",  "xmm1",  "xmm2",  "xmm3",
+                           "xmm4",  "xmm5",  "xmm6",  "xmm7",
+                           "xmm8",  "xmm9",  "xmm10", "xmm11",
+                           "xmm12", "xmm13", "xmm14", "xmm15"};
+
+// RAX、RDX、R11 和 XMM14、XMM15 不参与分配，留给指令选择做临时寄存器；
+// RDX 同时是 idiv 的固定操作数
+const Reg CALLER_SAVED[] = {RCX, RSI, RDI, R8, R9, R10};
+const Reg CALLEE_SAVED[] = {RBX, R12, R13, R14, R15};
+const Reg INT_ARGS[] = {RDI, RSI, RDX, RCX, R8, R9};
+const uint32_t FLOAT_ARGS = 8;
+const uint32_t FLOAT_REGS = 14;  // XMM0 - XMM13
+
+const uint32_t NONE = CFG::NONE;
+
+bool isXmm(Reg r) { return r >= XMM0 && r < NUM_REGS; }
+
+const char *regName(Reg r, IRType type) {
+  if (isXmm(r)) return XMM[r - XMM0];
+  return type == IR_PTR ? REG64[r] : REG32[r];
+}
+
+bool isCompare(Opcode op) { return op >= OP_EQ && op <= OP_FGE; }
+
+// 整数比较的条件码，以及交换两个操作数后的条件码
+const char *const INT_CC[] = {"e", "ne", "l", "le", "g", "ge"};
+const char *const SWAPPED_CC[] = {"e", "ne", "g", "ge", "l", "le"};
+
+const char *invert(const char *cc) {
+  static const char *const PAIRS[][2] = {
+      {"e", "ne"}, {"l", "ge"}, {"le", "g"}, {"a", "be"}, {"ae", "b"}};
+  for (auto &pair : PAIRS) {
+    if (strcmp(cc, pair[0]) == 0) return pair[1];
+    if (strcmp(cc, pair[1]) == 0) return pair[0];
+  }
+  return cc;
+}
+
+std::string format(const char *fmt, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < static_cast<int>(sizeof(buf))) return std::string(buf, n);
+  std::string s(n, '\0');
+  va_start(ap, fmt);
+  vsnprintf(&s[0], n + 1, fmt, ap);
+  va_end(ap);
+  return s;
+}
+
+// 值的位置：寄存器，或相对 %rbp 的栈槽（传入的栈参数在正偏移处）
+struct Loc {
+  enum Kind : uint8_t { NONE, REG, MEM };
+  Kind kind = NONE;
+  Reg reg = NO_REG;
+  int32_t offset = 0;
+
+  static Loc inReg(Reg r) {
+    Loc loc;
+    loc.kind = REG;
+    loc.reg = r;
+    return loc;
+  }
+  static Loc inMem(int32_t offset) {
+    Loc loc;
+    loc.kind = MEM;
+    loc.offset = offset;
+    return loc;
+  }
+  bool operator==(const Loc &other) const {
+    return kind == other.kind &&
+           (kind == REG ? reg == other.reg : offset == other.offset);
+  }
+};
+
+// 活跃区间：[start, end] 为线性化后的指令位置，start 处定义、end 处最后一次使用
+struct Interval {
+  uint32_t id;
+  int32_t start, end;
+  bool isFloat;
+  bool crossesCall;  // 有调用落在 (start, end) 内
+};
+
+// 并行拷贝中的一条：src 为 NONE 时 dst 直接由 value（常量或地址）生成
+struct Move {
+  Loc dst;
+  Value value;
+  Loc src;
+  IRType type;
+};
+
+class FunctionEmitter {
+ public:
+  FunctionEmitter(const Module &module, const Function &func, uint32_t id,
+                  OutBuffer &out)
+      : module(module), func(func), id(id), out(out), cfg(func) {}
+
+  void run();
+
+ private:
+  struct Use {
+    uint32_t block;
+    int32_t pos;
+    bool phi;  // 作为 PHI 入边的值，在前驱块末尾使用
+  };
+  struct Stub {
+    uint32_t label, from, to;
+  };
+
+  // 分配寄存器前的分析
+  void number();
+  void fuse();
+  void intervals();
+  void allocate();
+  void layoutFrame();
+
+  uint32_t valueId(Value v) const {
+    return kindOf(v) == VK_INST ? indexOf(v) : func.insts.size() + indexOf(v);
+  }
+  // 需要寄存器或栈槽的值：形参和有结果、未被合并进使用者的指令
+  bool needsLoc(Value v) const;
+  // 常量地址：全局变量和栈上数组，用到时直接生成地址
+  bool isAddress(Value v) const {
+    return kindOf(v) == VK_GLOBAL ||
+           (kindOf(v) == VK_INST && func.insts[indexOf(v)].op == OP_ALLOCA);
+  }
+  Loc locOf(Value v) const {
+    if (kindOf(v) != VK_INST && kindOf(v) != VK_ARG) return Loc();
+    return locs[valueId(v)];
+  }
+  Reg regOf(Value v) const {
+    Loc loc = locOf(v);
+    return loc.kind == Loc::REG ? loc.reg : NO_REG;
+  }
+
+  // 输出
+  void ins(const char *fmt, ...);
+  void label(uint32_t block) {
+    out.write(format(".L%u_%u:\n", id, block));
+  }
+  std::string blockLabel(uint32_t block) const {
+    return format(".L%u_%u", id, block);
+  }
+  std::string mem(int32_t offset) const { return format("%d(%%rbp)", offset); }
+  std::string constLabel(Value v);
+  // 寄存器、栈槽、立即数，或浮点常量的内存操作数
+  std::string operand(Value v);
+  std::string addressOf(Value v, int64_t disp);
+  // LOAD/STORE/ZERO 的内存操作数，可能用到 RAX 和 R11
+  std::string address(Value v);
+  std::string gepAddress(const Inst &gep);
+  std::string base(Value v, int64_t disp);
+
+  void load(Reg r, const std::string &src, IRType type);
+  void store(const std::string &dst, Reg r, IRType type);
+  void moveReg(Reg dst, Reg src, IRType type);
+  void moveInto(Reg r, Value v);
+  Reg dstReg(uint32_t index, Reg scratch) const {
+    Loc loc = locs[index];
+    return loc.kind == Loc::REG ? loc.reg : scratch;
+  }
+  // 把放在 r 中的结果写到指令的位置
+  void finish(uint32_t index, Reg r);
+  void moveLoc(const Move &move);
+  void parallelMove(std::vector<Move> &moves);
+
+  void prologue();
+  void epilogue();
+  void inst(uint32_t index);
+  void call(uint32_t index, const Inst &inst);
+  const char *compareInt(Opcode op, Value a, Value b);
+  const char *compareFloat(Opcode op, Value a, Value b);
+  void terminator(uint32_t block, const Inst &inst, uint32_t next);
+  void edgeMoves(uint32_t from, uint32_t to);
+  bool hasPhis(uint32_t block) const {
+    return func.insts[func.blocks[block].insts[0]].op == OP_PHI;
+  }
+  std::string target(uint32_t from, uint32_t to);
+  void jump(const char *cc, const std::string &yes, const std::string &no,
+            uint32_t to, uint32_t next);
+
+  const Module &module;
+  const Function &func;
+  uint32_t id;
+  OutBuffer &out;
+  CFG cfg;
+
+  std::vector<int32_t> pos;
+  std::vector<int32_t> from, to;  // 块的第一条和最后一条指令的位置
+  std::vector<uint32_t> useCount;
+  std::vector<uint32_t> fusedInto;  // 合并进哪条指令，NONE 表示单独生成
+  std::vector<int32_t> callPos;
+  std::vector<Interval> ranges;
+  std::vector<Loc> locs;  // 按 valueId 编号
+  std::vector<Loc> paramLocs;  // 形参传入的位置
+  std::vector<int32_t> allocaOffset;
+  std::vector<Reg> saved;  // 用到的被调者保存寄存器
+  std::vector<int32_t> saveOffset;
+  int32_t frameSize = 0;
+  uint32_t outgoing = 0;  // 栈上传参区的字节数
+  std::vector<uint32_t> usedConsts;
+  std::vector<bool> constUsed;
+  std::vector<Stub> stubs;
+  uint32_t nextLabel = 0;
+};
+
+void FunctionEmitter::ins(const char *fmt, ...) {
+  char buf[512];
+  buf[0] = '\t';
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf + 1, sizeof(buf) - 2, fmt, ap);
+  va_end(ap);
+  n = std::min(n, static_cast<int>(sizeof(buf)) - 3);
+  buf[n + 1] = '\n';
+  out.write(buf, n + 2);
+}
+
+bool FunctionEmitter::needsLoc(Value v) const {
+  if (kindOf(v) == VK_ARG) return true;
+  if (kindOf(v) != VK_INST) return false;
+  const Inst &inst = func.insts[indexOf(v)];
+  return inst.type != IR_VOID && inst.op != OP_ALLOCA &&
+         fusedInto[indexOf(v)] == NONE;
+}
+
+void FunctionEmitter::number() {
+  pos.assign(func.insts.size(), -1);
+  from.assign(func.blocks.size(), 0);
+  to.assign(func.blocks.size(), 0);
+  int32_t p = 0;
+  for (uint32_t b : cfg.rpo) {
+    from[b] = p;
+    for (uint32_t index : func.blocks[b].insts) {
+      pos[index] = p;
+      if (func.insts[index].op == OP_CALL) callPos.push_back(p);
+      p += 2;
+    }
+    to[b] = p - 2;
+  }
+}
+
+void FunctionEmitter::fuse() {
+  useCount.assign(func.insts.size() + func.params.size(), 0);
+  fusedInto.assign(func.insts.size(), NONE);
+  for (uint32_t b : cfg.rpo) {
+    for (uint32_t index : func.blocks[b].insts) {
+      const Inst &inst = func.insts[index];
+      if (inst.op == OP_PHI) {
+        for (uint32_t i = 0; i < inst.c; i++) {
+          Value v = func.lists[inst.b + 2 * i];
+          if (cfg.reachable(func.lists[inst.b + 2 * i + 1]) &&
+              (kindOf(v) == VK_INST || kindOf(v) == VK_ARG))
+            useCount[valueId(v)]++;
+        }
+        continue;
+      }
+      forEachOperand(func, inst, [&](Value v) {
+        if (kindOf(v) == VK_INST || kindOf(v) == VK_ARG) useCount[valueId(v)]++;
+      });
+    }
+  }
+  // 同一块内只用一次的比较并入条件跳转（直接用标志位），
+  // 地址计算并入访存指令的寻址方式
+  for (uint32_t b : cfg.rpo) {
+    for (uint32_t index : func.blocks[b].insts) {
+      const Inst &inst = func.insts[index];
+      if (inst.op != OP_CONDBR && inst.op != OP_LOAD && inst.op != OP_STORE)
+        continue;
+      if (kindOf(inst.a) != VK_INST) continue;
+      const Inst &def = func.insts[indexOf(inst.a)];
+      if (def.block != b || useCount[indexOf(inst.a)] != 1) continue;
+      if (inst.op == OP_CONDBR ? isCompare(def.op) : def.op == OP_GEP)
+        fusedInto[indexOf(inst.a)] = index;
+    }
+  }
+}
+
+void FunctionEmitter::intervals() {
+  uint32_t numValues = func.insts.size() + func.params.size();
+  // 按值收集使用位置（CSR）：合并进使用者的指令，其操作数在使用者处被使用
+  std::vector<uint32_t> first(numValues + 1, 0);
+  std::vector<Use> uses;
+  auto walk = [&](auto fn) {
+    for (uint32_t b : cfg.rpo) {
+      for (uint32_t index : func.blocks[b].insts) {
+        const Inst &inst = func.insts[index];
+        if (inst.op == OP_PHI) {
+          for (uint32_t i = 0; i < inst.c; i++) {
+            Value v = func.lists[inst.b + 2 * i];
+            uint32_t pred = func.lists[inst.b + 2 * i + 1];
+            if (cfg.reachable(pred) && needsLoc(v)) fn(v, Use{pred, to[pred], true});
+          }
+          continue;
+        }
+        int32_t at = fusedInto[index] != NONE ? pos[fusedInto[index]] : pos[index];
+        forEachOperand(func, inst, [&](Value v) {
+          if (needsLoc(v)) fn(v, Use{b, at, false});
+        });
+      }
+    }
+  };
+  walk([&](Value v, Use) { first[valueId(v) + 1]++; });
+  for (uint32_t i = 0; i < numValues; i++) first[i + 1] += first[i];
+  uses.resize(first[numValues]);
+  std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+  walk([&](Value v, Use use) { uses[fill[valueId(v)]++] = use; });
+
+  // 沿使用处逆着控制流找到定义块，经过的块里值都活跃
+  std::vector<uint32_t> mark(func.blocks.size(), NONE);
+  std::vector<uint32_t> work;
+  locs.assign(numValues, Loc());
+  for (uint32_t v = 0; v < numValues; v++) {
+    bool isArg = v >= func.insts.size();
+    uint32_t defBlock = 0;
+    int32_t start = -1;
+    IRType type;
+    if (isArg) {
+      type = func.params[v - func.insts.size()];
+    } else {
+      const Inst &inst = func.insts[v];
+      if (pos[v] < 0 || !needsLoc(makeValue(VK_INST, v))) continue;
+      defBlock = inst.block;
+      start = inst.op == OP_PHI ? from[defBlock] : pos[v];
+      type = inst.type;
+      // 没有使用的调用结果不需要位置；其余无用的指令仍要有地方写
+      if (first[v] == first[v + 1] && inst.op == OP_CALL) continue;
+    }
+    if (isArg && first[v] == first[v + 1]) continue;
+    int32_t end = start;
+    for (uint32_t k = first[v]; k < first[v + 1]; k++) {
+      const Use &use = uses[k];
+      end = std::max(end, use.pos);
+      if (use.block != defBlock) work.push_back(use.block);
+    }
+    while (!work.empty()) {
+      uint32_t b = work.back();
+      work.pop_back();
+      if (mark[b] == v) continue;
+      mark[b] = v;
+      start = std::min(start, from[b]);
+      for (uint32_t pred : cfg.preds[b]) {
+        if (!cfg.reachable(pred)) continue;
+        end = std::max(end, to[pred]);
+        if (pred != defBlock && mark[pred] != v) work.push_back(pred);
+      }
+    }
+    auto call = std::upper_bound(callPos.begin(), callPos.end(), start);
+    bool crosses = call != callPos.end() && *call < end;
+    ranges.push_back({v, start, end, type == IR_F32, crosses});
+  }
+}
+
+void FunctionEmitter::allocate() {
+  std::sort(ranges.begin(), ranges.end(),
+            [](const Interval &a, const Interval &b) {
+              return a.start != b.start ? a.start < b.start : a.id < b.id;
+            });
+  std::vector<const Interval *> active;
+  std::vector<bool> busy(NUM_REGS, false);
+  std::vector<bool> used(NUM_REGS, false);
+  auto spill = [&](const Interval &iv) {
+    uint32_t arg = iv.id - func.insts.size();
+    if (iv.id >= func.insts.size() && paramLocs[arg].kind == Loc::MEM) {
+      locs[iv.id] = paramLocs[arg];  // 栈上传入的形参就留在原处
+      return;
+    }
+    frameSize += 8;
+    locs[iv.id] = Loc::inMem(-frameSize);
+  };
+  std::vector<Reg> candidates;
+  for (const Interval &iv : ranges) {
+    // 区间端点相同也不共用寄存器：同一位置定义的 PHI 不会互相覆盖
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [&](const Interval *other) {
+                                  if (other->end >= iv.start) return false;
+                                  busy[locs[other->id].reg] = false;
+                                  return true;
+                                }),
+                 active.end());
+    candidates.clear();
+    if (iv.isFloat) {
+      if (!iv.crossesCall)
+        for (uint32_t i = 0; i < FLOAT_REGS; i++) candidates.push_back(Reg(XMM0 + i));
+    } else {
+      if (!iv.crossesCall)
+        candidates.insert(candidates.end(), std::begin(CALLER_SAVED),
+                          std::end(CALLER_SAVED));
+      candidates.insert(candidates.end(), std::begin(CALLEE_SAVED),
+                        std::end(CALLEE_SAVED));
+    }
+    Reg chosen = NO_REG;
+    for (Reg r : candidates) {
+      if (!busy[r]) {
+        chosen = r;
+        break;
+      }
+    }
+    if (chosen == NO_REG) {
+      // 没有空闲寄存器：溢出结束得最晚的那个区间
+      const Interval *victim = nullptr;
+      for (const Interval *other : active) {
+        Reg r = locs[other->id].reg;
+        if (std::find(candidates.begin(), candidates.end(), r) ==
+            candidates.end())
+          continue;
+        if (victim == nullptr || other->end > victim->end) victim = other;
+      }
+      if (victim == nullptr || victim->end <= iv.end) {
+        spill(iv);
+        continue;
+      }
+      chosen = locs[victim->id].reg;
+      spill(*victim);
+      active.erase(std::find(active.begin(), active.end(), victim));
+    }
+    busy[chosen] = true;
+    used[chosen] = true;
+    locs[iv.id] = Loc::inReg(chosen);
+    active.push_back(&iv);
+  }
+  for (Reg r : CALLEE_SAVED) {
+    if (!used[r]) continue;
+    saved.push_back(r);
+    frameSize += 8;
+    saveOffset.push_back(-frameSize);
+  }
+}
+
+void FunctionEmitter::layoutFrame() {
+  allocaOffset.assign(func.insts.size(), 0);
+  for (uint32_t b : cfg.rpo) {
+    for (uint32_t index : func.blocks[b].insts) {
+      const Inst &inst = func.insts[index];
+      if (inst.op == OP_ALLOCA) {
+        frameSize += (inst.a * 4 + 7) & ~7;
+        allocaOffset[index] = -frameSize;
+      } else if (inst.op == OP_CALL) {
+        uint32_t ints = 0, floats = 0;
+        for (uint32_t i = 0; i < inst.c; i++) {
+          if (func.typeOf(func.lists[inst.b + i]) == IR_F32)
+            floats++;
+          else
+            ints++;
+        }
+        uint32_t onStack = (ints > 6 ? ints - 6 : 0) +
+                           (floats > FLOAT_ARGS ? floats - FLOAT_ARGS : 0);
+        outgoing = std::max(outgoing, onStack * 8);
+      }
+    }
+  }
+  // 调用时 %rsp 按 16 字节对齐
+  frameSize = (frameSize + outgoing + 15) & ~15;
+}
+
+std::string FunctionEmitter::constLabel(Value v) {
+  uint32_t index = indexOf(v);
+  if (!constUsed[index]) {
+    constUsed[index] = true;
+    usedConsts.push_back(index);
+  }
+  return format(".LC%u_%u(%%rip)", id, index);
+}
+
+std::string FunctionEmitter::operand(Value v) {
+  if (func.isConst(v)) {
+    if (func.typeOf(v) == IR_F32) return constLabel(v);
+    return format("$%d", func.intOf(v));
+  }
+  Loc loc = locOf(v);
+  if (loc.kind == Loc::REG)
+    return std::string("%") + regName(loc.reg, func.typeOf(v));
+  return mem(loc.offset);
+}
+
+std::string FunctionEmitter::addressOf(Value v, int64_t disp) {
+  if (kindOf(v) == VK_GLOBAL) {
+    std::string name(interner.name(module.globals[indexOf(v)].name));
+    if (disp == 0) return name + "(%rip)";
+    return format("%s%+" PRId64 "(%%rip)", name.c_str(), disp);
+  }
+  return mem(allocaOffset[indexOf(v)] + disp);
+}
+
+std::string FunctionEmitter::base(Value v, int64_t disp) {
+  if (isAddress(v)) return addressOf(v, disp);
+  Reg r = regOf(v);
+  if (r == NO_REG) {
+    moveInto(R11, v);
+    r = R11;
+  }
+  if (disp == 0) return format("(%%%s)", REG64[r]);
+  return format("%" PRId64 "(%%%s)", disp, REG64[r]);
+}
+
+std::string FunctionEmitter::gepAddress(const Inst &gep) {
+  int64_t scale = int64_t(gep.c) * 4;
+  if (func.isConst(gep.b)) {
+    int64_t disp = func.intOf(gep.b) * scale;
+    if (disp > INT32_MIN / 2 && disp < INT32_MAX / 2) return base(gep.a, disp);
+  }
+  // 下标符号扩展到 64 位放进 RAX，基址不在寄存器中时放进 R11
+  if (func.isConst(gep.b))
+    ins("movq $%d, %%rax", func.intOf(gep.b));
+  else
+    ins("movslq %s, %%rax", operand(gep.b).c_str());
+  if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+    ins("imulq $%" PRId64 ", %%rax, %%rax", scale);
+    scale = 1;
+  }
+  if (kindOf(gep.a) == VK_INST && func.insts[indexOf(gep.a)].op == OP_ALLOCA)
+    return format("%d(%%rbp,%%rax,%" PRId64 ")", allocaOffset[indexOf(gep.a)],
+                  scale);
+  Reg r = regOf(gep.a);
+  if (r == NO_REG) {
+    moveInto(R11, gep.a);
+    r = R11;
+  }
+  return format("(%%%s,%%rax,%" PRId64 ")", REG64[r], scale);
+}
+
+std::string FunctionEmitter::address(Value v) {
+  if (kindOf(v) == VK_INST && fusedInto[indexOf(v)] != NONE)
+    return gepAddress(func.insts[indexOf(v)]);
+  return base(v, 0);
+}
+
+void FunctionEmitter::load(Reg r, const std::string &src, IRType type) {
+  if (isXmm(r))
+    ins("movss %s, %%%s", src.c_str(), XMM[r - XMM0]);
+  else if (type == IR_PTR)
+    ins("movq %s, %%%s", src.c_str(), REG64[r]);
+  else
+    ins("movl %s, %%%s", src.c_str(), REG32[r]);
+}
+
+void FunctionEmitter::store(const std::string &dst, Reg r, IRType type) {
+  if (isXmm(r))
+    ins("movss %%%s, %s", XMM[r - XMM0], dst.c_str());
+  else if (type == IR_PTR)
+    ins("movq %%%s, %s", REG64[r], dst.c_str());
+  else
+    ins("movl %%%s, %s", REG32[r], dst.c_str());
+}
+
+void FunctionEmitter::moveReg(Reg dst, Reg src, IRType type) {
+  if (dst == src) return;
+  if (isXmm(dst) && isXmm(src))
+    ins("movaps %%%s, %%%s", XMM[src - XMM0], XMM[dst - XMM0]);
+  else if (isXmm(dst))
+    ins("movd %%%s, %%%s", REG32[src], XMM[dst - XMM0]);
+  else if (isXmm(src))
+    ins("movd %%%s, %%%s", XMM[src - XMM0], REG32[dst]);
+  else if (type == IR_PTR)
+    ins("movq %%%s, %%%s", REG64[src], REG64[dst]);
+  else
+    ins("movl %%%s, %%%s", REG32[src], REG32[dst]);
+}
+
+void FunctionEmitter::moveInto(Reg r, Value v) {
+  if (isAddress(v)) {
+    ins("leaq %s, %%%s", addressOf(v, 0).c_str(), REG64[r]);
+    return;
+  }
+  if (func.isConst(v)) {
+    if (isXmm(r))
+      ins("movss %s, %%%s", constLabel(v).c_str(), XMM[r - XMM0]);
+    else if (func.intOf(v) == 0)
+      ins("xorl %%%s, %%%s", REG32[r], REG32[r]);
+    else
+      ins("movl $%d, %%%s", func.intOf(v), REG32[r]);
+    return;
+  }
+  Loc loc = locOf(v);
+  if (loc.kind == Loc::REG)
+    moveReg(r, loc.reg, func.typeOf(v));
+  else
+    load(r, mem(loc.offset), func.typeOf(v));
+}
+
+void FunctionEmitter::finish(uint32_t index, Reg r) {
+  Loc loc = locs[index];
+  if (loc.kind == Loc::REG)
+    moveReg(loc.reg, r, func.insts[index].type);
+  else if (loc.kind == Loc::MEM)
+    store(mem(loc.offset), r, func.insts[index].type);
+}
+
+void FunctionEmitter::moveLoc(const Move &move) {
+  const Loc &dst = move.dst, &src = move.src;
+  if (src.kind == Loc::NONE) {
+    if (dst.kind == Loc::REG) {
+      moveInto(dst.reg, move.value);
+    } else if (func.isConst(move.value) && move.type != IR_F32) {
+      ins("movl $%d, %s", func.intOf(move.value), mem(dst.offset).c_str());
+    } else if (func.isConst(move.value)) {
+      ins("movl %s, %%eax", constLabel(move.value).c_str());
+      ins("movl %%eax, %s", mem(dst.offset).c_str());
+    } else {
+      ins("leaq %s, %%rax", addressOf(move.value, 0).c_str());
+      ins("movq %%rax, %s", mem(dst.offset).c_str());
+    }
+  } else if (src.kind == Loc::REG && dst.kind == Loc::REG) {
+    moveReg(dst.reg, src.reg, move.type);
+  } else if (src.kind == Loc::REG) {
+    store(mem(dst.offset), src.reg, move.type);
+  } else if (dst.kind == Loc::REG) {
+    load(dst.reg, mem(src.offset), move.type);
+  } else {
+    ins("movq %s, %%rax", mem(src.offset).c_str());
+    ins("movq %%rax, %s", mem(dst.offset).c_str());
+  }
+}
+
+void FunctionEmitter::parallelMove(std::vector<Move> &moves) {
+  moves.erase(std::remove_if(moves.begin(), moves.end(),
+                             [](const Move &move) {
+                               return move.dst.kind == Loc::NONE ||
+                                      (move.src.kind != Loc::NONE &&
+                                       move.src == move.dst);
+                             }),
+              moves.end());
+  auto isRead = [&](const Loc &loc, size_t except) {
+    for (size_t j = 0; j < moves.size(); j++)
+      if (j != except && moves[j].src.kind != Loc::NONE && moves[j].src == loc)
+        return true;
+    return false;
+  };
+  while (!moves.empty()) {
+    bool progress = false;
+    for (size_t i = 0; i < moves.size();) {
+      if (isRead(moves[i].dst, i)) {
+        i++;
+        continue;
+      }
+      moveLoc(moves[i]);
+      moves.erase(moves.begin() + i);
+      progress = true;
+    }
+    if (progress) continue;
+    // 剩下的拷贝成环：把一个目标的旧值挪到临时寄存器，环就断开了
+    Loc old = moves[0].dst;
+    Reg tmp = old.kind == Loc::REG && isXmm(old.reg) ? XMM15 : R11;
+    IRType type = IR_I32;
+    for (auto &move : moves)
+      if (move.src == old) type = move.type;
+    moveLoc({Loc::inReg(tmp), NO_VALUE, old, type == IR_F32 && tmp == R11 ? IR_PTR : type});
+    for (auto &move : moves)
+      if (move.src.kind != Loc::NONE && move.src == old) move.src = Loc::inReg(tmp);
+  }
+}
+
+void FunctionEmitter::prologue() {
+  std::string_view name = interner.name(func.name);
+  out.write("\t.text\n\t.globl ");
+  out.write(name);
+  out.write("\n\t.type ");
+  out.write(name);
+  out.write(", @function\n");
+  out.write(name);
+  out.write(":\n");
+  ins("pushq %%rbp");
+  ins("movq %%rsp, %%rbp");
+  if (frameSize > 0) ins("subq $%d, %%rsp", frameSize);
+  for (size_t i = 0; i < saved.size(); i++)
+    ins("movq %%%s, %s", REG64[saved[i]], mem(saveOffset[i]).c_str());
+  std::vector<Move> moves;
+  for (uint32_t i = 0; i < func.params.size(); i++)
+    moves.push_back({locs[func.insts.size() + i], NO_VALUE, paramLocs[i],
+                     func.params[i]});
+  parallelMove(moves);
+}
+
+void FunctionEmitter::epilogue() {
+  for (size_t i = 0; i < saved.size(); i++)
+    ins("movq %s, %%%s", mem(saveOffset[i]).c_str(), REG64[saved[i]]);
+  ins("leave");
+  ins("ret");
+}
+
+const char *FunctionEmitter::compareInt(Opcode op, Value a, Value b) {
+  bool swapped = func.isConst(a) && !func.isConst(b);
+  if (swapped) std::swap(a, b);
+  // cmp 的第二个操作数不能是立即数，两个操作数不能都在内存里
+  std::string lhs;
+  if (func.isConst(a) ||
+      (regOf(a) == NO_REG && regOf(b) == NO_REG && !func.isConst(b))) {
+    moveInto(RAX, a);
+    lhs = "%eax";
+  } else {
+    lhs = operand(a);
+  }
+  ins("cmpl %s, %s", operand(b).c_str(), lhs.c_str());
+  return (swapped ? SWAPPED_CC : INT_CC)[op - OP_EQ];
+}
+
+const char *FunctionEmitter::compareFloat(Opcode op, Value a, Value b) {
+  // ucomiss x, y 按 y - x 置标志位；无序（NaN）时 ZF、PF、CF 都为 1，
+  // 所以 a < b 写成 b > a，用 above 系列条件码
+  if (op == OP_FLT || op == OP_FLE) std::swap(a, b);
+  Reg r = regOf(a);
+  if (r == NO_REG) {
+    moveInto(XMM15, a);
+    r = XMM15;
+  }
+  ins("ucomiss %s, %%%s", operand(b).c_str(), XMM[r - XMM0]);
+  switch (op) {
+    case OP_FEQ: return "e";
+    case OP_FNE: return "ne";
+    case OP_FLT: case OP_FGT: return "a";
+    default: return "ae";
+  }
+}
+
+void FunctionEmitter::call(uint32_t index, const Inst &inst) {
+  const Function &callee = module.functions[inst.a];
+  std::vector<Move> moves;
+  std::vector<Value> onStack;
+  uint32_t ints = 0, floats = 0;
+  for (uint32_t i = 0; i < inst.c; i++) {
+    Value v = func.lists[inst.b + i];
+    IRType type = func.typeOf(v);
+    Loc dst;
+    if (type == IR_F32 && floats < FLOAT_ARGS)
+      dst = Loc::inReg(Reg(XMM0 + floats++));
+    else if (type != IR_F32 && ints < 6)
+      dst = Loc::inReg(INT_ARGS[ints++]);
+    else
+      onStack.push_back(v);
+    if (dst.kind != Loc::NONE)
+      moves.push_back({dst, v, isAddress(v) ? Loc() : locOf(v), type});
+  }
+  for (size_t k = 0; k < onStack.size(); k++) {
+    Reg r = func.typeOf(onStack[k]) == IR_F32 ? XMM15 : RAX;
+    moveInto(r, onStack[k]);
+    store(format("%zu(%%rsp)", 8 * k), r, func.typeOf(onStack[k]));
+  }
+  parallelMove(moves);
+  std::string_view name = interner.name(callee.name);
+  ins("call %.*s", static_cast<int>(name.size()), name.data());
+  if (inst.type != IR_VOID) finish(index, inst.type == IR_F32 ? XMM0 : RAX);
+}
+
+void FunctionEmitter::inst(uint32_t index) {
+  const Inst &inst = func.insts[index];
+  // 结果没人用的纯运算不必生成
+  if (isPure(inst.op) && useCount[index] == 0) return;
+  switch (inst.op) {
+    case OP_ADD: case OP_SUB: case OP_MUL: {
+      static const char *const NAMES[] = {"addl", "subl", "imull"};
+      Value a = inst.a, b = inst.b;
+      Reg r = dstReg(index, RAX);
+      if (inst.op != OP_SUB && r == regOf(b)) std::swap(a, b);
+      if (r == regOf(b) && r != regOf(a)) r = RAX;
+      moveInto(r, a);
+      ins("%s %s, %%%s", NAMES[inst.op - OP_ADD], operand(b).c_str(), REG32[r]);
+      finish(index, r);
+      break;
+    }
+    case OP_DIV: case OP_MOD:
+      moveInto(RAX, inst.a);
+      ins("cltd");
+      if (func.isConst(inst.b)) {
+        moveInto(R11, inst.b);
+        ins("idivl %%r11d");
+      } else {
+        ins("idivl %s", operand(inst.b).c_str());
+      }
+      finish(index, inst.op == OP_DIV ? RAX : RDX);
+      break;
+    case OP_FADD: case OP_FSUB: case OP_FMUL: case OP_FDIV: {
+      static const char *const NAMES[] = {"addss", "subss", "mulss", "divss"};
+      Value a = inst.a, b = inst.b;
+      Reg r = dstReg(index, XMM15);
+      if ((inst.op == OP_FADD || inst.op == OP_FMUL) && r == regOf(b))
+        std::swap(a, b);
+      if (r == regOf(b) && r != regOf(a)) r = XMM15;
+      moveInto(r, a);
+      ins("%s %s, %%%s", NAMES[inst.op - OP_FADD], operand(b).c_str(),
+          XMM[r - XMM0]);
+      finish(index, r);
+      break;
+    }
+    case OP_FNEG: {
+      Reg r = dstReg(index, XMM15);
+      moveInto(r, inst.a);
+      ins("movl $0x80000000, %%eax");
+      ins("movd %%eax, %%xmm14");
+      ins("xorps %%xmm14, %%%s", XMM[r - XMM0]);
+      finish(index, r);
+      break;
+    }
+    case OP_EQ: case OP_NE: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+    case OP_FEQ: case OP_FNE: case OP_FLT: case OP_FLE: case OP_FGT:
+    case OP_FGE: {
+      if (inst.op >= OP_FEQ) {
+        const char *cc = compareFloat(inst.op, inst.a, inst.b);
+        ins("set%s %%al", cc);
+        // 相等要求有序，不等在无序时也成立
+        if (inst.op == OP_FEQ) {
+          ins("setnp %%dl");
+          ins("andb %%dl, %%al");
+        } else if (inst.op == OP_FNE) {
+          ins("setp %%dl");
+          ins("orb %%dl, %%al");
+        }
+      } else {
+        ins("set%s %%al", compareInt(inst.op, inst.a, inst.b));
+      }
+      Reg r = dstReg(index, RAX);
+      ins("movzbl %%al, %%%s", REG32[r]);
+      finish(index, r);
+      break;
+    }
+    case OP_ITOF: {
+      Reg r = dstReg(index, XMM15);
+      std::string src = "%eax";
+      if (func.isConst(inst.a))
+        moveInto(RAX, inst.a);
+      else
+        src = operand(inst.a);
+      // 先清零目标，断开对它旧值的依赖
+      ins("xorps %%%s, %%%s", XMM[r - XMM0], XMM[r - XMM0]);
+      ins("cvtsi2ssl %s, %%%s", src.c_str(), XMM[r - XMM0]);
+      finish(index, r);
+      break;
+    }
+    case OP_FTOI: {
+      Reg r = dstReg(index, RAX);
+      ins("cvttss2si %s, %%%s", operand(inst.a).c_str(), REG32[r]);
+      finish(index, r);
+      break;
+    }
+    case OP_GEP: {
+      std::string addr = gepAddress(inst);
+      Reg r = dstReg(index, RAX);
+      ins("leaq %s, %%%s", addr.c_str(), REG64[r]);
+      finish(index, r);
+      break;
+    }
+    case OP_LOAD: {
+      std::string addr = address(inst.a);
+      Reg r = dstReg(index, inst.type == IR_F32 ? XMM15 : RAX);
+      load(r, addr, inst.type);
+      finish(index, r);
+      break;
+    }
+    case OP_STORE: {
+      std::string addr = address(inst.a);
+      IRType type = func.typeOf(inst.b);
+      Reg r = regOf(inst.b);
+      if (func.isConst(inst.b) && type != IR_F32) {
+        ins("movl $%d, %s", func.intOf(inst.b), addr.c_str());
+      } else if (r != NO_REG) {
+        store(addr, r, type);
+      } else {
+        // 栈槽、浮点常量和地址都经 RDX 中转
+        if (isAddress(inst.b))
+          moveInto(RDX, inst.b);
+        else
+          load(RDX, operand(inst.b), type == IR_PTR ? IR_PTR : IR_I32);
+        store(addr, RDX, type == IR_PTR ? IR_PTR : IR_I32);
+      }
+      break;
+    }
+    case OP_ZERO: {
+      std::string addr = address(inst.a);
+      ins("leaq %s, %%r11", addr.c_str());
+      uint32_t words = inst.b;
+      if (words <= 16) {
+        for (uint32_t k = 0; k + 1 < words; k += 2) ins("movq $0, %u(%%r11)", k * 4);
+        if (words % 2) ins("movl $0, %u(%%r11)", (words - 1) * 4);
+        break;
+      }
+      // rep stos 要用 RDI、RCX，它们可能正被分配给别的值
+      ins("pushq %%rdi");
+      ins("pushq %%rcx");
+      ins("movq %%r11, %%rdi");
+      ins("movl $%u, %%ecx", words);
+      ins("xorl %%eax, %%eax");
+      ins("rep stosl");
+      ins("popq %%rcx");
+      ins("popq %%rdi");
+      break;
+    }
+    case OP_CALL:
+      call(index, inst);
+      break;
+    case OP_ALLOCA:
+    case OP_PHI:
+    default:
+      break;
+  }
+}
+
+std::string FunctionEmitter::target(uint32_t from, uint32_t to) {
+  if (!hasPhis(to)) return blockLabel(to);
+  // 边上有 PHI 拷贝时先跳到函数末尾的拷贝代码
+  stubs.push_back({nextLabel, from, to});
+  return format(".L%u_s%u", id, nextLabel++);
+}
+
+void FunctionEmitter::edgeMoves(uint32_t from, uint32_t to) {
+  std::vector<Move> moves;
+  for (uint32_t index : func.blocks[to].insts) {
+    const Inst &phi = func.insts[index];
+    if (phi.op != OP_PHI) break;
+    Value v = incoming(func, phi, from);
+    moves.push_back({locs[index], v, isAddress(v) ? Loc() : locOf(v), phi.type});
+  }
+  parallelMove(moves);
+}
+
+void FunctionEmitter::jump(const char *cc, const std::string &yes,
+                           const std::string &no, uint32_t to, uint32_t next) {
+  if (to == next && !hasPhis(to)) {
+    ins("j%s %s", invert(cc), no.c_str());
+    return;
+  }
+  ins("j%s %s", cc, yes.c_str());
+  ins("jmp %s", no.c_str());
+}
+
+void FunctionEmitter::terminator(uint32_t block, const Inst &inst,
+                                 uint32_t next) {
+  switch (inst.op) {
+    case OP_BR:
+      edgeMoves(block, inst.a);
+      if (inst.a != next) ins("jmp %s", blockLabel(inst.a).c_str());
+      break;
+    case OP_CONDBR: {
+      if (func.isConst(inst.a)) {
+        uint32_t taken = func.intOf(inst.a) != 0 ? inst.b : inst.c;
+        edgeMoves(block, taken);
+        if (taken != next) ins("jmp %s", blockLabel(taken).c_str());
+        break;
+      }
+      const char *cc = "ne";
+      Opcode op = OP_NOP;
+      if (kindOf(inst.a) == VK_INST && fusedInto[indexOf(inst.a)] != NONE) {
+        const Inst &cmp = func.insts[indexOf(inst.a)];
+        op = cmp.op;
+        cc = op >= OP_FEQ ? compareFloat(op, cmp.a, cmp.b)
+                          : compareInt(op, cmp.a, cmp.b);
+      } else if (regOf(inst.a) != NO_REG) {
+        ins("testl %s, %s", operand(inst.a).c_str(), operand(inst.a).c_str());
+      } else {
+        ins("cmpl $0, %s", operand(inst.a).c_str());
+      }
+      std::string yes = target(block, inst.b);
+      std::string no = target(block, inst.c);
+      bool fallThrough = inst.c == next && !hasPhis(inst.c);
+      if (op == OP_FEQ) {
+        ins("jp %s", no.c_str());
+        ins("je %s", yes.c_str());
+        if (!fallThrough) ins("jmp %s", no.c_str());
+      } else if (op == OP_FNE) {
+        ins("jp %s", yes.c_str());
+        ins("jne %s", yes.c_str());
+        if (!fallThrough) ins("jmp %s", no.c_str());
+      } else if (fallThrough) {
+        ins("j%s %s", cc, yes.c_str());
+      } else {
+        jump(cc, yes, no, inst.b, next);
+      }
+      break;
+    }
+    case OP_RET:
+      if (inst.a != NO_VALUE)
+        moveInto(func.typeOf(inst.a) == IR_F32 ? XMM0 : RAX, inst.a);
+      epilogue();
+      break;
+    default:
+      break;
+  }
+}
+
+void FunctionEmitter::run() {
+  number();
+  fuse();
+  // 形参传入的位置：前 6 个整数和前 8 个浮点用寄存器，其余在调用者的栈上
+  uint32_t ints = 0, floats = 0, stack = 0;
+  for (IRType type : func.params) {
+    if (type == IR_F32 && floats < FLOAT_ARGS)
+      paramLocs.push_back(Loc::inReg(Reg(XMM0 + floats++)));
+    else if (type != IR_F32 && ints < 6)
+      paramLocs.push_back(Loc::inReg(INT_ARGS[ints++]));
+    else
+      paramLocs.push_back(Loc::inMem(16 + 8 * stack++));
+  }
+  intervals();
+  allocate();
+  layoutFrame();
+  constUsed.assign(func.consts.size(), false);
+
+  prologue();
+  for (size_t i = 0; i < cfg.rpo.size(); i++) {
+    uint32_t b = cfg.rpo[i];
+    uint32_t next = i + 1 < cfg.rpo.size() ? cfg.rpo[i + 1] : NONE;
+    label(b);
+    auto &insts = func.blocks[b].insts;
+    for (size_t k = 0; k + 1 < insts.size(); k++)
+      if (fusedInto[insts[k]] == NONE) inst(insts[k]);
+    terminator(b, func.insts[insts.back()], next);
+  }
+  // 拷贝代码追加时可能用到新的浮点常量，但不会再产生新的 stub
+  for (auto &stub : stubs) {
+    out.write(format(".L%u_s%u:\n", id, stub.label));
+    edgeMoves(stub.from, stub.to);
+    ins("jmp %s", blockLabel(stub.to).c_str());
+  }
+  std::string_view name = interner.name(func.name);
+  out.write("\t.size ");
+  out.write(name);
+  out.write(", .-");
+  out.write(name);
+  out.put('\n');
+
+  if (usedConsts.empty()) return;
+  out.write("\t.section .rodata\n\t.align 4\n");
+  for (uint32_t index : usedConsts)
+    out.write(format(".LC%u_%u:\n\t.long 0x%08x\n", id, index,
+                     func.consts[index].bits));
+}
+
+void emitGlobal(const Global &global, OutBuffer &out) {
+  std::string_view name = interner.name(global.name);
+  std::string n(name);
+  if (global.init.empty())
+    out.write("\t.bss\n");
+  else if (global.isConst)
+    out.write("\t.section .rodata\n");
+  else
+    out.write("\t.data\n");
+  out.write(format("\t.globl %s\n\t.align %d\n\t.type %s, @object\n"
+                   "\t.size %s, %u\n%s:\n",
+                   n.c_str(), global.size >= 4 ? 16 : 4, n.c_str(), n.c_str(),
+                   global.size * 4, n.c_str()));
+  if (global.init.empty()) {
+    out.write(format("\t.zero %u\n", global.size * 4));
+    return;
+  }
+  // 连续 4 个以上的 0 合成一条 .zero，其余每行最多 8 个字
+  int column = 0;
+  auto word = [&](uint32_t w) {
+    out.write(column == 0 ? "\t.long " : ",");
+    out.write(format("%u", w));
+    if (++column == 8) {
+      out.put('\n');
+      column = 0;
+    }
+  };
+  auto zeros = [&](uint32_t n) {
+    if (n < 4) {
+      for (uint32_t i = 0; i < n; i++) word(0);
+      return;
+    }
+    if (column > 0) out.put('\n');
+    column = 0;
+    out.write(format("\t.zero %u\n", n * 4));
+  };
+  uint32_t pos = 0;
+  for (auto &run : global.init) {
+    zeros(run.offset - pos);
+    for (uint32_t w : run.words) word(w);
+    pos = run.offset + run.words.size();
+  }
+  if (column > 0) out.put('\n');
+  if (pos < global.size)
+    out.write(format("\t.zero %u\n", (global.size - pos) * 4));
+}
+
+}  // namespace
+
+void emitX86(const Module &module, OutBuffer &out, ThreadPool *pool,
+             std::vector<std::string> *texts) {
+  bool parallel = pool != nullptr && pool->size() > 1;
+  if (!parallel && texts == nullptr) {
+    for (uint32_t i = 0; i < module.functions.size(); i++) {
+      const Function &func = module.functions[i];
+      if (!func.external) FunctionEmitter(module, func, i, out).run();
+    }
+  } else {
+    // 标号带函数下标，各函数的文本互不依赖，可以分别生成再按顺序拼接
+    std::vector<std::string> local;
+    if (texts == nullptr) texts = &local;
+    texts->resize(module.functions.size());
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < module.functions.size(); i++)
+      if (!module.functions[i].external && (*texts)[i].empty())
+        order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return module.functions[a].insts.size() > module.functions[b].insts.size();
+    });
+    auto emit = [&module, texts](uint32_t i) {
+      OutBuffer part;
+      FunctionEmitter(module, module.functions[i], i, part).run();
+      (*texts)[i] = std::move(part.str());
+    };
+    for (uint32_t i : order) {
+      if (parallel)
+        pool->submit([&emit, i] { emit(i); });
+      else
+        emit(i);
+    }
+    if (parallel) pool->wait();
+    for (auto &text : *texts) out.write(text);
+  }
+  for (auto &global : module.globals) emitGlobal(global, out);
+  out.write("\t.section .note.GNU-stack,\"\",@progbits\n");
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ir.h"
+#include "out_buffer.h"
+
+class ThreadPool;
+
+// x86-64 后端：把校验过的 IR 翻译成 GNU as 语法的汇编，遵循 SysV 调用约定，
+// 可以和 runtime/sylib.c 一起链接成可执行文件。
+// 寄存器分配是基于活跃区间的线性扫描（Poletto & Sarkar）：每个 SSA 值一个
+// 连续区间，跨过调用的整数值只用被调者保存的寄存器，跨过调用的浮点值溢出到栈上。
+// pool 不为空时各函数在线程池上并行生成到各自的缓冲区，再按原顺序拼接，
+// 输出与串行逐字节相同。texts 不为空时按函数下标给出各函数的汇编：
+// 非空的直接使用（增量编译命中缓存），其余生成后写回
+void emitX86(const Module &module, OutBuffer &out, ThreadPool *pool = nullptr,
+             std::vector<std::string> *texts = nullptr);
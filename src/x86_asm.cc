@@ -0,0 +1,455 @@
+#include "x86_asm.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const int8_t NO_REG = -1;
+const int8_t RIP = 16;
+
+const char *const REG64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp",
+                             "rsi", "rdi", "r8",  "r9",  "r10", "r11",
+                             "r12", "r13", "r14", "r15"};
+const char *const REG32[] = {"eax", "ecx", "edx",  "ebx",  "esp",  "ebp",
+                             "esi", "edi", "r8d",  "r9d",  "r10d", "r11d",
+                             "r12d", "r13d", "r14d", "r15d"};
+const char *const REG8[] = {"al", "cl", "dl", "bl"};
+
+// 条件码后缀及其编号（jcc 为 0F 80+cc，setcc 为 0F 90+cc）
+const struct {
+  const char *name;
+  uint8_t code;
+} CONDITIONS[] = {
+    {"o", 0},  {"no", 1}, {"b", 2},   {"ae", 3}, {"e", 4},   {"ne", 5},
+    {"be", 6}, {"a", 7},  {"s", 8},   {"ns", 9}, {"p", 10},  {"np", 11},
+    {"l", 12}, {"ge", 13}, {"le", 14}, {"g", 15},
+};
+
+struct Operand {
+  enum Kind : uint8_t { NONE, REG, XMM, IMM, MEM, SYM };
+  Kind kind = NONE;
+  uint8_t width = 0;  // REG 的位数：8、32 或 64
+  int8_t reg = NO_REG;  // REG、XMM 的编号；MEM 的基址（RIP 为 16）
+  int8_t index = NO_REG;
+  uint8_t scale = 1;
+  int64_t value = 0;  // IMM 的值或 MEM 的位移
+  std::string_view symbol;  // SYM，或 MEM 的符号位移
+};
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+    s.remove_suffix(1);
+  return s;
+}
+
+// 十进制或 0x 开头的十六进制整数，可带符号
+bool parseInt(std::string_view s, int64_t &value) {
+  if (s.empty() || s.size() > 24) return false;
+  char buf[32];
+  memcpy(buf, s.data(), s.size());
+  buf[s.size()] = '\0';
+  char *end;
+  value = strtoll(buf, &end, 0);
+  return *end == '\0';
+}
+
+bool parseReg(std::string_view name, Operand &op) {
+  for (int8_t r = 0; r < 16; r++) {
+    if (name == REG64[r] || name == REG32[r]) {
+      op.kind = Operand::REG;
+      op.reg = r;
+      op.width = name == REG64[r] ? 64 : 32;
+      return true;
+    }
+  }
+  for (int8_t r = 0; r < 4; r++) {
+    if (name == REG8[r]) {
+      op.kind = Operand::REG;
+      op.reg = r;
+      op.width = 8;
+      return true;
+    }
+  }
+  if (name.size() >= 4 && name.size() <= 5 && name.substr(0, 3) == "xmm") {
+    int64_t n;
+    if (!parseInt(name.substr(3), n) || n < 0 || n > 15) return false;
+    op.kind = Operand::XMM;
+    op.reg = static_cast<int8_t>(n);
+    return true;
+  }
+  return false;
+}
+
+// disp(%base,%index,scale)，disp 可以是数字、符号或 符号±数字
+bool parseMem(std::string_view s, Operand &op) {
+  op.kind = Operand::MEM;
+  size_t paren = s.find('(');
+  std::string_view head = s.substr(0, paren);
+  if (!head.empty()) {
+    if (head[0] == '-' || head[0] == '+' || (head[0] >= '0' && head[0] <= '9')) {
+      if (!parseInt(head, op.value)) return false;
+    } else {
+      size_t sign = head.find_first_of("+-", 1);
+      op.symbol = head.substr(0, sign);
+      if (sign != std::string_view::npos) {
+        std::string_view rest = head.substr(sign);
+        if (rest[0] == '+') rest.remove_prefix(1);
+        if (!parseInt(rest, op.value)) return false;
+      }
+    }
+  }
+  if (paren == std::string_view::npos) return false;  // 没有基址的绝对地址不支持
+  if (s.back() != ')') return false;
+  std::string_view inner = s.substr(paren + 1, s.size() - paren - 2);
+  std::string_view parts[3];
+  size_t n = 0;
+  while (n < 3) {
+    size_t comma = inner.find(',');
+    parts[n++] = trim(inner.substr(0, comma));
+    if (comma == std::string_view::npos) break;
+    inner.remove_prefix(comma + 1);
+  }
+  Operand reg;
+  if (parts[0] == "%rip") {
+    op.reg = RIP;
+  } else {
+    if (parts[0].empty() || parts[0][0] != '%' || !parseReg(parts[0].substr(1), reg) ||
+        reg.kind != Operand::REG || reg.width != 64)
+      return false;
+    op.reg = reg.reg;
+  }
+  if (n >= 2) {
+    if (parts[1].empty() || parts[1][0] != '%' || !parseReg(parts[1].substr(1), reg) ||
+        reg.kind != Operand::REG || reg.width != 64 || reg.reg == 4)
+      return false;
+    op.index = reg.reg;
+    int64_t scale = 1;
+    if (n == 3 && !parseInt(parts[2], scale)) return false;
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) return false;
+    op.scale = static_cast<uint8_t>(scale);
+  }
+  if (op.reg == RIP && (op.index != NO_REG || op.symbol.empty())) return false;
+  return true;
+}
+
+bool parseOperand(std::string_view s, Operand &op) {
+  if (s.empty()) return false;
+  if (s[0] == '%') return parseReg(s.substr(1), op);
+  if (s[0] == '$') {
+    op.kind = Operand::IMM;
+    return parseInt(s.substr(1), op.value);
+  }
+  if (s.find('(') != std::string_view::npos) return parseMem(s, op);
+  op.kind = Operand::SYM;
+  op.symbol = s;
+  return true;
+}
+
+bool fitsInt8(int64_t v) { return v >= -128 && v <= 127; }
+
+class Assembler {
+ public:
+  explicit Assembler(AsmObject &object) : object(object) {}
+
+  bool line(std::string_view s, std::string &error);
+
+ private:
+  std::vector<uint8_t> &code() { return object.bytes[section]; }
+  void byte(uint8_t b) { code().push_back(b); }
+  void imm(int64_t v, int size) {
+    for (int i = 0; i < size; i++) byte(static_cast<uint8_t>(v >> (8 * i)));
+  }
+
+  // 编码一条带 ModRM 的指令：可选的强制前缀（66/F3），REX，1-2 字节操作码，
+  // ModRM 的 reg 字段，r/m 操作数（寄存器或内存），以及跟在后面的立即数
+  bool encode(uint8_t prefix, bool wide, uint16_t opcode, uint8_t reg,
+              const Operand &rm, int immSize = 0, int64_t immValue = 0);
+  bool instruction(std::string_view mnemonic, Operand *ops, size_t count);
+  bool directive(std::string_view name, std::string_view args);
+  bool alu(uint8_t digit, bool wide, const Operand &src, const Operand &dst);
+  bool mov(bool wide, const Operand &src, const Operand &dst);
+  bool branch(uint16_t opcode, const Operand &target);
+
+  AsmObject &object;
+  AsmObject::Section section = AsmObject::TEXT;
+};
+
+bool Assembler::encode(uint8_t prefix, bool wide, uint16_t opcode, uint8_t reg,
+                       const Operand &rm, int immSize, int64_t immValue) {
+  bool isReg = rm.kind == Operand::REG || rm.kind == Operand::XMM;
+  if (!isReg && rm.kind != Operand::MEM) return false;
+  uint8_t rex = (wide ? 8 : 0) | ((reg >> 3) << 2);
+  if (isReg) {
+    rex |= rm.reg >> 3;
+  } else {
+    if (rm.index != NO_REG) rex |= (rm.index >> 3) << 1;
+    if (rm.reg != RIP) rex |= rm.reg >> 3;
+  }
+  if (prefix != 0) byte(prefix);
+  if (rex != 0) byte(0x40 | rex);
+  if (opcode > 0xff) byte(opcode >> 8);
+  byte(opcode & 0xff);
+  reg &= 7;
+  if (isReg) {
+    byte(0xc0 | (reg << 3) | (rm.reg & 7));
+  } else if (rm.reg == RIP) {
+    // RIP 相对：位移相对下一条指令，也就是要跳过其后的立即数
+    byte(0x05 | (reg << 3));
+    object.fixups.push_back({section, static_cast<uint32_t>(code().size()),
+                             std::string(rm.symbol), rm.value - 4 - immSize});
+    imm(0, 4);
+  } else {
+    if (!rm.symbol.empty()) return false;
+    uint8_t base = rm.reg & 7;
+    uint8_t mod = rm.value == 0 && base != 5 ? 0 : fitsInt8(rm.value) ? 1 : 2;
+    if (rm.index == NO_REG && base != 4) {
+      byte((mod << 6) | (reg << 3) | base);
+    } else {
+      static const uint8_t SCALE_BITS[] = {0, 0, 1, 0, 2, 0, 0, 0, 3};
+      uint8_t index = rm.index == NO_REG ? 4 : rm.index & 7;
+      byte((mod << 6) | (reg << 3) | 4);
+      byte((SCALE_BITS[rm.scale] << 6) | (index << 3) | base);
+    }
+    if (mod == 1) imm(rm.value, 1);
+    if (mod == 2) imm(rm.value, 4);
+  }
+  imm(immValue, immSize);
+  return true;
+}
+
+// add/or/and/sub/xor/cmp：digit 是 81/83 /digit 中的编号，也决定了寄存器形式的操作码
+bool Assembler::alu(uint8_t digit, bool wide, const Operand &src,
+                    const Operand &dst) {
+  if (src.kind == Operand::IMM) {
+    if (fitsInt8(src.value)) return encode(0, wide, 0x83, digit, dst, 1, src.value);
+    return encode(0, wide, 0x81, digit, dst, 4, src.value);
+  }
+  if (src.kind == Operand::REG) return encode(0, wide, digit * 8 + 1, src.reg, dst);
+  if (dst.kind != Operand::REG) return false;
+  return encode(0, wide, digit * 8 + 3, dst.reg, src);
+}
+
+bool Assembler::mov(bool wide, const Operand &src, const Operand &dst) {
+  if (src.kind == Operand::IMM) {
+    if (!wide && dst.kind == Operand::REG) {
+      if (dst.reg >= 8) byte(0x41);
+      byte(0xb8 + (dst.reg & 7));
+      imm(src.value, 4);
+      return true;
+    }
+    return encode(0, wide, 0xc7, 0, dst, 4, src.value);
+  }
+  if (src.kind == Operand::REG) return encode(0, wide, 0x89, src.reg, dst);
+  if (dst.kind != Operand::REG) return false;
+  return encode(0, wide, 0x8b, dst.reg, src);
+}
+
+// jmp/jcc/call：总是用 32 位相对位移
+bool Assembler::branch(uint16_t opcode, const Operand &target) {
+  if (target.kind != Operand::SYM) return false;
+  if (opcode > 0xff) byte(opcode >> 8);
+  byte(opcode & 0xff);
+  object.fixups.push_back({section, static_cast<uint32_t>(code().size()),
+                           std::string(target.symbol), -4});
+  imm(0, 4);
+  return true;
+}
+
+bool Assembler::instruction(std::string_view m, Operand *ops, size_t count) {
+  const Operand &a = ops[0], &b = ops[1];
+  auto is = [&](Operand::Kind k0, Operand::Kind k1) {
+    return count == 2 && a.kind == k0 && b.kind == k1;
+  };
+  if (count == 0) {
+    static const struct {
+      const char *name;
+      uint8_t opcode;
+    } SIMPLE[] = {{"ret", 0xc3}, {"leave", 0xc9}, {"cltd", 0x99}};
+    for (auto &op : SIMPLE) {
+      if (m != op.name) continue;
+      byte(op.opcode);
+      return true;
+    }
+    return false;
+  }
+  if (count == 1) {
+    if (m == "pushq" || m == "popq") {
+      if (a.kind != Operand::REG || a.width != 64) return false;
+      if (a.reg >= 8) byte(0x41);
+      byte((m == "pushq" ? 0x50 : 0x58) + (a.reg & 7));
+      return true;
+    }
+    if (m == "jmp") return branch(0xe9, a);
+    if (m == "call") return branch(0xe8, a);
+    if (m == "idivl") return encode(0, false, 0xf7, 7, a);
+    for (auto &cond : CONDITIONS) {
+      if (m.size() > 1 && m[0] == 'j' && m.substr(1) == cond.name)
+        return branch(0x0f80 + cond.code, a);
+      if (m.size() > 3 && m.substr(0, 3) == "set" && m.substr(3) == cond.name)
+        return a.kind == Operand::REG && a.width == 8 &&
+               encode(0, false, 0x0f90 + cond.code, 0, a);
+    }
+    return false;
+  }
+  if (count == 3) {
+    // imulq $imm, src, dst
+    if (m != "imulq" || a.kind != Operand::IMM || ops[2].kind != Operand::REG)
+      return false;
+    return encode(0, true, 0x69, ops[2].reg, b, 4, a.value);
+  }
+
+  if (m == "movl" || m == "movq") return mov(m == "movq", a, b);
+  if (m == "addl") return alu(0, false, a, b);
+  if (m == "subl") return alu(5, false, a, b);
+  if (m == "subq") return alu(5, true, a, b);
+  if (m == "cmpl") return alu(7, false, a, b);
+  if (m == "xorl") return alu(6, false, a, b);
+  if (m == "andb" && is(Operand::REG, Operand::REG)) return encode(0, false, 0x20, a.reg, b);
+  if (m == "orb" && is(Operand::REG, Operand::REG)) return encode(0, false, 0x08, a.reg, b);
+  if (m == "testl" && a.kind == Operand::REG) return encode(0, false, 0x85, a.reg, b);
+  if (m == "imull" && b.kind == Operand::REG) {
+    if (a.kind == Operand::IMM) return encode(0, false, 0x69, b.reg, b, 4, a.value);
+    return encode(0, false, 0x0faf, b.reg, a);
+  }
+  if (m == "leaq" && is(Operand::MEM, Operand::REG)) return encode(0, true, 0x8d, b.reg, a);
+  if (m == "movslq" && b.kind == Operand::REG) return encode(0, true, 0x63, b.reg, a);
+  if (m == "movzbl" && is(Operand::REG, Operand::REG) && a.width == 8)
+    return encode(0, false, 0x0fb6, b.reg, a);
+  if (m == "movss") {
+    if (b.kind == Operand::XMM) return encode(0xf3, false, 0x0f10, b.reg, a);
+    if (a.kind == Operand::XMM) return encode(0xf3, false, 0x0f11, a.reg, b);
+    return false;
+  }
+  if (m == "movaps" && is(Operand::XMM, Operand::XMM))
+    return encode(0, false, 0x0f28, b.reg, a);
+  if (m == "movd") {
+    if (is(Operand::REG, Operand::XMM)) return encode(0x66, false, 0x0f6e, b.reg, a);
+    if (is(Operand::XMM, Operand::REG)) return encode(0x66, false, 0x0f7e, a.reg, b);
+    return false;
+  }
+  if (m == "cvtsi2ssl" && b.kind == Operand::XMM)
+    return encode(0xf3, false, 0x0f2a, b.reg, a);
+  if (m == "cvttss2si" && b.kind == Operand::REG)
+    return encode(0xf3, false, 0x0f2c, b.reg, a);
+  if (b.kind != Operand::XMM) return false;
+  // 标量单精度运算：xmm/m32 -> xmm
+  static const struct {
+    const char *name;
+    uint8_t prefix;
+    uint16_t opcode;
+  } SSE[] = {
+      {"addss", 0xf3, 0x0f58}, {"subss", 0xf3, 0x0f5c}, {"mulss", 0xf3, 0x0f59},
+      {"divss", 0xf3, 0x0f5e}, {"xorps", 0, 0x0f57},    {"ucomiss", 0, 0x0f2e},
+  };
+  for (auto &op : SSE)
+    if (m == op.name) return encode(op.prefix, false, op.opcode, b.reg, a);
+  return false;
+}
+
+bool Assembler::directive(std::string_view name, std::string_view args) {
+  if (name == ".text") {
+    section = AsmObject::TEXT;
+  } else if (name == ".data") {
+    section = AsmObject::DATA;
+  } else if (name == ".bss") {
+    section = AsmObject::BSS;
+  } else if (name == ".section") {
+    // 除了 .rodata 都是不需要装载的节（如 .note.GNU-stack）
+    section = args == ".rodata" ? AsmObject::RODATA : AsmObject::NO_SECTION;
+  } else if (name == ".globl" || name == ".type" || name == ".size") {
+    // 所有符号都在同一张表里，不区分可见性
+  } else if (name == ".align" || name == ".zero") {
+    int64_t n;
+    if (!parseInt(args, n) || n < 0 || section == AsmObject::NO_SECTION) return false;
+    if (name == ".align") {
+      if (n == 0 || (n & (n - 1)) != 0) return false;
+      object.align[section] = std::max<uint32_t>(object.align[section], n);
+    }
+    size_t &size = object.size[section];
+    if (section != AsmObject::BSS) size = code().size();
+    size_t target = name == ".align" ? (size + n - 1) / n * n : size + n;
+    if (section == AsmObject::BSS)
+      size = target;
+    else
+      code().resize(target, 0);
+  } else if (name == ".long") {
+    if (section == AsmObject::NO_SECTION || section == AsmObject::BSS) return false;
+    while (!args.empty()) {
+      size_t comma = args.find(',');
+      int64_t v;
+      if (!parseInt(trim(args.substr(0, comma)), v)) return false;
+      imm(v, 4);
+      if (comma == std::string_view::npos) break;
+      args.remove_prefix(comma + 1);
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool Assembler::line(std::string_view s, std::string &error) {
+  s = trim(s);
+  if (s.empty()) return true;
+  if (s.back() == ':') {
+    if (section == AsmObject::NO_SECTION) return true;
+    std::string name(s.substr(0, s.size() - 1));
+    uint32_t offset = static_cast<uint32_t>(
+        section == AsmObject::BSS ? object.size[section] : code().size());
+    if (!object.symbols.emplace(name, AsmObject::Symbol{section, offset}).second) {
+      error = "duplicate symbol '" + name + "'";
+      return false;
+    }
+    return true;
+  }
+  size_t space = s.find_first_of(" \t");
+  std::string_view mnemonic = s.substr(0, space);
+  std::string_view args =
+      space == std::string_view::npos ? std::string_view() : trim(s.substr(space));
+  bool ok;
+  if (mnemonic[0] == '.') {
+    ok = directive(mnemonic, args);
+  } else if (section != AsmObject::TEXT) {
+    ok = false;
+  } else if (mnemonic == "rep" && args == "stosl") {
+    byte(0xf3);
+    byte(0xab);
+    ok = true;
+  } else {
+    // 按不在括号里的逗号切分操作数
+    Operand ops[3];
+    size_t count = 0;
+    ok = true;
+    while (ok && !args.empty()) {
+      size_t depth = 0, i = 0;
+      for (; i < args.size(); i++) {
+        if (args[i] == '(') depth++;
+        if (args[i] == ')') depth--;
+        if (args[i] == ',' && depth == 0) break;
+      }
+      ok = count < 3 && parseOperand(trim(args.substr(0, i)), ops[count++]);
+      args.remove_prefix(std::min(i + 1, args.size()));
+    }
+    ok = ok && instruction(mnemonic, ops, count);
+  }
+  if (!ok) error = "unsupported assembly: " + std::string(s);
+  return ok;
+}
+
+}  // namespace
+
+bool assembleX86(std::string_view text, AsmObject &object, std::string &error) {
+  Assembler assembler(object);
+  while (!text.empty()) {
+    size_t newline = text.find('\n');
+    if (!assembler.line(text.substr(0, newline), error)) return false;
+    if (newline == std::string_view::npos) break;
+    text.remove_prefix(newline + 1);
+  }
+  for (int s = 0; s < AsmObject::NUM_SECTIONS; s++)
+    if (s != AsmObject::BSS) object.size[s] = object.bytes[s].size();
+  return true;
+}
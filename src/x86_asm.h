@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 汇编结果：各节的字节、符号表和装载时要回填的 32 位相对地址
+struct AsmObject {
+  enum Section : uint8_t { TEXT, RODATA, DATA, BSS, NUM_SECTIONS, NO_SECTION };
+
+  struct Symbol {
+    Section section;
+    uint32_t offset;
+  };
+  // 在 section 的 offset 处写入 S + addend - P（P 为该处的地址）
+  struct Fixup {
+    Section section;
+    uint32_t offset;
+    std::string symbol;
+    int64_t addend;
+  };
+
+  std::vector<uint8_t> bytes[NUM_SECTIONS];  // BSS 只用 size
+  size_t size[NUM_SECTIONS] = {};
+  uint32_t align[NUM_SECTIONS] = {1, 1, 1, 1};
+  std::unordered_map<std::string, Symbol> symbols;
+  std::vector<Fixup> fixups;
+};
+
+// 进程内汇编器：只认 emitX86 输出的那部分 GNU as（AT&T）语法，
+// 未定义的符号（运行时库函数）留在 fixups 里由装载者解析
+bool assembleX86(std::string_view text, AsmObject &object, std::string &error);